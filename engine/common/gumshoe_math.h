@@ -6,6 +6,14 @@
   Math related structures and functions for the game engine.
 
   @detail
+  Vectors, 4x4 matrices, planes and quaternions for the CPU side, so the
+  culling, physics and animation code doesn't need D3DX. The conventions
+  are D3DX's: matrices are row-major and transform row vectors (v*M), A*B
+  applies A then B, and the layout of a Matrix4_t is a D3DXMATRIX's, so a
+  matrix can be copied from one to the other as 16 floats. The vector
+  types stay plain unaligned floats (Vector4_t is part of vertex layouts),
+  the SSE or NEON paths load and store them unaligned. The batch functions
+  work on one array per component and do four values at a time.
 */
 
 #pragma once
@@ -15,40 +23,155 @@
 //--------------------------------------------
 #include "gumshoe_typedefs.h"
 #include <math.h>
-#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define GUMSHOE_MATH_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GUMSHOE_MATH_NEON 1
+#endif
 
 
 namespace Gumshoe {
 
 //--------------------------------------------
-// RNG Functions
+// Random number generator
 //--------------------------------------------
-int RandomInt(int exclusiveMax)
+// xoshiro256** stream. The state is 32 bytes, seeding never touches the OS
+// entropy pool, and the same seed always produces the same sequence.
+// Use Split() to hand independent streams to parallel consumers.
+class Random
 {
-    std::random_device rd;
-    std::mt19937 mt(rd());
+public:
+	Random(uint64 seed = 0x9E3779B97F4A7C15ULL)
+	{
+		Seed(seed);
+	}
 
-    std::uniform_int_distribution<> dist(0, exclusiveMax - 1);
-    return dist(mt);
-}
- 
-int RandomInt(int min, int max) // inclusive min/max
-{
-    std::random_device rd;
-    std::mt19937 mt(rd());
+	void Seed(uint64 seed)
+	{
+		// Expand the seed with splitmix64 so that similar seeds give unrelated states
+		for (int i = 0; i < 4; i++)
+		{
+			seed += 0x9E3779B97F4A7C15ULL;
+			uint64 z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			m_state[i] = z ^ (z >> 31);
+		}
+	}
 
-    std::uniform_int_distribution<> dist(0, max - min);
-    return dist(mt) + min;
-}
- 
-bool RandomBool(double probability = 0.5)
-{
-    std::random_device rd;
-    std::mt19937 mt(rd());
-    
-    std::bernoulli_distribution dist(probability);
-    return dist(mt);
-}
+	uint64 Next()
+	{
+		uint64 result = RotateLeft(m_state[1] * 5, 7) * 9;
+		uint64 t = m_state[1] << 17;
+
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= t;
+		m_state[3] = RotateLeft(m_state[3], 45);
+
+		return(result);
+	}
+
+	uint32 NextUint32()
+	{
+		return (uint32)(Next() >> 32);
+	}
+
+	// Unbiased value in [0, range) using Lemire's multiply-shift method
+	uint32 NextBounded(uint32 range)
+	{
+		uint64 m = (uint64)NextUint32() * (uint64)range;
+		uint32 low = (uint32)m;
+		if (low < range)
+		{
+			uint32 threshold = (0u - range) % range;
+			while (low < threshold)
+			{
+				m = (uint64)NextUint32() * (uint64)range;
+				low = (uint32)m;
+			}
+		}
+
+		return (uint32)(m >> 32);
+	}
+
+	int RandomInt(int exclusiveMax)
+	{
+		return (int)NextBounded((uint32)exclusiveMax);
+	}
+
+	int RandomInt(int min, int max) // inclusive min/max
+	{
+		return (int)NextBounded((uint32)(max - min) + 1) + min;
+	}
+
+	bool RandomBool(double probability = 0.5)
+	{
+		return RandomDouble() < probability;
+	}
+
+	// Uniform value in [0, 1)
+	float RandomFloat()
+	{
+		return (float)(NextUint32() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	double RandomDouble()
+	{
+		return (double)(Next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	// Advance the stream by 2^128 steps
+	void Jump()
+	{
+		static const uint64 jumpTable[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+		                                     0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+		uint64 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+		for (int i = 0; i < 4; i++)
+		{
+			for (int b = 0; b < 64; b++)
+			{
+				if (jumpTable[i] & (1ULL << b))
+				{
+					s0 ^= m_state[0];
+					s1 ^= m_state[1];
+					s2 ^= m_state[2];
+					s3 ^= m_state[3];
+				}
+				Next();
+			}
+		}
+
+		m_state[0] = s0;
+		m_state[1] = s1;
+		m_state[2] = s2;
+		m_state[3] = s3;
+	}
+
+	// Return the current stream and jump this one ahead, so the two never overlap.
+	// Calling Split() N times in a fixed order gives N deterministic sub-streams.
+	Random Split()
+	{
+		Random result = *this;
+		Jump();
+		return(result);
+	}
+
+private:
+	static uint64 RotateLeft(uint64 x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+private:
+	uint64 m_state[4];
+};
 
 
 //--------------------------------------------
@@ -80,6 +203,67 @@ union Vector3_t
     float e[3];
 };
 
+
+//--------------------------------------------
+// Vector4 type
+//--------------------------------------------
+union Vector4_t
+{
+    struct
+    {
+        float x, y, z, w;
+    };
+    struct
+    {
+        float r, g, b, a;
+    };
+    float e[4];
+};
+
+
+//--------------------------------------------
+// Vector Constructors
+//--------------------------------------------
+inline Vector2_t
+V2(float x, float y)
+{
+    Vector2_t result;
+
+    result.x = x;
+    result.y = y;
+
+    return(result);
+}
+
+inline Vector3_t
+V3(float x, float y, float z)
+{
+    Vector3_t result;
+
+    result.x = x;
+    result.y = y;
+    result.z = z;
+
+    return(result);
+}
+
+inline Vector4_t
+V4(float x, float y, float z, float w)
+{
+    Vector4_t result;
+
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    result.w = w;
+
+    return(result);
+}
+
+
+//--------------------------------------------
+// Vector3 Operators
+//--------------------------------------------
 inline Vector3_t
 operator+(Vector3_t B, float A)
 {
@@ -193,4 +377,871 @@ inline float LengthSq(Vector3_t v1)
     return(result);
 }
 
+inline Vector3_t
+operator-(Vector3_t A)
+{
+    Vector3_t result;
+
+    result.x = -A.x;
+    result.y = -A.y;
+    result.z = -A.z;
+
+    return(result);
+}
+
+
+inline Vector3_t Cross(Vector3_t v1, Vector3_t v2)
+{
+    Vector3_t result;
+
+    result.x = v1.y*v2.z - v1.z*v2.y;
+    result.y = v1.z*v2.x - v1.x*v2.z;
+    result.z = v1.x*v2.y - v1.y*v2.x;
+
+    return(result);
+}
+
+
+inline float Length(Vector3_t v1)
+{
+    float result = SquareRoot(LengthSq(v1));
+
+    return(result);
+}
+
+
+// A zero vector stays zero
+inline Vector3_t Normalize(Vector3_t v1)
+{
+    float length = Length(v1);
+    Vector3_t result = (length > 0.0f) ? (1.0f / length)*v1 : v1;
+
+    return(result);
+}
+
+
+//--------------------------------------------
+// SIMD Lanes
+//--------------------------------------------
+// Four floats in an SSE or NEON register, or in an array without either. A multiply and add is a
+// multiply and then an add, in the same order as the single versions, so the batches round the same.
+#if defined(GUMSHOE_MATH_SSE)
+typedef __m128 Lanes4_t;
+
+inline Lanes4_t LoadLanes(const float* p)                      { return _mm_loadu_ps(p); }
+inline void StoreLanes(float* p, Lanes4_t v)                   { _mm_storeu_ps(p, v); }
+inline Lanes4_t SplatLanes(float s)                            { return _mm_set1_ps(s); }
+inline Lanes4_t AddLanes(Lanes4_t a, Lanes4_t b)               { return _mm_add_ps(a, b); }
+inline Lanes4_t SubLanes(Lanes4_t a, Lanes4_t b)               { return _mm_sub_ps(a, b); }
+inline Lanes4_t MulLanes(Lanes4_t a, Lanes4_t b)               { return _mm_mul_ps(a, b); }
+inline Lanes4_t MulAddLanes(Lanes4_t a, Lanes4_t b, Lanes4_t c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#elif defined(GUMSHOE_MATH_NEON)
+typedef float32x4_t Lanes4_t;
+
+inline Lanes4_t LoadLanes(const float* p)                      { return vld1q_f32(p); }
+inline void StoreLanes(float* p, Lanes4_t v)                   { vst1q_f32(p, v); }
+inline Lanes4_t SplatLanes(float s)                            { return vdupq_n_f32(s); }
+inline Lanes4_t AddLanes(Lanes4_t a, Lanes4_t b)               { return vaddq_f32(a, b); }
+inline Lanes4_t SubLanes(Lanes4_t a, Lanes4_t b)               { return vsubq_f32(a, b); }
+inline Lanes4_t MulLanes(Lanes4_t a, Lanes4_t b)               { return vmulq_f32(a, b); }
+inline Lanes4_t MulAddLanes(Lanes4_t a, Lanes4_t b, Lanes4_t c) { return vaddq_f32(vmulq_f32(a, b), c); }
+#else
+struct Lanes4_t
+{
+    float e[4];
+};
+
+inline Lanes4_t LoadLanes(const float* p)
+{
+    Lanes4_t result;
+    for (int i = 0; i < 4; i++)
+        result.e[i] = p[i];
+    return(result);
+}
+
+inline void StoreLanes(float* p, Lanes4_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = v.e[i];
+}
+
+inline Lanes4_t SplatLanes(float s)
+{
+    Lanes4_t result;
+    for (int i = 0; i < 4; i++)
+        result.e[i] = s;
+    return(result);
+}
+
+inline Lanes4_t AddLanes(Lanes4_t a, Lanes4_t b)
+{
+    for (int i = 0; i < 4; i++)
+        a.e[i] = a.e[i] + b.e[i];
+    return(a);
+}
+
+inline Lanes4_t SubLanes(Lanes4_t a, Lanes4_t b)
+{
+    for (int i = 0; i < 4; i++)
+        a.e[i] = a.e[i] - b.e[i];
+    return(a);
+}
+
+inline Lanes4_t MulLanes(Lanes4_t a, Lanes4_t b)
+{
+    for (int i = 0; i < 4; i++)
+        a.e[i] = a.e[i] * b.e[i];
+    return(a);
+}
+
+inline Lanes4_t MulAddLanes(Lanes4_t a, Lanes4_t b, Lanes4_t c)
+{
+    for (int i = 0; i < 4; i++)
+        c.e[i] = a.e[i] * b.e[i] + c.e[i];
+    return(c);
+}
+#endif
+
+
+//--------------------------------------------
+// Vector4 Operators
+//--------------------------------------------
+inline Vector4_t
+operator+(Vector4_t A, Vector4_t B)
+{
+    Vector4_t result;
+
+    StoreLanes(result.e, AddLanes(LoadLanes(A.e), LoadLanes(B.e)));
+
+    return(result);
+}
+
+inline Vector4_t&
+operator+=(Vector4_t &v1, Vector4_t v2)
+{
+    v1 = v1+v2;
+
+    return(v1);
+}
+
+inline Vector4_t
+operator-(Vector4_t A, Vector4_t B)
+{
+    Vector4_t result;
+
+    StoreLanes(result.e, SubLanes(LoadLanes(A.e), LoadLanes(B.e)));
+
+    return(result);
+}
+
+inline Vector4_t
+operator*(float A, Vector4_t B)
+{
+    Vector4_t result;
+
+    StoreLanes(result.e, MulLanes(SplatLanes(A), LoadLanes(B.e)));
+
+    return(result);
+}
+
+inline Vector4_t
+operator*(Vector4_t B, float A)
+{
+    Vector4_t result = A*B;
+
+    return(result);
+}
+
+inline Vector4_t&
+operator*=(Vector4_t &v1, float s1)
+{
+    v1 = s1*v1;
+
+    return(v1);
+}
+
+
+//--------------------------------------------
+// Vector4 Functions
+//--------------------------------------------
+inline Vector4_t Hadamard(Vector4_t v1, Vector4_t v2)
+{
+    Vector4_t result;
+
+    StoreLanes(result.e, MulLanes(LoadLanes(v1.e), LoadLanes(v2.e)));
+
+    return(result);
+}
+
+
+inline float Inner(Vector4_t v1, Vector4_t v2)
+{
+    float result = v1.x*v2.x + v1.y*v2.y + v1.z*v2.z + v1.w*v2.w;
+
+    return(result);
+}
+
+
+inline float LengthSq(Vector4_t v1)
+{
+    float result = Inner(v1, v1);
+
+    return(result);
+}
+
+
+inline float Length(Vector4_t v1)
+{
+    float result = SquareRoot(LengthSq(v1));
+
+    return(result);
+}
+
+
+inline Vector4_t Normalize(Vector4_t v1)
+{
+    float length = Length(v1);
+    Vector4_t result = (length > 0.0f) ? (1.0f / length)*v1 : v1;
+
+    return(result);
+}
+
+
+//--------------------------------------------
+// Matrix4 type
+//--------------------------------------------
+// Row-major like a D3DXMATRIX, row 3 holds the translation
+union Matrix4_t
+{
+    struct
+    {
+        float _11, _12, _13, _14;
+        float _21, _22, _23, _24;
+        float _31, _32, _33, _34;
+        float _41, _42, _43, _44;
+    };
+    float m[4][4];
+    float e[16];
+    Vector4_t row[4];
+};
+
+
+//--------------------------------------------
+// Matrix4 Constructors
+//--------------------------------------------
+inline Matrix4_t
+Matrix4Identity()
+{
+    Matrix4_t result = {};
+
+    result._11 = 1.0f;
+    result._22 = 1.0f;
+    result._33 = 1.0f;
+    result._44 = 1.0f;
+
+    return(result);
+}
+
+inline Matrix4_t
+Matrix4Translation(float x, float y, float z)
+{
+    Matrix4_t result = Matrix4Identity();
+
+    result._41 = x;
+    result._42 = y;
+    result._43 = z;
+
+    return(result);
+}
+
+inline Matrix4_t
+Matrix4Scaling(float x, float y, float z)
+{
+    Matrix4_t result = {};
+
+    result._11 = x;
+    result._22 = y;
+    result._33 = z;
+    result._44 = 1.0f;
+
+    return(result);
+}
+
+// Angles are in radians, clockwise looking down the axis towards the origin
+inline Matrix4_t
+Matrix4RotationX(float angle)
+{
+    Matrix4_t result = Matrix4Identity();
+    float c = cosf(angle);
+    float s = sinf(angle);
+
+    result._22 = c;
+    result._23 = s;
+    result._32 = -s;
+    result._33 = c;
+
+    return(result);
+}
+
+inline Matrix4_t
+Matrix4RotationY(float angle)
+{
+    Matrix4_t result = Matrix4Identity();
+    float c = cosf(angle);
+    float s = sinf(angle);
+
+    result._11 = c;
+    result._13 = -s;
+    result._31 = s;
+    result._33 = c;
+
+    return(result);
+}
+
+inline Matrix4_t
+Matrix4RotationZ(float angle)
+{
+    Matrix4_t result = Matrix4Identity();
+    float c = cosf(angle);
+    float s = sinf(angle);
+
+    result._11 = c;
+    result._12 = s;
+    result._21 = -s;
+    result._22 = c;
+
+    return(result);
+}
+
+// Looking from eye towards at, for a left handed view
+inline Matrix4_t
+Matrix4LookAtLH(Vector3_t eye, Vector3_t at, Vector3_t up)
+{
+    Matrix4_t result;
+    Vector3_t zAxis = Normalize(at - eye);
+    Vector3_t xAxis = Normalize(Cross(up, zAxis));
+    Vector3_t yAxis = Cross(zAxis, xAxis);
+
+    result._11 = xAxis.x;  result._12 = yAxis.x;  result._13 = zAxis.x;  result._14 = 0.0f;
+    result._21 = xAxis.y;  result._22 = yAxis.y;  result._23 = zAxis.y;  result._24 = 0.0f;
+    result._31 = xAxis.z;  result._32 = yAxis.z;  result._33 = zAxis.z;  result._34 = 0.0f;
+    result._41 = -Inner(xAxis, eye);
+    result._42 = -Inner(yAxis, eye);
+    result._43 = -Inner(zAxis, eye);
+    result._44 = 1.0f;
+
+    return(result);
+}
+
+// Left handed projection, depth goes from 0 at the near plane to 1 at the far plane
+inline Matrix4_t
+Matrix4PerspectiveFovLH(float fovY, float aspect, float zNear, float zFar)
+{
+    Matrix4_t result = {};
+    float yScale = 1.0f / tanf(0.5f*fovY);
+
+    result._11 = yScale / aspect;
+    result._22 = yScale;
+    result._33 = zFar / (zFar - zNear);
+    result._34 = 1.0f;
+    result._43 = -zNear*zFar / (zFar - zNear);
+
+    return(result);
+}
+
+inline Matrix4_t
+Matrix4OrthoLH(float width, float height, float zNear, float zFar)
+{
+    Matrix4_t result = {};
+
+    result._11 = 2.0f / width;
+    result._22 = 2.0f / height;
+    result._33 = 1.0f / (zFar - zNear);
+    result._43 = zNear / (zNear - zFar);
+    result._44 = 1.0f;
+
+    return(result);
+}
+
+
+//--------------------------------------------
+// Matrix4 Operators
+//--------------------------------------------
+// Every row of the result is a row of A times B, built from B's rows scaled by A's elements
+inline Matrix4_t
+operator*(const Matrix4_t& A, const Matrix4_t& B)
+{
+    Matrix4_t result;
+    Lanes4_t b0 = LoadLanes(B.m[0]);
+    Lanes4_t b1 = LoadLanes(B.m[1]);
+    Lanes4_t b2 = LoadLanes(B.m[2]);
+    Lanes4_t b3 = LoadLanes(B.m[3]);
+
+    for (int i = 0; i < 4; i++)
+    {
+        Lanes4_t row = MulLanes(SplatLanes(A.m[i][0]), b0);
+        row = MulAddLanes(SplatLanes(A.m[i][1]), b1, row);
+        row = MulAddLanes(SplatLanes(A.m[i][2]), b2, row);
+        row = MulAddLanes(SplatLanes(A.m[i][3]), b3, row);
+        StoreLanes(result.m[i], row);
+    }
+
+    return(result);
+}
+
+inline Matrix4_t&
+operator*=(Matrix4_t &m1, const Matrix4_t& m2)
+{
+    m1 = m1*m2;
+
+    return(m1);
+}
+
+
+//--------------------------------------------
+// Matrix4 Functions
+//--------------------------------------------
+inline Vector4_t Transform(Vector4_t v1, const Matrix4_t& m1)
+{
+    Vector4_t result;
+
+    Lanes4_t row = MulLanes(SplatLanes(v1.x), LoadLanes(m1.m[0]));
+    row = MulAddLanes(SplatLanes(v1.y), LoadLanes(m1.m[1]), row);
+    row = MulAddLanes(SplatLanes(v1.z), LoadLanes(m1.m[2]), row);
+    row = MulAddLanes(SplatLanes(v1.w), LoadLanes(m1.m[3]), row);
+    StoreLanes(result.e, row);
+
+    return(result);
+}
+
+
+// A point, w is 1 and the result is divided by its w like D3DXVec3TransformCoord
+inline Vector3_t TransformCoord(Vector3_t v1, const Matrix4_t& m1)
+{
+    Vector4_t transformed = Transform(V4(v1.x, v1.y, v1.z, 1.0f), m1);
+    float inverseW = (transformed.w != 0.0f) ? 1.0f / transformed.w : 1.0f;
+    Vector3_t result = V3(transformed.x*inverseW, transformed.y*inverseW, transformed.z*inverseW);
+
+    return(result);
+}
+
+
+// A direction, w is 0 so the translation doesn't apply
+inline Vector3_t TransformNormal(Vector3_t v1, const Matrix4_t& m1)
+{
+    Vector4_t transformed = Transform(V4(v1.x, v1.y, v1.z, 0.0f), m1);
+    Vector3_t result = V3(transformed.x, transformed.y, transformed.z);
+
+    return(result);
+}
+
+
+inline Matrix4_t Transpose(const Matrix4_t& m1)
+{
+    Matrix4_t result;
+
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            result.m[i][j] = m1.m[j][i];
+
+    return(result);
+}
+
+
+// Cofactors from the 2x2 determinants of the top and bottom halves, false when the matrix
+// has no inverse
+inline bool Inverse(const Matrix4_t& m1, Matrix4_t& result)
+{
+    const float (*a)[4] = m1.m;
+
+    float s0 = a[0][0]*a[1][1] - a[1][0]*a[0][1];
+    float s1 = a[0][0]*a[1][2] - a[1][0]*a[0][2];
+    float s2 = a[0][0]*a[1][3] - a[1][0]*a[0][3];
+    float s3 = a[0][1]*a[1][2] - a[1][1]*a[0][2];
+    float s4 = a[0][1]*a[1][3] - a[1][1]*a[0][3];
+    float s5 = a[0][2]*a[1][3] - a[1][2]*a[0][3];
+
+    float c5 = a[2][2]*a[3][3] - a[3][2]*a[2][3];
+    float c4 = a[2][1]*a[3][3] - a[3][1]*a[2][3];
+    float c3 = a[2][1]*a[3][2] - a[3][1]*a[2][2];
+    float c2 = a[2][0]*a[3][3] - a[3][0]*a[2][3];
+    float c1 = a[2][0]*a[3][2] - a[3][0]*a[2][2];
+    float c0 = a[2][0]*a[3][1] - a[3][0]*a[2][1];
+
+    float determinant = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+    if (determinant == 0.0f || !(fabsf(determinant) < INFINITY))
+    {
+        return false;
+    }
+
+    float inverseDeterminant = 1.0f / determinant;
+
+    result.m[0][0] = ( a[1][1]*c5 - a[1][2]*c4 + a[1][3]*c3) * inverseDeterminant;
+    result.m[0][1] = (-a[0][1]*c5 + a[0][2]*c4 - a[0][3]*c3) * inverseDeterminant;
+    result.m[0][2] = ( a[3][1]*s5 - a[3][2]*s4 + a[3][3]*s3) * inverseDeterminant;
+    result.m[0][3] = (-a[2][1]*s5 + a[2][2]*s4 - a[2][3]*s3) * inverseDeterminant;
+
+    result.m[1][0] = (-a[1][0]*c5 + a[1][2]*c2 - a[1][3]*c1) * inverseDeterminant;
+    result.m[1][1] = ( a[0][0]*c5 - a[0][2]*c2 + a[0][3]*c1) * inverseDeterminant;
+    result.m[1][2] = (-a[3][0]*s5 + a[3][2]*s2 - a[3][3]*s1) * inverseDeterminant;
+    result.m[1][3] = ( a[2][0]*s5 - a[2][2]*s2 + a[2][3]*s1) * inverseDeterminant;
+
+    result.m[2][0] = ( a[1][0]*c4 - a[1][1]*c2 + a[1][3]*c0) * inverseDeterminant;
+    result.m[2][1] = (-a[0][0]*c4 + a[0][1]*c2 - a[0][3]*c0) * inverseDeterminant;
+    result.m[2][2] = ( a[3][0]*s4 - a[3][1]*s2 + a[3][3]*s0) * inverseDeterminant;
+    result.m[2][3] = (-a[2][0]*s4 + a[2][1]*s2 - a[2][3]*s0) * inverseDeterminant;
+
+    result.m[3][0] = (-a[1][0]*c3 + a[1][1]*c1 - a[1][2]*c0) * inverseDeterminant;
+    result.m[3][1] = ( a[0][0]*c3 - a[0][1]*c1 + a[0][2]*c0) * inverseDeterminant;
+    result.m[3][2] = (-a[3][0]*s3 + a[3][1]*s1 - a[3][2]*s0) * inverseDeterminant;
+    result.m[3][3] = ( a[2][0]*s3 - a[2][1]*s1 + a[2][2]*s0) * inverseDeterminant;
+
+    return true;
+}
+
+
+//--------------------------------------------
+// Plane type
+//--------------------------------------------
+// ax + by + cz + d = 0, the normal (a, b, c) points to the inside
+union Plane_t
+{
+    struct
+    {
+        float a, b, c, d;
+    };
+    float e[4];
+};
+
+
+//--------------------------------------------
+// Plane Functions
+//--------------------------------------------
+inline Plane_t
+PlaneFromPointNormal(Vector3_t point, Vector3_t normal)
+{
+    Plane_t result;
+
+    result.a = normal.x;
+    result.b = normal.y;
+    result.c = normal.z;
+    result.d = -Inner(normal, point);
+
+    return(result);
+}
+
+// Scales the plane so its normal has unit length, the distances then come out in world units
+inline Plane_t PlaneNormalize(Plane_t p1)
+{
+    Plane_t result = p1;
+    float length = SquareRoot(p1.a*p1.a + p1.b*p1.b + p1.c*p1.c);
+
+    if (length > 0.0f)
+    {
+        result.a = p1.a / length;
+        result.b = p1.b / length;
+        result.c = p1.c / length;
+        result.d = p1.d / length;
+    }
+
+    return(result);
+}
+
+// Signed distance of a point from a normalized plane, negative on the outside
+inline float PlaneDotCoord(Plane_t p1, Vector3_t v1)
+{
+    float result = p1.a*v1.x + p1.b*v1.y + p1.c*v1.z + p1.d;
+
+    return(result);
+}
+
+inline float PlaneDotNormal(Plane_t p1, Vector3_t v1)
+{
+    float result = p1.a*v1.x + p1.b*v1.y + p1.c*v1.z;
+
+    return(result);
+}
+
+
+//--------------------------------------------
+// Quaternion type
+//--------------------------------------------
+// A rotation, (x, y, z) is the axis scaled by the sine of half the angle and w is the cosine
+union Quaternion_t
+{
+    struct
+    {
+        float x, y, z, w;
+    };
+    float e[4];
+};
+
+
+//--------------------------------------------
+// Quaternion Constructors
+//--------------------------------------------
+inline Quaternion_t
+QuaternionIdentity()
+{
+    Quaternion_t result;
+
+    result.x = 0.0f;
+    result.y = 0.0f;
+    result.z = 0.0f;
+    result.w = 1.0f;
+
+    return(result);
+}
+
+// The same rotation as Matrix4RotationX/Y/Z for the unit axes
+inline Quaternion_t
+QuaternionRotationAxis(Vector3_t axis, float angle)
+{
+    Quaternion_t result;
+    Vector3_t unitAxis = Normalize(axis);
+    float s = sinf(0.5f*angle);
+
+    result.x = unitAxis.x*s;
+    result.y = unitAxis.y*s;
+    result.z = unitAxis.z*s;
+    result.w = cosf(0.5f*angle);
+
+    return(result);
+}
+
+
+//--------------------------------------------
+// Quaternion Operators
+//--------------------------------------------
+// Like the matrices A*B rotates by A and then by B, which is the product B*A of the quaternions
+inline Quaternion_t
+operator*(Quaternion_t A, Quaternion_t B)
+{
+    Quaternion_t result;
+
+    result.x = B.w*A.x + B.x*A.w + B.y*A.z - B.z*A.y;
+    result.y = B.w*A.y - B.x*A.z + B.y*A.w + B.z*A.x;
+    result.z = B.w*A.z + B.x*A.y - B.y*A.x + B.z*A.w;
+    result.w = B.w*A.w - B.x*A.x - B.y*A.y - B.z*A.z;
+
+    return(result);
+}
+
+
+//--------------------------------------------
+// Quaternion Functions
+//--------------------------------------------
+inline float Inner(Quaternion_t q1, Quaternion_t q2)
+{
+    float result = q1.x*q2.x + q1.y*q2.y + q1.z*q2.z + q1.w*q2.w;
+
+    return(result);
+}
+
+
+inline Quaternion_t Normalize(Quaternion_t q1)
+{
+    Quaternion_t result = QuaternionIdentity();
+    float length = SquareRoot(Inner(q1, q1));
+
+    if (length > 0.0f)
+    {
+        float inverseLength = 1.0f / length;
+        for (int i = 0; i < 4; i++)
+            result.e[i] = q1.e[i]*inverseLength;
+    }
+
+    return(result);
+}
+
+
+// The opposite rotation of a unit quaternion
+inline Quaternion_t Conjugate(Quaternion_t q1)
+{
+    Quaternion_t result;
+
+    result.x = -q1.x;
+    result.y = -q1.y;
+    result.z = -q1.z;
+    result.w = q1.w;
+
+    return(result);
+}
+
+
+// Roll around z first, then pitch around x and yaw around y, like Matrix4RotationYawPitchRoll
+inline Quaternion_t QuaternionRotationYawPitchRoll(float yaw, float pitch, float roll)
+{
+    Quaternion_t result = QuaternionRotationAxis(V3(0.0f, 0.0f, 1.0f), roll) *
+                          QuaternionRotationAxis(V3(1.0f, 0.0f, 0.0f), pitch) *
+                          QuaternionRotationAxis(V3(0.0f, 1.0f, 0.0f), yaw);
+
+    return(result);
+}
+
+
+inline Vector3_t Rotate(Vector3_t v1, Quaternion_t q1)
+{
+    // v + 2w(u x v) + 2u x (u x v), with u the vector part
+    Vector3_t u = V3(q1.x, q1.y, q1.z);
+    Vector3_t t = 2.0f*Cross(u, v1);
+    Vector3_t result = v1 + q1.w*t + Cross(u, t);
+
+    return(result);
+}
+
+
+// Takes the short way round, and blends straight across when the two are almost the same
+inline Quaternion_t Slerp(Quaternion_t q1, Quaternion_t q2, float t)
+{
+    Quaternion_t result;
+    float cosine = Inner(q1, q2);
+    float sign = 1.0f;
+    float scale1 = 1.0f - t;
+    float scale2 = t;
+
+    if (cosine < 0.0f)
+    {
+        cosine = -cosine;
+        sign = -1.0f;
+    }
+
+    if (cosine < 0.9995f)
+    {
+        float angle = acosf(cosine);
+        float inverseSine = 1.0f / sinf(angle);
+        scale1 = sinf((1.0f - t)*angle)*inverseSine;
+        scale2 = sinf(t*angle)*inverseSine;
+    }
+
+    for (int i = 0; i < 4; i++)
+        result.e[i] = scale1*q1.e[i] + sign*scale2*q2.e[i];
+
+    return(Normalize(result));
+}
+
+
+inline Matrix4_t
+Matrix4RotationQuaternion(Quaternion_t q1)
+{
+    Matrix4_t result = Matrix4Identity();
+    float xx = q1.x*q1.x, yy = q1.y*q1.y, zz = q1.z*q1.z;
+    float xy = q1.x*q1.y, xz = q1.x*q1.z, yz = q1.y*q1.z;
+    float wx = q1.w*q1.x, wy = q1.w*q1.y, wz = q1.w*q1.z;
+
+    result._11 = 1.0f - 2.0f*(yy + zz);
+    result._12 = 2.0f*(xy + wz);
+    result._13 = 2.0f*(xz - wy);
+    result._21 = 2.0f*(xy - wz);
+    result._22 = 1.0f - 2.0f*(xx + zz);
+    result._23 = 2.0f*(yz + wx);
+    result._31 = 2.0f*(xz + wy);
+    result._32 = 2.0f*(yz - wx);
+    result._33 = 1.0f - 2.0f*(xx + yy);
+
+    return(result);
+}
+
+
+// Roll around z first, then pitch around x and yaw around y
+inline Matrix4_t
+Matrix4RotationYawPitchRoll(float yaw, float pitch, float roll)
+{
+    Matrix4_t result = Matrix4RotationZ(roll) * Matrix4RotationX(pitch) * Matrix4RotationY(yaw);
+
+    return(result);
+}
+
+
+//--------------------------------------------
+// Batch Functions
+//--------------------------------------------
+// One array per component, four values at a time and the rest one by one, each worked out in the
+// same order as the single version.
+
+// Points with w = 1 through the matrix, outW can be null when the matrix has no projection
+inline void TransformPoints(const Matrix4_t& m1, const float* x, const float* y, const float* z, uint32 count,
+                            float* outX, float* outY, float* outZ, float* outW)
+{
+    uint32 i = 0;
+
+    Lanes4_t m[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            m[r][c] = SplatLanes(m1.m[r][c]);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        Lanes4_t px = LoadLanes(x + i);
+        Lanes4_t py = LoadLanes(y + i);
+        Lanes4_t pz = LoadLanes(z + i);
+
+        StoreLanes(outX + i, AddLanes(MulAddLanes(pz, m[2][0], MulAddLanes(py, m[1][0], MulLanes(px, m[0][0]))), m[3][0]));
+        StoreLanes(outY + i, AddLanes(MulAddLanes(pz, m[2][1], MulAddLanes(py, m[1][1], MulLanes(px, m[0][1]))), m[3][1]));
+        StoreLanes(outZ + i, AddLanes(MulAddLanes(pz, m[2][2], MulAddLanes(py, m[1][2], MulLanes(px, m[0][2]))), m[3][2]));
+        if (outW)
+            StoreLanes(outW + i, AddLanes(MulAddLanes(pz, m[2][3], MulAddLanes(py, m[1][3], MulLanes(px, m[0][3]))), m[3][3]));
+    }
+
+    for (; i < count; i++)
+    {
+        Vector4_t transformed = Transform(V4(x[i], y[i], z[i], 1.0f), m1);
+        outX[i] = transformed.x;
+        outY[i] = transformed.y;
+        outZ[i] = transformed.z;
+        if (outW)
+            outW[i] = transformed.w;
+    }
+
+    return;
+}
+
+
+inline void DotProducts(const float* ax, const float* ay, const float* az, const float* bx, const float* by, const float* bz,
+                        uint32 count, float* out)
+{
+    uint32 i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        Lanes4_t dot = MulLanes(LoadLanes(ax + i), LoadLanes(bx + i));
+        dot = MulAddLanes(LoadLanes(ay + i), LoadLanes(by + i), dot);
+        dot = MulAddLanes(LoadLanes(az + i), LoadLanes(bz + i), dot);
+        StoreLanes(out + i, dot);
+    }
+
+    for (; i < count; i++)
+    {
+        out[i] = Inner(V3(ax[i], ay[i], az[i]), V3(bx[i], by[i], bz[i]));
+    }
+
+    return;
+}
+
+
+// Signed distances of the points from one plane
+inline void PlaneDistances(Plane_t p1, const float* x, const float* y, const float* z, uint32 count, float* out)
+{
+    uint32 i = 0;
+    Lanes4_t a = SplatLanes(p1.a);
+    Lanes4_t b = SplatLanes(p1.b);
+    Lanes4_t c = SplatLanes(p1.c);
+    Lanes4_t d = SplatLanes(p1.d);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        Lanes4_t distance = MulLanes(LoadLanes(x + i), a);
+        distance = MulAddLanes(LoadLanes(y + i), b, distance);
+        distance = MulAddLanes(LoadLanes(z + i), c, distance);
+        StoreLanes(out + i, AddLanes(distance, d));
+    }
+
+    for (; i < count; i++)
+    {
+        out[i] = PlaneDotCoord(p1, V3(x[i], y[i], z[i]));
+    }
+
+    return;
+}
+
 } // end of namespace Gumshoe
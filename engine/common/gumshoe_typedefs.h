@@ -13,7 +13,9 @@
 //--------------------------------------------
 // Includes
 //--------------------------------------------
+#if BUILD_WIN32
 #include <windows.h>
+#endif
 #include <stdint.h>
 #include <stddef.h>
 
@@ -15,7 +15,6 @@
 //--------------------------------------------
 #include "gumshoe_typedefs.h"
 #include "gumshoe_math.h"
-#include "physics_movement.h"
 #include <d3dx10math.h>
 
 // MOVEMENT SPEED
@@ -20,21 +20,11 @@
 #include "gumshoe_intrinsics.h"
 //#include "physics_aabb.h"
 //#include "physics_movement.h"
+#include "physics_tile_collider.h"
+#include "entity_store.h"
 #include "model.h"
 #include "dungeon_world.h"
 
-// MOVEMENT SPEED
-// 0.75 - 1.25 for crouching/walking
-// 2.5 - 3 m/s for jogging
-// 10 - 12 m/s for sprinting
-const float WALK_SPEED = 1.0f;
-const float JOG_SPEED  = 2.75f;
-const float SPRINT_SPEED = 10.0f;
-
-const float PLAYER_ACCEL = 1.0f;
-const float JUMP_ACCEL = 0.5f;
-const float GRAVITY_ACCEL = 9.8f;
-
 // MOVEMENT EQUATIONS
 // p_new = 1/2*a*t^2 + v*t + p_old
 // v_new = a*t + v_old
@@ -61,6 +51,7 @@ public:
 	void GetRotation(Vector3_t&);
 
 	void Move(ID3D11Device*, Vector3_t, GameWorld*, float);
+	void UpdateModel(ID3D11Device*);
 	void Rotate(Vector3_t, float);
 
 	void SetOnGround(bool);
@@ -68,10 +59,6 @@ public:
 	int GetIndexCount();
 	ID3D11ShaderResourceView* GetTexture();
 
-	// Temporary collision functions
-	// These will be moved into the Physics objects later on
-	bool TestFloorCollision(Vector3_t, Vector3_t, float*);
-
 private:
 	Vector3_t m_position, m_rotation;
 	float m_maxVelocity;
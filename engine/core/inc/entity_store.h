@@ -0,0 +1,128 @@
+/*!
+  @file
+  entity_store.h
+
+  @brief
+  Structure of arrays storage and movement for large numbers of entities.
+
+  @detail
+  Enemies and projectiles don't need their own model or heap object, only a
+  box that moves. The store keeps every component in its own packed array,
+  so one tick integrates the whole store in a single pass, four (SSE) or
+  eight (AVX) entities at a time: the drag, gravity, velocity and the move
+  for the tick. Moves are then swept through the tile collider one entity
+  at a time, or added straight to the positions when there is no collider.
+  Entities are packed at the front of the arrays, removing one moves the
+  last entity into its place, and ids stay the same while entities move
+  around in the arrays. The movement is the same as Entity::Move.
+  The positions from before the last update are kept too, so rendering can
+  blend between the last two fixed steps.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include "gumshoe_math.h"
+#include "physics_tile_collider.h"
+#include <vector>
+
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+// MOVEMENT SPEED
+// 0.75 - 1.25 for crouching/walking
+// 2.5 - 3 m/s for jogging
+// 10 - 12 m/s for sprinting
+const float WALK_SPEED = 1.0f;
+const float JOG_SPEED  = 2.75f;
+const float SPRINT_SPEED = 10.0f;
+
+const float PLAYER_ACCEL = 1.0f;
+const float JUMP_ACCEL = 0.5f;
+const float GRAVITY_ACCEL = 9.8f;
+
+// Drag takes this times the velocity off the acceleration, and the move acceleration is scaled by
+// the ground drag so that it balances out at the entity's speed
+const float GROUND_DRAG = 8.0f;
+const float AIR_DRAG = 5.0f;
+const float JUMP_SCALE = 20.0f;
+
+const uint32 ENTITY_STORE_NONE = 0xFFFFFFFF; // no entity, returned when the store is full
+
+
+namespace Gumshoe {
+
+//--------------------------------------------
+// EntityStore class definition
+//--------------------------------------------
+class EntityStore
+{
+public:
+	// Work done since the stats were last reset
+	struct storeStats_t
+	{
+		uint64 updates;
+		uint64 entitiesMoved;
+		uint64 contacts;          // entities that hit a wall or the ground
+	};
+
+public:
+	EntityStore();
+	~EntityStore();
+
+	bool Init(uint32);
+	void Shutdown();
+	void Clear();
+
+	uint32 Add(Vector3_t, Vector3_t, float = WALK_SPEED);
+	bool Remove(uint32);
+
+	void SetMoveAccel(uint32, Vector3_t);
+	void SetOnGround(uint32, bool);
+	void SetPosition(uint32, Vector3_t);
+	void SetVelocity(uint32, Vector3_t);
+	bool GetPosition(uint32, Vector3_t&);
+	bool GetVelocity(uint32, Vector3_t&);
+	bool GetRenderPosition(uint32, float, Vector3_t&);
+	void GetRenderPositions(float, float*, float*, float*);
+
+	void Update(float, Physics::TileCollider*);
+
+	// Packed arrays, entity i of GetCount() has id GetIds()[i]
+	uint32 GetCount();
+	const uint32* GetIds();
+	const float* GetPositionsX();
+	const float* GetPositionsY();
+	const float* GetPositionsZ();
+
+	const storeStats_t& GetStats();
+	void ResetStats();
+
+private:
+	void Integrate(float);
+	void ApplyMoves(Physics::TileCollider*);
+
+private:
+	uint32 m_count;
+	std::vector<uint32> m_ids;       // id of every packed entity
+	std::vector<uint32> m_indices;   // packed index of every id, ENTITY_STORE_NONE when the id is free
+	std::vector<uint32> m_freeIds;
+
+	// Per packed entity
+	std::vector<float> m_positionX, m_positionY, m_positionZ;
+	std::vector<float> m_previousX, m_previousY, m_previousZ; // positions before the last update
+	std::vector<float> m_velocityX, m_velocityY, m_velocityZ;
+	std::vector<float> m_accelX, m_accelY, m_accelZ; // what the entity is trying to do, without drag and gravity
+	std::vector<float> m_moveX, m_moveY, m_moveZ;    // this tick's move before collision
+	std::vector<float> m_drag;
+	std::vector<float> m_speed;
+	std::vector<Vector3_t> m_halfSize;
+
+	storeStats_t m_stats;
+};
+
+} // end of namespace Gumshoe
@@ -6,15 +6,28 @@
   Create a view frustum and check if objects are in it.
 
   @detail
+  The planes are kept one array per component, so the batched box test can
+  load a plane into every lane and check four (SSE) or eight (AVX) boxes at
+  once. Boxes are tested with their centre and extents against the plane's
+  most positive corner, which is one dot product per plane instead of eight.
+  Hierarchies test a box against only the planes its parent straddled, with
+  the plane that rejected it last time first, and count the tests made and
+  skipped until the frustum is constructed again for the next frame.
+  Nothing here needs DirectX, the matrices are plain row-major floats.
 */
 
 #pragma once
 
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const int FRUSTUM_PLANES = 6;
+const int FRUSTUM_ALL_PLANES = (1 << FRUSTUM_PLANES) - 1; // plane mask of a box nothing is known about
+
 //--------------------------------------------
 // Includes
 //--------------------------------------------
 #include "gumshoe_typedefs.h"
-#include <d3dx10math.h>
 
 
 namespace Gumshoe {
@@ -24,19 +37,45 @@ namespace Gumshoe {
 //--------------------------------------------
 class Frustum
 {
+public:
+	// Axis aligned boxes for the batched test, one array per component
+	struct boxArrays_t
+	{
+		const float* centerX;
+		const float* centerY;
+		const float* centerZ;
+		const float* extentX; // half sizes
+		const float* extentY;
+		const float* extentZ;
+	};
+
+	// Plane tests since the frustum was constructed
+	struct cullStats_t
+	{
+		uint32 boxes;
+		uint32 planeTests;
+		uint32 planesSkipped; // planes a parent was already fully inside of
+		uint32 cachedRejects; // boxes rejected by the plane that rejected them last time
+	};
+
 public:
 	Frustum();
 	~Frustum();
 
-	void ConstructFrustum(float, D3DXMATRIX, D3DXMATRIX);
+	void ConstructFrustum(float, const float*, const float*);
 
 	bool CheckPoint(float, float, float);
 	bool CheckCube(float, float, float, float);
 	bool CheckSphere(float, float, float, float);
 	bool CheckRectangle(float, float, float, float, float, float);
+	uint32 CheckRectangles(const boxArrays_t&, uint32, uint32*);
+	bool CheckRectangleMasked(float, float, float, float, float, float, uint32&, uint8&);
+	const cullStats_t& GetCullStats();
 
 private:
-	D3DXPLANE m_planes[6];
+	float m_planeA[FRUSTUM_PLANES], m_planeB[FRUSTUM_PLANES], m_planeC[FRUSTUM_PLANES], m_planeD[FRUSTUM_PLANES];
+	float m_absA[FRUSTUM_PLANES], m_absB[FRUSTUM_PLANES], m_absC[FRUSTUM_PLANES]; // picks the corner furthest along the normal
+	cullStats_t m_cullStats;
 };
 
-} // end of namespace Gumshoe
\ No newline at end of file
+} // end of namespace Gumshoe
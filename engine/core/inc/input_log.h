@@ -0,0 +1,107 @@
+/*!
+  @file
+  input_log.h
+
+  @brief
+  Records the input for every simulation step so a session can be replayed.
+
+  @detail
+  The simulation only depends on the world it started in and the input it
+  got on each fixed step, so the log is a header (seed, floor and where it
+  was built, step time, where the player started) and one input per step. Most steps have the
+  same buttons held as the step before and no mouse movement, and those
+  are only counted. A step that changes something is written as the count
+  of quiet steps before it, its buttons, and the look movement as zigzag
+  varints when there is any. An hour at 60 steps a second of ordinary play
+  is a few hundred kilobytes, and holding a key down costs nothing.
+  Taking the stairs, or walking far enough that the floor is built again
+  further on, starts a new log on the new floor.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include <vector>
+
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const uint32 INPUT_LOG_MAGIC = 0x314C4947; // "GIL1"
+const uint32 INPUT_LOG_VERSION = 2;
+
+
+namespace Gumshoe {
+
+//--------------------------------------------
+// InputLog class definition
+//--------------------------------------------
+class InputLog
+{
+public:
+	enum Button
+	{
+		ButtonForward	= (1<<0),
+		ButtonBack		= (1<<1),
+		ButtonLeft		= (1<<2),
+		ButtonRight		= (1<<3),
+		ButtonJump		= (1<<4)
+	};
+
+	// The input for one simulation step
+	struct simInput_t
+	{
+		uint8 buttons;
+		int16 lookX, lookY;       // mouse movement since the last step
+	};
+
+	// Everything needed to start the simulation where the session started
+	struct logHeader_t
+	{
+		uint64 seed;
+		uint32 floor;
+		uint32 stepCount;
+		float stepMs;
+		float spawnX, spawnY, spawnZ;
+		int32 windowX, windowZ; // dungeon tile at the floor's 0,0
+	};
+
+public:
+	InputLog();
+	~InputLog();
+
+	void Begin(const logHeader_t&);
+	void Record(const simInput_t&);
+
+	bool Save(const char*);
+	bool Load(const char*);
+
+	void StartReplay();
+	bool Replay(simInput_t&);
+
+	const logHeader_t& GetHeader();
+	uint32 GetSize();
+
+private:
+	void WriteVarint(uint32);
+	uint32 ReadVarint();
+
+private:
+	logHeader_t m_header;
+	std::vector<uint8> m_data;
+
+	// Recording
+	uint8 m_lastButtons;
+	uint32 m_quietSteps;
+
+	// Replaying
+	uint32 m_readPosition;
+	uint32 m_readStep;
+	uint32 m_readQuietSteps;
+	uint8 m_heldButtons;
+};
+
+} // end of namespace Gumshoe
@@ -0,0 +1,101 @@
+/*!
+  @file
+  job_pool.h
+
+  @brief
+  Work-stealing thread pool for the game engine.
+
+  @detail
+  Every worker owns a job queue. A worker runs its own jobs newest first and,
+  when it runs dry, steals the oldest job from another queue.
+  Jobs submitted from outside the pool go to a shared queue that every worker
+  steals from. Wait() runs jobs on the calling thread as well, so a pool with
+  no workers still makes progress.
+  Jobs can also be submitted against a JobCounter and waited on as a group,
+  which lets a job fan out work of its own without waiting on the whole pool.
+*/
+
+#pragma once
+
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Gumshoe {
+
+typedef void (*JobFunction)(void*);
+typedef std::atomic<uint32> JobCounter; // jobs of a group that haven't finished
+
+
+//--------------------------------------------
+// JobPool class definition
+//--------------------------------------------
+class JobPool
+{
+public:
+	struct jobStats_t
+	{
+		uint64 jobsRun;
+		uint64 jobsStolen;
+	};
+
+private:
+	struct job_t
+	{
+		JobFunction function;
+		void* data;
+		JobCounter* counter;
+	};
+
+	struct jobQueue_t
+	{
+		std::mutex lock;
+		std::deque<job_t> jobs;
+	};
+
+public:
+	JobPool();
+	~JobPool();
+
+	bool Init(int);
+	void Shutdown();
+
+	void Submit(JobFunction, void*, JobCounter* = nullptr);
+	void Wait();
+	void Wait(JobCounter&);
+
+	int GetWorkerCount();
+	jobStats_t GetStats();
+
+private:
+	void WorkerLoop(int);
+	int GetQueueIndex();
+	bool RunJob(int);
+	bool PopJob(int, job_t&);
+	bool StealJob(int, job_t&);
+
+private:
+	std::vector<jobQueue_t*> m_queues; // queue 0 is shared, queue i+1 belongs to worker i
+	std::vector<std::thread> m_workers;
+
+	std::atomic<bool> m_running;
+	std::atomic<uint32> m_queuedJobs;  // submitted but not started
+	std::atomic<uint32> m_pendingJobs; // submitted but not finished
+	std::atomic<uint64> m_jobsRun;
+	std::atomic<uint64> m_jobsStolen;
+
+	std::mutex m_sleepLock;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_allDone;
+};
+
+} // end of namespace Gumshoe
@@ -6,6 +6,15 @@
   Part of the physics engine to create bounding-boxes.
 
   @detail
+  A collider is an axis aligned box or an upright capsule, standing on its
+  position the way entities stand on theirs: the position is the centre of
+  the bottom, and the shape goes up by its height from there. A capsule is
+  a vertical segment with a radius, its height includes both round ends.
+  Collide is the narrow phase between two colliders, it finds the direction
+  to push them apart and how far they overlap. Boxes and capsules meet the
+  dungeon grid through their bounds, walls are full height columns over the
+  cells of their thin tops so only a capsule brushing a wall's corner is
+  pushed a little further than it would be by the round shape.
 */
 
 #pragma once
@@ -26,23 +35,48 @@ namespace Physics {
 // AABB class definition
 //--------------------------------------------
 class AABB {
+public:
+	enum Type
+	{
+		BoxCollider		= 0,
+		CapsuleCollider	= 1
+	};
+
+	// Where two colliders touch, the normal points from the first one to the second
+	struct contact_t
+	{
+		Vector3_t normal;
+		float depth;
+	};
+
 public:
 	AABB();
 	~AABB();
 
 	void SetType(uint32);
     void SetPosition(Vector3_t*);
+    void SetSize(Vector3_t);
     void SetHeight(float);
 	void SetRadius(float);
 
-	uint32 GetType();
-    Vector3_t GetPosition();
-    float GetHeight();
-	float GetRadius();
+	uint32 GetType() const;
+    Vector3_t GetPosition() const;
+    Vector3_t GetSize() const;
+    float GetHeight() const;
+	float GetRadius() const;
+	void GetBounds(Vector3_t&, Vector3_t&) const;
+
+	static bool Collide(const AABB&, const AABB&, contact_t&);
+
+private:
+	static bool CollideBoxes(const AABB&, const AABB&, contact_t&);
+	static bool CollideCapsules(const AABB&, const AABB&, contact_t&);
+	static bool CollideBoxCapsule(const AABB&, const AABB&, contact_t&);
 
 private:
 	Vector3_t m_position;
-	float m_height, m_radius;
+	Vector3_t m_size; // full width, height and depth, a capsule is two radii wide
+	float m_radius;
 	uint32 m_aabbType;
 };
 
@@ -6,6 +6,20 @@
   Part of the physics engine to control object movement.
 
   @detail
+  Movement owns a pool of rigid bodies, each one a collider with a mass,
+  a velocity and the forces pushed on it since the last step. Bodies are
+  packed into one array per component and stepped together:
+    - velocities take the forces, gravity and drag, then every moving body
+      is swept through the dungeon grid by the tile collider, so it stops
+      at walls and the floor and slides along them
+    - the spatial hash, filed by the bodies' ids, finds the pairs whose
+      bounds overlap on the ground plane
+    - the colliders of each pair are tested, and overlapping bodies are
+      pushed apart by their inverse masses and lose the velocity they had
+      into each other (through the tile collider again, so a push can't
+      put a body into a wall)
+  Static bodies never move and push everything else. Ids stay the same
+  while bodies move around in the arrays.
 */
 
 #pragma once
@@ -15,7 +29,19 @@
 //--------------------------------------------
 #include "gumshoe_typedefs.h"
 #include "gumshoe_math.h"
-#include <math.h>
+#include "physics_aabb.h"
+#include "physics_tile_collider.h"
+#include "spatial_hash.h"
+#include <vector>
+
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const uint32 PHYSICS_NO_BODY = 0xFFFFFFFF;      // returned when the pool is full
+const float PHYSICS_CELL_SIZE = 2.0f;           // broad phase cell, a couple of bodies across
+const uint32 PHYSICS_ITERATIONS = 2;            // passes over the contacts each step
+const float PHYSICS_GRAVITY = -9.8f;
 
 
 namespace Gumshoe {
@@ -26,21 +52,108 @@ namespace Physics {
 // Movement class definition
 //--------------------------------------------
 class Movement {
+public:
+	enum BodyFlags
+	{
+		BodyStatic		= (1<<0),   // never moves, pushes everything else
+		BodyNoGravity	= (1<<1)
+	};
+
+	// How to make a body, the shape's position is where it starts
+	struct bodyDesc_t
+	{
+		AABB shape;
+		Vector3_t velocity;
+		float mass;
+		float drag;               // takes this times the velocity off each second
+		uint32 flags;
+	};
+
+	// Two bodies touching, by id, the normal points from the first to the second
+	struct bodyContact_t
+	{
+		uint32 first, second;
+		Vector3_t normal;
+		float depth;
+	};
+
+	// Work done since the stats were last reset
+	struct physicsStats_t
+	{
+		uint64 steps;
+		uint64 bodiesMoved;
+		uint64 gridContacts;      // bodies that hit a wall, standing on the floor doesn't count
+		uint64 broadPairs;        // pairs the broad phase handed to the narrow phase
+		uint64 contacts;          // pairs that really touched
+	};
+
 public:
 	Movement();
 	~Movement();
 
-	void Move(Vector3_t*, Vector3_t, float);
-    void Rotate(Vector3_t*, Vector3_t, float);
+	bool Init(uint32, TileCollider* = nullptr, float = PHYSICS_CELL_SIZE);
+	void Shutdown();
+	void Clear();
 
-	void SetVelocity(float);
-	void SetAngularVelocity(float);
+	uint32 CreateBody(const bodyDesc_t&);
+	bool DestroyBody(uint32);
 
-	float GetVelocity();
-	float GetAngularVelocity();
+	void SetPosition(uint32, Vector3_t);
+	void SetVelocity(uint32, Vector3_t);
+	void AddForce(uint32, Vector3_t);
+	bool GetPosition(uint32, Vector3_t&);
+	bool GetVelocity(uint32, Vector3_t&);
+	bool GetShape(uint32, AABB&);
+	uint32 GetGridContacts(uint32);
+
+	void SetGravity(float);
+	void SetRestitution(float);
+	void SetIterations(uint32);
+
+	void Step(float);
+	uint32 FindContacts(std::vector<bodyContact_t>&);
+	const std::vector<bodyContact_t>& GetContacts();
+
+	// Packed arrays, body i of GetBodyCount() has id GetIds()[i]
+	uint32 GetBodyCount();
+	const uint32* GetIds();
+	const float* GetPositionsX();
+	const float* GetPositionsY();
+	const float* GetPositionsZ();
+
+	const physicsStats_t& GetStats();
+	void ResetStats();
 
 private:
-	float m_linearAccel, m_angularAccel;
+	void Integrate(float);
+	void MoveThroughGrid(uint32, Vector3_t);
+	void SolveContacts();
+	void BuildShape(uint32, AABB&);
+
+private:
+	TileCollider* m_grid;         // can be null, then only the floor at y = 0 stops bodies
+	SpatialHash m_broadPhase;
+	float m_gravity, m_restitution;
+	uint32 m_iterations;
+
+	uint32 m_count;
+	std::vector<uint32> m_ids;       // id of every packed body
+	std::vector<uint32> m_indices;   // packed index of every id, PHYSICS_NO_BODY when the id is free
+	std::vector<uint32> m_freeIds;
+
+	// Per packed body
+	std::vector<float> m_positionX, m_positionY, m_positionZ;
+	std::vector<float> m_velocityX, m_velocityY, m_velocityZ;
+	std::vector<float> m_forceX, m_forceY, m_forceZ;
+	std::vector<float> m_inverseMass, m_drag;
+	std::vector<float> m_sizeX, m_sizeY, m_sizeZ, m_radius;
+	std::vector<uint8> m_shapeType;
+	std::vector<uint32> m_flags;
+	std::vector<uint32> m_gridContacts;
+
+	std::vector<SpatialHash::entityPair_t> m_pairs;
+	std::vector<bodyContact_t> m_contacts;
+	physicsStats_t m_stats;
 };
 
 } // end of namespace Physics
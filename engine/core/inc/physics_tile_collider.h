@@ -0,0 +1,94 @@
+/*!
+  @file
+  physics_tile_collider.h
+
+  @brief
+  Part of the physics engine to collide boxes with the tile grid.
+
+  @detail
+  Solid tiles are columns one tile wide that go up forever, and the ground
+  is the y = 0 plane. A moving box is swept across the grid one tile edge
+  at a time (a DDA on the box's leading faces), so only the row or column
+  of tiles the box is about to enter is looked at, and fast boxes can't
+  tunnel through thin walls. The box stops the skin short of the first
+  solid tile it meets, also when the move itself would end closer, the
+  blocked part of the move is dropped and the rest slides along the wall,
+  so one move can touch a wall on each axis and the ground.
+  The grid is one byte per tile, read directly, with no calls per tile.
+  A grid can also split each tile into cells, so walls thinner than a tile
+  collide where they are drawn. The sweep then runs on the cell edges,
+  positions and moves stay in tiles, and SetSolid and IsSolid take cells.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const float TILE_COLLIDER_SKIN = 0.001f; // gap left between a box and the wall it stopped at
+const float TILE_COLLIDER_MIN_MOVE = 1.0e-6f; // smaller moves along an axis are dropped, like the velocity left over from drag
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include "gumshoe_math.h"
+#include <vector>
+
+
+namespace Gumshoe {
+
+namespace Physics {
+
+//--------------------------------------------
+// TileCollider class definition
+//--------------------------------------------
+class TileCollider {
+public:
+	// What a move ran into
+	enum Contact
+	{
+		ContactX		= (1<<0),
+		ContactZ		= (1<<1),
+		ContactGround	= (1<<2)
+	};
+
+	// Work done since the stats were last reset
+	struct sweepStats_t
+	{
+		uint64 moves;
+		uint64 sweeps;            // one per slide
+		uint64 tilesTested;
+		uint64 contacts;
+	};
+
+public:
+	TileCollider();
+	~TileCollider();
+
+	bool Init(const uint8*, int, int, int = 1);
+	void Shutdown();
+
+	void SetSolid(int, int, bool);
+	bool IsSolid(int, int);
+	bool IsBoxClear(Vector3_t, Vector3_t);
+
+	uint32 MoveBox(Vector3_t&, Vector3_t&, Vector3_t, Vector3_t);
+
+	const sweepStats_t& GetStats();
+	void ResetStats();
+
+private:
+	float SweepBox(const float*, const float*, const float*, int&, float&);
+	bool IsSolidTile(int, int);
+
+private:
+	int m_length, m_width; // in cells
+	float m_cellsPerTile;
+	std::vector<uint8> m_solid; // row-major, outside the grid is solid
+	sweepStats_t m_stats;
+};
+
+} // end of namespace Physics
+
+} // end of namespace Gumshoe
@@ -7,6 +7,22 @@
 
   @detail
   Quad trees are used to determine which areas of the world are viewable.
+  The tree is built on the CPU from any indexed triangle mesh. Each node's
+  triangle list is split between its children in one pass, so building
+  touches every triangle a constant number of times per level. Big subtrees
+  can be built in parallel on a JobPool.
+  The finished tree is one array of nodes in breadth first order, so the
+  children of a node sit next to each other. Leaves own a range of one shared
+  index array, and the whole tree can be saved to and loaded from a file.
+  Height queries go through a uniform grid of ground triangles, so a lookup
+  only tests the few triangles that overlap one cell.
+  Culling and drawing are separate passes: Cull writes the visible leaves as
+  ranges of the index array, joining leaves that sit next to each other, and
+  Submit draws a range list. Culling needs no DirectX and can run ahead of
+  the frame that draws its list.
+  UpdateTriangles patches a built tree when part of the mesh changes. Only
+  the nodes and grid cells the changed triangles touch are visited, and a
+  node that runs out of room moves its range to the end of the index array.
 */
 
 #pragma once
@@ -15,15 +31,27 @@
 // Globals
 //--------------------------------------------
 const int MAX_TRIANGLES = 10000;
+const int QUADTREE_MAX_DEPTH = 16; // stops splitting when triangles pile up on one spot
+const int QUADTREE_JOB_TRIANGLES = 65536; // nodes with more triangles build their children as jobs
+const int QUADTREE_FILE_MAGIC = 0x52545147; // "GQTR"
+const int QUADTREE_FILE_VERSION = 3;
+const int QUADTREE_MAX_GROUND_CELLS = 4096; // along each side of the height grid
+const int QUADTREE_HEIGHT_JOB_QUERIES = 4096; // batched height queries per job
+const float QUADTREE_GROUND_PADDING = 0.01f; // grows triangle bounds when binning them into the height grid
+const int QUADTREE_GROW_TRIANGLES = 16; // least room a node gets when an update outgrows its range
 
 //--------------------------------------------
 // Includes
 //--------------------------------------------
 #include "gumshoe_typedefs.h"
 #include "gumshoe_math.h"
-#include "escape_world.h"
+#include "job_pool.h"
 #include "frustum.h"
+#include <unordered_map>
+#include <vector>
+#if BUILD_WIN32
 #include "shader.h"
+#endif
 
 namespace Gumshoe {
 
@@ -32,50 +60,177 @@ namespace Gumshoe {
 //--------------------------------------------
 class QuadTree
 {
-private:
-	struct vertex_t
+public:
+	struct buildStats_t
+	{
+		uint32 nodes;
+		uint32 leaves;
+		uint32 maxDepth;
+		uint64 leafTriangles;     // triangles across the edge of a leaf are in each leaf they touch
+		uint64 trianglesTested;   // containment tests made while building
+		uint32 groundCells;       // along each side of the height grid
+		uint64 groundTriangles;   // height grid entries, triangles are in each cell they touch
+	};
+
+	// A run of the index buffer to draw, one or more visible leaves
+	struct drawRange_t
 	{
-		D3DXVECTOR3 position;
-		D3DXVECTOR4 texture;
-		D3DXVECTOR3 normal;
-		D3DXVECTOR4 color;
+		uint32 firstIndex, indexCount;
 	};
 
+	struct updateStats_t
+	{
+		uint32 removedTriangles;
+		uint32 addedTriangles;
+		uint32 nodesVisited;
+		uint32 movedNodes;        // nodes whose range outgrew its room
+	};
+
+	struct visibilityStats_t
+	{
+		uint32 nodesTested;
+		uint32 visibleLeaves;
+		uint32 drawRanges;        // after joining neighbouring leaves
+		uint32 triangles;
+	};
+
+private:
+	// A node of the finished tree, this is also its layout on disk
 	struct node_t
+	{
+		float positionX, positionZ, width;
+		uint32 firstChild, childCount; // children are next to each other in the node array
+		uint32 firstIndex, triangleCount, triangleCapacity; // range of the shared index array, leaves and nodes patched by updates
+	};
+
+	struct fileHeader_t
+	{
+		uint32 magic, version;
+		uint32 triangleCount;
+		uint32 nodeCount, vertexCount, indexCount;
+		uint32 groundCells, groundIndexCount;
+		float groundMinX, groundMinZ, groundCellSize;
+	};
+
+	struct triangleBounds_t
+	{
+		float minX, maxX;
+		float minZ, maxZ;
+	};
+
+	// A node while the tree is being built
+	struct buildNode_t
 	{
         float positionX, positionZ, width;
-		int triangleCount;
-		ID3D11Buffer *vertexBuffer, *indexBuffer;
-		Vector3_t* vertexArray;
-        node_t* nodes[4];
+		std::vector<uint32> triangles; // mesh triangle numbers, leaves only
+        buildNode_t* nodes[4];
+	};
+
+	// A node an updated triangle may be in
+	struct nodeTriangle_t
+	{
+		uint32 node, triangle;
+	};
+
+	struct heightJob_t
+	{
+		QuadTree* tree;
+		const Vector2_t* positions;
+		float* heights;
+		bool* found;
+		uint32 count, foundCount;
+	};
+
+	struct buildJob_t
+	{
+		QuadTree* tree;
+		buildNode_t* node;
+		float positionX, positionZ, width;
+		int depth;
+		std::vector<uint32> triangles;
+		JobPool* jobPool;
 	};
 
 public:
 	QuadTree();
 	~QuadTree();
 
-	bool Init(GameWorld*, ID3D11Device*);
+	bool Init(const Vector3_t*, uint32, uint32, const uint32*, uint32, JobPool* = nullptr);
 	void Shutdown();
+	bool Save(const char*);
+	bool Load(const char*);
+	bool UpdateTriangles(const Vector3_t*, uint32, uint32, const uint32*, const uint32*, uint32, uint32, uint32);
+#if BUILD_WIN32
+	bool InitBuffers(ID3D11Device*);
+	bool UpdateBuffers(ID3D11Device*, ID3D11DeviceContext*);
 	void Render(Frustum*, ID3D11DeviceContext*, Shader*);
+	void Submit(const std::vector<drawRange_t>&, ID3D11DeviceContext*, Shader*);
+#endif
 
+	uint32 Cull(Frustum*, std::vector<drawRange_t>&);
+	const visibilityStats_t& GetVisibilityStats();
+	const updateStats_t& GetUpdateStats();
 	int GetDrawCount();
 	bool GetHeightAtPosition(float, float, float&);
+	uint32 GetHeightsAtPositions(const Vector2_t*, uint32, float*, bool*, JobPool* = nullptr);
+	const buildStats_t& GetBuildStats();
 
 private:
-	void CalculateMeshDimensions(int, float&, float&, float&);
-	void CreateTreeNode(node_t*, float, float, float, ID3D11Device*);
-	int CountTriangles(float, float, float);
-	bool IsTriangleContained(int, float, float, float);
-	void ReleaseNode(node_t*);
-	void RenderNode(node_t*, Frustum*, ID3D11DeviceContext*, Shader*);
-
-	void FindNode(node_t*, float, float, float&);
+	void CalculateMeshDimensions(float&, float&, float&);
+	void CreateTreeNode(buildNode_t*, float, float, float, int, std::vector<uint32>&, JobPool*);
+	static void CreateTreeNodeJob(void*);
+	void FlattenTree(buildNode_t*);
+	void ReleaseNode(buildNode_t*);
+	void CountNodes();
+	void BuildGroundGrid();
+	int GetGroundCell(float, float);
+	uint32 GetHeights(const Vector2_t*, uint32, float*, bool*);
+	static void GetHeightsJob(void*);
+	bool IsGroundTriangle(uint32, uint32, uint32);
+	bool CheckGroundTriangle(float, float, const uint32*, float&);
+	void GetTriangleBounds(const uint32*, triangleBounds_t&);
+	void FindTriangleNodes(uint32, const triangleBounds_t&, uint32, std::vector<nodeTriangle_t>&);
+	void RemoveNodeTriangles(uint32, const uint32*, nodeTriangle_t*, uint32, std::vector<uint8>&);
+	void AddNodeTriangle(uint32, const triangleBounds_t&, const uint32*);
+	void AppendNodeTriangle(uint32, const uint32*);
+	void RemoveGroundTriangle(const triangleBounds_t&, const uint32*);
+	void AddGroundTriangle(const triangleBounds_t&, const uint32*);
+	void CompactGroundGrid();
+	void MarkIndicesDirty(uint32, uint32);
+	void CullNode(uint32, uint32, Frustum*, std::vector<drawRange_t>&);
+
 	bool CheckHeightOfTriangle(float, float, float&, float[3], float[3], float[3]);
 
 private:
 	int m_triangleCount, m_drawCount;
-	vertex_t* m_vertexList;
-	node_t* m_rootNode;
+	std::vector<node_t> m_nodes; // breadth first, the root is node 0
+	std::vector<Vector3_t> m_positions;
+	std::vector<uint32> m_leafIndices; // the triangles of every leaf, leaf by leaf
+	std::vector<uint8> m_lastFailedPlanes; // per node, the frustum plane that culled it last frame
+
+	// Height grid over the root square: the ground triangles (not walls) touching each cell, in mesh order
+	float m_groundMinX, m_groundMinZ, m_groundCellSize;
+	int m_groundCells;
+	std::vector<uint32> m_groundCellStarts; // first ground index of every cell, plus the total
+	std::vector<uint32> m_groundIndices; // triangles removed by updates have their first index set to ~0
+	std::unordered_map<uint32, std::vector<uint32>> m_groundAdded; // triangles added by updates, by cell
+	bool m_groundPatched;
+#if BUILD_WIN32
+	ID3D11Buffer* m_indexBuffer;
+	std::vector<drawRange_t> m_drawRanges; // Render's own list, kept to reuse its memory
+	uint32 m_indexBufferCount;
+#endif
+	visibilityStats_t m_visibilityStats;
+	updateStats_t m_updateStats;
+	uint32 m_dirtyFirstIndex, m_dirtyLastIndex; // part of the index array changed since the last upload
+	std::vector<nodeTriangle_t> m_nodeTriangles; // scratch for updates
+
+	// Only used while building
+	std::vector<uint32> m_indices;
+	std::vector<triangleBounds_t> m_triangleBounds;
+
+	std::atomic<uint64> m_trianglesTested;
+	buildStats_t m_buildStats;
 };
 
 } // end of namespace Gumshoe
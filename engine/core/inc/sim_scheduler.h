@@ -0,0 +1,75 @@
+/*!
+  @file
+  sim_scheduler.h
+
+  @brief
+  Runs the simulation in fixed steps, whatever the frame rate is.
+
+  @detail
+  Every frame's time goes into an accumulator, and the simulation takes as
+  many whole steps as fit in it. Physics then sees the same step time on
+  every tick, so a session plays out the same at any frame rate and can be
+  replayed from its input alone. A frame can only catch up so many steps,
+  after a long stall (a breakpoint, loading a floor) the rest of the time
+  is dropped instead of the simulation spiralling further behind. What is
+  left in the accumulator, as a fraction of a step, is how far rendering
+  should blend from the previous step's state to the current one.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const float SIM_STEP_MS = 1000.0f / 60.0f;
+const uint32 SIM_MAX_STEPS_PER_FRAME = 5; // catch up at most this many steps in one frame
+
+
+namespace Gumshoe {
+
+//--------------------------------------------
+// SimScheduler class definition
+//--------------------------------------------
+class SimScheduler
+{
+public:
+	// Work done since the stats were last reset
+	struct schedulerStats_t
+	{
+		uint64 frames;
+		uint64 steps;
+		uint64 clampedFrames;     // frames that hit the catch-up limit
+		double droppedMs;         // time thrown away by those frames
+	};
+
+public:
+	SimScheduler();
+	~SimScheduler();
+
+	bool Init(float = SIM_STEP_MS, uint32 = SIM_MAX_STEPS_PER_FRAME);
+	void Reset();
+
+	uint32 Advance(float);
+
+	float GetStepTime();
+	float GetAlpha();
+	uint64 GetStepCount();
+
+	const schedulerStats_t& GetStats();
+	void ResetStats();
+
+private:
+	float m_stepMs;
+	uint32 m_maxSteps;
+	float m_accumulator;
+	uint64 m_stepCount;
+	schedulerStats_t m_stats;
+};
+
+} // end of namespace Gumshoe
@@ -0,0 +1,98 @@
+/*!
+  @file
+  spatial_hash.h
+
+  @brief
+  Broad phase for entity against entity queries.
+
+  @detail
+  Entities are boxes on the ground plane, filed under the square cell their
+  centre is in. Cells are hashed into a fixed table of buckets, so the world
+  needs no bounds and an empty cell costs nothing. Each bucket is a linked
+  list threaded through per entity arrays, which makes insert, remove and a
+  move to another cell constant time. MoveEntities takes a whole tick of
+  positions at once and only relinks the entities that changed cell.
+  Queries visit the cells a box could reach, widened by the biggest entity,
+  and skip entities from other cells that share a bucket.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const int SPATIAL_HASH_BUCKETS_PER_ENTITY = 2; // default table size, most lists then hold one cell's entities
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include <vector>
+
+
+namespace Gumshoe {
+
+//--------------------------------------------
+// SpatialHash class definition
+//--------------------------------------------
+class SpatialHash
+{
+public:
+	// Two entities whose boxes overlap, the lower id first
+	struct entityPair_t
+	{
+		uint32 first, second;
+	};
+
+	// Work done since the stats were last reset
+	struct hashStats_t
+	{
+		uint64 moves;
+		uint64 cellChanges;       // moves that relinked the entity
+		uint64 cellsVisited;
+		uint64 entitiesTested;    // box tests made by queries
+	};
+
+public:
+	SpatialHash();
+	~SpatialHash();
+
+	bool Init(float, uint32, uint32 = 0);
+	void Shutdown();
+
+	bool Insert(uint32, float, float, float);
+	bool Remove(uint32);
+	bool Move(uint32, float, float);
+	void MoveEntities(const uint32*, const float*, const float*, uint32);
+
+	uint32 Query(float, float, float, float, std::vector<uint32>&);
+	uint32 FindPairs(std::vector<entityPair_t>&);
+
+	uint32 GetEntityCount();
+	float GetCellSize();
+	const hashStats_t& GetStats();
+	void ResetStats();
+
+private:
+	int GetCell(float);
+	uint32 GetBucket(int, int);
+	void Link(uint32, int, int);
+	void Unlink(uint32);
+
+private:
+	float m_cellSize, m_inverseCellSize;
+	float m_maxExtent; // biggest half size inserted, queries reach this far into neighbouring cells
+	uint32 m_bucketMask;
+	uint32 m_entityCount;
+	std::vector<uint32> m_buckets; // first entity of every bucket
+
+	// Per entity id
+	std::vector<float> m_positionX, m_positionZ, m_extent;
+	std::vector<int> m_cellX, m_cellZ;
+	std::vector<uint32> m_next, m_previous;
+	std::vector<uint8> m_inserted;
+
+	hashStats_t m_stats;
+};
+
+} // end of namespace Gumshoe
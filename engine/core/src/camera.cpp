@@ -12,7 +12,6 @@
 // Includes
 //--------------------------------------------
 #include "camera.h"
-#include "physics_movement.cpp"
 
 
 namespace Gumshoe {
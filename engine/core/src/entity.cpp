@@ -147,31 +147,6 @@ void Entity::GetRotation(Vector3_t& outRotation)
 }
 
 
-bool Entity::TestFloorCollision(Vector3_t oldPos, Vector3_t posDelta, float *tMin)
-{
-    bool hit = false;
-    float tEpsilon = 0.00001f;
-    
-    // Get the final postion based on the old position and the delta
-    float newYPos = oldPos.y + posDelta.y;
-
-    if (newYPos < 0.0f)
-    {
-        // Now find where along that vector the collision was
-        float tResult = (-oldPos.y) / posDelta.y;
-        
-        // Only use the result if this collision is closer than another one
-        if((tResult >= 0.0f) && (*tMin > tResult))
-        {
-            *tMin = Maximum(0.0f, tResult - tEpsilon);
-            hit = true;
-        }
-    }
-
-    return hit;
-}
-
-
 void Entity::Move(ID3D11Device* device, Vector3_t moveAccel, GameWorld* gameWorld, float frameTime)
 {
     // CHANGE MOVE_BITMASK TO V3 inAccel
@@ -193,24 +168,24 @@ void Entity::Move(ID3D11Device* device, Vector3_t moveAccel, GameWorld* gameWorl
         accelVec *= (1.0f / SquareRoot(accelLength));
     }
 
-    // Twiddle factor for movment speed (8.0 is used to combat the drag for movement)
-    float entitySpeed = WALK_SPEED*8.0f;
+    // Twiddle factor for movment speed (scaled by the ground drag to combat the drag for movement)
+    float entitySpeed = WALK_SPEED*GROUND_DRAG;
     accelVec *= entitySpeed;
 
     // TODO(ebd): ODE here!
     if (m_groundDragEn)
     {
-        accelVec.x += -8.0f*m_velocity.x;
-        accelVec.z += -8.0f*m_velocity.z;  
+        accelVec.x += -GROUND_DRAG*m_velocity.x;
+        accelVec.z += -GROUND_DRAG*m_velocity.z;
     }
     else
     {
-        accelVec.x += -5.0f*m_velocity.x;
-        accelVec.z += -5.0f*m_velocity.z;
+        accelVec.x += -AIR_DRAG*m_velocity.x;
+        accelVec.z += -AIR_DRAG*m_velocity.z;
     }
 
     // Now add in the y acceleration value
-    accelVec.y = moveAccel.y*entitySpeed*20.0f;
+    accelVec.y = moveAccel.y*entitySpeed*JUMP_SCALE;
 
     // Add gravity
     accelVec.y -= GRAVITY_ACCEL;
@@ -224,58 +199,14 @@ void Entity::Move(ID3D11Device* device, Vector3_t moveAccel, GameWorld* gameWorl
     // m_Collider->CollisionTest(&position, &rotation);  // This should return a bool for if there was a collision or not
     
     // Do the movement internally for now
-    Vector3_t oldPosition = m_position;
     Vector3_t positionDelta = (0.5f*accelVec*Square(dt) + m_velocity*dt);
     
     m_velocity = accelVec*dt + m_velocity;
-    m_position = oldPosition + positionDelta;
-
-    // Do minkowski based collision here
-    // First get a list of game map tiles to search through
-/*
-    uint32 minTileX = FloorFloattoUint32(Minimum(m_position.x, oldPosition.x) - m_aabb.x/2);
-    uint32 maxTileX = FloorFloattoUint32(Maximum(m_position.x, oldPosition.x) + m_aabb.x/2);
-    uint32 minTileZ = FloorFloattoUint32(Minimum(m_position.z, oldPosition.z) - m_aabb.z/2);
-    uint32 maxTileZ = FloorFloattoUint32(Maximum(m_position.z, oldPosition.z) + m_aabb.z/2);
-*/
-    uint32 minTileX = FloorFloattoUint32(Minimum(m_position.x, oldPosition.x));
-    uint32 maxTileX = FloorFloattoUint32(Maximum(m_position.x, oldPosition.x));
-    uint32 minTileZ = FloorFloattoUint32(Minimum(m_position.z, oldPosition.z));
-    uint32 maxTileZ = FloorFloattoUint32(Maximum(m_position.z, oldPosition.z));
-
-    // Set the time remaining on the search to 1.0
-    // We use this to find where the collision was along the movement vector
-    float tMin = 1.0f;
-    Vector3_t collisionNormal = {0.0f, 0.0f, 0.0f};
-    bool floorCollision = false;
-
-    // Test each tile in the search space
-    for (uint32 tileX = minTileX; tileX <= maxTileX; tileX++)
-    {
-        for (uint32 tileZ = minTileZ; tileZ <= maxTileZ; tileZ++)
-        {
-            // Get the normal for the current tile (is it a wall or floor or neither)
-            collisionNormal = gameWorld->GetTileNormal(tileX, tileZ);
-
-            // Get the current tile value, and if there is a valid tile then do collision there
-            if (collisionNormal.y == 1.0f)
-            {
-                if (TestFloorCollision(oldPosition, positionDelta, &tMin))
-                {
-                    collisionNormal = {0.0f, 1.0f, 0.0f};
-                    floorCollision = true;
-                }     
-            } 
-        }
-    }
-
-    if (!floorCollision)
-        collisionNormal = {0.0f, 0.0f, 0.0f};
 
-    // Now update the entity position based on the output of the collision detection
-    // Update the timeRemaining using tMin
-    m_position.y = oldPosition.y + tMin*positionDelta.y;
-    m_velocity = m_velocity - 1*Inner(m_velocity, collisionNormal)*collisionNormal;
+    // Sweep the bounding box through the tiles it passes, it stops at walls and the floor
+    // and slides along them, and the velocity into whatever it hit is removed
+    Vector3_t halfSize = 0.5f*m_aabb;
+    gameWorld->GetCollider()->MoveBox(m_position, m_velocity, halfSize, positionDelta);
 
 /*
     if (m_position.y < 0)
@@ -290,6 +221,13 @@ void Entity::Move(ID3D11Device* device, Vector3_t moveAccel, GameWorld* gameWorl
 }
 
 
+void Entity::UpdateModel(ID3D11Device* device)
+{
+    // Move the model to wherever the entity was placed for this frame
+    m_Model->UpdatePosition(device, m_position);
+}
+
+
 void Entity::Rotate(Vector3_t inRotate, float frameTime)
 {
     m_rotation.x += inRotate.x/2;
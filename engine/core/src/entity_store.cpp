@@ -0,0 +1,514 @@
+/*!
+  @file
+  entity_store.cpp
+
+  @brief
+  Structure of arrays storage and movement for large numbers of entities.
+
+  @detail
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "entity_store.h"
+#include "gumshoe_intrinsics.h"
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define ENTITY_STORE_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define ENTITY_STORE_SIMD_WIDTH 4
+#else
+#define ENTITY_STORE_SIMD_WIDTH 1
+#endif
+
+
+namespace Gumshoe {
+
+EntityStore::EntityStore()
+{
+	m_count = 0;
+	m_stats = {};
+}
+
+
+EntityStore::~EntityStore()
+{
+}
+
+
+bool EntityStore::Init(uint32 maxEntities)
+{
+	if (maxEntities == 0 || maxEntities == ENTITY_STORE_NONE)
+	{
+		return false;
+	}
+
+	m_ids.assign(maxEntities, 0);
+	m_indices.assign(maxEntities, ENTITY_STORE_NONE);
+
+	m_positionX.assign(maxEntities, 0.0f);
+	m_positionY.assign(maxEntities, 0.0f);
+	m_positionZ.assign(maxEntities, 0.0f);
+	m_previousX.assign(maxEntities, 0.0f);
+	m_previousY.assign(maxEntities, 0.0f);
+	m_previousZ.assign(maxEntities, 0.0f);
+	m_velocityX.assign(maxEntities, 0.0f);
+	m_velocityY.assign(maxEntities, 0.0f);
+	m_velocityZ.assign(maxEntities, 0.0f);
+	m_accelX.assign(maxEntities, 0.0f);
+	m_accelY.assign(maxEntities, 0.0f);
+	m_accelZ.assign(maxEntities, 0.0f);
+	m_moveX.assign(maxEntities, 0.0f);
+	m_moveY.assign(maxEntities, 0.0f);
+	m_moveZ.assign(maxEntities, 0.0f);
+	m_drag.assign(maxEntities, GROUND_DRAG);
+	m_speed.assign(maxEntities, WALK_SPEED);
+	m_halfSize.assign(maxEntities, Vector3_t());
+
+	Clear();
+	m_stats = {};
+
+	return true;
+}
+
+
+void EntityStore::Shutdown()
+{
+	m_ids.clear();
+	m_indices.clear();
+	m_freeIds.clear();
+
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_previousX.clear();
+	m_previousY.clear();
+	m_previousZ.clear();
+	m_velocityX.clear();
+	m_velocityY.clear();
+	m_velocityZ.clear();
+	m_accelX.clear();
+	m_accelY.clear();
+	m_accelZ.clear();
+	m_moveX.clear();
+	m_moveY.clear();
+	m_moveZ.clear();
+	m_drag.clear();
+	m_speed.clear();
+	m_halfSize.clear();
+	m_count = 0;
+
+	return;
+}
+
+
+void EntityStore::Clear()
+{
+	uint32 maxEntities = (uint32)m_indices.size();
+
+
+	// Hand the lowest ids out first
+	m_freeIds.resize(maxEntities);
+	for (uint32 i = 0; i < maxEntities; i++)
+	{
+		m_freeIds[i] = maxEntities - 1 - i;
+		m_indices[i] = ENTITY_STORE_NONE;
+	}
+	m_count = 0;
+
+	return;
+}
+
+
+uint32 EntityStore::Add(Vector3_t position, Vector3_t halfSize, float speed)
+{
+	if (m_freeIds.empty())
+	{
+		return ENTITY_STORE_NONE;
+	}
+
+	uint32 id = m_freeIds.back();
+	uint32 index = m_count++;
+	m_freeIds.pop_back();
+
+	m_ids[index] = id;
+	m_indices[id] = index;
+
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	m_previousX[index] = position.x;
+	m_previousY[index] = position.y;
+	m_previousZ[index] = position.z;
+	m_velocityX[index] = 0.0f;
+	m_velocityY[index] = 0.0f;
+	m_velocityZ[index] = 0.0f;
+	m_accelX[index] = 0.0f;
+	m_accelY[index] = 0.0f;
+	m_accelZ[index] = 0.0f;
+	m_drag[index] = GROUND_DRAG;
+	m_speed[index] = speed;
+	m_halfSize[index] = halfSize;
+
+	return id;
+}
+
+
+bool EntityStore::Remove(uint32 id)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == ENTITY_STORE_NONE)
+	{
+		return false;
+	}
+
+	// Keep the arrays packed by moving the last entity into the hole
+	uint32 index = m_indices[id];
+	uint32 last = --m_count;
+
+	if (index != last)
+	{
+		m_ids[index] = m_ids[last];
+		m_indices[m_ids[index]] = index;
+
+		m_positionX[index] = m_positionX[last];
+		m_positionY[index] = m_positionY[last];
+		m_positionZ[index] = m_positionZ[last];
+		m_previousX[index] = m_previousX[last];
+		m_previousY[index] = m_previousY[last];
+		m_previousZ[index] = m_previousZ[last];
+		m_velocityX[index] = m_velocityX[last];
+		m_velocityY[index] = m_velocityY[last];
+		m_velocityZ[index] = m_velocityZ[last];
+		m_accelX[index] = m_accelX[last];
+		m_accelY[index] = m_accelY[last];
+		m_accelZ[index] = m_accelZ[last];
+		m_drag[index] = m_drag[last];
+		m_speed[index] = m_speed[last];
+		m_halfSize[index] = m_halfSize[last];
+	}
+
+	m_indices[id] = ENTITY_STORE_NONE;
+	m_freeIds.push_back(id);
+
+	return true;
+}
+
+
+void EntityStore::SetMoveAccel(uint32 id, Vector3_t moveAccel)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == ENTITY_STORE_NONE)
+		return;
+
+	uint32 index = m_indices[id];
+	Vector3_t accelVec = {moveAccel.x, 0.0f, moveAccel.z};
+
+
+	// Same as Entity::Move, normalize the X & Z movement and scale it up to balance the ground drag
+	float accelLength = LengthSq(accelVec);
+	if (accelLength > 1.0f)
+	{
+		accelVec *= (1.0f / SquareRoot(accelLength));
+	}
+
+	float entitySpeed = m_speed[index]*GROUND_DRAG;
+	m_accelX[index] = accelVec.x*entitySpeed;
+	m_accelY[index] = moveAccel.y*entitySpeed*JUMP_SCALE;
+	m_accelZ[index] = accelVec.z*entitySpeed;
+
+	return;
+}
+
+
+void EntityStore::SetOnGround(uint32 id, bool onGround)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == ENTITY_STORE_NONE)
+		return;
+
+	m_drag[m_indices[id]] = onGround ? GROUND_DRAG : AIR_DRAG;
+
+	return;
+}
+
+
+void EntityStore::SetPosition(uint32 id, Vector3_t position)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == ENTITY_STORE_NONE)
+		return;
+
+	// A teleport, so there's nothing to blend from
+	uint32 index = m_indices[id];
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	m_previousX[index] = position.x;
+	m_previousY[index] = position.y;
+	m_previousZ[index] = position.z;
+
+	return;
+}
+
+
+void EntityStore::SetVelocity(uint32 id, Vector3_t velocity)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == ENTITY_STORE_NONE)
+		return;
+
+	uint32 index = m_indices[id];
+	m_velocityX[index] = velocity.x;
+	m_velocityY[index] = velocity.y;
+	m_velocityZ[index] = velocity.z;
+
+	return;
+}
+
+
+bool EntityStore::GetPosition(uint32 id, Vector3_t& position)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == ENTITY_STORE_NONE)
+	{
+		return false;
+	}
+
+	uint32 index = m_indices[id];
+	position.x = m_positionX[index];
+	position.y = m_positionY[index];
+	position.z = m_positionZ[index];
+
+	return true;
+}
+
+
+bool EntityStore::GetVelocity(uint32 id, Vector3_t& velocity)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == ENTITY_STORE_NONE)
+	{
+		return false;
+	}
+
+	uint32 index = m_indices[id];
+	velocity.x = m_velocityX[index];
+	velocity.y = m_velocityY[index];
+	velocity.z = m_velocityZ[index];
+
+	return true;
+}
+
+
+bool EntityStore::GetRenderPosition(uint32 id, float alpha, Vector3_t& position)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == ENTITY_STORE_NONE)
+	{
+		return false;
+	}
+
+	uint32 index = m_indices[id];
+	position.x = m_previousX[index] + (m_positionX[index] - m_previousX[index])*alpha;
+	position.y = m_previousY[index] + (m_positionY[index] - m_previousY[index])*alpha;
+	position.z = m_previousZ[index] + (m_positionZ[index] - m_previousZ[index])*alpha;
+
+	return true;
+}
+
+
+void EntityStore::GetRenderPositions(float alpha, float* x, float* y, float* z)
+{
+	// Blend every packed entity from its previous position to its current one
+	for (uint32 i = 0; i < m_count; i++)
+	{
+		x[i] = m_previousX[i] + (m_positionX[i] - m_previousX[i])*alpha;
+		y[i] = m_previousY[i] + (m_positionY[i] - m_previousY[i])*alpha;
+		z[i] = m_previousZ[i] + (m_positionZ[i] - m_previousZ[i])*alpha;
+	}
+
+	return;
+}
+
+
+void EntityStore::Update(float frameTime, Physics::TileCollider* collider)
+{
+	float dt = frameTime/1000.0f;
+
+
+	if (m_count > 0)
+	{
+		memcpy(m_previousX.data(), m_positionX.data(), sizeof(float)*m_count);
+		memcpy(m_previousY.data(), m_positionY.data(), sizeof(float)*m_count);
+		memcpy(m_previousZ.data(), m_positionZ.data(), sizeof(float)*m_count);
+	}
+
+	Integrate(dt);
+	ApplyMoves(collider);
+
+	m_stats.updates++;
+	m_stats.entitiesMoved += m_count;
+
+	return;
+}
+
+
+uint32 EntityStore::GetCount()
+{
+	return m_count;
+}
+
+
+const uint32* EntityStore::GetIds()
+{
+	return m_ids.data();
+}
+
+
+const float* EntityStore::GetPositionsX()
+{
+	return m_positionX.data();
+}
+
+
+const float* EntityStore::GetPositionsY()
+{
+	return m_positionY.data();
+}
+
+
+const float* EntityStore::GetPositionsZ()
+{
+	return m_positionZ.data();
+}
+
+
+const EntityStore::storeStats_t& EntityStore::GetStats()
+{
+	return m_stats;
+}
+
+
+void EntityStore::ResetStats()
+{
+	m_stats = {};
+
+	return;
+}
+
+
+void EntityStore::Integrate(float dt)
+{
+	float halfDtSq = 0.5f*Square(dt);
+	uint32 i = 0;
+
+
+	// The lanes and the scalar tail do the same sums in the same order, so an entity moves the same
+	// wherever it is in the arrays
+#if ENTITY_STORE_SIMD_WIDTH == 8
+	__m256 dtVec = _mm256_set1_ps(dt);
+	__m256 halfDtSqVec = _mm256_set1_ps(halfDtSq);
+	__m256 gravity = _mm256_set1_ps(GRAVITY_ACCEL);
+
+	for (; i+8<=m_count; i+=8)
+	{
+		__m256 drag = _mm256_loadu_ps(&m_drag[i]);
+		__m256 velocityX = _mm256_loadu_ps(&m_velocityX[i]);
+		__m256 velocityY = _mm256_loadu_ps(&m_velocityY[i]);
+		__m256 velocityZ = _mm256_loadu_ps(&m_velocityZ[i]);
+		__m256 accelX = _mm256_sub_ps(_mm256_loadu_ps(&m_accelX[i]), _mm256_mul_ps(drag, velocityX));
+		__m256 accelY = _mm256_sub_ps(_mm256_loadu_ps(&m_accelY[i]), gravity);
+		__m256 accelZ = _mm256_sub_ps(_mm256_loadu_ps(&m_accelZ[i]), _mm256_mul_ps(drag, velocityZ));
+
+		_mm256_storeu_ps(&m_moveX[i], _mm256_add_ps(_mm256_mul_ps(accelX, halfDtSqVec), _mm256_mul_ps(velocityX, dtVec)));
+		_mm256_storeu_ps(&m_moveY[i], _mm256_add_ps(_mm256_mul_ps(accelY, halfDtSqVec), _mm256_mul_ps(velocityY, dtVec)));
+		_mm256_storeu_ps(&m_moveZ[i], _mm256_add_ps(_mm256_mul_ps(accelZ, halfDtSqVec), _mm256_mul_ps(velocityZ, dtVec)));
+		_mm256_storeu_ps(&m_velocityX[i], _mm256_add_ps(_mm256_mul_ps(accelX, dtVec), velocityX));
+		_mm256_storeu_ps(&m_velocityY[i], _mm256_add_ps(_mm256_mul_ps(accelY, dtVec), velocityY));
+		_mm256_storeu_ps(&m_velocityZ[i], _mm256_add_ps(_mm256_mul_ps(accelZ, dtVec), velocityZ));
+	}
+#elif ENTITY_STORE_SIMD_WIDTH == 4
+	__m128 dtVec = _mm_set1_ps(dt);
+	__m128 halfDtSqVec = _mm_set1_ps(halfDtSq);
+	__m128 gravity = _mm_set1_ps(GRAVITY_ACCEL);
+
+	for (; i+4<=m_count; i+=4)
+	{
+		__m128 drag = _mm_loadu_ps(&m_drag[i]);
+		__m128 velocityX = _mm_loadu_ps(&m_velocityX[i]);
+		__m128 velocityY = _mm_loadu_ps(&m_velocityY[i]);
+		__m128 velocityZ = _mm_loadu_ps(&m_velocityZ[i]);
+		__m128 accelX = _mm_sub_ps(_mm_loadu_ps(&m_accelX[i]), _mm_mul_ps(drag, velocityX));
+		__m128 accelY = _mm_sub_ps(_mm_loadu_ps(&m_accelY[i]), gravity);
+		__m128 accelZ = _mm_sub_ps(_mm_loadu_ps(&m_accelZ[i]), _mm_mul_ps(drag, velocityZ));
+
+		_mm_storeu_ps(&m_moveX[i], _mm_add_ps(_mm_mul_ps(accelX, halfDtSqVec), _mm_mul_ps(velocityX, dtVec)));
+		_mm_storeu_ps(&m_moveY[i], _mm_add_ps(_mm_mul_ps(accelY, halfDtSqVec), _mm_mul_ps(velocityY, dtVec)));
+		_mm_storeu_ps(&m_moveZ[i], _mm_add_ps(_mm_mul_ps(accelZ, halfDtSqVec), _mm_mul_ps(velocityZ, dtVec)));
+		_mm_storeu_ps(&m_velocityX[i], _mm_add_ps(_mm_mul_ps(accelX, dtVec), velocityX));
+		_mm_storeu_ps(&m_velocityY[i], _mm_add_ps(_mm_mul_ps(accelY, dtVec), velocityY));
+		_mm_storeu_ps(&m_velocityZ[i], _mm_add_ps(_mm_mul_ps(accelZ, dtVec), velocityZ));
+	}
+#endif
+
+	// The entities that don't fill a whole vector
+	for (; i<m_count; i++)
+	{
+		float accelX = m_accelX[i] - m_drag[i]*m_velocityX[i];
+		float accelY = m_accelY[i] - GRAVITY_ACCEL;
+		float accelZ = m_accelZ[i] - m_drag[i]*m_velocityZ[i];
+
+		m_moveX[i] = accelX*halfDtSq + m_velocityX[i]*dt;
+		m_moveY[i] = accelY*halfDtSq + m_velocityY[i]*dt;
+		m_moveZ[i] = accelZ*halfDtSq + m_velocityZ[i]*dt;
+		m_velocityX[i] = accelX*dt + m_velocityX[i];
+		m_velocityY[i] = accelY*dt + m_velocityY[i];
+		m_velocityZ[i] = accelZ*dt + m_velocityZ[i];
+	}
+
+	return;
+}
+
+
+void EntityStore::ApplyMoves(Physics::TileCollider* collider)
+{
+	// Without a collider nothing stops a move except the ground
+	if (!collider)
+	{
+		for (uint32 i = 0; i < m_count; i++)
+		{
+			m_positionX[i] += m_moveX[i];
+			m_positionY[i] += m_moveY[i];
+			m_positionZ[i] += m_moveZ[i];
+
+			if (m_positionY[i] < 0.0f)
+			{
+				m_positionY[i] = 0.0f;
+				m_velocityY[i] = Maximum(m_velocityY[i], 0.0f);
+			}
+		}
+
+		return;
+	}
+
+	// Sweeps branch on every tile they cross, so they go one entity at a time
+	for (uint32 i = 0; i < m_count; i++)
+	{
+		Vector3_t position = {m_positionX[i], m_positionY[i], m_positionZ[i]};
+		Vector3_t velocity = {m_velocityX[i], m_velocityY[i], m_velocityZ[i]};
+		Vector3_t move = {m_moveX[i], m_moveY[i], m_moveZ[i]};
+
+		if (collider->MoveBox(position, velocity, m_halfSize[i], move))
+		{
+			m_stats.contacts++;
+		}
+
+		m_positionX[i] = position.x;
+		m_positionY[i] = position.y;
+		m_positionZ[i] = position.z;
+		m_velocityX[i] = velocity.x;
+		m_velocityY[i] = velocity.y;
+		m_velocityZ[i] = velocity.z;
+	}
+
+	return;
+}
+
+} // end of namespace Gumshoe
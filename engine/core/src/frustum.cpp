@@ -12,12 +12,49 @@
 // Includes
 //--------------------------------------------
 #include "frustum.h"
+#include "gumshoe_math.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define FRUSTUM_SIMD_WIDTH 4
+#else
+#define FRUSTUM_SIMD_WIDTH 1
+#endif
 
 
 namespace Gumshoe {
 
+// Visible boxes in one vector's mask.
+static uint32 CountMaskBits(uint32 mask)
+{
+	uint32 count = 0;
+
+	while(mask)
+	{
+		mask &= mask - 1;
+		count++;
+	}
+
+	return count;
+}
+
+
 Frustum::Frustum()
 {
+	// Until it is constructed the frustum lets everything through.
+	memset(m_planeA, 0, sizeof(m_planeA));
+	memset(m_planeB, 0, sizeof(m_planeB));
+	memset(m_planeC, 0, sizeof(m_planeC));
+	memset(m_planeD, 0, sizeof(m_planeD));
+	memset(m_absA, 0, sizeof(m_absA));
+	memset(m_absB, 0, sizeof(m_absB));
+	memset(m_absC, 0, sizeof(m_absC));
+	m_cullStats = {};
 }
 
 
@@ -26,62 +63,52 @@ Frustum::~Frustum()
 }
 
 
-void Frustum::ConstructFrustum(float screenDepth, D3DXMATRIX projectionMatrix, D3DXMATRIX viewMatrix)
+void Frustum::ConstructFrustum(float screenDepth, const float* projectionMatrix, const float* viewMatrix)
 {
 	float zMinimum, r;
-	D3DXMATRIX matrix;
+	Matrix4_t projection, view, matrix;
+	Plane_t planes[FRUSTUM_PLANES];
+	int i;
+
 
-	
 	// Calculate the minimum Z distance in the frustum.
-	zMinimum = -projectionMatrix._43 / projectionMatrix._33;
+	memcpy(projection.e, projectionMatrix, sizeof(projection.e));
+	memcpy(view.e, viewMatrix, sizeof(view.e));
+	zMinimum = -projection._43 / projection._33;
 	r = screenDepth / (screenDepth - zMinimum);
-	projectionMatrix._33 = r;
-	projectionMatrix._43 = -r * zMinimum;
+	projection._33 = r;
+	projection._43 = -r * zMinimum;
 
 	// Create the frustum matrix from the view matrix and updated projection matrix.
-	D3DXMatrixMultiply(&matrix, &viewMatrix, &projectionMatrix);
-
-	// Calculate near plane of frustum.
-	m_planes[0].a = matrix._14 + matrix._13;
-	m_planes[0].b = matrix._24 + matrix._23;
-	m_planes[0].c = matrix._34 + matrix._33;
-	m_planes[0].d = matrix._44 + matrix._43;
-	D3DXPlaneNormalize(&m_planes[0], &m_planes[0]);
-
-	// Calculate far plane of frustum.
-	m_planes[1].a = matrix._14 - matrix._13; 
-	m_planes[1].b = matrix._24 - matrix._23;
-	m_planes[1].c = matrix._34 - matrix._33;
-	m_planes[1].d = matrix._44 - matrix._43;
-	D3DXPlaneNormalize(&m_planes[1], &m_planes[1]);
-
-	// Calculate left plane of frustum.
-	m_planes[2].a = matrix._14 + matrix._11; 
-	m_planes[2].b = matrix._24 + matrix._21;
-	m_planes[2].c = matrix._34 + matrix._31;
-	m_planes[2].d = matrix._44 + matrix._41;
-	D3DXPlaneNormalize(&m_planes[2], &m_planes[2]);
-
-	// Calculate right plane of frustum.
-	m_planes[3].a = matrix._14 - matrix._11; 
-	m_planes[3].b = matrix._24 - matrix._21;
-	m_planes[3].c = matrix._34 - matrix._31;
-	m_planes[3].d = matrix._44 - matrix._41;
-	D3DXPlaneNormalize(&m_planes[3], &m_planes[3]);
-
-	// Calculate top plane of frustum.
-	m_planes[4].a = matrix._14 - matrix._12; 
-	m_planes[4].b = matrix._24 - matrix._22;
-	m_planes[4].c = matrix._34 - matrix._32;
-	m_planes[4].d = matrix._44 - matrix._42;
-	D3DXPlaneNormalize(&m_planes[4], &m_planes[4]);
-
-	// Calculate bottom plane of frustum.
-	m_planes[5].a = matrix._14 + matrix._12;
-	m_planes[5].b = matrix._24 + matrix._22;
-	m_planes[5].c = matrix._34 + matrix._32;
-	m_planes[5].d = matrix._44 + matrix._42;
-	D3DXPlaneNormalize(&m_planes[5], &m_planes[5]);
+	matrix = view * projection;
+
+	// Near, far, left, right, top and bottom planes, each a sum or difference of the fourth column and another one.
+	for(i=0; i<4; i++)
+	{
+		planes[0].e[i] = matrix.m[i][3] + matrix.m[i][2];
+		planes[1].e[i] = matrix.m[i][3] - matrix.m[i][2];
+		planes[2].e[i] = matrix.m[i][3] + matrix.m[i][0];
+		planes[3].e[i] = matrix.m[i][3] - matrix.m[i][0];
+		planes[4].e[i] = matrix.m[i][3] - matrix.m[i][1];
+		planes[5].e[i] = matrix.m[i][3] + matrix.m[i][1];
+	}
+
+	// Normalize the planes and store them by component.
+	for(i=0; i<FRUSTUM_PLANES; i++)
+	{
+		planes[i] = PlaneNormalize(planes[i]);
+		m_planeA[i] = planes[i].a;
+		m_planeB[i] = planes[i].b;
+		m_planeC[i] = planes[i].c;
+		m_planeD[i] = planes[i].d;
+
+		m_absA[i] = fabsf(m_planeA[i]);
+		m_absB[i] = fabsf(m_planeB[i]);
+		m_absC[i] = fabsf(m_planeC[i]);
+	}
+
+	// A new frustum starts a new frame of stats.
+	m_cullStats = {};
 
 	return;
 }
@@ -93,10 +120,10 @@ bool Frustum::CheckPoint(float x, float y, float z)
 
 
 	// Check if the point is inside all six planes of the view frustum.
-	for(i=0; i<6; i++) 
+	for(i=0; i<FRUSTUM_PLANES; i++)
 	{
 		// If the result is negative, it is in the outer half-space, and not in the frustum
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3(x, y, z)) < 0.0f)
+		if(((m_planeA[i] * x) + (m_planeB[i] * y) + (m_planeC[i] * z) + m_planeD[i]) < 0.0f)
 		{
 			return false;
 		}
@@ -108,69 +135,41 @@ bool Frustum::CheckPoint(float x, float y, float z)
 
 bool Frustum::CheckCube(float xCenter, float yCenter, float zCenter, float distToCorner)
 {
-	int i;
-
-
-	// Loop through the 6 planes to see if the point is in the inner half-space
-	for(i=0; i<6; i++) 
-	{
-		// Check each corner of the cube seperately, if any one is inside the frustrum, it should be rendered
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter - distToCorner), (yCenter - distToCorner), (zCenter - distToCorner))) >= 0.0f)
-		{
-			continue;
-		}
-		
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter + distToCorner), (yCenter - distToCorner), (zCenter - distToCorner))) >= 0.0f)
-		{
-			continue;
-		}
-
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter - distToCorner), (yCenter + distToCorner), (zCenter - distToCorner))) >= 0.0f)
-		{
-			continue;
-		}
+	return CheckRectangle(xCenter, yCenter, zCenter, distToCorner, distToCorner, distToCorner);
+}
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter + distToCorner), (yCenter + distToCorner), (zCenter - distToCorner))) >= 0.0f)
-		{
-			continue;
-		}
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter - distToCorner), (yCenter - distToCorner), (zCenter + distToCorner))) >= 0.0f)
-		{
-			continue;
-		}
+bool Frustum::CheckSphere(float xCenter, float yCenter, float zCenter, float radius)
+{
+	int i;
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter + distToCorner), (yCenter - distToCorner), (zCenter + distToCorner))) >= 0.0f)
-		{
-			continue;
-		}
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter - distToCorner), (yCenter + distToCorner), (zCenter + distToCorner))) >= 0.0f)
-		{
-			continue;
-		}
-		
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter + distToCorner), (yCenter + distToCorner), (zCenter + distToCorner))) >= 0.0f)
+	// Check if the radius of the sphere is inside the view frustum.
+	for(i=0; i<FRUSTUM_PLANES; i++)
+	{
+		if(((m_planeA[i] * xCenter) + (m_planeB[i] * yCenter) + (m_planeC[i] * zCenter) + m_planeD[i]) < -radius)
 		{
-			continue;
+			return false;
 		}
-
-		return false;
 	}
 
 	return true;
 }
 
 
-bool Frustum::CheckSphere(float xCenter, float yCenter, float zCenter, float radius)
+bool Frustum::CheckRectangle(float xCenter, float yCenter, float zCenter, float xSize, float ySize, float zSize)
 {
 	int i;
+	float distance;
 
 
-	// Check if the radius of the sphere is inside the view frustum.
-	for(i=0; i<6; i++) 
+	// The box is outside when even its corner furthest along a plane's normal is behind that plane.
+	// Same operations in the same order as CheckRectangles, so both give the same answer for a box.
+	for(i=0; i<FRUSTUM_PLANES; i++)
 	{
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3(xCenter, yCenter, zCenter)) < -radius)
+		distance = (m_planeA[i] * xCenter) + (m_planeB[i] * yCenter) + (m_planeC[i] * zCenter) + m_planeD[i];
+		distance = distance + ((m_absA[i] * xSize) + (m_absB[i] * ySize) + (m_absC[i] * zSize));
+		if(distance < 0.0f)
 		{
 			return false;
 		}
@@ -180,59 +179,165 @@ bool Frustum::CheckSphere(float xCenter, float yCenter, float zCenter, float rad
 }
 
 
-bool Frustum::CheckRectangle(float xCenter, float yCenter, float zCenter, float xSize, float ySize, float zSize)
+bool Frustum::CheckRectangleMasked(float xCenter, float yCenter, float zCenter, float xSize, float ySize, float zSize,
+                                   uint32& planeMask, uint8& lastFailedPlane)
 {
-	int i;
+	int i, plane;
+	float distance, reach;
+
 
+	m_cullStats.boxes++;
 
-	// Loop through the 6 planes to see if the point is in the inner half-space
-	for(i=0; i<6; i++)
+	// Start with the plane that rejected this box last time, boxes mostly stay out the same side between frames.
+	for(i=0; i<FRUSTUM_PLANES; i++)
 	{
-		// Check each corner of the rectangle seperately, if any one is inside the frustrum, it should be rendered
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter - xSize), (yCenter - ySize), (zCenter - zSize))) >= 0.0f)
+		plane = (i == 0) ? lastFailedPlane : ((i <= lastFailedPlane) ? i - 1 : i);
+		if(!(planeMask & (1u << plane)))
 		{
+			m_cullStats.planesSkipped++;
 			continue;
 		}
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter + xSize), (yCenter - ySize), (zCenter - zSize))) >= 0.0f)
-		{
-			continue;
-		}
+		m_cullStats.planeTests++;
+		distance = (m_planeA[plane] * xCenter) + (m_planeB[plane] * yCenter) + (m_planeC[plane] * zCenter) + m_planeD[plane];
+		reach = (m_absA[plane] * xSize) + (m_absB[plane] * ySize) + (m_absC[plane] * zSize);
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter - xSize), (yCenter + ySize), (zCenter - zSize))) >= 0.0f)
+		// Even the corner furthest along the normal is behind the plane, so the box is outside.
+		if((distance + reach) < 0.0f)
 		{
-			continue;
+			if(i == 0)
+			{
+				m_cullStats.cachedRejects++;
+			}
+			lastFailedPlane = (uint8)plane;
+			return false;
 		}
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter - xSize), (yCenter - ySize), (zCenter + zSize))) >= 0.0f)
+		// Even the nearest corner is in front, so nothing inside this box needs this plane again.
+		if((distance - reach) >= 0.0f)
 		{
-			continue;
+			planeMask &= ~(1u << plane);
 		}
+	}
+
+	return true;
+}
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter + xSize), (yCenter + ySize), (zCenter - zSize))) >= 0.0f)
-		{
-			continue;
-		}
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter + xSize), (yCenter - ySize), (zCenter + zSize))) >= 0.0f)
+uint32 Frustum::CheckRectangles(const boxArrays_t& boxes, uint32 count, uint32* visible)
+{
+	uint32 i, visibleCount;
+	int p;
+
+
+	// One bit per box, bit i % 32 of word i / 32.
+	memset(visible, 0, sizeof(uint32) * ((count + 31) / 32));
+	visibleCount = 0;
+	i = 0;
+
+#if FRUSTUM_SIMD_WIDTH == 8
+	// Splat every plane component once, the loop then only loads boxes.
+	__m256 planeA[FRUSTUM_PLANES], planeB[FRUSTUM_PLANES], planeC[FRUSTUM_PLANES], planeD[FRUSTUM_PLANES];
+	__m256 absA[FRUSTUM_PLANES], absB[FRUSTUM_PLANES], absC[FRUSTUM_PLANES];
+	for(p=0; p<FRUSTUM_PLANES; p++)
+	{
+		planeA[p] = _mm256_set1_ps(m_planeA[p]);
+		planeB[p] = _mm256_set1_ps(m_planeB[p]);
+		planeC[p] = _mm256_set1_ps(m_planeC[p]);
+		planeD[p] = _mm256_set1_ps(m_planeD[p]);
+		absA[p] = _mm256_set1_ps(m_absA[p]);
+		absB[p] = _mm256_set1_ps(m_absB[p]);
+		absC[p] = _mm256_set1_ps(m_absC[p]);
+	}
+
+	for(; i+8<=count; i+=8)
+	{
+		__m256 centerX = _mm256_loadu_ps(boxes.centerX + i);
+		__m256 centerY = _mm256_loadu_ps(boxes.centerY + i);
+		__m256 centerZ = _mm256_loadu_ps(boxes.centerZ + i);
+		__m256 extentX = _mm256_loadu_ps(boxes.extentX + i);
+		__m256 extentY = _mm256_loadu_ps(boxes.extentY + i);
+		__m256 extentZ = _mm256_loadu_ps(boxes.extentZ + i);
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for(p=0; p<FRUSTUM_PLANES; p++)
 		{
-			continue;
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeA[p], centerX),
+			                                                            _mm256_mul_ps(planeB[p], centerY)),
+			                                              _mm256_mul_ps(planeC[p], centerZ)),
+			                                planeD[p]);
+			__m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absA[p], extentX),
+			                                           _mm256_mul_ps(absB[p], extentY)),
+			                             _mm256_mul_ps(absC[p], extentZ));
+
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
 		}
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter - xSize), (yCenter + ySize), (zCenter + zSize))) >= 0.0f)
+		uint32 mask = (uint32)_mm256_movemask_ps(inside);
+		visible[i >> 5] |= mask << (i & 31);
+		visibleCount += CountMaskBits(mask);
+	}
+#elif FRUSTUM_SIMD_WIDTH == 4
+	// Splat every plane component once, the loop then only loads boxes.
+	__m128 planeA[FRUSTUM_PLANES], planeB[FRUSTUM_PLANES], planeC[FRUSTUM_PLANES], planeD[FRUSTUM_PLANES];
+	__m128 absA[FRUSTUM_PLANES], absB[FRUSTUM_PLANES], absC[FRUSTUM_PLANES];
+	for(p=0; p<FRUSTUM_PLANES; p++)
+	{
+		planeA[p] = _mm_set1_ps(m_planeA[p]);
+		planeB[p] = _mm_set1_ps(m_planeB[p]);
+		planeC[p] = _mm_set1_ps(m_planeC[p]);
+		planeD[p] = _mm_set1_ps(m_planeD[p]);
+		absA[p] = _mm_set1_ps(m_absA[p]);
+		absB[p] = _mm_set1_ps(m_absB[p]);
+		absC[p] = _mm_set1_ps(m_absC[p]);
+	}
+
+	for(; i+4<=count; i+=4)
+	{
+		__m128 centerX = _mm_loadu_ps(boxes.centerX + i);
+		__m128 centerY = _mm_loadu_ps(boxes.centerY + i);
+		__m128 centerZ = _mm_loadu_ps(boxes.centerZ + i);
+		__m128 extentX = _mm_loadu_ps(boxes.extentX + i);
+		__m128 extentY = _mm_loadu_ps(boxes.extentY + i);
+		__m128 extentZ = _mm_loadu_ps(boxes.extentZ + i);
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for(p=0; p<FRUSTUM_PLANES; p++)
 		{
-			continue;
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeA[p], centerX),
+			                                                   _mm_mul_ps(planeB[p], centerY)),
+			                                        _mm_mul_ps(planeC[p], centerZ)),
+			                             planeD[p]);
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absA[p], extentX),
+			                                     _mm_mul_ps(absB[p], extentY)),
+			                          _mm_mul_ps(absC[p], extentZ));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
 		}
 
-		if(D3DXPlaneDotCoord(&m_planes[i], &D3DXVECTOR3((xCenter + xSize), (yCenter + ySize), (zCenter + zSize))) >= 0.0f)
+		// Four lanes never straddle a word, i is a multiple of four here.
+		uint32 mask = (uint32)_mm_movemask_ps(inside);
+		visible[i >> 5] |= mask << (i & 31);
+		visibleCount += CountMaskBits(mask);
+	}
+#endif
+
+	// The boxes that don't fill a whole vector.
+	for(; i<count; i++)
+	{
+		if(CheckRectangle(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i], boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]))
 		{
-			continue;
+			visible[i >> 5] |= 1u << (i & 31);
+			visibleCount++;
 		}
-
-		return false;
 	}
 
-	return true;
+	return visibleCount;
+}
+
+const Frustum::cullStats_t& Frustum::GetCullStats()
+{
+	return m_cullStats;
 }
 
-} // end of namespace Gumshoe
\ No newline at end of file
+} // end of namespace Gumshoe
@@ -0,0 +1,257 @@
+/*!
+  @file
+  input_log.cpp
+
+  @brief
+  Records the input for every simulation step so a session can be replayed.
+
+  @detail
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "input_log.h"
+#include <fstream>
+
+
+namespace Gumshoe {
+
+// Flag on a step's buttons byte when look movement follows
+static const uint8 INPUT_LOG_LOOK = 0x80;
+
+
+InputLog::InputLog()
+{
+	m_header = {};
+	m_lastButtons = 0;
+	m_quietSteps = 0;
+	m_readPosition = 0;
+	m_readStep = 0;
+	m_readQuietSteps = 0;
+	m_heldButtons = 0;
+}
+
+
+InputLog::~InputLog()
+{
+}
+
+
+void InputLog::Begin(const logHeader_t& header)
+{
+	m_header = header;
+	m_header.stepCount = 0;
+	m_data.clear();
+	m_lastButtons = 0;
+	m_quietSteps = 0;
+
+	return;
+}
+
+
+void InputLog::Record(const simInput_t& input)
+{
+	m_header.stepCount++;
+
+	// Nothing changed, only count the step
+	if (input.buttons == m_lastButtons && input.lookX == 0 && input.lookY == 0)
+	{
+		m_quietSteps++;
+		return;
+	}
+
+	WriteVarint(m_quietSteps);
+	m_quietSteps = 0;
+	m_lastButtons = input.buttons;
+
+	if (input.lookX == 0 && input.lookY == 0)
+	{
+		m_data.push_back(input.buttons);
+		return;
+	}
+
+	// Zigzag so small movements either way take one byte
+	m_data.push_back(input.buttons | INPUT_LOG_LOOK);
+	WriteVarint(((uint32)input.lookX << 1) ^ (uint32)(input.lookX >> 15));
+	WriteVarint(((uint32)input.lookY << 1) ^ (uint32)(input.lookY >> 15));
+
+	return;
+}
+
+
+bool InputLog::Save(const char* filename)
+{
+	std::ofstream fout;
+	uint32 magic = INPUT_LOG_MAGIC;
+	uint32 version = INPUT_LOG_VERSION;
+	uint32 size = (uint32)m_data.size();
+
+
+	fout.open(filename, std::ios::out | std::ios::binary);
+	if (fout.fail())
+	{
+		return false;
+	}
+
+	// The quiet steps at the end aren't written, the step count covers them
+	fout.write((const char*)&magic, sizeof(magic));
+	fout.write((const char*)&version, sizeof(version));
+	fout.write((const char*)&m_header, sizeof(m_header));
+	fout.write((const char*)&size, sizeof(size));
+	fout.write((const char*)m_data.data(), size);
+
+	bool result = !fout.fail();
+	fout.close();
+
+	return result;
+}
+
+
+bool InputLog::Load(const char* filename)
+{
+	std::ifstream fin;
+	uint32 magic = 0, version = 0, size = 0;
+
+
+	fin.open(filename, std::ios::in | std::ios::binary);
+	if (fin.fail())
+	{
+		return false;
+	}
+
+	fin.read((char*)&magic, sizeof(magic));
+	fin.read((char*)&version, sizeof(version));
+	if (fin.fail() || magic != INPUT_LOG_MAGIC || version != INPUT_LOG_VERSION)
+	{
+		return false;
+	}
+
+	fin.read((char*)&m_header, sizeof(m_header));
+	fin.read((char*)&size, sizeof(size));
+	if (fin.fail())
+	{
+		return false;
+	}
+
+	// A damaged size can't be trusted to allocate, the input has to be in the file after it
+	std::streamoff dataStart = fin.tellg();
+	fin.seekg(0, std::ios::end);
+	std::streamoff fileEnd = fin.tellg();
+	fin.seekg(dataStart, std::ios::beg);
+	if (fin.fail() || dataStart < 0 || (std::streamoff)size > fileEnd - dataStart)
+	{
+		m_data.clear();
+		return false;
+	}
+
+	m_data.resize(size);
+	fin.read((char*)m_data.data(), size);
+	if (fin.fail())
+	{
+		m_data.clear();
+		return false;
+	}
+
+	fin.close();
+	StartReplay();
+
+	return true;
+}
+
+
+void InputLog::StartReplay()
+{
+	m_readPosition = 0;
+	m_readStep = 0;
+	m_heldButtons = 0;
+	m_readQuietSteps = (m_data.empty()) ? m_header.stepCount : ReadVarint();
+
+	return;
+}
+
+
+bool InputLog::Replay(simInput_t& input)
+{
+	if (m_readStep >= m_header.stepCount)
+	{
+		return false;
+	}
+
+	m_readStep++;
+	input.lookX = 0;
+	input.lookY = 0;
+
+	// A quiet step holds the same buttons as the one before
+	if (m_readQuietSteps > 0 || m_readPosition >= (uint32)m_data.size())
+	{
+		m_readQuietSteps -= (m_readQuietSteps > 0) ? 1 : 0;
+		input.buttons = m_heldButtons;
+		return true;
+	}
+
+	uint8 flags = m_data[m_readPosition++];
+	m_heldButtons = flags & ~INPUT_LOG_LOOK;
+	input.buttons = m_heldButtons;
+
+	if (flags & INPUT_LOG_LOOK)
+	{
+		uint32 lookX = ReadVarint();
+		uint32 lookY = ReadVarint();
+		input.lookX = (int16)((lookX >> 1) ^ (0 - (lookX & 1)));
+		input.lookY = (int16)((lookY >> 1) ^ (0 - (lookY & 1)));
+	}
+
+	// Every step after the last change is quiet
+	m_readQuietSteps = (m_readPosition < (uint32)m_data.size()) ? ReadVarint() : m_header.stepCount - m_readStep;
+
+	return true;
+}
+
+
+const InputLog::logHeader_t& InputLog::GetHeader()
+{
+	return m_header;
+}
+
+
+uint32 InputLog::GetSize()
+{
+	return (uint32)m_data.size();
+}
+
+
+void InputLog::WriteVarint(uint32 value)
+{
+	// Seven bits a byte, the top bit set on every byte but the last
+	while (value >= 0x80)
+	{
+		m_data.push_back((uint8)(value | 0x80));
+		value >>= 7;
+	}
+	m_data.push_back((uint8)value);
+
+	return;
+}
+
+
+uint32 InputLog::ReadVarint()
+{
+	uint32 value = 0;
+	int shift = 0;
+
+
+	// A log cut short ends the varint instead of reading past the data
+	while (m_readPosition < (uint32)m_data.size() && shift < 32)
+	{
+		uint8 next = m_data[m_readPosition++];
+		value |= (uint32)(next & 0x7F) << shift;
+		if (!(next & 0x80))
+			break;
+		shift += 7;
+	}
+
+	return value;
+}
+
+} // end of namespace Gumshoe
@@ -0,0 +1,271 @@
+/*!
+  @file
+  job_pool.cpp
+
+  @brief
+  Work-stealing thread pool for the game engine.
+
+  @detail
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "job_pool.h"
+
+
+namespace Gumshoe {
+
+// Queue owned by the current thread and the pool it belongs to. A worker of one pool that
+// submits to or waits on another one uses that pool's shared queue 0.
+static thread_local int t_queueIndex = 0;
+static thread_local JobPool* t_queuePool = nullptr;
+
+
+JobPool::JobPool()
+{
+	m_running = false;
+	m_queuedJobs = 0;
+	m_pendingJobs = 0;
+	m_jobsRun = 0;
+	m_jobsStolen = 0;
+}
+
+
+JobPool::~JobPool()
+{
+	Shutdown();
+}
+
+
+bool JobPool::Init(int workerCount)
+{
+	// Default to one worker per core, leaving a core for the calling thread
+	if (workerCount < 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+		if (workerCount < 0)
+			workerCount = 0;
+	}
+
+	for (int i = 0; i < workerCount + 1; i++)
+	{
+		jobQueue_t* queue = new jobQueue_t;
+		if (!queue)
+		{
+			return false;
+		}
+		m_queues.push_back(queue);
+	}
+
+	m_running = true;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobPool::WorkerLoop, this, i + 1));
+	}
+
+	return true;
+}
+
+
+void JobPool::Shutdown()
+{
+	if (m_running)
+	{
+		Wait();
+
+		{
+			std::lock_guard<std::mutex> guard(m_sleepLock);
+			m_running = false;
+		}
+		m_workAvailable.notify_all();
+
+		for (size_t i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i].join();
+		}
+		m_workers.clear();
+	}
+
+	for (size_t i = 0; i < m_queues.size(); i++)
+	{
+		delete m_queues[i];
+	}
+	m_queues.clear();
+
+	return;
+}
+
+
+void JobPool::Submit(JobFunction function, void* data, JobCounter* counter)
+{
+	job_t job = { function, data, counter };
+
+	if (counter)
+		(*counter)++;
+
+	// Jobs submitted by a worker stay on its own queue, where it will find them first
+	int queueIndex = GetQueueIndex();
+
+	m_pendingJobs++;
+	{
+		std::lock_guard<std::mutex> guard(m_queues[queueIndex]->lock);
+		m_queues[queueIndex]->jobs.push_back(job);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(m_sleepLock);
+		m_queuedJobs++;
+	}
+	m_workAvailable.notify_one();
+
+	return;
+}
+
+
+void JobPool::Wait()
+{
+	// Help out until every submitted job has finished
+	while (m_pendingJobs > 0)
+	{
+		if (!RunJob(GetQueueIndex()))
+		{
+			std::unique_lock<std::mutex> guard(m_sleepLock);
+			m_allDone.wait(guard, [this]() { return m_pendingJobs == 0 || m_queuedJobs > 0; });
+		}
+	}
+
+	return;
+}
+
+
+void JobPool::Wait(JobCounter& counter)
+{
+	// Same as Wait(), but only until the jobs of this group are done
+	while (counter > 0)
+	{
+		if (!RunJob(GetQueueIndex()))
+		{
+			std::unique_lock<std::mutex> guard(m_sleepLock);
+			m_allDone.wait(guard, [this, &counter]() { return counter == 0 || m_queuedJobs > 0; });
+		}
+	}
+
+	return;
+}
+
+
+int JobPool::GetWorkerCount()
+{
+	return (int)m_workers.size();
+}
+
+
+JobPool::jobStats_t JobPool::GetStats()
+{
+	jobStats_t stats;
+	stats.jobsRun = m_jobsRun;
+	stats.jobsStolen = m_jobsStolen;
+
+	return stats;
+}
+
+
+void JobPool::WorkerLoop(int queueIndex)
+{
+	t_queueIndex = queueIndex;
+	t_queuePool = this;
+
+	while (m_running)
+	{
+		if (RunJob(queueIndex))
+			continue;
+
+		std::unique_lock<std::mutex> guard(m_sleepLock);
+		m_workAvailable.wait(guard, [this]() { return !m_running || m_queuedJobs > 0; });
+	}
+
+	return;
+}
+
+
+int JobPool::GetQueueIndex()
+{
+	if (t_queuePool != this || t_queueIndex >= (int)m_queues.size())
+	{
+		return 0;
+	}
+
+	return t_queueIndex;
+}
+
+
+bool JobPool::RunJob(int queueIndex)
+{
+	job_t job;
+
+	if (!PopJob(queueIndex, job) && !StealJob(queueIndex, job))
+	{
+		return false;
+	}
+
+	job.function(job.data);
+	m_jobsRun++;
+
+	// Take the lock so a thread about to sleep in Wait() can't miss the last job finishing
+	{
+		std::lock_guard<std::mutex> guard(m_sleepLock);
+		if (job.counter)
+			(*job.counter)--;
+		m_pendingJobs--;
+	}
+	m_allDone.notify_all();
+
+	return true;
+}
+
+
+bool JobPool::PopJob(int queueIndex, job_t& job)
+{
+	jobQueue_t* queue = m_queues[queueIndex];
+	std::lock_guard<std::mutex> guard(queue->lock);
+
+	if (queue->jobs.empty())
+	{
+		return false;
+	}
+
+	// Newest first, its data is most likely still in cache
+	job = queue->jobs.back();
+	queue->jobs.pop_back();
+	m_queuedJobs--;
+
+	return true;
+}
+
+
+bool JobPool::StealJob(int queueIndex, job_t& job)
+{
+	int queueCount = (int)m_queues.size();
+
+	for (int i = 1; i < queueCount; i++)
+	{
+		jobQueue_t* queue = m_queues[(queueIndex + i) % queueCount];
+		std::lock_guard<std::mutex> guard(queue->lock);
+
+		if (queue->jobs.empty())
+			continue;
+
+		// Oldest first, it is the furthest from what the owner is working on
+		job = queue->jobs.front();
+		queue->jobs.pop_front();
+		m_queuedJobs--;
+		m_jobsStolen++;
+
+		return true;
+	}
+
+	return false;
+}
+
+} // end of namespace Gumshoe
@@ -8,23 +8,33 @@
   @detail
 */
 
-#pragma once
-
 //--------------------------------------------
 // Includes
 //--------------------------------------------
 #include "physics_aabb.h"
+#include "gumshoe_intrinsics.h"
 
 
 namespace Gumshoe {
 
 namespace Physics {
 
+// Closer than this and two shapes are taken to have the same centre
+static const float AABB_EPSILON = 1.0e-6f;
+
+
+static inline float Clamp(float value, float low, float high)
+{
+	return (value < low) ? low : ((value > high) ? high : value);
+}
+
 
 AABB::AABB()
 {
-	m_linearAccel = 0.15f;
-	m_angularAccel = 0.15f;
+	m_position = {0.0f, 0.0f, 0.0f};
+	m_size = {0.0f, 0.0f, 0.0f};
+	m_radius = 0.0f;
+	m_aabbType = BoxCollider;
 }
 
 
@@ -32,18 +42,258 @@ AABB::~AABB()
 {
 }
 
-/*
-void Movement::Move(Vec3* position, Vec3 desiredPosition, float frameTime)
+
+void AABB::SetType(uint32 type)
 {
+	m_aabbType = type;
+
+	// A capsule is as wide and deep as it is round
+	if (m_aabbType == CapsuleCollider)
+	{
+		m_size.x = 2.0f*m_radius;
+		m_size.z = 2.0f*m_radius;
+	}
+
 	return;
 }
 
 
-void Movement::Rotate(Vec3* rotation, Vec3 desiredRotation, float frameTime)
+void AABB::SetPosition(Vector3_t* position)
 {
+	m_position = *position;
+
 	return;
 }
-*/
+
+
+void AABB::SetSize(Vector3_t size)
+{
+	m_size = size;
+
+	return;
+}
+
+
+void AABB::SetHeight(float height)
+{
+	m_size.y = height;
+
+	return;
+}
+
+
+void AABB::SetRadius(float radius)
+{
+	m_radius = radius;
+
+	if (m_aabbType == CapsuleCollider)
+	{
+		m_size.x = 2.0f*m_radius;
+		m_size.z = 2.0f*m_radius;
+	}
+
+	return;
+}
+
+
+uint32 AABB::GetType() const
+{
+	return m_aabbType;
+}
+
+
+Vector3_t AABB::GetPosition() const
+{
+	return m_position;
+}
+
+
+Vector3_t AABB::GetSize() const
+{
+	return m_size;
+}
+
+
+float AABB::GetHeight() const
+{
+	return m_size.y;
+}
+
+
+float AABB::GetRadius() const
+{
+	return m_radius;
+}
+
+
+void AABB::GetBounds(Vector3_t& boundsMin, Vector3_t& boundsMax) const
+{
+	boundsMin.x = m_position.x - 0.5f*m_size.x;
+	boundsMin.y = m_position.y;
+	boundsMin.z = m_position.z - 0.5f*m_size.z;
+	boundsMax.x = m_position.x + 0.5f*m_size.x;
+	boundsMax.y = m_position.y + m_size.y;
+	boundsMax.z = m_position.z + 0.5f*m_size.z;
+
+	return;
+}
+
+
+bool AABB::Collide(const AABB& first, const AABB& second, contact_t& contact)
+{
+	if (first.m_aabbType == CapsuleCollider && second.m_aabbType == CapsuleCollider)
+	{
+		return CollideCapsules(first, second, contact);
+	}
+
+	if (first.m_aabbType == CapsuleCollider)
+	{
+		// Work it out the other way round, and turn the normal around to match
+		if (!CollideBoxCapsule(second, first, contact))
+		{
+			return false;
+		}
+
+		contact.normal = -1.0f*contact.normal;
+		return true;
+	}
+
+	if (second.m_aabbType == CapsuleCollider)
+	{
+		return CollideBoxCapsule(first, second, contact);
+	}
+
+	return CollideBoxes(first, second, contact);
+}
+
+
+bool AABB::CollideBoxes(const AABB& first, const AABB& second, contact_t& contact)
+{
+	float delta[3], overlap[3];
+	int axis = 0;
+
+
+	// Centre to centre, and how far the boxes overlap along each axis
+	delta[0] = second.m_position.x - first.m_position.x;
+	delta[1] = (second.m_position.y + 0.5f*second.m_size.y) - (first.m_position.y + 0.5f*first.m_size.y);
+	delta[2] = second.m_position.z - first.m_position.z;
+
+	for (int a = 0; a < 3; a++)
+	{
+		overlap[a] = 0.5f*(first.m_size.e[a] + second.m_size.e[a]) - fabsf(delta[a]);
+		if (overlap[a] <= 0.0f)
+		{
+			return false;
+		}
+	}
+
+	// Push them apart along the axis they overlap the least on
+	if (overlap[1] < overlap[axis])
+		axis = 1;
+	if (overlap[2] < overlap[axis])
+		axis = 2;
+
+	contact.normal = {0.0f, 0.0f, 0.0f};
+	contact.normal.e[axis] = (delta[axis] < 0.0f) ? -1.0f : 1.0f;
+	contact.depth = overlap[axis];
+
+	return true;
+}
+
+
+bool AABB::CollideCapsules(const AABB& first, const AABB& second, contact_t& contact)
+{
+	// The heights of both segments, a capsule shorter than it is round is a sphere
+	float firstBottom = first.m_position.y + first.m_radius;
+	float firstTop = Maximum(firstBottom, first.m_position.y + first.m_size.y - first.m_radius);
+	float secondBottom = second.m_position.y + second.m_radius;
+	float secondTop = Maximum(secondBottom, second.m_position.y + second.m_size.y - second.m_radius);
+	float radii = first.m_radius + second.m_radius;
+
+
+	// Both segments are upright, so the closest points only differ in height when the segments don't overlap
+	Vector3_t delta;
+	delta.x = second.m_position.x - first.m_position.x;
+	delta.z = second.m_position.z - first.m_position.z;
+	delta.y = 0.0f;
+	if (secondBottom > firstTop)
+		delta.y = secondBottom - firstTop;
+	else if (firstBottom > secondTop)
+		delta.y = secondTop - firstBottom;
+
+	float distanceSq = LengthSq(delta);
+	if (distanceSq >= radii*radii)
+	{
+		return false;
+	}
+
+	float distance = SquareRoot(distanceSq);
+	if (distance > AABB_EPSILON)
+	{
+		contact.normal = (1.0f / distance)*delta;
+	}
+	else
+	{
+		contact.normal = {1.0f, 0.0f, 0.0f};
+	}
+	contact.depth = radii - distance;
+
+	return true;
+}
+
+
+bool AABB::CollideBoxCapsule(const AABB& box, const AABB& capsule, contact_t& contact)
+{
+	Vector3_t boxMin, boxMax;
+	box.GetBounds(boxMin, boxMax);
+
+	float bottom = capsule.m_position.y + capsule.m_radius;
+	float top = Maximum(bottom, capsule.m_position.y + capsule.m_size.y - capsule.m_radius);
+	float radius = capsule.m_radius;
+
+
+	// The point on the segment closest to the box: the end nearest the box, or anywhere the heights overlap
+	Vector3_t center;
+	center.x = capsule.m_position.x;
+	center.z = capsule.m_position.z;
+	center.y = Clamp(0.5f*(boxMin.y + boxMax.y), bottom, top);
+
+	// Then a sphere there against the box
+	Vector3_t closest;
+	closest.x = Clamp(center.x, boxMin.x, boxMax.x);
+	closest.y = Clamp(center.y, boxMin.y, boxMax.y);
+	closest.z = Clamp(center.z, boxMin.z, boxMax.z);
+
+	Vector3_t delta = center - closest;
+	float distanceSq = LengthSq(delta);
+	if (distanceSq >= radius*radius)
+	{
+		return false;
+	}
+
+	if (distanceSq > AABB_EPSILON*AABB_EPSILON)
+	{
+		float distance = SquareRoot(distanceSq);
+		contact.normal = (1.0f / distance)*delta;
+		contact.depth = radius - distance;
+		return true;
+	}
+
+	// The segment goes through the box, push it out through the nearest face
+	float faces[6] = { center.x - boxMin.x, boxMax.x - center.x, center.y - boxMin.y, boxMax.y - center.y, center.z - boxMin.z, boxMax.z - center.z };
+	int face = 0;
+	for (int f = 1; f < 6; f++)
+	{
+		if (faces[f] < faces[face])
+			face = f;
+	}
+
+	contact.normal = {0.0f, 0.0f, 0.0f};
+	contact.normal.e[face / 2] = (face & 1) ? 1.0f : -1.0f;
+	contact.depth = radius + faces[face];
+
+	return true;
+}
 
 } // end of namespace Physics
 
@@ -8,23 +8,29 @@
   @detail
 */
 
-#pragma once
-
 //--------------------------------------------
 // Includes
 //--------------------------------------------
 #include "physics_movement.h"
+#include "gumshoe_intrinsics.h"
 
 
 namespace Gumshoe {
 
 namespace Physics {
 
+// Overlap left alone, so bodies resting on each other don't jitter
+static const float PHYSICS_SLOP = 0.001f;
+
 
 Movement::Movement()
 {
-	m_linearAccel = 0.15f;
-	m_angularAccel = 0.15f;
+	m_grid = nullptr;
+	m_gravity = PHYSICS_GRAVITY;
+	m_restitution = 0.0f;
+	m_iterations = PHYSICS_ITERATIONS;
+	m_count = 0;
+	m_stats = {};
 }
 
 
@@ -32,18 +38,585 @@ Movement::~Movement()
 {
 }
 
-/*
-void Movement::Move(Vec3* position, Vec3 desiredPosition, float frameTime)
+
+bool Movement::Init(uint32 maxBodies, TileCollider* grid, float cellSize)
+{
+	if (maxBodies == 0 || maxBodies == PHYSICS_NO_BODY)
+	{
+		return false;
+	}
+
+	if (!m_broadPhase.Init(cellSize, maxBodies))
+	{
+		return false;
+	}
+
+	m_grid = grid;
+
+	m_ids.assign(maxBodies, 0);
+	m_indices.assign(maxBodies, PHYSICS_NO_BODY);
+
+	m_positionX.assign(maxBodies, 0.0f);
+	m_positionY.assign(maxBodies, 0.0f);
+	m_positionZ.assign(maxBodies, 0.0f);
+	m_velocityX.assign(maxBodies, 0.0f);
+	m_velocityY.assign(maxBodies, 0.0f);
+	m_velocityZ.assign(maxBodies, 0.0f);
+	m_forceX.assign(maxBodies, 0.0f);
+	m_forceY.assign(maxBodies, 0.0f);
+	m_forceZ.assign(maxBodies, 0.0f);
+	m_inverseMass.assign(maxBodies, 0.0f);
+	m_drag.assign(maxBodies, 0.0f);
+	m_sizeX.assign(maxBodies, 0.0f);
+	m_sizeY.assign(maxBodies, 0.0f);
+	m_sizeZ.assign(maxBodies, 0.0f);
+	m_radius.assign(maxBodies, 0.0f);
+	m_shapeType.assign(maxBodies, AABB::BoxCollider);
+	m_flags.assign(maxBodies, 0);
+	m_gridContacts.assign(maxBodies, 0);
+
+	m_count = 0;
+	Clear();
+	m_stats = {};
+
+	return true;
+}
+
+
+void Movement::Shutdown()
 {
+	m_broadPhase.Shutdown();
+	m_grid = nullptr;
+
+	m_ids.clear();
+	m_indices.clear();
+	m_freeIds.clear();
+
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_velocityX.clear();
+	m_velocityY.clear();
+	m_velocityZ.clear();
+	m_forceX.clear();
+	m_forceY.clear();
+	m_forceZ.clear();
+	m_inverseMass.clear();
+	m_drag.clear();
+	m_sizeX.clear();
+	m_sizeY.clear();
+	m_sizeZ.clear();
+	m_radius.clear();
+	m_shapeType.clear();
+	m_flags.clear();
+	m_gridContacts.clear();
+
+	m_pairs.clear();
+	m_contacts.clear();
+	m_count = 0;
+
 	return;
 }
 
 
-void Movement::Rotate(Vec3* rotation, Vec3 desiredRotation, float frameTime)
+void Movement::Clear()
 {
+	uint32 maxBodies = (uint32)m_indices.size();
+
+
+	for (uint32 i = 0; i < m_count; i++)
+	{
+		m_broadPhase.Remove(m_ids[i]);
+	}
+
+	// Hand the lowest ids out first
+	m_freeIds.resize(maxBodies);
+	for (uint32 i = 0; i < maxBodies; i++)
+	{
+		m_freeIds[i] = maxBodies - 1 - i;
+		m_indices[i] = PHYSICS_NO_BODY;
+	}
+	m_count = 0;
+	m_contacts.clear();
+
+	return;
+}
+
+
+uint32 Movement::CreateBody(const bodyDesc_t& desc)
+{
+	bool isStatic = (desc.flags & BodyStatic) != 0;
+
+
+	// Only static bodies can do without a mass
+	if (m_freeIds.empty() || (!isStatic && desc.mass <= 0.0f))
+	{
+		return PHYSICS_NO_BODY;
+	}
+
+	uint32 id = m_freeIds.back();
+	uint32 index = m_count++;
+	m_freeIds.pop_back();
+
+	m_ids[index] = id;
+	m_indices[id] = index;
+
+	Vector3_t position = desc.shape.GetPosition();
+	Vector3_t size = desc.shape.GetSize();
+
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	m_velocityX[index] = isStatic ? 0.0f : desc.velocity.x;
+	m_velocityY[index] = isStatic ? 0.0f : desc.velocity.y;
+	m_velocityZ[index] = isStatic ? 0.0f : desc.velocity.z;
+	m_forceX[index] = 0.0f;
+	m_forceY[index] = 0.0f;
+	m_forceZ[index] = 0.0f;
+	m_inverseMass[index] = isStatic ? 0.0f : 1.0f / desc.mass;
+	m_drag[index] = desc.drag;
+	m_sizeX[index] = size.x;
+	m_sizeY[index] = size.y;
+	m_sizeZ[index] = size.z;
+	m_radius[index] = desc.shape.GetRadius();
+	m_shapeType[index] = (uint8)desc.shape.GetType();
+	m_flags[index] = desc.flags;
+	m_gridContacts[index] = 0;
+
+	m_broadPhase.Insert(id, position.x, position.z, 0.5f*Maximum(size.x, size.z));
+
+	return id;
+}
+
+
+bool Movement::DestroyBody(uint32 id)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == PHYSICS_NO_BODY)
+	{
+		return false;
+	}
+
+	// Keep the arrays packed by moving the last body into the hole
+	uint32 index = m_indices[id];
+	uint32 last = --m_count;
+
+	m_broadPhase.Remove(id);
+
+	if (index != last)
+	{
+		m_ids[index] = m_ids[last];
+		m_indices[m_ids[index]] = index;
+
+		m_positionX[index] = m_positionX[last];
+		m_positionY[index] = m_positionY[last];
+		m_positionZ[index] = m_positionZ[last];
+		m_velocityX[index] = m_velocityX[last];
+		m_velocityY[index] = m_velocityY[last];
+		m_velocityZ[index] = m_velocityZ[last];
+		m_forceX[index] = m_forceX[last];
+		m_forceY[index] = m_forceY[last];
+		m_forceZ[index] = m_forceZ[last];
+		m_inverseMass[index] = m_inverseMass[last];
+		m_drag[index] = m_drag[last];
+		m_sizeX[index] = m_sizeX[last];
+		m_sizeY[index] = m_sizeY[last];
+		m_sizeZ[index] = m_sizeZ[last];
+		m_radius[index] = m_radius[last];
+		m_shapeType[index] = m_shapeType[last];
+		m_flags[index] = m_flags[last];
+		m_gridContacts[index] = m_gridContacts[last];
+	}
+
+	m_indices[id] = PHYSICS_NO_BODY;
+	m_freeIds.push_back(id);
+
+	return true;
+}
+
+
+void Movement::SetPosition(uint32 id, Vector3_t position)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == PHYSICS_NO_BODY)
+		return;
+
+	uint32 index = m_indices[id];
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	m_broadPhase.Move(id, position.x, position.z);
+
+	return;
+}
+
+
+void Movement::SetVelocity(uint32 id, Vector3_t velocity)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == PHYSICS_NO_BODY)
+		return;
+
+	uint32 index = m_indices[id];
+	if (m_flags[index] & BodyStatic)
+		return;
+
+	m_velocityX[index] = velocity.x;
+	m_velocityY[index] = velocity.y;
+	m_velocityZ[index] = velocity.z;
+
+	return;
+}
+
+
+void Movement::AddForce(uint32 id, Vector3_t force)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == PHYSICS_NO_BODY)
+		return;
+
+	// Forces add up until the next step uses them
+	uint32 index = m_indices[id];
+	m_forceX[index] += force.x;
+	m_forceY[index] += force.y;
+	m_forceZ[index] += force.z;
+
+	return;
+}
+
+
+bool Movement::GetPosition(uint32 id, Vector3_t& position)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == PHYSICS_NO_BODY)
+	{
+		return false;
+	}
+
+	uint32 index = m_indices[id];
+	position.x = m_positionX[index];
+	position.y = m_positionY[index];
+	position.z = m_positionZ[index];
+
+	return true;
+}
+
+
+bool Movement::GetVelocity(uint32 id, Vector3_t& velocity)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == PHYSICS_NO_BODY)
+	{
+		return false;
+	}
+
+	uint32 index = m_indices[id];
+	velocity.x = m_velocityX[index];
+	velocity.y = m_velocityY[index];
+	velocity.z = m_velocityZ[index];
+
+	return true;
+}
+
+
+bool Movement::GetShape(uint32 id, AABB& shape)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == PHYSICS_NO_BODY)
+	{
+		return false;
+	}
+
+	BuildShape(m_indices[id], shape);
+
+	return true;
+}
+
+
+uint32 Movement::GetGridContacts(uint32 id)
+{
+	if (id >= (uint32)m_indices.size() || m_indices[id] == PHYSICS_NO_BODY)
+	{
+		return 0;
+	}
+
+	return m_gridContacts[m_indices[id]];
+}
+
+
+void Movement::SetGravity(float gravity)
+{
+	m_gravity = gravity;
+
+	return;
+}
+
+
+void Movement::SetRestitution(float restitution)
+{
+	m_restitution = restitution;
+
+	return;
+}
+
+
+void Movement::SetIterations(uint32 iterations)
+{
+	m_iterations = (iterations > 0) ? iterations : 1;
+
+	return;
+}
+
+
+void Movement::Step(float stepTime)
+{
+	float dt = stepTime/1000.0f;
+
+
+	m_contacts.clear();
+
+	// Move every body as far as the walls let it
+	Integrate(dt);
+
+	// Then find the bodies that ended up in each other and push them apart
+	m_broadPhase.MoveEntities(m_ids.data(), m_positionX.data(), m_positionZ.data(), m_count);
+	SolveContacts();
+
+	for (uint32 i = 0; i < m_count; i++)
+	{
+		m_stats.gridContacts += (m_gridContacts[i] & (TileCollider::ContactX | TileCollider::ContactZ)) ? 1 : 0;
+	}
+	m_stats.steps++;
+	m_stats.bodiesMoved += m_count;
+
+	return;
+}
+
+
+uint32 Movement::FindContacts(std::vector<bodyContact_t>& contacts)
+{
+	uint32 found = 0;
+	AABB first, second;
+	AABB::contact_t contact;
+
+
+	// The same broad and narrow phase as a step, without pushing anything
+	m_broadPhase.MoveEntities(m_ids.data(), m_positionX.data(), m_positionZ.data(), m_count);
+	m_pairs.clear();
+	m_broadPhase.FindPairs(m_pairs);
+
+	for (size_t p = 0; p < m_pairs.size(); p++)
+	{
+		uint32 a = m_indices[m_pairs[p].first];
+		uint32 b = m_indices[m_pairs[p].second];
+
+		BuildShape(a, first);
+		BuildShape(b, second);
+		if (AABB::Collide(first, second, contact))
+		{
+			bodyContact_t bodyContact = { m_pairs[p].first, m_pairs[p].second, contact.normal, contact.depth };
+			contacts.push_back(bodyContact);
+			found++;
+		}
+	}
+
+	return found;
+}
+
+
+const std::vector<Movement::bodyContact_t>& Movement::GetContacts()
+{
+	return m_contacts;
+}
+
+
+uint32 Movement::GetBodyCount()
+{
+	return m_count;
+}
+
+
+const uint32* Movement::GetIds()
+{
+	return m_ids.data();
+}
+
+
+const float* Movement::GetPositionsX()
+{
+	return m_positionX.data();
+}
+
+
+const float* Movement::GetPositionsY()
+{
+	return m_positionY.data();
+}
+
+
+const float* Movement::GetPositionsZ()
+{
+	return m_positionZ.data();
+}
+
+
+const Movement::physicsStats_t& Movement::GetStats()
+{
+	return m_stats;
+}
+
+
+void Movement::ResetStats()
+{
+	m_stats = {};
+
+	return;
+}
+
+
+void Movement::Integrate(float dt)
+{
+	float halfDtSq = 0.5f*Square(dt);
+
+
+	for (uint32 i = 0; i < m_count; i++)
+	{
+		m_gridContacts[i] = 0;
+
+		if (m_flags[i] & BodyStatic)
+			continue;
+
+		// Same equations as the entities: p_new = 1/2*a*t^2 + v*t + p_old, v_new = a*t + v_old
+		float gravity = (m_flags[i] & BodyNoGravity) ? 0.0f : m_gravity;
+		Vector3_t accel;
+		accel.x = m_forceX[i]*m_inverseMass[i] - m_drag[i]*m_velocityX[i];
+		accel.y = m_forceY[i]*m_inverseMass[i] - m_drag[i]*m_velocityY[i] + gravity;
+		accel.z = m_forceZ[i]*m_inverseMass[i] - m_drag[i]*m_velocityZ[i];
+
+		Vector3_t move;
+		move.x = accel.x*halfDtSq + m_velocityX[i]*dt;
+		move.y = accel.y*halfDtSq + m_velocityY[i]*dt;
+		move.z = accel.z*halfDtSq + m_velocityZ[i]*dt;
+
+		m_velocityX[i] += accel.x*dt;
+		m_velocityY[i] += accel.y*dt;
+		m_velocityZ[i] += accel.z*dt;
+		m_forceX[i] = 0.0f;
+		m_forceY[i] = 0.0f;
+		m_forceZ[i] = 0.0f;
+
+		MoveThroughGrid(i, move);
+	}
+
+	return;
+}
+
+
+void Movement::MoveThroughGrid(uint32 index, Vector3_t move)
+{
+	Vector3_t position = {m_positionX[index], m_positionY[index], m_positionZ[index]};
+	Vector3_t velocity = {m_velocityX[index], m_velocityY[index], m_velocityZ[index]};
+
+
+	if (m_grid)
+	{
+		Vector3_t halfSize = {0.5f*m_sizeX[index], 0.5f*m_sizeY[index], 0.5f*m_sizeZ[index]};
+		m_gridContacts[index] |= m_grid->MoveBox(position, velocity, halfSize, move);
+	}
+	else
+	{
+		// Without a grid there is still the floor
+		position += move;
+		if (position.y < 0.0f)
+		{
+			position.y = 0.0f;
+			velocity.y = Maximum(velocity.y, 0.0f);
+			m_gridContacts[index] |= TileCollider::ContactGround;
+		}
+	}
+
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	m_velocityX[index] = velocity.x;
+	m_velocityY[index] = velocity.y;
+	m_velocityZ[index] = velocity.z;
+
+	return;
+}
+
+
+void Movement::SolveContacts()
+{
+	AABB first, second;
+	AABB::contact_t contact;
+
+
+	m_pairs.clear();
+	m_broadPhase.FindPairs(m_pairs);
+	m_stats.broadPairs += m_pairs.size();
+
+	// Every pass pushes each touching pair apart once, later passes fix what the earlier pushes disturbed
+	for (uint32 iteration = 0; iteration < m_iterations; iteration++)
+	{
+		for (size_t p = 0; p < m_pairs.size(); p++)
+		{
+			uint32 a = m_indices[m_pairs[p].first];
+			uint32 b = m_indices[m_pairs[p].second];
+			float inverseMassSum = m_inverseMass[a] + m_inverseMass[b];
+
+			if (inverseMassSum <= 0.0f)
+				continue;
+
+			BuildShape(a, first);
+			BuildShape(b, second);
+			if (!AABB::Collide(first, second, contact))
+				continue;
+
+			if (iteration == 0)
+			{
+				bodyContact_t bodyContact = { m_pairs[p].first, m_pairs[p].second, contact.normal, contact.depth };
+				m_contacts.push_back(bodyContact);
+				m_stats.contacts++;
+			}
+
+			// Take away the velocity they have into each other, bouncing back by the restitution
+			Vector3_t relative = {m_velocityX[b] - m_velocityX[a], m_velocityY[b] - m_velocityY[a], m_velocityZ[b] - m_velocityZ[a]};
+			float closing = Inner(relative, contact.normal);
+			if (closing < 0.0f)
+			{
+				float impulse = -(1.0f + m_restitution)*closing / inverseMassSum;
+				m_velocityX[a] -= contact.normal.x*impulse*m_inverseMass[a];
+				m_velocityY[a] -= contact.normal.y*impulse*m_inverseMass[a];
+				m_velocityZ[a] -= contact.normal.z*impulse*m_inverseMass[a];
+				m_velocityX[b] += contact.normal.x*impulse*m_inverseMass[b];
+				m_velocityY[b] += contact.normal.y*impulse*m_inverseMass[b];
+				m_velocityZ[b] += contact.normal.z*impulse*m_inverseMass[b];
+			}
+
+			// Push them apart, the lighter one further
+			float push = Maximum(contact.depth - PHYSICS_SLOP, 0.0f) / inverseMassSum;
+			if (push > 0.0f)
+			{
+				if (m_inverseMass[a] > 0.0f)
+					MoveThroughGrid(a, (-push*m_inverseMass[a])*contact.normal);
+				if (m_inverseMass[b] > 0.0f)
+					MoveThroughGrid(b, (push*m_inverseMass[b])*contact.normal);
+			}
+		}
+	}
+
+	return;
+}
+
+
+void Movement::BuildShape(uint32 index, AABB& shape)
+{
+	Vector3_t position = {m_positionX[index], m_positionY[index], m_positionZ[index]};
+	Vector3_t size = {m_sizeX[index], m_sizeY[index], m_sizeZ[index]};
+
+
+	// The type goes first, the shapes get reused and a capsule's radius would otherwise set a box's width
+	shape.SetType(m_shapeType[index]);
+	shape.SetSize(size);
+	shape.SetRadius(m_radius[index]);
+	shape.SetPosition(&position);
+
 	return;
 }
-*/
 
 } // end of namespace Physics
 
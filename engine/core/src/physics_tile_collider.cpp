@@ -0,0 +1,310 @@
+/*!
+  @file
+  physics_tile_collider.cpp
+
+  @brief
+  Part of the physics engine to collide boxes with the tile grid.
+
+  @detail
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "physics_tile_collider.h"
+#include "gumshoe_intrinsics.h"
+#include <float.h>
+
+
+namespace Gumshoe {
+
+namespace Physics {
+
+// Round down and up without calls to floorf and ceilf
+static inline int FloorToInt(float value)
+{
+	int result = (int)value;
+	return result - ((value < (float)result) ? 1 : 0);
+}
+
+static inline int CeilToInt(float value)
+{
+	int result = (int)value;
+	return result + ((value > (float)result) ? 1 : 0);
+}
+
+
+TileCollider::TileCollider()
+{
+	m_length = 0;
+	m_width = 0;
+	m_cellsPerTile = 1.0f;
+	m_stats = {};
+}
+
+
+TileCollider::~TileCollider()
+{
+}
+
+
+bool TileCollider::Init(const uint8* solid, int length, int width, int cellsPerTile)
+{
+	if (!solid || length < 1 || width < 1 || cellsPerTile < 1)
+	{
+		return false;
+	}
+
+	m_length = length;
+	m_width = width;
+	m_cellsPerTile = (float)cellsPerTile;
+	m_solid.assign(solid, solid + (size_t)length * width);
+	m_stats = {};
+
+	return true;
+}
+
+
+void TileCollider::Shutdown()
+{
+	m_solid.clear();
+	m_length = 0;
+	m_width = 0;
+
+	return;
+}
+
+
+void TileCollider::SetSolid(int x, int z, bool solid)
+{
+	if (x < 0 || z < 0 || x >= m_length || z >= m_width)
+		return;
+
+	m_solid[(size_t)z * m_length + x] = solid ? 1 : 0;
+
+	return;
+}
+
+
+bool TileCollider::IsSolid(int x, int z)
+{
+	return IsSolidTile(x, z);
+}
+
+
+bool TileCollider::IsBoxClear(Vector3_t position, Vector3_t halfSize)
+{
+	// The cells the box overlaps, touching a cell's edge doesn't count
+	int firstX = FloorToInt((position.x - halfSize.x) * m_cellsPerTile);
+	int lastX = CeilToInt((position.x + halfSize.x) * m_cellsPerTile) - 1;
+	int firstZ = FloorToInt((position.z - halfSize.z) * m_cellsPerTile);
+	int lastZ = CeilToInt((position.z + halfSize.z) * m_cellsPerTile) - 1;
+
+	for (int z = firstZ; z <= lastZ; z++)
+		for (int x = firstX; x <= lastX; x++)
+			if (IsSolidTile(x, z))
+				return false;
+
+	return true;
+}
+
+
+uint32 TileCollider::MoveBox(Vector3_t& position, Vector3_t& velocity, Vector3_t halfSize, Vector3_t delta)
+{
+	// The sweep is done in cells, so the box, the move and the skin are scaled to them
+	float scale = m_cellsPerTile;
+	float boxMin[2] = { (position.x - halfSize.x) * scale, (position.z - halfSize.z) * scale };
+	float boxMax[2] = { (position.x + halfSize.x) * scale, (position.z + halfSize.z) * scale };
+	float halfSizes[2] = { halfSize.x * scale, halfSize.z * scale };
+	float remaining[2] = { delta.x * scale, delta.z * scale };
+	float skin = TILE_COLLIDER_SKIN * scale;
+	uint32 contacts = 0;
+	float edge;
+	int axis;
+
+
+	m_stats.moves++;
+
+	// Nearly nothing left of a move would sweep with a step time so large it can overflow, denormals
+	// down to 1e-41 are what drag leaves of a velocity once an entity stops
+	for (int a = 0; a < 2; a++)
+	{
+		if (fabsf(remaining[a]) < TILE_COLLIDER_MIN_MOVE * scale)
+			remaining[a] = 0.0f;
+	}
+
+	// Each contact takes one axis out of the move, so two sweeps are the most a move needs
+	for (int sweep = 0; sweep < 2 && (remaining[0] != 0.0f || remaining[1] != 0.0f); sweep++)
+	{
+		float t = SweepBox(boxMin, boxMax, remaining, axis, edge);
+
+		for (int a = 0; a < 2; a++)
+		{
+			boxMin[a] += remaining[a] * t;
+			boxMax[a] += remaining[a] * t;
+		}
+
+		if (axis < 0)
+			break;
+
+		// Stop the skin short of the wall, and slide the rest of the move along it
+		if (remaining[axis] > 0.0f)
+		{
+			boxMax[axis] = edge - skin;
+			boxMin[axis] = boxMax[axis] - 2.0f*halfSizes[axis];
+		}
+		else
+		{
+			boxMin[axis] = edge + skin;
+			boxMax[axis] = boxMin[axis] + 2.0f*halfSizes[axis];
+		}
+
+		remaining[1 - axis] *= 1.0f - t;
+		remaining[axis] = 0.0f;
+
+		if (axis == 0)
+		{
+			velocity.x = 0.0f;
+			contacts |= ContactX;
+		}
+		else
+		{
+			velocity.z = 0.0f;
+			contacts |= ContactZ;
+		}
+		m_stats.contacts++;
+	}
+
+	position.x = boxMin[0] / scale + halfSize.x;
+	position.z = boxMin[1] / scale + halfSize.z;
+
+	// The ground is everywhere there isn't a wall
+	position.y += delta.y;
+	if (position.y < 0.0f)
+	{
+		position.y = 0.0f;
+		velocity.y = (velocity.y < 0.0f) ? 0.0f : velocity.y;
+		contacts |= ContactGround;
+	}
+
+	return contacts;
+}
+
+
+const TileCollider::sweepStats_t& TileCollider::GetStats()
+{
+	return m_stats;
+}
+
+
+void TileCollider::ResetStats()
+{
+	m_stats = {};
+
+	return;
+}
+
+
+float TileCollider::SweepBox(const float* boxMin, const float* boxMax, const float* delta, int& hitAxis, float& hitEdge)
+{
+	float tNext[2], tStep[2];
+	int tile[2], step[2];
+	float skin = TILE_COLLIDER_SKIN * m_cellsPerTile;
+	float minMove = TILE_COLLIDER_MIN_MOVE * m_cellsPerTile;
+
+
+	m_stats.sweeps++;
+
+	// When each leading face reaches its next tile edge, and the row or column of tiles it enters there
+	for (int a = 0; a < 2; a++)
+	{
+		if (delta[a] >= minMove)
+		{
+			tile[a] = CeilToInt(boxMax[a]);
+			step[a] = 1;
+			tNext[a] = ((float)tile[a] - boxMax[a]) / delta[a];
+			tStep[a] = 1.0f / delta[a];
+		}
+		else if (delta[a] <= -minMove)
+		{
+			tile[a] = FloorToInt(boxMin[a]) - 1;
+			step[a] = -1;
+			tNext[a] = ((float)(tile[a] + 1) - boxMin[a]) / delta[a];
+			tStep[a] = -1.0f / delta[a];
+		}
+		else
+		{
+			tile[a] = 0;
+			step[a] = 0;
+			tNext[a] = FLT_MAX;
+			tStep[a] = 0.0f;
+		}
+	}
+
+	// Step to the nearest tile edge each time, until the move runs out or the box enters a solid tile.
+	// The sweep looks the skin past the end of the move, a move that ends closer than that to a wall
+	// would leave nothing between the box and the wall but rounding. The smallest move keeps that
+	// look ahead finite.
+	for (;;)
+	{
+		int a = (tNext[0] <= tNext[1]) ? 0 : 1;
+		int other = 1 - a;
+		float t = tNext[a];
+
+		if (step[a] == 0 || t > 1.0f + skin*tStep[a])
+		{
+			hitAxis = -1;
+			return 1.0f;
+		}
+
+		// The tiles the box covers along the other axis at that time, which stops at the end of the move
+		// while this axis looks ahead. The leading side is the tile the other axis has stepped into,
+		// working it out from the position again can round back a tile. Crossing both edges at once also
+		// enters the diagonal tile.
+		float tOther = Minimum(t, 1.0f);
+		int first, last;
+		if (step[other] > 0)
+		{
+			first = FloorToInt(boxMin[other] + delta[other] * tOther);
+			last = (tNext[other] <= tOther) ? tile[other] : tile[other] - 1;
+		}
+		else if (step[other] < 0)
+		{
+			first = (tNext[other] <= tOther) ? tile[other] : tile[other] + 1;
+			last = CeilToInt(boxMax[other] + delta[other] * tOther) - 1;
+		}
+		else
+		{
+			first = FloorToInt(boxMin[other]);
+			last = CeilToInt(boxMax[other]) - 1;
+		}
+
+		for (int k = first; k <= last; k++)
+		{
+			m_stats.tilesTested++;
+
+			if ((a == 0) ? IsSolidTile(tile[0], k) : IsSolidTile(k, tile[1]))
+			{
+				hitAxis = a;
+				hitEdge = (float)((step[a] > 0) ? tile[a] : tile[a] + 1);
+				return Minimum(t, 1.0f);
+			}
+		}
+
+		tile[a] += step[a];
+		tNext[a] += tStep[a];
+	}
+}
+
+
+bool TileCollider::IsSolidTile(int x, int z)
+{
+	if (x < 0 || z < 0 || x >= m_length || z >= m_width)
+		return true;
+
+	return m_solid[(size_t)z * m_length + x] != 0;
+}
+
+} // end of namespace Physics
+
+} // end of namespace Gumshoe
@@ -13,16 +13,32 @@
 // Includes
 //--------------------------------------------
 #include "quadtree.h"
-//#include "frustum.cpp"
-#include "shader.cpp"
+#include <algorithm>
+#include <fstream>
+#include <string.h>
 
 
 namespace Gumshoe {
 
 QuadTree::QuadTree()
 {
-	m_vertexList = nullptr;
-	m_rootNode = nullptr;
+	m_triangleCount = 0;
+	m_drawCount = 0;
+	m_visibilityStats = {};
+	m_updateStats = {};
+	m_dirtyFirstIndex = 0xFFFFFFFF;
+	m_dirtyLastIndex = 0;
+#if BUILD_WIN32
+	m_indexBuffer = nullptr;
+	m_indexBufferCount = 0;
+#endif
+	m_groundPatched = false;
+	m_groundMinX = 0.0f;
+	m_groundMinZ = 0.0f;
+	m_groundCellSize = 1.0f;
+	m_groundCells = 0;
+	m_trianglesTested = 0;
+	m_buildStats = {};
 }
 
 
@@ -31,47 +47,80 @@ QuadTree::~QuadTree()
 }
 
 
-bool QuadTree::Init(GameWorld* gameWorld, ID3D11Device* device)
+bool QuadTree::Init(const Vector3_t* positions, uint32 vertexStride, uint32 vertexCount,
+	                const uint32* indices, uint32 triangleCount, JobPool* jobPool)
 {
-	int vertexCount;
+	uint32 i;
 	float centerX, centerZ, width;
+	const uint8* vertex;
+	std::vector<uint32> triangles;
+	buildNode_t* rootNode;
 
 
-	// Get the number of vertices in the gameWorld vertex array.
-	vertexCount = gameWorld->GetVertexCount();
-
-	// Store the total triangle count for the vertex list.
-	m_triangleCount = vertexCount / 3;
+	Shutdown();
 
-	// Create a vertex array to hold all of the gameWorld vertices.
-	m_vertexList = new vertex_t[vertexCount];
-	if(!m_vertexList)
+	if (triangleCount == 0)
 	{
 		return false;
 	}
 
-	// Copy the gameWorld vertices into the vertex list.
-	gameWorld->CopyVertexArray((void*)m_vertexList);
+	// Store the total triangle count for the mesh.
+	m_triangleCount = (int)triangleCount;
+
+	// Copy the vertex positions and the indices, the tree keeps them to look up heights.
+	m_positions.resize(vertexCount);
+	vertex = (const uint8*)positions;
+	for (i = 0; i < vertexCount; i++)
+	{
+		memcpy(&m_positions[i], vertex, sizeof(Vector3_t));
+		vertex += vertexStride;
+	}
+	m_indices.assign(indices, indices + triangleCount * 3);
+
+	// Work out the extent of every triangle once, rather than at every node it is tested against.
+	m_triangleBounds.resize(triangleCount);
+	triangles.resize(triangleCount);
+	for (i = 0; i < triangleCount; i++)
+	{
+		const Vector3_t& v1 = m_positions[m_indices[i * 3]];
+		const Vector3_t& v2 = m_positions[m_indices[i * 3 + 1]];
+		const Vector3_t& v3 = m_positions[m_indices[i * 3 + 2]];
+
+		m_triangleBounds[i].minX = fminf(v1.x, fminf(v2.x, v3.x));
+		m_triangleBounds[i].maxX = fmaxf(v1.x, fmaxf(v2.x, v3.x));
+		m_triangleBounds[i].minZ = fminf(v1.z, fminf(v2.z, v3.z));
+		m_triangleBounds[i].maxZ = fmaxf(v1.z, fmaxf(v2.z, v3.z));
+		triangles[i] = i;
+	}
 
 	// Calculate the center x,z and the width of the mesh.
-	CalculateMeshDimensions(vertexCount, centerX, centerZ, width);
+	CalculateMeshDimensions(centerX, centerZ, width);
 
 	// Create the root node for the quad tree.
-	m_rootNode = new node_t;
-	if(!m_rootNode)
+	rootNode = new buildNode_t;
+	if(!rootNode)
 	{
 		return false;
 	}
 
-	// Recursively build the quad tree based on the vertex list data and mesh dimensions.
-	CreateTreeNode(m_rootNode, centerX, centerZ, width, device);
+	// Recursively build the quad tree, handing each node's triangles down to its children.
+	m_trianglesTested = 0;
+	CreateTreeNode(rootNode, centerX, centerZ, width, 0, triangles, jobPool);
 
-	// Release the vertex list since the quad tree now has the vertices in each node.
-	if(m_vertexList)
-	{
-		delete [] m_vertexList;
-		m_vertexList = nullptr;
-	}
+	// Lay the tree out in one array and release the build nodes.
+	FlattenTree(rootNode);
+	ReleaseNode(rootNode);
+	delete rootNode;
+
+	// Bin the ground triangles for height queries.
+	BuildGroundGrid();
+
+	// The mesh indices and bounds are only needed while building.
+	std::vector<uint32>().swap(m_indices);
+	std::vector<triangleBounds_t>().swap(m_triangleBounds);
+
+	CountNodes();
+	m_buildStats.trianglesTested = m_trianglesTested;
 
 	return true;
 }
@@ -79,405 +128,439 @@ bool QuadTree::Init(GameWorld* gameWorld, ID3D11Device* device)
 
 void QuadTree::Shutdown()
 {
-	// Recursively release the quad tree data.
-	if(m_rootNode)
+#if BUILD_WIN32
+	// Release the index buffer.
+	if(m_indexBuffer)
 	{
-		ReleaseNode(m_rootNode);
-		delete m_rootNode;
-		m_rootNode = nullptr;
+		m_indexBuffer->Release();
+		m_indexBuffer = nullptr;
 	}
+#endif
+
+	// Release the quad tree data.
+	m_nodes.clear();
+	m_positions.clear();
+	m_leafIndices.clear();
+	m_lastFailedPlanes.clear();
+	m_groundCellStarts.clear();
+	m_groundIndices.clear();
+	m_groundAdded.clear();
+	m_groundPatched = false;
+	m_nodeTriangles.clear();
+	m_groundCells = 0;
+	m_dirtyFirstIndex = 0xFFFFFFFF;
+	m_dirtyLastIndex = 0;
+	m_indices.clear();
+	m_triangleBounds.clear();
+	m_triangleCount = 0;
+	m_buildStats = {};
 
 	return;
 }
 
 
-void QuadTree::Render(Frustum* frustum, ID3D11DeviceContext* deviceContext, Shader* shader)
+bool QuadTree::Save(const char* filename)
 {
-	// Reset the number of triangles that are drawn for this frame.
-	m_drawCount = 0;
+	std::ofstream fout;
+	fileHeader_t header;
 
-	// Render each node that is visible starting at the parent node and moving down the tree.
-	RenderNode(m_rootNode, frustum, deviceContext, shader);
 
-	return;
-}
+	if(m_nodes.empty())
+	{
+		return false;
+	}
 
+	// The file has no room for the triangles updates added to the height grid.
+	if(m_groundPatched)
+	{
+		CompactGroundGrid();
+	}
 
-int QuadTree::GetDrawCount()
-{
-	return m_drawCount;
+	header.magic = (uint32)QUADTREE_FILE_MAGIC;
+	header.version = (uint32)QUADTREE_FILE_VERSION;
+	header.triangleCount = (uint32)m_triangleCount;
+	header.nodeCount = (uint32)m_nodes.size();
+	header.vertexCount = (uint32)m_positions.size();
+	header.indexCount = (uint32)m_leafIndices.size();
+	header.groundCells = (uint32)m_groundCells;
+	header.groundIndexCount = (uint32)m_groundIndices.size();
+	header.groundMinX = m_groundMinX;
+	header.groundMinZ = m_groundMinZ;
+	header.groundCellSize = m_groundCellSize;
+
+	// The header and then the arrays, as they are in memory
+	fout.open(filename, std::ios::out | std::ios::binary);
+	if(fout.fail())
+	{
+		return false;
+	}
+
+	fout.write((const char*)&header, sizeof(header));
+	fout.write((const char*)m_nodes.data(), sizeof(node_t) * m_nodes.size());
+	fout.write((const char*)m_positions.data(), sizeof(Vector3_t) * m_positions.size());
+	fout.write((const char*)m_leafIndices.data(), sizeof(uint32) * m_leafIndices.size());
+	fout.write((const char*)m_groundCellStarts.data(), sizeof(uint32) * m_groundCellStarts.size());
+	fout.write((const char*)m_groundIndices.data(), sizeof(uint32) * m_groundIndices.size());
+	fout.close();
+
+	return !fout.fail();
 }
 
 
-void QuadTree::CalculateMeshDimensions(int vertexCount, float& centerX, float& centerZ, float& meshWidth)
+bool QuadTree::Load(const char* filename)
 {
-	int i;
-	float maxWidth, maxDepth, minWidth, minDepth, width, depth, maxX, maxZ;
+	std::ifstream fin;
+	fileHeader_t header;
+	uint32 i;
 
 
-	// Initialize the center position of the mesh to zero.
-	centerX = 0.0f;
-	centerZ = 0.0f;
+	Shutdown();
 
-	// Sum all the vertices in the mesh.
-	for(i=0; i<vertexCount; i++)
+	fin.open(filename, std::ios::in | std::ios::binary);
+	if(fin.fail())
 	{
-		centerX += m_vertexList[i].position.x;
-		centerZ += m_vertexList[i].position.z;
+		return false;
 	}
 
-	// And then divide it by the number of vertices to find the mid-point of the mesh.
-	centerX = centerX / (float)vertexCount;
-	centerZ = centerZ / (float)vertexCount;
+	fin.read((char*)&header, sizeof(header));
+	if(fin.fail() || (header.magic != (uint32)QUADTREE_FILE_MAGIC) || (header.version != (uint32)QUADTREE_FILE_VERSION) ||
+	   (header.nodeCount == 0) || (header.indexCount % 3 != 0) ||
+	   (header.groundCells == 0) || (header.groundCells > (uint32)QUADTREE_MAX_GROUND_CELLS) ||
+	   (header.groundIndexCount % 3 != 0) || !(header.groundCellSize > 0.0f))
+	{
+		return false;
+	}
 
-	// Initialize the maximum and minimum size of the mesh.
-	maxWidth = 0.0f;
-	maxDepth = 0.0f;
+	m_nodes.resize(header.nodeCount);
+	m_lastFailedPlanes.assign(header.nodeCount, 0);
+	m_positions.resize(header.vertexCount);
+	m_leafIndices.resize(header.indexCount);
+	m_groundCellStarts.resize((size_t)header.groundCells * header.groundCells + 1);
+	m_groundIndices.resize(header.groundIndexCount);
+
+	fin.read((char*)m_nodes.data(), sizeof(node_t) * m_nodes.size());
+	fin.read((char*)m_positions.data(), sizeof(Vector3_t) * m_positions.size());
+	fin.read((char*)m_leafIndices.data(), sizeof(uint32) * m_leafIndices.size());
+	fin.read((char*)m_groundCellStarts.data(), sizeof(uint32) * m_groundCellStarts.size());
+	fin.read((char*)m_groundIndices.data(), sizeof(uint32) * m_groundIndices.size());
+	if(fin.fail())
+	{
+		Shutdown();
+		return false;
+	}
 
-	minWidth = fabsf(m_vertexList[0].position.x - centerX);
-	minDepth = fabsf(m_vertexList[0].position.z - centerZ);
+	// Don't trust a file to stay inside the arrays
+	for(i=0; i<header.nodeCount; i++)
+	{
+		const node_t& node = m_nodes[i];
 
-	// Go through all the vertices and find the maximum and minimum width and depth of the mesh.
-	for(i=0; i<vertexCount; i++)
+		if(((node.childCount > 0) && ((node.firstChild <= i) || (node.childCount > 4) || (node.firstChild + node.childCount > header.nodeCount))) ||
+		   (node.triangleCount > node.triangleCapacity) ||
+		   ((uint64)node.firstIndex + (uint64)node.triangleCapacity * 3 > header.indexCount))
+		{
+			Shutdown();
+			return false;
+		}
+	}
+
+	for(i=0; i<header.indexCount; i++)
 	{
-		width = fabsf(m_vertexList[i].position.x - centerX);	
-		depth = fabsf(m_vertexList[i].position.z - centerZ);	
+		if(m_leafIndices[i] >= header.vertexCount)
+		{
+			Shutdown();
+			return false;
+		}
+	}
 
-		if(width > maxWidth) { maxWidth = width; }
-		if(depth > maxDepth) { maxDepth = depth; }
-		if(width < minWidth) { minWidth = width; }
-		if(depth < minDepth) { minDepth = depth; }
+	for(i=0; i+1<(uint32)m_groundCellStarts.size(); i++)
+	{
+		if(m_groundCellStarts[i] > m_groundCellStarts[i + 1])
+		{
+			Shutdown();
+			return false;
+		}
 	}
 
-	// Find the absolute maximum value between the min and max depth and width.
-	maxX = (float)max(fabs(minWidth), fabs(maxWidth));
-	maxZ = (float)max(fabs(minDepth), fabs(maxDepth));
-	
-	// Calculate the maximum diameter of the mesh.
-	meshWidth = max(maxX, maxZ) * 2.0f;
+	for(i=0; i<header.groundIndexCount; i++)
+	{
+		if(m_groundIndices[i] >= header.vertexCount)
+		{
+			Shutdown();
+			return false;
+		}
+	}
 
-	return;
+	if((m_groundCellStarts[0] != 0) || (m_groundCellStarts.back() != header.groundIndexCount))
+	{
+		Shutdown();
+		return false;
+	}
+
+	m_triangleCount = (int)header.triangleCount;
+	m_groundCells = (int)header.groundCells;
+	m_groundMinX = header.groundMinX;
+	m_groundMinZ = header.groundMinZ;
+	m_groundCellSize = header.groundCellSize;
+	CountNodes();
+
+	return true;
 }
 
 
-void QuadTree::CreateTreeNode(node_t* node, float positionX, float positionZ, float width, ID3D11Device* device)
+bool QuadTree::UpdateTriangles(const Vector3_t* positions, uint32 vertexStride, uint32 vertexCount, const uint32* indices,
+	                           const uint32* removedCorners, uint32 removedCount, uint32 firstAdded, uint32 addedCount)
 {
-	int numTriangles, i, count, vertexCount, index, vertexIndex;
-	float offsetX, offsetZ;
-	vertex_t* vertices;
-	unsigned long* indices;
-	bool result;
-	//D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-    //D3D11_SUBRESOURCE_DATA vertexData, indexData;
+	uint32 i, oldVertexCount, first, last;
+	const uint8* vertex;
+	triangleBounds_t bounds;
+	std::vector<uint8> removed;
 
-	
-	// Store the node position and size.
-	node->positionX = positionX;
-	node->positionZ = positionZ;
-	node->width = width;
 
-	// Initialize the triangle count to zero for the node.
-	node->triangleCount = 0;
+	m_updateStats = {};
 
-	// Initialize the vertex and index buffer to null.
-	node->vertexBuffer = nullptr;
-	node->indexBuffer = nullptr;
+	// Vertices are only ever appended to the mesh, the ones the tree already has keep their place.
+	oldVertexCount = (uint32)m_positions.size();
+	if(m_nodes.empty() || (vertexCount < oldVertexCount))
+	{
+		return false;
+	}
 
-	// Initialize the vertex array to null.
-	node->vertexArray = nullptr;
+	for(i=0; i<addedCount * 3; i++)
+	{
+		if(indices[firstAdded * 3 + i] >= vertexCount)
+		{
+			return false;
+		}
+	}
 
-	// Initialize the children nodes of this node to null.
-	node->nodes[0] = nullptr;
-	node->nodes[1] = nullptr;
-	node->nodes[2] = nullptr;
-	node->nodes[3] = nullptr;
+	for(i=0; i<removedCount * 3; i++)
+	{
+		if(removedCorners[i] >= oldVertexCount)
+		{
+			return false;
+		}
+	}
 
-	// Count the number of triangles that are inside this node.
-	numTriangles = CountTriangles(positionX, positionZ, width);
+	// Leave room for more updates, rather than copying the arrays a little at a time.
+	if(m_positions.capacity() < vertexCount)
+	{
+		m_positions.reserve(vertexCount + vertexCount / 4);
+	}
+	if(m_leafIndices.capacity() < m_leafIndices.size() + (size_t)addedCount * 3 * 4)
+	{
+		m_leafIndices.reserve(m_leafIndices.size() + m_leafIndices.size() / 4 + (size_t)addedCount * 3 * 4);
+	}
 
-	// Case 1: If there are no triangles in this node then return as it is empty and requires no processing.
-	if(numTriangles == 0)
+	m_positions.resize(vertexCount);
+	vertex = (const uint8*)positions + (size_t)oldVertexCount * vertexStride;
+	for(i=oldVertexCount; i<vertexCount; i++)
 	{
-		return;
+		memcpy(&m_positions[i], vertex, sizeof(Vector3_t));
+		vertex += vertexStride;
 	}
 
-	// Case 2: If there are too many triangles in this node then split it into four equal sized smaller tree nodes.
-	if(numTriangles > MAX_TRIANGLES)
+	// Find the nodes each old triangle can be in, and take it out of the grid cells.
+	m_nodeTriangles.clear();
+	for(i=0; i<removedCount; i++)
 	{
-		for(i=0; i<4; i++)
-		{
-			// Calculate the position offsets for the new child node.
-			offsetX = (((i % 2) < 1) ? -1.0f : 1.0f) * (width / 4.0f);
-			offsetZ = (((i % 4) < 2) ? -1.0f : 1.0f) * (width / 4.0f);
+		const uint32* corners = &removedCorners[i * 3];
 
-			// See if there are any triangles in the new node.
-			count = CountTriangles((positionX + offsetX), (positionZ + offsetZ), (width / 2.0f));
-			if(count > 0)
-			{
-				// If there are triangles inside where this new node would be then create the child node.
-				node->nodes[i] = new node_t;
+		GetTriangleBounds(corners, bounds);
+		FindTriangleNodes(0, bounds, i, m_nodeTriangles);
+		if(IsGroundTriangle(corners[0], corners[1], corners[2]))
+		{
+			RemoveGroundTriangle(bounds, corners);
+		}
+	}
 
-				// Extend the tree starting from this new child node now.
-				CreateTreeNode(node->nodes[i], (positionX + offsetX), (positionZ + offsetZ), (width / 2.0f), device);
-			}
+	// Then go through each of those nodes once for all the triangles it may have.
+	std::sort(m_nodeTriangles.begin(), m_nodeTriangles.end(),
+	          [](const nodeTriangle_t& a, const nodeTriangle_t& b) { return a.node < b.node; });
+	removed.assign(removedCount, 0);
+	for(first=0; first<(uint32)m_nodeTriangles.size(); first=last)
+	{
+		last = first + 1;
+		while((last < (uint32)m_nodeTriangles.size()) && (m_nodeTriangles[last].node == m_nodeTriangles[first].node))
+		{
+			last++;
 		}
 
-		return;
+		RemoveNodeTriangles(m_nodeTriangles[first].node, removedCorners, &m_nodeTriangles[first], last - first, removed);
+	}
+
+	for(i=0; i<removedCount; i++)
+	{
+		m_updateStats.removedTriangles += removed[i];
 	}
 
-	// Case 3: If this node is not empty and the triangle count for it is less than the max then 
-	// this node is at the bottom of the tree so create the list of triangles to store in it.
-	node->triangleCount = numTriangles;
+	// Then put the new ones in, the same way the build would have.
+	for(i=0; i<addedCount; i++)
+	{
+		const uint32* corners = &indices[(firstAdded + i) * 3];
+
+		GetTriangleBounds(corners, bounds);
+		AddNodeTriangle(0, bounds, corners);
+		if(IsGroundTriangle(corners[0], corners[1], corners[2]))
+		{
+			AddGroundTriangle(bounds, corners);
+		}
+		m_updateStats.addedTriangles++;
+	}
 
-	// Calculate the number of vertices.
-	vertexCount = numTriangles * 3;
+	m_triangleCount += (int)m_updateStats.addedTriangles - (int)m_updateStats.removedTriangles;
 
-	// Create the vertex array.
-	vertices = new vertex_t[vertexCount];
+	return true;
+}
 
-	// Create the index array.
-	indices = new unsigned long[vertexCount];
 
-	// Create the vertex array.
-	node->vertexArray = new Vector3_t[vertexCount];
+#if BUILD_WIN32
+bool QuadTree::InitBuffers(ID3D11Device* device)
+{
+	D3D11_BUFFER_DESC indexBufferDesc;
+	D3D11_SUBRESOURCE_DATA indexData;
+	HRESULT result;
 
-	// Initialize the index for this new vertex and index array.
-	index = 0;
 
-	// Go through all the triangles in the vertex list.
-	for(i=0; i<m_triangleCount; i++)
+	if(m_leafIndices.empty())
 	{
-		// If the triangle is inside this node then add it to the vertex array.
-		result = IsTriangleContained(i, positionX, positionZ, width);
-		if(result == true)
-		{
-			// Calculate the index into the terrain vertex list.
-			vertexIndex = i * 3;
-
-			// Get the three vertices of this triangle from the vertex list.
-			vertices[index].position = m_vertexList[vertexIndex].position;
-			vertices[index].texture = m_vertexList[vertexIndex].texture;
-			vertices[index].normal = m_vertexList[vertexIndex].normal;
-			vertices[index].color = m_vertexList[vertexIndex].color;
-			indices[index] = index;
-            // Also store the vertex position information in the node vertex array.
-			node->vertexArray[index].x = m_vertexList[vertexIndex].position.x;
-			node->vertexArray[index].y = m_vertexList[vertexIndex].position.y;
-			node->vertexArray[index].z = m_vertexList[vertexIndex].position.z;
-            // Increment the indexes.
-			index++;
-			vertexIndex++;
-
-            // Do the same for the 2nd vertex.
-			vertices[index].position = m_vertexList[vertexIndex].position;
-			vertices[index].texture = m_vertexList[vertexIndex].texture;
-			vertices[index].normal = m_vertexList[vertexIndex].normal;
-			vertices[index].color = m_vertexList[vertexIndex].color;
-			indices[index] = index;
-            node->vertexArray[index].x = m_vertexList[vertexIndex].position.x;
-			node->vertexArray[index].y = m_vertexList[vertexIndex].position.y;
-			node->vertexArray[index].z = m_vertexList[vertexIndex].position.z;
-			index++;
-			vertexIndex++;
-
-			// Do the same for the 3rd vertex.
-			vertices[index].position = m_vertexList[vertexIndex].position;
-			vertices[index].texture = m_vertexList[vertexIndex].texture;
-			vertices[index].normal = m_vertexList[vertexIndex].normal;
-			vertices[index].color = m_vertexList[vertexIndex].color;
-			indices[index] = index;
-			node->vertexArray[index].x = m_vertexList[vertexIndex].position.x;
-			node->vertexArray[index].y = m_vertexList[vertexIndex].position.y;
-			node->vertexArray[index].z = m_vertexList[vertexIndex].position.z;
-			index++;
-		}
-	}
-
-/*
-	// Set up the description of the vertex buffer.
-    vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    vertexBufferDesc.ByteWidth = sizeof(vertex_t) * vertexCount;
-    vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    vertexBufferDesc.CPUAccessFlags = 0;
-    vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-
-	// Give the subresource structure a pointer to the vertex data.
-    vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-
-	// Now finally create the vertex buffer.
-    device->CreateBuffer(&vertexBufferDesc, &vertexData, &node->vertexBuffer);
-
-	// Set up the description of the index buffer.
+		return false;
+	}
+
+	// One index buffer for every leaf, into the vertex buffer of the mesh the tree was built from.
     indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    indexBufferDesc.ByteWidth = sizeof(unsigned long) * vertexCount;
+    indexBufferDesc.ByteWidth = sizeof(uint32) * (UINT)m_leafIndices.size();
     indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
     indexBufferDesc.CPUAccessFlags = 0;
     indexBufferDesc.MiscFlags = 0;
 	indexBufferDesc.StructureByteStride = 0;
 
 	// Give the subresource structure a pointer to the index data.
-    indexData.pSysMem = indices;
+    indexData.pSysMem = m_leafIndices.data();
 	indexData.SysMemPitch = 0;
 	indexData.SysMemSlicePitch = 0;
 
 	// Create the index buffer.
-	device->CreateBuffer(&indexBufferDesc, &indexData, &node->indexBuffer);
-*/
-
-	// Release the vertex and index arrays now that the data is stored in the buffers in the node.
-	delete [] vertices;
-	vertices = nullptr;
+	result = device->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer);
+	if(FAILED(result))
+	{
+		return false;
+	}
 
-	delete [] indices;
-	indices = nullptr;
+	// The whole array is on the card now.
+	m_indexBufferCount = (uint32)m_leafIndices.size();
+	m_dirtyFirstIndex = 0xFFFFFFFF;
+	m_dirtyLastIndex = 0;
 
-	return;
+	return true;
 }
 
 
-int QuadTree::CountTriangles(float positionX, float positionZ, float width)
+bool QuadTree::UpdateBuffers(ID3D11Device* device, ID3D11DeviceContext* deviceContext)
 {
-	int count, i;
-	bool result;
+	D3D11_BOX box;
 
 
-	// Initialize the count to zero.
-	count = 0;
+	if(m_dirtyFirstIndex >= m_dirtyLastIndex)
+	{
+		return true;
+	}
 
-	// Go through all the triangles in the entire mesh and check which ones should be inside this node.
-	for(i=0; i<m_triangleCount; i++)
+	// An array that grew past the buffer needs a new buffer, otherwise only the changed part is copied.
+	if(!m_indexBuffer || (m_leafIndices.size() > m_indexBufferCount))
 	{
-		// If the triangle is inside the node then increment the count by one.
-		result = IsTriangleContained(i, positionX, positionZ, width);
-		if(result == true)
+		if(m_indexBuffer)
 		{
-			count++;
+			m_indexBuffer->Release();
+			m_indexBuffer = nullptr;
 		}
+
+		return InitBuffers(device);
 	}
 
-	return count;
-}
+	box.left = m_dirtyFirstIndex * sizeof(uint32);
+	box.right = m_dirtyLastIndex * sizeof(uint32);
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+	deviceContext->UpdateSubresource(m_indexBuffer, 0, &box, &m_leafIndices[m_dirtyFirstIndex], 0, 0);
 
+	m_dirtyFirstIndex = 0xFFFFFFFF;
+	m_dirtyLastIndex = 0;
 
-bool QuadTree::IsTriangleContained(int index, float positionX, float positionZ, float width)
-{
-	float radius;
-	int vertexIndex;
-	float x1, z1, x2, z2, x3, z3;
-	float minimumX, maximumX, minimumZ, maximumZ;
+	return true;
+}
 
 
-	// Calculate the radius of this node.
-	radius = width / 2.0f;
+void QuadTree::Render(Frustum* frustum, ID3D11DeviceContext* deviceContext, Shader* shader)
+{
+	// Cull and draw the same frame.
+	Cull(frustum, m_drawRanges);
+	Submit(m_drawRanges, deviceContext, shader);
 
-	// Get the index into the vertex list.
-	vertexIndex = index * 3;
+	return;
+}
 
-	// Get the three vertices of this triangle from the vertex list.
-	x1 = m_vertexList[vertexIndex].position.x;
-	z1 = m_vertexList[vertexIndex].position.z;
-	vertexIndex++;
-	
-	x2 = m_vertexList[vertexIndex].position.x;
-	z2 = m_vertexList[vertexIndex].position.z;
-	vertexIndex++;
 
-	x3 = m_vertexList[vertexIndex].position.x;
-	z3 = m_vertexList[vertexIndex].position.z;
+void QuadTree::Submit(const std::vector<drawRange_t>& drawRanges, ID3D11DeviceContext* deviceContext, Shader* shader)
+{
+	size_t i;
 
-	// Check to see if the minimum of the x coordinates of the triangle is inside the node.
-	minimumX = min(x1, min(x2, x3));
-	if(minimumX > (positionX + radius))
-	{
-		return false;
-	}
 
-	// Check to see if the maximum of the x coordinates of the triangle is inside the node.
-	maximumX = max(x1, max(x2, x3));
-	if(maximumX < (positionX - radius))
+	if(drawRanges.empty() || !m_indexBuffer)
 	{
-		return false;
+		return;
 	}
 
-	// Check to see if the minimum of the z coordinates of the triangle is inside the node.
-	minimumZ = min(z1, min(z2, z3));
-	if(minimumZ > (positionZ + radius))
-	{
-		return false;
-	}
+	// Every leaf draws from the same index buffer.
+    deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	// Check to see if the maximum of the z coordinates of the triangle is inside the node.
-	maximumZ = max(z1, max(z2, z3));
-	if(maximumZ < (positionZ - radius))
+	// Render each range of the index buffer with the game world shader.
+	for(i=0; i<drawRanges.size(); i++)
 	{
-		return false;
+		shader->PublicRenderShader(deviceContext, (int)drawRanges[i].indexCount, (int)drawRanges[i].firstIndex);
 	}
 
-	return true;
+	return;
 }
+#endif
 
 
-void QuadTree::ReleaseNode(node_t* node)
+uint32 QuadTree::Cull(Frustum* frustum, std::vector<drawRange_t>& drawRanges)
 {
-	int i;
-
-
-	// Recursively go down the tree and release the bottom nodes first.
-	for(i=0; i<4; i++)
-	{
-		if(node->nodes[i] != nullptr)
-		{
-			ReleaseNode(node->nodes[i]);
-		}
-	}
-
-	// Release the vertex buffer for this node.
-	if(node->vertexBuffer)
-	{
-		node->vertexBuffer->Release();
-		node->vertexBuffer = nullptr;
-	}
+	// Reset the number of triangles that are drawn for this frame.
+	drawRanges.clear();
+	m_visibilityStats = {};
+	m_drawCount = 0;
 
-	// Release the index buffer for this node.
-	if(node->indexBuffer)
+	if(m_nodes.empty())
 	{
-		node->indexBuffer->Release();
-		node->indexBuffer = nullptr;
+		return 0;
 	}
 
-	// Release the vertex array for this node.
-	if(node->vertexArray)
-	{
-		delete [] node->vertexArray;
-		node->vertexArray = nullptr;
-	}
+	// Collect each node that is visible starting at the parent node and moving down the tree.
+	CullNode(0, FRUSTUM_ALL_PLANES, frustum, drawRanges);
 
-	// Release the four child nodes.
-	for(i=0; i<4; i++)
-	{
-		if(node->nodes[i])
-		{
-			delete node->nodes[i];
-			node->nodes[i] = nullptr;
-		}
-	}
+	m_visibilityStats.drawRanges = (uint32)drawRanges.size();
+	m_drawCount = (int)m_visibilityStats.triangles;
 
-	return;
+	return m_visibilityStats.triangles;
 }
 
 
-void QuadTree::RenderNode(node_t* node, Frustum* frustum, ID3D11DeviceContext* deviceContext, Shader* shader)
+void QuadTree::CullNode(uint32 nodeIndex, uint32 planeMask, Frustum* frustum, std::vector<drawRange_t>& drawRanges)
 {
 	bool result;
-	int count, i, indexCount;
-	unsigned int stride, offset;
+	uint32 i;
+	const node_t& node = m_nodes[nodeIndex];
 
 
 	// Check to see if the node can be viewed, height doesn't matter in a quad tree.
-	result = frustum->CheckCube(node->positionX, 0.0f, node->positionZ, (node->width / 2.0f));
+	// Only the planes the parent straddled are tested, and the one that culled this node last frame goes first.
+	m_visibilityStats.nodesTested++;
+	result = frustum->CheckRectangleMasked(node.positionX, 0.0f, node.positionZ, (node.width / 2.0f), (node.width / 2.0f), (node.width / 2.0f),
+	                                       planeMask, m_lastFailedPlanes[nodeIndex]);
 
 	// If it can't be seen then none of its children can either so don't continue down the tree, this is where the speed is gained.
 	if(!result)
@@ -485,147 +568,1033 @@ void QuadTree::RenderNode(node_t* node, Frustum* frustum, ID3D11DeviceContext* d
 		return;
 	}
 
-	// If it can be seen then check all four child nodes to see if they can also be seen.
-	count = 0;
-	for(i=0; i<4; i++)
+	// Leaves own triangles, and so can a parent that was given some by an update where it had no child.
+	if(node.triangleCount > 0)
 	{
-		if(node->nodes[i] != nullptr)
+		// Sibling leaves own neighbouring parts of the index array, so their ranges usually join into one draw.
+		if(!drawRanges.empty() && (drawRanges.back().firstIndex + drawRanges.back().indexCount == node.firstIndex))
+		{
+			drawRanges.back().indexCount += node.triangleCount * 3;
+		}
+		else
 		{
-			count++;
-			RenderNode(node->nodes[i], frustum, deviceContext, shader);
+			drawRange_t range = { node.firstIndex, node.triangleCount * 3 };
+			drawRanges.push_back(range);
 		}
+
+		// Increase the count of the number of polygons that are visible during this frame.
+		m_visibilityStats.triangles += node.triangleCount;
 	}
 
-	// If there were any children nodes then there is no need to continue as parent nodes won't contain any triangles to render.
-	if(count != 0)
+	if(node.childCount == 0)
 	{
+		m_visibilityStats.visibleLeaves++;
 		return;
 	}
 
-	// Otherwise if this node can be seen and has triangles in it then render these triangles.
-
-	// Set vertex buffer stride and offset.
-    stride = sizeof(vertex_t); 
-	offset = 0;
-
-	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetVertexBuffers(0, 1, &node->vertexBuffer, &stride, &offset);
-
-    // Set the index buffer to active in the input assembler so it can be rendered.
-    deviceContext->IASetIndexBuffer(node->indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-
-    // Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	// Determine the number of indices in this node.
-	indexCount = node->triangleCount * 3;
-
-	// Call the game world shader to render the polygons in this node.
-	shader->PublicRenderShader(deviceContext, indexCount);
-
-	// Increase the count of the number of polygons that have been rendered during this frame.
-	m_drawCount += node->triangleCount;
+	// If it can be seen then check all the child nodes to see if they can also be seen.
+	for(i=0; i<node.childCount; i++)
+	{
+		CullNode(node.firstChild + i, planeMask, frustum, drawRanges);
+	}
 
 	return;
 }
 
 
-bool QuadTree::GetHeightAtPosition(float positionX, float positionZ, float& height)
+const QuadTree::visibilityStats_t& QuadTree::GetVisibilityStats()
 {
-	float meshMinX, meshMaxX, meshMinZ, meshMaxZ;
+	return m_visibilityStats;
+}
 
 
-	meshMinX = m_rootNode->positionX - (m_rootNode->width / 2.0f);
-	meshMaxX = m_rootNode->positionX + (m_rootNode->width / 2.0f);
+const QuadTree::updateStats_t& QuadTree::GetUpdateStats()
+{
+	return m_updateStats;
+}
 
-	meshMinZ = m_rootNode->positionZ - (m_rootNode->width / 2.0f);
-	meshMaxZ = m_rootNode->positionZ + (m_rootNode->width / 2.0f);
 
-	// Make sure the coordinates are actually over a polygon.
-	if((positionX < meshMinX) || (positionX > meshMaxX) || (positionZ < meshMinZ) || (positionZ > meshMaxZ))
-	{
-		return false;
-	}
+int QuadTree::GetDrawCount()
+{
+	return m_drawCount;
+}
 
-	// Find the node which contains the polygon for this position.
-	FindNode(m_rootNode, positionX, positionZ, height);
-	
-	return true;
+
+const QuadTree::buildStats_t& QuadTree::GetBuildStats()
+{
+	return m_buildStats;
 }
 
 
-void QuadTree::FindNode(node_t* node, float x, float z, float& height)
+void QuadTree::CalculateMeshDimensions(float& centerX, float& centerZ, float& meshWidth)
 {
-	float xMin, xMax, zMin, zMax;
-	int count, i, index;
-	float vertex1[3], vertex2[3], vertex3[3];
-	bool foundHeight;
+	int i, vertexCount;
+	float maxWidth, maxDepth, minWidth, minDepth, width, depth, maxX, maxZ;
 
 
-	// Calculate the dimensions of this node.
-	xMin = node->positionX - (node->width / 2.0f);
-	xMax = node->positionX + (node->width / 2.0f);
+	// Every corner of every triangle counts, just like the unindexed vertex list did.
+	vertexCount = m_triangleCount * 3;
 
-	zMin = node->positionZ - (node->width / 2.0f);
-	zMax = node->positionZ + (node->width / 2.0f);
+	// Initialize the center position of the mesh to zero.
+	centerX = 0.0f;
+	centerZ = 0.0f;
 
-	// See if the x and z coordinate are in this node, if not then stop traversing this part of the tree.
-	if((x < xMin) || (x > xMax) || (z < zMin) || (z > zMax))
+	// Sum all the vertices in the mesh.
+	for(i=0; i<vertexCount; i++)
 	{
-		return;
+		centerX += m_positions[m_indices[i]].x;
+		centerZ += m_positions[m_indices[i]].z;
 	}
 
-	// If the coordinates are in this node then check first to see if children nodes exist.
-	count = 0;
+	// And then divide it by the number of vertices to find the mid-point of the mesh.
+	centerX = centerX / (float)vertexCount;
+	centerZ = centerZ / (float)vertexCount;
 
-	for(i=0; i<4; i++)
-	{
-		if(node->nodes[i] != 0)
-		{
-			count++;
-			FindNode(node->nodes[i], x, z, height);
-		}
-	}
+	// Initialize the maximum and minimum size of the mesh.
+	maxWidth = 0.0f;
+	maxDepth = 0.0f;
 
-	// If there were children nodes then return since the polygon will be in one of the children.
-	if(count > 0)
-	{
-		return;
-	}
+	minWidth = fabsf(m_positions[m_indices[0]].x - centerX);
+	minDepth = fabsf(m_positions[m_indices[0]].z - centerZ);
 
-	// If there were no children then the polygon must be in this node.  Check all the polygons in this node to find 
-	// the height of which one the polygon we are looking for.
-	for(i=0; i<node->triangleCount; i++)
+	// Go through all the vertices and find the maximum and minimum width and depth of the mesh.
+	for(i=0; i<vertexCount; i++)
 	{
-		index = i * 3;
-		vertex1[0] = node->vertexArray[index].x;
-		vertex1[1] = node->vertexArray[index].y;
-		vertex1[2] = node->vertexArray[index].z;
-
-		index++;
-		vertex2[0] = node->vertexArray[index].x;
-		vertex2[1] = node->vertexArray[index].y;
-		vertex2[2] = node->vertexArray[index].z;
+		width = fabsf(m_positions[m_indices[i]].x - centerX);
+		depth = fabsf(m_positions[m_indices[i]].z - centerZ);
 
-		index++;
-		vertex3[0] = node->vertexArray[index].x;
-		vertex3[1] = node->vertexArray[index].y;
-		vertex3[2] = node->vertexArray[index].z;
+		if(width > maxWidth) { maxWidth = width; }
+		if(depth > maxDepth) { maxDepth = depth; }
+		if(width < minWidth) { minWidth = width; }
+		if(depth < minDepth) { minDepth = depth; }
+	}
+
+	// Find the absolute maximum value between the min and max depth and width.
+	maxX = fmaxf(fabsf(minWidth), fabsf(maxWidth));
+	maxZ = fmaxf(fabsf(minDepth), fabsf(maxDepth));
+
+	// Calculate the maximum diameter of the mesh.
+	meshWidth = fmaxf(maxX, maxZ) * 2.0f;
+
+	return;
+}
+
+
+void QuadTree::CreateTreeNode(buildNode_t* node, float positionX, float positionZ, float width, int depth,
+	                          std::vector<uint32>& triangles, JobPool* jobPool)
+{
+	int numTriangles, i;
+	float offsetX, offsetZ, radius;
+	float childMinX[4], childMaxX[4], childMinZ[4], childMaxZ[4];
+
+
+	// Store the node position and size.
+	node->positionX = positionX;
+	node->positionZ = positionZ;
+	node->width = width;
+
+	// Initialize the children nodes of this node to null.
+	node->nodes[0] = nullptr;
+	node->nodes[1] = nullptr;
+	node->nodes[2] = nullptr;
+	node->nodes[3] = nullptr;
+
+	// The parent has already picked out the triangles that are inside this node.
+	numTriangles = (int)triangles.size();
+
+	// Case 1: If there are no triangles in this node then return as it is empty and requires no processing.
+	if(numTriangles == 0)
+	{
+		return;
+	}
+
+	// Case 2: If there are too many triangles in this node then split it into four equal sized smaller tree nodes.
+	if((numTriangles > MAX_TRIANGLES) && (depth < QUADTREE_MAX_DEPTH))
+	{
+		std::vector<uint32> childTriangles[4];
+		std::vector<buildJob_t> jobs;
+		JobCounter counter(0);
+
+		// Calculate the extent of each child node, the same way the child will work out its own.
+		radius = (width / 2.0f) / 2.0f;
+		for(i=0; i<4; i++)
+		{
+			offsetX = (((i % 2) < 1) ? -1.0f : 1.0f) * (width / 4.0f);
+			offsetZ = (((i % 4) < 2) ? -1.0f : 1.0f) * (width / 4.0f);
+
+			childMinX[i] = (positionX + offsetX) - radius;
+			childMaxX[i] = (positionX + offsetX) + radius;
+			childMinZ[i] = (positionZ + offsetZ) - radius;
+			childMaxZ[i] = (positionZ + offsetZ) + radius;
+		}
+
+		// Hand each triangle to every child it touches, in one pass over this node's list.
+		for(size_t t=0; t<triangles.size(); t++)
+		{
+			const triangleBounds_t& bounds = m_triangleBounds[triangles[t]];
+
+			for(i=0; i<4; i++)
+			{
+				if((bounds.minX <= childMaxX[i]) && (bounds.maxX >= childMinX[i]) &&
+				   (bounds.minZ <= childMaxZ[i]) && (bounds.maxZ >= childMinZ[i]))
+				{
+					childTriangles[i].push_back(triangles[t]);
+				}
+			}
+		}
+		m_trianglesTested += (uint64)numTriangles * 4;
+
+		// This node's list has been handed down, so it can go.
+		std::vector<uint32>().swap(triangles);
+
+		for(i=0; i<4; i++)
+		{
+			// If there are triangles inside where this new node would be then create the child node.
+			if(childTriangles[i].empty())
+			{
+				continue;
+			}
+
+			node->nodes[i] = new buildNode_t;
+			if(!node->nodes[i])
+			{
+				continue;
+			}
+
+			offsetX = (((i % 2) < 1) ? -1.0f : 1.0f) * (width / 4.0f);
+			offsetZ = (((i % 4) < 2) ? -1.0f : 1.0f) * (width / 4.0f);
+
+			// Big children are built as jobs, the rest straight away.
+			if(jobPool && ((int)childTriangles[i].size() >= QUADTREE_JOB_TRIANGLES))
+			{
+				buildJob_t job;
+				job.tree = this;
+				job.node = node->nodes[i];
+				job.positionX = positionX + offsetX;
+				job.positionZ = positionZ + offsetZ;
+				job.width = width / 2.0f;
+				job.depth = depth + 1;
+				job.jobPool = jobPool;
+				job.triangles.swap(childTriangles[i]);
+				jobs.push_back(job);
+			}
+			else
+			{
+				CreateTreeNode(node->nodes[i], (positionX + offsetX), (positionZ + offsetZ), (width / 2.0f), depth + 1,
+				               childTriangles[i], jobPool);
+			}
+		}
+
+		// Submit the jobs once the list has stopped growing, then help build them.
+		for(size_t j=0; j<jobs.size(); j++)
+		{
+			jobPool->Submit(CreateTreeNodeJob, &jobs[j], &counter);
+		}
+		if(!jobs.empty())
+		{
+			jobPool->Wait(counter);
+		}
+
+		return;
+	}
+
+	// Case 3: If this node is not empty and the triangle count for it is less than the max then
+	// this node is at the bottom of the tree so keep the list of triangles in it.
+	node->triangles.swap(triangles);
+
+	return;
+}
+
+
+void QuadTree::CreateTreeNodeJob(void* data)
+{
+	buildJob_t* job = (buildJob_t*)data;
+
+	job->tree->CreateTreeNode(job->node, job->positionX, job->positionZ, job->width, job->depth,
+	                          job->triangles, job->jobPool);
+
+	return;
+}
+
+
+void QuadTree::FlattenTree(buildNode_t* rootNode)
+{
+	size_t i, leafIndexCount;
+	int j;
+	std::vector<buildNode_t*> order;
+
+
+	// Breadth first: a node's place in the order is its place in the array, and its
+	// children are added to the end of the order together.
+	order.push_back(rootNode);
+	leafIndexCount = 0;
+	for(i=0; i<order.size(); i++)
+	{
+		for(j=0; j<4; j++)
+		{
+			if(order[i]->nodes[j] != nullptr)
+			{
+				order.push_back(order[i]->nodes[j]);
+			}
+		}
+		leafIndexCount += order[i]->triangles.size() * 3;
+	}
+
+	m_nodes.resize(order.size());
+	m_lastFailedPlanes.assign(order.size(), 0);
+	m_leafIndices.resize(leafIndexCount);
+
+	uint32 firstChild = 1;
+	uint32 firstIndex = 0;
+	for(i=0; i<order.size(); i++)
+	{
+		buildNode_t* buildNode = order[i];
+		node_t& node = m_nodes[i];
+
+		node.positionX = buildNode->positionX;
+		node.positionZ = buildNode->positionZ;
+		node.width = buildNode->width;
+
+		node.childCount = 0;
+		for(j=0; j<4; j++)
+		{
+			if(buildNode->nodes[j] != nullptr)
+			{
+				node.childCount++;
+			}
+		}
+		node.firstChild = (node.childCount > 0) ? firstChild : 0;
+		firstChild += node.childCount;
+
+		// Copy the leaf's triangles into its range of the shared index array.
+		node.firstIndex = firstIndex;
+		node.triangleCount = (uint32)buildNode->triangles.size();
+		node.triangleCapacity = node.triangleCount;
+		for(size_t t=0; t<buildNode->triangles.size(); t++)
+		{
+			m_leafIndices[firstIndex++] = m_indices[buildNode->triangles[t] * 3];
+			m_leafIndices[firstIndex++] = m_indices[buildNode->triangles[t] * 3 + 1];
+			m_leafIndices[firstIndex++] = m_indices[buildNode->triangles[t] * 3 + 2];
+		}
+	}
+
+	return;
+}
+
+
+void QuadTree::CountNodes()
+{
+	uint32 i, j;
+	std::vector<uint32> depth(m_nodes.size(), 0);
+
+
+	m_buildStats = {};
+	m_buildStats.nodes = (uint32)m_nodes.size();
+
+	// Parents always come before their children, so one pass hands the depths down.
+	for(i=0; i<(uint32)m_nodes.size(); i++)
+	{
+		for(j=0; j<m_nodes[i].childCount; j++)
+		{
+			depth[m_nodes[i].firstChild + j] = depth[i] + 1;
+		}
+
+		if(depth[i] > m_buildStats.maxDepth)
+		{
+			m_buildStats.maxDepth = depth[i];
+		}
+
+		if(m_nodes[i].childCount == 0)
+		{
+			m_buildStats.leaves++;
+			m_buildStats.leafTriangles += m_nodes[i].triangleCount;
+		}
+	}
+
+	m_buildStats.groundCells = (uint32)m_groundCells;
+	m_buildStats.groundTriangles = m_groundIndices.size() / 3;
+
+	return;
+}
+
+
+void QuadTree::BuildGroundGrid()
+{
+	int i, cell, minColumn, maxColumn, minRow, maxRow, column, row;
+	std::vector<uint32> groundTriangles;
+	std::vector<int> triangleCells;
+
+
+	// Only triangles that can be stood on go in the grid.
+	for(i=0; i<m_triangleCount; i++)
+	{
+		if(IsGroundTriangle(m_indices[i * 3], m_indices[i * 3 + 1], m_indices[i * 3 + 2]))
+		{
+			groundTriangles.push_back((uint32)i);
+		}
+	}
+
+	// About two ground triangles per cell, over the root square.
+	m_groundCells = (int)ceil(sqrt((double)groundTriangles.size() / 2.0));
+	if(m_groundCells < 1)
+	{
+		m_groundCells = 1;
+	}
+	if(m_groundCells > QUADTREE_MAX_GROUND_CELLS)
+	{
+		m_groundCells = QUADTREE_MAX_GROUND_CELLS;
+	}
+	m_groundMinX = m_nodes[0].positionX - (m_nodes[0].width / 2.0f);
+	m_groundMinZ = m_nodes[0].positionZ - (m_nodes[0].width / 2.0f);
+	m_groundCellSize = m_nodes[0].width / (float)m_groundCells;
+
+	// Count the triangles of every cell, then give each cell its range and fill them in mesh order.
+	m_groundCellStarts.assign((size_t)m_groundCells * m_groundCells + 1, 0);
+	triangleCells.resize(groundTriangles.size() * 4);
+	for(size_t t=0; t<groundTriangles.size(); t++)
+	{
+		const triangleBounds_t& bounds = m_triangleBounds[groundTriangles[t]];
+
+		// The ray test accepts points a hair outside the edges, so the bounds are padded to match.
+		cell = GetGroundCell(bounds.minX - QUADTREE_GROUND_PADDING, bounds.minZ - QUADTREE_GROUND_PADDING);
+		minColumn = cell % m_groundCells;
+		minRow = cell / m_groundCells;
+		cell = GetGroundCell(bounds.maxX + QUADTREE_GROUND_PADDING, bounds.maxZ + QUADTREE_GROUND_PADDING);
+		maxColumn = cell % m_groundCells;
+		maxRow = cell / m_groundCells;
+
+		triangleCells[t * 4] = minColumn;
+		triangleCells[t * 4 + 1] = maxColumn;
+		triangleCells[t * 4 + 2] = minRow;
+		triangleCells[t * 4 + 3] = maxRow;
+
+		for(row=minRow; row<=maxRow; row++)
+		{
+			for(column=minColumn; column<=maxColumn; column++)
+			{
+				m_groundCellStarts[row * m_groundCells + column + 1]++;
+			}
+		}
+	}
+
+	for(i=0; i<m_groundCells * m_groundCells; i++)
+	{
+		m_groundCellStarts[i + 1] += m_groundCellStarts[i];
+	}
+
+	std::vector<uint32> cellFill(m_groundCellStarts.begin(), m_groundCellStarts.end() - 1);
+	m_groundIndices.resize((size_t)m_groundCellStarts.back() * 3);
+	for(size_t t=0; t<groundTriangles.size(); t++)
+	{
+		for(row=triangleCells[t * 4 + 2]; row<=triangleCells[t * 4 + 3]; row++)
+		{
+			for(column=triangleCells[t * 4]; column<=triangleCells[t * 4 + 1]; column++)
+			{
+				uint32 entry = cellFill[row * m_groundCells + column]++;
+
+				m_groundIndices[entry * 3] = m_indices[groundTriangles[t] * 3];
+				m_groundIndices[entry * 3 + 1] = m_indices[groundTriangles[t] * 3 + 1];
+				m_groundIndices[entry * 3 + 2] = m_indices[groundTriangles[t] * 3 + 2];
+			}
+		}
+	}
+
+	// The cell starts count triangles, the queries want index positions.
+	for(i=0; i<m_groundCells * m_groundCells + 1; i++)
+	{
+		m_groundCellStarts[i] *= 3;
+	}
+
+	return;
+}
+
+
+bool QuadTree::IsGroundTriangle(uint32 index1, uint32 index2, uint32 index3)
+{
+	const Vector3_t& v0 = m_positions[index1];
+	const Vector3_t& v1 = m_positions[index2];
+	const Vector3_t& v2 = m_positions[index3];
+	float edge1[3] = { v1.x - v0.x, v1.y - v0.y, v1.z - v0.z };
+	float edge2[3] = { v2.x - v0.x, v2.y - v0.y, v2.z - v0.z };
+	float normal[3], magnitude;
+
+
+	normal[0] = (edge1[1] * edge2[2]) - (edge1[2] * edge2[1]);
+	normal[1] = (edge1[2] * edge2[0]) - (edge1[0] * edge2[2]);
+	normal[2] = (edge1[0] * edge2[1]) - (edge1[1] * edge2[0]);
+
+	// Walls can't be stood on, the ray test never hits a triangle whose normal is this flat.
+	// Triangles with no area, like the ones a patched mesh leaves behind, have no normal at all.
+	magnitude = (float)sqrt((normal[0] * normal[0]) + (normal[1] * normal[1]) + (normal[2] * normal[2]));
+	if(!(magnitude > 0.0f))
+	{
+		return false;
+	}
+
+	return !(fabs(normal[1] / magnitude) < 0.0001f);
+}
+
+
+int QuadTree::GetGroundCell(float x, float z)
+{
+	int column, row;
+
+
+	// Points on or past the edge of the grid belong to the outer cells.
+	column = (int)floorf((x - m_groundMinX) / m_groundCellSize);
+	row = (int)floorf((z - m_groundMinZ) / m_groundCellSize);
+
+	column = (column < 0) ? 0 : ((column >= m_groundCells) ? m_groundCells - 1 : column);
+	row = (row < 0) ? 0 : ((row >= m_groundCells) ? m_groundCells - 1 : row);
+
+	return row * m_groundCells + column;
+}
+
+
+void QuadTree::GetTriangleBounds(const uint32* corners, triangleBounds_t& bounds)
+{
+	const Vector3_t& v1 = m_positions[corners[0]];
+	const Vector3_t& v2 = m_positions[corners[1]];
+	const Vector3_t& v3 = m_positions[corners[2]];
+
+
+	bounds.minX = fminf(v1.x, fminf(v2.x, v3.x));
+	bounds.maxX = fmaxf(v1.x, fmaxf(v2.x, v3.x));
+	bounds.minZ = fminf(v1.z, fminf(v2.z, v3.z));
+	bounds.maxZ = fmaxf(v1.z, fmaxf(v2.z, v3.z));
+
+	return;
+}
+
+
+void QuadTree::FindTriangleNodes(uint32 nodeIndex, const triangleBounds_t& bounds, uint32 triangle, std::vector<nodeTriangle_t>& nodeTriangles)
+{
+	uint32 i;
+	float radius;
+	const node_t& node = m_nodes[nodeIndex];
+
+
+	m_updateStats.nodesVisited++;
+
+	// Any node can own triangles once updates have run, not just leaves.
+	if(node.triangleCount > 0)
+	{
+		nodeTriangle_t entry = { nodeIndex, triangle };
+		nodeTriangles.push_back(entry);
+	}
+
+	// A triangle across the edge of a node is in every child it touches.
+	for(i=0; i<node.childCount; i++)
+	{
+		const node_t& child = m_nodes[node.firstChild + i];
+
+		radius = child.width / 2.0f;
+		if((bounds.minX <= child.positionX + radius) && (bounds.maxX >= child.positionX - radius) &&
+		   (bounds.minZ <= child.positionZ + radius) && (bounds.maxZ >= child.positionZ - radius))
+		{
+			FindTriangleNodes(node.firstChild + i, bounds, triangle, nodeTriangles);
+		}
+	}
+
+	return;
+}
+
+
+void QuadTree::RemoveNodeTriangles(uint32 nodeIndex, const uint32* removedCorners, nodeTriangle_t* nodeTriangles,
+	                               uint32 count, std::vector<uint8>& removed)
+{
+	uint32 i, j, last, filter[32];
+	uint32 first, end;
+	node_t& node = m_nodes[nodeIndex];
+
+
+	// A bit per first corner lets the scan skip nearly every triangle without looking at the list.
+	memset(filter, 0, sizeof(filter));
+	for(j=0; j<count; j++)
+	{
+		uint32 corner = removedCorners[nodeTriangles[j].triangle * 3];
+		filter[(corner >> 5) & 31] |= 1u << (corner & 31);
+	}
+
+	// One pass over the node's range for all of its removed triangles.
+	first = 0xFFFFFFFF;
+	end = 0;
+	i = 0;
+	while((i < node.triangleCount) && (count > 0))
+	{
+		uint32* triangle = &m_leafIndices[node.firstIndex + i * 3];
+
+		if(!(filter[(triangle[0] >> 5) & 31] & (1u << (triangle[0] & 31))))
+		{
+			i++;
+			continue;
+		}
+
+		for(j=0; j<count; j++)
+		{
+			const uint32* corners = &removedCorners[nodeTriangles[j].triangle * 3];
+
+			if((triangle[0] == corners[0]) && (triangle[1] == corners[1]) && (triangle[2] == corners[2]))
+			{
+				break;
+			}
+		}
+
+		if(j == count)
+		{
+			i++;
+			continue;
+		}
+
+		// Fill the hole with the last triangle of the range, and look at that one next.
+		last = node.firstIndex + (node.triangleCount - 1) * 3;
+		triangle[0] = m_leafIndices[last];
+		triangle[1] = m_leafIndices[last + 1];
+		triangle[2] = m_leafIndices[last + 2];
+		node.triangleCount--;
+
+		first = (node.firstIndex + i * 3 < first) ? node.firstIndex + i * 3 : first;
+		end = last + 3;
+
+		// Each copy of a triangle is taken out once.
+		removed[nodeTriangles[j].triangle] = 1;
+		nodeTriangles[j] = nodeTriangles[count - 1];
+		count--;
+	}
+
+	if(first < end)
+	{
+		MarkIndicesDirty(first, end);
+	}
+
+	return;
+}
+
+
+void QuadTree::AddNodeTriangle(uint32 nodeIndex, const triangleBounds_t& bounds, const uint32* corners)
+{
+	int i;
+	uint32 j, childIndex;
+	float offsetX, offsetZ, radius, nodeRadius;
+	bool ownRange;
+	const node_t& node = m_nodes[nodeIndex];
+
+
+	m_updateStats.nodesVisited++;
+
+	// Leaves keep the triangle, and so does a node the triangle sticks out of.
+	nodeRadius = node.width / 2.0f;
+	if((node.childCount == 0) ||
+	   (bounds.minX < node.positionX - nodeRadius) || (bounds.maxX > node.positionX + nodeRadius) ||
+	   (bounds.minZ < node.positionZ - nodeRadius) || (bounds.maxZ > node.positionZ + nodeRadius))
+	{
+		AppendNodeTriangle(nodeIndex, corners);
+		return;
+	}
+
+	// Hand it to every child square it touches, the same test the build uses.
+	// The build made no child for a square that had no triangles, so this node keeps the part that lands there.
+	ownRange = false;
+	radius = (node.width / 2.0f) / 2.0f;
+	for(i=0; i<4; i++)
+	{
+		offsetX = (((i % 2) < 1) ? -1.0f : 1.0f) * (node.width / 4.0f);
+		offsetZ = (((i % 4) < 2) ? -1.0f : 1.0f) * (node.width / 4.0f);
+
+		if(!((bounds.minX <= (node.positionX + offsetX) + radius) && (bounds.maxX >= (node.positionX + offsetX) - radius) &&
+		     (bounds.minZ <= (node.positionZ + offsetZ) + radius) && (bounds.maxZ >= (node.positionZ + offsetZ) - radius)))
+		{
+			continue;
+		}
+
+		childIndex = 0;
+		for(j=0; j<node.childCount; j++)
+		{
+			const node_t& child = m_nodes[node.firstChild + j];
+
+			if(((child.positionX < node.positionX) == (offsetX < 0.0f)) && ((child.positionZ < node.positionZ) == (offsetZ < 0.0f)))
+			{
+				childIndex = node.firstChild + j;
+				break;
+			}
+		}
+
+		if(childIndex == 0)
+		{
+			ownRange = true;
+			continue;
+		}
+
+		AddNodeTriangle(childIndex, bounds, corners);
+	}
+
+	if(ownRange)
+	{
+		AppendNodeTriangle(nodeIndex, corners);
+	}
+
+	return;
+}
+
+
+void QuadTree::AppendNodeTriangle(uint32 nodeIndex, const uint32* corners)
+{
+	uint32 capacity, first;
+	node_t& node = m_nodes[nodeIndex];
+
+
+	if(node.triangleCount == node.triangleCapacity)
+	{
+		// A range at the end of the array can grow where it is.
+		if((size_t)node.firstIndex + node.triangleCapacity * 3 == m_leafIndices.size())
+		{
+			capacity = node.triangleCapacity + QUADTREE_GROW_TRIANGLES;
+			m_leafIndices.resize((size_t)node.firstIndex + capacity * 3, corners[0]);
+		}
+		// Anywhere else it moves to the end, with room to spare. The old range is left unused.
+		else
+		{
+			capacity = (node.triangleCount * 2 > (uint32)QUADTREE_GROW_TRIANGLES) ? node.triangleCount * 2 : (uint32)QUADTREE_GROW_TRIANGLES;
+			first = (uint32)m_leafIndices.size();
+			m_leafIndices.resize((size_t)first + capacity * 3, corners[0]);
+			memmove(&m_leafIndices[first], &m_leafIndices[node.firstIndex], sizeof(uint32) * node.triangleCount * 3);
+
+			node.firstIndex = first;
+			MarkIndicesDirty(first, first + node.triangleCount * 3);
+			m_updateStats.movedNodes++;
+		}
+
+		node.triangleCapacity = capacity;
+	}
+
+	first = node.firstIndex + node.triangleCount * 3;
+	m_leafIndices[first] = corners[0];
+	m_leafIndices[first + 1] = corners[1];
+	m_leafIndices[first + 2] = corners[2];
+	node.triangleCount++;
+
+	MarkIndicesDirty(first, first + 3);
+
+	return;
+}
+
+
+void QuadTree::RemoveGroundTriangle(const triangleBounds_t& bounds, const uint32* corners)
+{
+	int minCell, maxCell, row, column, cell;
+	uint32 i;
+
+
+	minCell = GetGroundCell(bounds.minX - QUADTREE_GROUND_PADDING, bounds.minZ - QUADTREE_GROUND_PADDING);
+	maxCell = GetGroundCell(bounds.maxX + QUADTREE_GROUND_PADDING, bounds.maxZ + QUADTREE_GROUND_PADDING);
+
+	for(row=minCell / m_groundCells; row<=maxCell / m_groundCells; row++)
+	{
+		for(column=minCell % m_groundCells; column<=maxCell % m_groundCells; column++)
+		{
+			cell = row * m_groundCells + column;
+
+			// Built entries can't be taken out of their cell without moving every cell after it, so they are only marked.
+			for(i=m_groundCellStarts[cell]; i<m_groundCellStarts[cell + 1]; i+=3)
+			{
+				if((m_groundIndices[i] == corners[0]) && (m_groundIndices[i + 1] == corners[1]) && (m_groundIndices[i + 2] == corners[2]))
+				{
+					m_groundIndices[i] = 0xFFFFFFFF;
+					m_groundPatched = true;
+				}
+			}
+
+			std::unordered_map<uint32, std::vector<uint32>>::iterator added = m_groundAdded.find((uint32)cell);
+			if(added == m_groundAdded.end())
+			{
+				continue;
+			}
+
+			for(i=0; i<(uint32)added->second.size(); i+=3)
+			{
+				if((added->second[i] == corners[0]) && (added->second[i + 1] == corners[1]) && (added->second[i + 2] == corners[2]))
+				{
+					added->second.erase(added->second.begin() + i, added->second.begin() + i + 3);
+					break;
+				}
+			}
+		}
+	}
+
+	return;
+}
+
+
+void QuadTree::AddGroundTriangle(const triangleBounds_t& bounds, const uint32* corners)
+{
+	int minCell, maxCell, row, column;
+
+
+	minCell = GetGroundCell(bounds.minX - QUADTREE_GROUND_PADDING, bounds.minZ - QUADTREE_GROUND_PADDING);
+	maxCell = GetGroundCell(bounds.maxX + QUADTREE_GROUND_PADDING, bounds.maxZ + QUADTREE_GROUND_PADDING);
+
+	for(row=minCell / m_groundCells; row<=maxCell / m_groundCells; row++)
+	{
+		for(column=minCell % m_groundCells; column<=maxCell % m_groundCells; column++)
+		{
+			std::vector<uint32>& added = m_groundAdded[(uint32)(row * m_groundCells + column)];
+
+			added.push_back(corners[0]);
+			added.push_back(corners[1]);
+			added.push_back(corners[2]);
+		}
+	}
+
+	m_groundPatched = true;
+
+	return;
+}
+
+
+void QuadTree::CompactGroundGrid()
+{
+	int cell;
+	uint32 i;
+	std::vector<uint32> cellStarts, groundIndices;
+
+
+	// Rebuild the cell ranges from the entries still in use and the ones updates added.
+	cellStarts.resize(m_groundCellStarts.size());
+	groundIndices.reserve(m_groundIndices.size());
+	for(cell=0; cell<m_groundCells * m_groundCells; cell++)
+	{
+		cellStarts[cell] = (uint32)groundIndices.size();
+
+		for(i=m_groundCellStarts[cell]; i<m_groundCellStarts[cell + 1]; i+=3)
+		{
+			if(m_groundIndices[i] != 0xFFFFFFFF)
+			{
+				groundIndices.insert(groundIndices.end(), &m_groundIndices[i], &m_groundIndices[i] + 3);
+			}
+		}
+
+		std::unordered_map<uint32, std::vector<uint32>>::const_iterator added = m_groundAdded.find((uint32)cell);
+		if(added != m_groundAdded.end())
+		{
+			groundIndices.insert(groundIndices.end(), added->second.begin(), added->second.end());
+		}
+	}
+	cellStarts.back() = (uint32)groundIndices.size();
+
+	m_groundCellStarts.swap(cellStarts);
+	m_groundIndices.swap(groundIndices);
+	m_groundAdded.clear();
+	m_groundPatched = false;
 
-		// Check to see if this is the polygon we are looking for.
-		foundHeight = CheckHeightOfTriangle(x, z, height, vertex1, vertex2, vertex3);
+	return;
+}
+
+
+void QuadTree::MarkIndicesDirty(uint32 firstIndex, uint32 lastIndex)
+{
+	// One range covers every change, it is what gets copied to the index buffer.
+	if(firstIndex < m_dirtyFirstIndex)
+	{
+		m_dirtyFirstIndex = firstIndex;
+	}
+	if(lastIndex > m_dirtyLastIndex)
+	{
+		m_dirtyLastIndex = lastIndex;
+	}
+
+	return;
+}
+
+
+void QuadTree::ReleaseNode(buildNode_t* node)
+{
+	int i;
+
+
+	// Recursively go down the tree and release the bottom nodes first.
+	for(i=0; i<4; i++)
+	{
+		if(node->nodes[i] != nullptr)
+		{
+			ReleaseNode(node->nodes[i]);
+		}
+	}
+
+	// Release the four child nodes.
+	for(i=0; i<4; i++)
+	{
+		if(node->nodes[i])
+		{
+			delete node->nodes[i];
+			node->nodes[i] = nullptr;
+		}
+	}
+
+	return;
+}
+
+
+
+bool QuadTree::GetHeightAtPosition(float positionX, float positionZ, float& height)
+{
+	float meshMinX, meshMaxX, meshMinZ, meshMaxZ;
+	uint32 i;
+	int cell;
+
+
+	if(m_nodes.empty())
+	{
+		return false;
+	}
+
+	meshMinX = m_nodes[0].positionX - (m_nodes[0].width / 2.0f);
+	meshMaxX = m_nodes[0].positionX + (m_nodes[0].width / 2.0f);
+
+	meshMinZ = m_nodes[0].positionZ - (m_nodes[0].width / 2.0f);
+	meshMaxZ = m_nodes[0].positionZ + (m_nodes[0].width / 2.0f);
+
+	// Make sure the coordinates are actually over a polygon.
+	if((positionX < meshMinX) || (positionX > meshMaxX) || (positionZ < meshMinZ) || (positionZ > meshMaxZ))
+	{
+		return false;
+	}
+
+	// Test the ground triangles of the grid cell under this position, the first one hit gives the height.
+	cell = GetGroundCell(positionX, positionZ);
+	for(i=m_groundCellStarts[cell]; i<m_groundCellStarts[cell + 1]; i+=3)
+	{
+		if(CheckGroundTriangle(positionX, positionZ, &m_groundIndices[i], height))
+		{
+			return true;
+		}
+	}
 
-		// If this was the triangle then quit the function and the height will be returned to the calling function.
-		if(foundHeight)
+	// Then the ones updates added, they come after the others in the mesh.
+	if(!m_groundAdded.empty())
+	{
+		std::unordered_map<uint32, std::vector<uint32>>::const_iterator added = m_groundAdded.find((uint32)cell);
+		if(added != m_groundAdded.end())
 		{
-			return;
+			for(i=0; i<(uint32)added->second.size(); i+=3)
+			{
+				if(CheckGroundTriangle(positionX, positionZ, &added->second[i], height))
+				{
+					return true;
+				}
+			}
 		}
 	}
 
+	return false;
+}
+
+
+uint32 QuadTree::GetHeightsAtPositions(const Vector2_t* positions, uint32 count, float* heights, bool* found, JobPool* jobPool)
+{
+	std::vector<heightJob_t> jobs;
+	JobCounter counter(0);
+	uint32 i, foundCount;
+
+
+	// Small batches aren't worth the jobs.
+	if(!jobPool || (count <= (uint32)QUADTREE_HEIGHT_JOB_QUERIES))
+	{
+		return GetHeights(positions, count, heights, found);
+	}
+
+	// Every job answers its own slice of the positions, so the results don't depend on the worker count.
+	jobs.resize((count + QUADTREE_HEIGHT_JOB_QUERIES - 1) / QUADTREE_HEIGHT_JOB_QUERIES);
+	for(i=0; i<(uint32)jobs.size(); i++)
+	{
+		uint32 first = i * QUADTREE_HEIGHT_JOB_QUERIES;
+
+		jobs[i].tree = this;
+		jobs[i].positions = positions + first;
+		jobs[i].heights = heights + first;
+		jobs[i].found = found ? found + first : nullptr;
+		jobs[i].count = ((count - first) < (uint32)QUADTREE_HEIGHT_JOB_QUERIES) ? (count - first) : QUADTREE_HEIGHT_JOB_QUERIES;
+		jobs[i].foundCount = 0;
+	}
+
+	for(i=0; i<(uint32)jobs.size(); i++)
+	{
+		jobPool->Submit(GetHeightsJob, &jobs[i], &counter);
+	}
+	jobPool->Wait(counter);
+
+	foundCount = 0;
+	for(i=0; i<(uint32)jobs.size(); i++)
+	{
+		foundCount += jobs[i].foundCount;
+	}
+
+	return foundCount;
+}
+
+
+uint32 QuadTree::GetHeights(const Vector2_t* positions, uint32 count, float* heights, bool* found)
+{
+	uint32 i, foundCount;
+	bool hit;
+
+
+	// Positions that miss the ground keep the height they came in with, like GetHeightAtPosition.
+	foundCount = 0;
+	for(i=0; i<count; i++)
+	{
+		hit = GetHeightAtPosition(positions[i].x, positions[i].y, heights[i]);
+		if(found)
+		{
+			found[i] = hit;
+		}
+		if(hit)
+		{
+			foundCount++;
+		}
+	}
+
+	return foundCount;
+}
+
+
+void QuadTree::GetHeightsJob(void* data)
+{
+	heightJob_t* job = (heightJob_t*)data;
+
+
+	job->foundCount = job->tree->GetHeights(job->positions, job->count, job->heights, job->found);
+
 	return;
 }
 
 
+bool QuadTree::CheckGroundTriangle(float x, float z, const uint32* corners, float& height)
+{
+	float vertex1[3], vertex2[3], vertex3[3];
+
+
+	// Skip the triangles updates took out.
+	if(corners[0] == 0xFFFFFFFF)
+	{
+		return false;
+	}
+
+	vertex1[0] = m_positions[corners[0]].x;
+	vertex1[1] = m_positions[corners[0]].y;
+	vertex1[2] = m_positions[corners[0]].z;
+
+	vertex2[0] = m_positions[corners[1]].x;
+	vertex2[1] = m_positions[corners[1]].y;
+	vertex2[2] = m_positions[corners[1]].z;
+
+	vertex3[0] = m_positions[corners[2]].x;
+	vertex3[1] = m_positions[corners[2]].y;
+	vertex3[2] = m_positions[corners[2]].z;
+
+	return CheckHeightOfTriangle(x, z, height, vertex1, vertex2, vertex3);
+}
+
+
 bool QuadTree::CheckHeightOfTriangle(float x, float z, float& height, float v0[3], float v1[3], float v2[3])
 {
 	float startVector[3], directionVector[3], edge1[3], edge2[3], normal[3];
@@ -232,7 +232,7 @@ bool Shader::PublicSetShaderParameters(ID3D11DeviceContext* deviceContext, D3DXM
 // ----------------------------------------------------
 // Public function for rendering a shader
 // ----------------------------------------------------
-void Shader::PublicRenderShader(ID3D11DeviceContext* deviceContext, int indexCount)
+void Shader::PublicRenderShader(ID3D11DeviceContext* deviceContext, int indexCount, int startIndex)
 {
 	// Set the vertex input layout.
 	deviceContext->IASetInputLayout(m_layout);
@@ -244,8 +244,8 @@ void Shader::PublicRenderShader(ID3D11DeviceContext* deviceContext, int indexCou
     // Set the sampler state in the pixel shader.
 	deviceContext->PSSetSamplers(0, 1, &m_sampleState);
 
-	// Render the triangle.
-	deviceContext->DrawIndexed(indexCount, 0, 0);
+	// Render the triangles, starting part way into the index buffer if asked to.
+	deviceContext->DrawIndexed(indexCount, startIndex, 0);
 
 	return;
 }
@@ -0,0 +1,132 @@
+/*!
+  @file
+  sim_scheduler.cpp
+
+  @brief
+  Runs the simulation in fixed steps, whatever the frame rate is.
+
+  @detail
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "sim_scheduler.h"
+
+
+namespace Gumshoe {
+
+SimScheduler::SimScheduler()
+{
+	m_stepMs = SIM_STEP_MS;
+	m_maxSteps = SIM_MAX_STEPS_PER_FRAME;
+	m_accumulator = 0.0f;
+	m_stepCount = 0;
+	m_stats = {};
+}
+
+
+SimScheduler::~SimScheduler()
+{
+}
+
+
+bool SimScheduler::Init(float stepMs, uint32 maxSteps)
+{
+	if (stepMs <= 0.0f || maxSteps == 0)
+	{
+		return false;
+	}
+
+	m_stepMs = stepMs;
+	m_maxSteps = maxSteps;
+	Reset();
+
+	return true;
+}
+
+
+void SimScheduler::Reset()
+{
+	m_accumulator = 0.0f;
+	m_stepCount = 0;
+	m_stats = {};
+
+	return;
+}
+
+
+uint32 SimScheduler::Advance(float frameTime)
+{
+	uint32 steps;
+
+
+	m_stats.frames++;
+
+	// A timer that went backwards doesn't take time away
+	if (frameTime > 0.0f)
+	{
+		m_accumulator += frameTime;
+	}
+
+	steps = (uint32)(m_accumulator / m_stepMs);
+	m_accumulator -= (float)steps * m_stepMs;
+
+	// The subtraction can round to just under zero, or leave a whole step behind
+	if (m_accumulator < 0.0f)
+	{
+		m_accumulator = 0.0f;
+	}
+	else if (m_accumulator >= m_stepMs)
+	{
+		m_accumulator -= m_stepMs;
+		steps++;
+	}
+
+	// Drop the steps a stall left behind rather than falling further behind catching up
+	if (steps > m_maxSteps)
+	{
+		m_stats.clampedFrames++;
+		m_stats.droppedMs += (double)(steps - m_maxSteps) * m_stepMs;
+		steps = m_maxSteps;
+	}
+
+	m_stepCount += steps;
+	m_stats.steps += steps;
+
+	return steps;
+}
+
+
+float SimScheduler::GetStepTime()
+{
+	return m_stepMs;
+}
+
+
+float SimScheduler::GetAlpha()
+{
+	return m_accumulator / m_stepMs;
+}
+
+
+uint64 SimScheduler::GetStepCount()
+{
+	return m_stepCount;
+}
+
+
+const SimScheduler::schedulerStats_t& SimScheduler::GetStats()
+{
+	return m_stats;
+}
+
+
+void SimScheduler::ResetStats()
+{
+	m_stats = {};
+
+	return;
+}
+
+} // end of namespace Gumshoe
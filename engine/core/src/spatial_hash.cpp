@@ -0,0 +1,353 @@
+/*!
+  @file
+  spatial_hash.cpp
+
+  @brief
+  Broad phase for entity against entity queries.
+
+  @detail
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "spatial_hash.h"
+#include <math.h>
+
+
+namespace Gumshoe {
+
+// End of a bucket's list
+static const uint32 SPATIAL_HASH_NONE = 0xFFFFFFFF;
+
+
+SpatialHash::SpatialHash()
+{
+	m_cellSize = 1.0f;
+	m_inverseCellSize = 1.0f;
+	m_maxExtent = 0.0f;
+	m_bucketMask = 0;
+	m_entityCount = 0;
+	m_stats = {};
+}
+
+
+SpatialHash::~SpatialHash()
+{
+}
+
+
+bool SpatialHash::Init(float cellSize, uint32 maxEntities, uint32 bucketCount)
+{
+	uint32 buckets = 1;
+
+
+	if (cellSize <= 0.0f || maxEntities == 0)
+	{
+		return false;
+	}
+
+	if (bucketCount == 0)
+	{
+		bucketCount = maxEntities * SPATIAL_HASH_BUCKETS_PER_ENTITY;
+	}
+	while (buckets < bucketCount)
+	{
+		buckets <<= 1;
+	}
+
+	m_cellSize = cellSize;
+	m_inverseCellSize = 1.0f / cellSize;
+	m_maxExtent = 0.0f;
+	m_bucketMask = buckets - 1;
+	m_entityCount = 0;
+	m_buckets.assign(buckets, SPATIAL_HASH_NONE);
+
+	m_positionX.assign(maxEntities, 0.0f);
+	m_positionZ.assign(maxEntities, 0.0f);
+	m_extent.assign(maxEntities, 0.0f);
+	m_cellX.assign(maxEntities, 0);
+	m_cellZ.assign(maxEntities, 0);
+	m_next.assign(maxEntities, SPATIAL_HASH_NONE);
+	m_previous.assign(maxEntities, SPATIAL_HASH_NONE);
+	m_inserted.assign(maxEntities, 0);
+	m_stats = {};
+
+	return true;
+}
+
+
+void SpatialHash::Shutdown()
+{
+	m_buckets.clear();
+	m_positionX.clear();
+	m_positionZ.clear();
+	m_extent.clear();
+	m_cellX.clear();
+	m_cellZ.clear();
+	m_next.clear();
+	m_previous.clear();
+	m_inserted.clear();
+	m_entityCount = 0;
+
+	return;
+}
+
+
+bool SpatialHash::Insert(uint32 id, float x, float z, float extent)
+{
+	if (id >= (uint32)m_inserted.size() || m_inserted[id])
+	{
+		return false;
+	}
+
+	m_positionX[id] = x;
+	m_positionZ[id] = z;
+	m_extent[id] = extent;
+	m_inserted[id] = 1;
+	m_entityCount++;
+
+	if (extent > m_maxExtent)
+	{
+		m_maxExtent = extent;
+	}
+
+	Link(id, GetCell(x), GetCell(z));
+
+	return true;
+}
+
+
+bool SpatialHash::Remove(uint32 id)
+{
+	if (id >= (uint32)m_inserted.size() || !m_inserted[id])
+	{
+		return false;
+	}
+
+	Unlink(id);
+	m_inserted[id] = 0;
+	m_entityCount--;
+
+	return true;
+}
+
+
+bool SpatialHash::Move(uint32 id, float x, float z)
+{
+	if (id >= (uint32)m_inserted.size() || !m_inserted[id])
+	{
+		return false;
+	}
+
+	MoveEntities(&id, &x, &z, 1);
+
+	return true;
+}
+
+
+void SpatialHash::MoveEntities(const uint32* ids, const float* x, const float* z, uint32 count)
+{
+	// Without ids the positions are for entities 0 to count - 1, straight out of an entity array
+	for (uint32 i = 0; i < count; i++)
+	{
+		uint32 id = ids ? ids[i] : i;
+		if (!m_inserted[id])
+			continue;
+
+		int cellX = GetCell(x[i]);
+		int cellZ = GetCell(z[i]);
+
+		m_positionX[id] = x[i];
+		m_positionZ[id] = z[i];
+
+		// Most moves stay in the same cell and only change the position
+		if (cellX != m_cellX[id] || cellZ != m_cellZ[id])
+		{
+			Unlink(id);
+			Link(id, cellX, cellZ);
+			m_stats.cellChanges++;
+		}
+	}
+
+	m_stats.moves += count;
+
+	return;
+}
+
+
+uint32 SpatialHash::Query(float minX, float minZ, float maxX, float maxZ, std::vector<uint32>& ids)
+{
+	uint32 found = 0;
+
+
+	// An entity is filed by its centre, so its box can reach up to the biggest extent into the next cells
+	int firstCellX = GetCell(minX - m_maxExtent);
+	int lastCellX = GetCell(maxX + m_maxExtent);
+	int firstCellZ = GetCell(minZ - m_maxExtent);
+	int lastCellZ = GetCell(maxZ + m_maxExtent);
+
+	for (int cellZ = firstCellZ; cellZ <= lastCellZ; cellZ++)
+	{
+		for (int cellX = firstCellX; cellX <= lastCellX; cellX++)
+		{
+			m_stats.cellsVisited++;
+
+			for (uint32 id = m_buckets[GetBucket(cellX, cellZ)]; id != SPATIAL_HASH_NONE; id = m_next[id])
+			{
+				// Other cells can share the bucket, each entity is only looked at from its own cell
+				if (m_cellX[id] != cellX || m_cellZ[id] != cellZ)
+					continue;
+
+				m_stats.entitiesTested++;
+
+				float extent = m_extent[id];
+				if (m_positionX[id] + extent >= minX && m_positionX[id] - extent <= maxX &&
+				    m_positionZ[id] + extent >= minZ && m_positionZ[id] - extent <= maxZ)
+				{
+					ids.push_back(id);
+					found++;
+				}
+			}
+		}
+	}
+
+	return found;
+}
+
+
+uint32 SpatialHash::FindPairs(std::vector<entityPair_t>& pairs)
+{
+	uint32 found = 0;
+
+
+	for (uint32 id = 0; id < (uint32)m_inserted.size(); id++)
+	{
+		if (!m_inserted[id])
+			continue;
+
+		float x = m_positionX[id];
+		float z = m_positionZ[id];
+		float extent = m_extent[id];
+		float reach = extent + m_maxExtent;
+		int firstCellX = GetCell(x - reach);
+		int lastCellX = GetCell(x + reach);
+		int firstCellZ = GetCell(z - reach);
+		int lastCellZ = GetCell(z + reach);
+
+		for (int cellZ = firstCellZ; cellZ <= lastCellZ; cellZ++)
+		{
+			for (int cellX = firstCellX; cellX <= lastCellX; cellX++)
+			{
+				m_stats.cellsVisited++;
+
+				for (uint32 other = m_buckets[GetBucket(cellX, cellZ)]; other != SPATIAL_HASH_NONE; other = m_next[other])
+				{
+					// Every pair is found from its lower id
+					if (other <= id || m_cellX[other] != cellX || m_cellZ[other] != cellZ)
+						continue;
+
+					m_stats.entitiesTested++;
+
+					float sum = extent + m_extent[other];
+					if (fabsf(m_positionX[other] - x) <= sum && fabsf(m_positionZ[other] - z) <= sum)
+					{
+						entityPair_t pair = { id, other };
+						pairs.push_back(pair);
+						found++;
+					}
+				}
+			}
+		}
+	}
+
+	return found;
+}
+
+
+uint32 SpatialHash::GetEntityCount()
+{
+	return m_entityCount;
+}
+
+
+float SpatialHash::GetCellSize()
+{
+	return m_cellSize;
+}
+
+
+const SpatialHash::hashStats_t& SpatialHash::GetStats()
+{
+	return m_stats;
+}
+
+
+void SpatialHash::ResetStats()
+{
+	m_stats = {};
+
+	return;
+}
+
+
+int SpatialHash::GetCell(float position)
+{
+	// Rounds down without a call to floorf, which the compiler can't inline without SSE4.1
+	float scaled = position * m_inverseCellSize;
+	int cell = (int)scaled;
+
+	return cell - ((scaled < (float)cell) ? 1 : 0);
+}
+
+
+uint32 SpatialHash::GetBucket(int cellX, int cellZ)
+{
+	// Neighbouring cells land in unrelated buckets
+	uint32 hash = ((uint32)cellX * 0x8DA6B343u) ^ ((uint32)cellZ * 0xD8163841u);
+
+	return (hash ^ (hash >> 15)) & m_bucketMask;
+}
+
+
+void SpatialHash::Link(uint32 id, int cellX, int cellZ)
+{
+	uint32 bucket = GetBucket(cellX, cellZ);
+
+
+	// New entities go on the front of the bucket's list
+	m_cellX[id] = cellX;
+	m_cellZ[id] = cellZ;
+	m_previous[id] = SPATIAL_HASH_NONE;
+	m_next[id] = m_buckets[bucket];
+
+	if (m_buckets[bucket] != SPATIAL_HASH_NONE)
+	{
+		m_previous[m_buckets[bucket]] = id;
+	}
+	m_buckets[bucket] = id;
+
+	return;
+}
+
+
+void SpatialHash::Unlink(uint32 id)
+{
+	if (m_previous[id] != SPATIAL_HASH_NONE)
+	{
+		m_next[m_previous[id]] = m_next[id];
+	}
+	else
+	{
+		m_buckets[GetBucket(m_cellX[id], m_cellZ[id])] = m_next[id];
+	}
+
+	if (m_next[id] != SPATIAL_HASH_NONE)
+	{
+		m_previous[m_next[id]] = m_previous[id];
+	}
+
+	return;
+}
+
+} // end of namespace Gumshoe
@@ -0,0 +1,98 @@
+/*!
+  @file
+  dungeon_chunks.h
+
+  @brief
+  Unbounded multi-floor dungeon, stored as fixed-size tile chunks.
+
+  @detail
+  Chunks are generated on demand from the world seed and evicted least-recently-used
+  once the resident budget is exceeded, so memory stays bounded however far the player goes.
+  An evicted chunk is regenerated from the seed if it is visited again.
+  Floors are linked by stairs: the DownStairs in a chunk leads to the UpStairs in the
+  same chunk one floor down.
+  GameWorld plays on it: the floor the player is on is built from a window of chunks
+  around them, and moved along with them, so only the window has geometry and a
+  collider while the chunks further out stay plain tiles under the budget.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include "dungeon_gen.h"
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const int CHUNK_SIZE = 64;
+const int CHUNK_MAX_FEATURES = 24;
+const uint32 DEFAULT_CHUNK_BUDGET = 64;
+const int CHUNK_WINDOW = 3; // chunks along each side of the floor built around the player
+const int CHUNK_WINDOW_MARGIN = CHUNK_SIZE / 2; // tiles from the window's edge the player gets before it moves
+
+
+//--------------------------------------------
+// ChunkedWorld class definition
+//--------------------------------------------
+class ChunkedWorld
+{
+public:
+	struct chunkStats_t
+	{
+		uint32 residentChunks;
+		uint64 generatedChunks;
+		uint64 evictedChunks;
+		uint64 residentBytes;
+	};
+
+private:
+	struct chunk_t
+	{
+		int floor, chunkX, chunkY;
+		int upX, upY, downX, downY; // stairs location inside the chunk, -1 if none
+		std::vector<char> tiles;
+		std::list<uint64>::iterator lruEntry;
+	};
+
+public:
+	ChunkedWorld();
+	~ChunkedWorld();
+
+	void Init(uint64, uint32);
+	void Shutdown();
+
+	char GetTile(int, int, int);
+	void GetTileRect(int, int, int, int, int, char*);
+	void UpdateAround(int, int, int, int);
+	static void GetWindowOrigin(int, int, int&, int&);
+
+	bool GetEntranceLocation(int&, int&);
+	bool FindStairsLink(int, int, int, int&, int&, int&);
+
+	const chunkStats_t& GetStats();
+
+private:
+	chunk_t* GetChunk(int, int, int);
+	chunk_t* GenerateChunk(int, int, int);
+	void CarveGate(chunk_t*, int, int, int, int);
+	void EvictChunks(chunk_t*);
+
+	uint64 ChunkKey(int, int, int);
+	uint64 ChunkSeed(int, int, int);
+	int GatePosition(int, int, int, bool);
+
+private:
+	uint64 m_seed;
+	uint32 m_chunkBudget;
+	chunkStats_t m_stats;
+	DungeonGenerator m_generator;
+
+	std::unordered_map<uint64, chunk_t*> m_chunks;
+	std::list<uint64> m_lru; // most recently used at the front
+};
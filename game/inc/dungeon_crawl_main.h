@@ -19,6 +19,7 @@ const bool FULL_SCREEN = true;
 const bool VSYNC_ENABLED = true;
 const float SCREEN_DEPTH = 1000.0f;
 const float SCREEN_NEAR = 0.01f;
+const char SESSION_LOG_FILENAME[] = "last_session.gil"; // input since the player came onto the floor they left on, for gumshoe_replay
 
 //--------------------------------------------
 // Includes
@@ -37,6 +38,8 @@ const float SCREEN_NEAR = 0.01f;
 #include "light.h"
 #include "frustum.h"
 #include "entity.h"
+#include "sim_scheduler.h"
+#include "input_log.h"
 /*
 #include "debug_window.h"
 #include "texture_shader.h"
@@ -44,6 +47,7 @@ const float SCREEN_NEAR = 0.01f;
 #include "depth_shader.h"
 */
 #include "dungeon_world.h"
+#include "game_sim.h"
 
 using namespace Gumshoe;
 
@@ -62,6 +66,10 @@ public:
 
 private:
 	bool HandleInput(float);
+	bool FollowPlayer();
+	bool RestartSim(Vector3_t);
+	void BeginInputLog(Vector3_t);
+	void ReadInput();
 	bool RenderSceneToTexture();
 	bool RenderGraphics();
 
@@ -87,4 +95,11 @@ private:
 */
 	// Game specific components
 	GameWorld* m_World;
+
+	// Fixed step simulation, and the input it was given
+	SimScheduler m_Scheduler;
+	GameSim m_Sim;
+	InputLog m_InputLog;
+	InputLog::simInput_t m_PendingInput; // read since the last step
+	int m_PlayerTileX, m_PlayerTileZ; // tile the player was last checked on, stairs only work when stepped onto
 };
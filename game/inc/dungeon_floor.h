@@ -0,0 +1,221 @@
+/*!
+  @file
+  dungeon_floor.h
+
+  @brief
+  One floor of the dungeon: its tile map, tile features and geometry.
+
+  @detail
+  Everything up to the vertex and index arrays is built on the CPU without
+  DirectX, so floors can be built in parallel and by the headless tools.
+  GameWorld builds the floor the player is on from a rect of ChunkedWorld
+  tiles and uploads its arrays.
+  Tiles changed after the build (doors, broken walls) are marked dirty by
+  SetTile, and UpdateGeometry rebuilds only their pieces: the old quads are
+  collapsed to a point in place and the new ones appended to the arrays.
+  The tile map can be kept row-major, in 8x8 blocks or in Morton order.
+  Used tiles are kept as 8 byte records: grid position, feature bits and a
+  material. Positions, normals, texture origins and colours are worked out
+  from them only when the geometry is built.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include "gumshoe_math.h"
+#include "dungeon_gen.h"
+#include "dungeon_chunks.h"
+#include "tile_grid.h"
+#include "job_pool.h"
+#include <vector>
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const int COLLIDER_CELLS_PER_TILE = 5; // wall tops run 0.4 to 0.6 across a tile, fifths fit them exactly
+
+
+//--------------------------------------------
+// DungeonFloor class definition
+//--------------------------------------------
+class DungeonFloor
+{
+public:
+	// Tiles after generation, the renderer's view of the map
+	enum Tile
+	{
+		Empty		= '.',
+		Open		= ' ',
+		Wall		= DungeonGenerator::Wall,
+		ClosedDoor	= DungeonGenerator::ClosedDoor,
+		OpenDoor	= DungeonGenerator::OpenDoor,
+		UpStairs	= DungeonGenerator::UpStairs,
+		DownStairs	= DungeonGenerator::DownStairs
+	};
+
+	enum TileFeatures
+	{
+        NorthWestFloor  = (1<<0),
+        NorthEastFloor  = (1<<1),
+        SouthWestFloor  = (1<<2),
+        SouthEastFloor  = (1<<3),
+        NorthWall       = (1<<4),
+        SouthWall       = (1<<5),
+        EastWall        = (1<<6),
+        WestWall        = (1<<7),
+        NorthWallCap    = (1<<8),
+        SouthWallCap    = (1<<9),
+        EastWallCap     = (1<<10),
+        WestWallCap     = (1<<11),
+        VertDoorway     = (1<<12),
+        HorizDoorway    = (1<<13)
+	};
+
+	// What a used tile is made of, picks its colour and normals when the geometry is built
+	enum TileMaterial
+	{
+		FloorMaterial,
+		WallMaterial,
+		DoorMaterial,
+		MaterialCount
+	};
+
+	// Same layout as the vertex buffer the world shader reads
+	struct floorVertex_t
+	{
+		Gumshoe::Vector3_t position;
+		Gumshoe::Vector2_t texture;
+		Gumshoe::Vector3_t normal;
+		Gumshoe::Vector4_t color;
+	};
+
+	// A used tile, floors are at most 64K tiles along each side
+	struct floorTile_t
+	{
+		uint16 x, z;
+		uint16 geoFeatures;
+		uint16 material;
+	};
+
+	struct geometryStats_t
+	{
+		uint32 triangles;
+		uint32 unmergedTriangles; // with one floor and wall top quad per tile piece
+		uint32 emittedVertices; // before welding
+		uint32 vertices;
+	};
+
+	// What UpdateGeometry changed, for anything built from the arrays
+	struct geometryPatch_t
+	{
+		std::vector<uint32> removedTriangles; // corners of the triangles taken out, as they were
+		uint32 firstVertex, vertexCount; // new vertices
+		uint32 firstTriangle, triangleCount; // new triangles, at the end of the index array
+	};
+
+private:
+	// A rectangle of grid cells, for merging
+	struct cellRect_t
+	{
+		int column, row;
+		int columns, rows; // no columns once an update has replaced it
+		uint32 quad;
+	};
+
+	// The wall and cap quads of a tile
+	struct quadRange_t
+	{
+		uint32 firstQuad, quadCount;
+	};
+
+	// A range of tiles for one geometry job to write
+	struct geometryJob_t
+	{
+		DungeonFloor* floor;
+		uint32 firstTile, lastTile;
+	};
+
+public:
+	DungeonFloor();
+	~DungeonFloor();
+
+	bool Build(Gumshoe::Random&, int, int, int, Gumshoe::JobPool* = nullptr);
+	bool Build(ChunkedWorld&, int, int, int, int, int, Gumshoe::JobPool* = nullptr);
+	bool Generate(Gumshoe::Random&, int, int, int);
+	void ClassifyTiles();
+	void BuildGeometry(Gumshoe::JobPool* = nullptr);
+
+	int GetLength();
+	int GetWidth();
+	const char* GetError();
+
+	char GetTile(int, int);
+	void GetTileRect(int, int, int, int, char*);
+	bool SetTile(int, int, char);
+	void SetTileLayout(TileGrid::Layout);
+	TileGrid::Layout GetTileLayout();
+	static bool IsSolid(char);
+	void GetSolidTiles(std::vector<uint8>&);
+	void GetSolidCells(std::vector<uint8>&);
+	bool UpdateGeometry(geometryPatch_t&);
+	bool GetUpStairsLocation(int&, int&);
+	bool GetDownStairsLocation(int&, int&);
+
+	uint32 GetTileCount();
+	const std::vector<floorTile_t>& GetTiles();
+	const std::vector<floorVertex_t>& GetVertices();
+	const std::vector<uint32>& GetIndices();
+	bool HasShortIndices();
+	const std::vector<uint16>& GetShortIndices();
+	const geometryStats_t& GetGeometryStats();
+
+	bool PrintWorld(const char*, uint64);
+
+private:
+	bool SetSize(int, int);
+	void AssignTiles(std::vector<char>&);
+	bool FindTile(char, int&, int&);
+	void WeldVertices();
+	void MergeCells(std::vector<uint8>&, int, int, std::vector<cellRect_t>&);
+	void MergeFloorCells();
+	void MergeWallTopCells();
+	void AddMergedGeometry(floorVertex_t*&, uint32*&, uint32&);
+	void AddRectGeometry(const cellRect_t&, int, floorVertex_t*&, uint32*&, uint32&);
+	void BuildUpdateLookup();
+	void PatchMergedCells(std::vector<cellRect_t>&, std::vector<uint32>&, int, const std::vector<uint32>&,
+	                      const std::vector<uint32>&, geometryPatch_t&);
+	void RemoveQuad(uint32, geometryPatch_t&);
+	uint32 AppendQuads(uint32, floorVertex_t*&, uint32*&, uint32&);
+	void AddTileGeometry(uint32, uint32);
+	static void AddTileGeometryJob(void*);
+	void AddHorizontalQuad(float, float, float, float, float, floorVertex_t*&, uint32*&, uint32&);
+	void AddTileWallGeometry(uint32, floorVertex_t*&, uint32*&, uint32&);
+	void AddTileWallCapGeometry(uint32, floorVertex_t*&, uint32*&, uint32&);
+	void AddTileDoorwayGeometry(uint32, floorVertex_t*&, uint32*&, uint32&);
+
+private:
+	int m_length, m_width;
+	const char* m_error;
+
+	TileGrid m_map;
+	std::vector<uint8> m_classes; // neighbour class of every map tile, with a border
+	std::vector<floorTile_t> m_tiles; // one per used map tile, in row order
+	std::vector<floorVertex_t> m_vertices;
+	std::vector<uint32> m_indices;
+	std::vector<uint16> m_shortIndices; // copy of m_indices when the floor has at most 64K vertices
+	geometryStats_t m_geometryStats;
+	std::vector<uint8> m_cells; // scratch coverage grid for merging
+	std::vector<cellRect_t> m_floorRects;
+	std::vector<cellRect_t> m_wallTopRects;
+	std::vector<uint32> m_quadOffsets; // first quad of every tile's walls, plus the total
+
+	// Built the first time tiles are updated
+	std::vector<int> m_dirtyTiles; // map positions
+	std::vector<uint32> m_tileLookup; // tile of every map position, ~0 for empty ones
+	std::vector<quadRange_t> m_tileQuads;
+	std::vector<uint32> m_floorRectCells; // rect covering every floor cell, ~0 for none
+	std::vector<uint32> m_wallTopRectCells;
+};
@@ -0,0 +1,151 @@
+/*!
+  @file
+  dungeon_gen.h
+
+  @brief
+  Procedural generator for the dungeon tile map.
+
+  @detail
+  Has no DirectX dependencies, so it can be built headless and used by tools.
+  The same seed, size and feature budget always produce the same dungeon.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include "gumshoe_math.h"
+#include <vector>
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const int DEFAULT_WORLD_SIZE = 96;
+const int DEFAULT_MAX_FEATURES = 60;
+const int MIN_ROOM_SIZE = 3;
+const int MAX_ROOM_SIZE = 6;
+// The first room is centred and can face any way, so the largest one, its wall and the
+// border row the generator keeps clear have to fit on either side of the centre
+const int MIN_WORLD_SIZE = 2 * (MAX_ROOM_SIZE + 2) + 1;
+
+
+//--------------------------------------------
+// OccupancyMap class definition
+//--------------------------------------------
+// One bit per tile, packed 64 to a word along each row, set once the tile is used.
+// Lets the generator test a whole rectangle a word at a time instead of tile by tile.
+class OccupancyMap
+{
+public:
+	OccupancyMap();
+	~OccupancyMap();
+
+	void Init(int, int);
+	void Set(int, int);
+	void SetRect(int, int, int, int);
+	bool IsSet(int, int);
+	bool IsRectFree(int, int, int, int);
+
+private:
+	int m_length, m_width, m_wordsPerRow;
+	std::vector<uint64> m_bits;
+};
+
+
+//--------------------------------------------
+// DungeonGenerator class definition
+//--------------------------------------------
+class DungeonGenerator
+{
+public:
+	enum Tile
+	{
+		Unused		= ' ',
+		Floor		= '.',
+		Corridor	= ',',
+		Wall		= '|',
+		ClosedDoor	= '+',
+		OpenDoor	= '-',
+		UpStairs	= '<',
+		DownStairs	= '>'
+	};
+
+	enum Direction
+	{
+		North,
+		South,
+		West,
+		East,
+		DirectionCount
+	};
+
+	struct Rect
+    {
+	    int x, y;
+	    int xSize, ySize;
+    };
+
+	struct genStats_t
+	{
+		uint64 probes;         // exit tiles tried
+		uint64 rejects;        // rooms/corridors that didn't fit at a probed exit
+		uint32 exhaustedExits; // exits dropped after every tile failed
+		uint32 features;
+		double timeMs;
+	};
+
+private:
+	// Walks the tiles of an exit in a random order, so no tile is tried twice
+	struct exitProbe_t
+	{
+		int start, stride, tried;
+	};
+
+public:
+	DungeonGenerator();
+	~DungeonGenerator();
+
+	bool Generate(uint64, int, int, int);
+	bool Generate(Gumshoe::Random&, int, int, int);
+	bool Validate();
+
+	int GetLength();
+	int GetWidth();
+	int GetFeatureCount();
+	const genStats_t& GetStats();
+	const char* GetError();
+
+	char GetTile(int, int);
+	const std::vector<char>& GetTiles();
+	const std::vector<Rect>& GetRooms();
+	const std::vector<Rect>& GetExits();
+
+	bool PrintWorld(const char*);
+
+private:
+	void SetTile(int, int, char);
+	void AddExit(const Rect&);
+	void RemoveExit(int);
+	bool CreateFeature();
+	bool CreateFeature(int, int, Direction);
+	bool MakeRoom(int, int, Direction, bool);
+	bool MakeCorridor(int, int, Direction);
+	bool PlaceRect(const Rect&, char);
+	bool PlaceObject(char);
+
+private:
+	int m_length, m_width;
+	int m_featureCount;
+	const char* m_error;
+	genStats_t m_stats;
+	Gumshoe::Random m_random;
+
+	std::vector<char> m_tiles;
+	OccupancyMap m_occupancy;
+	std::vector<Rect> m_rooms; // rooms to put items, stairs, enemies, etc.
+	std::vector<Rect> m_exits; // could be an exit on any of the 4 room sides
+	std::vector<exitProbe_t> m_exitProbes; // kept in step with m_exits
+	std::vector<int> m_freeRooms; // rooms that don't hold an object yet
+};
@@ -6,6 +6,12 @@
   Object to create and hold the game world.
 
   @detail
+  The dungeon is a ChunkedWorld, and the floor the player is on is built
+  from the CHUNK_WINDOW chunks square around them. The window moves once the
+  player walks close to its edge, so however far they go only the chunks
+  near them are in memory. Positions are in the window's tiles, the window
+  origin turns them into dungeon tiles. Tiles changed with SetTile last
+  until the window moves, the chunks come back from the seed.
 */
 
 #pragma once
@@ -15,6 +21,15 @@
 //--------------------------------------------
 #include "gumshoe_typedefs.h"
 #include "gumshoe_math.h"
+#include "dungeon_gen.h"
+#include "dungeon_floor.h"
+#include "dungeon_chunks.h"
+#include "job_pool.h"
+#include "quadtree.h"
+#include "physics_tile_collider.h"
+#include "entity_store.h"
+#include "physics_movement.h"
+#include "game_sim.h"
 #include <d3d11.h>
 #include <d3dx10math.h>
 #include <random>
@@ -37,51 +52,18 @@ class GameWorld
 public:
 	enum Tile
 	{
-		Unused		= ' ',
-		Floor		= '.',
-		Corridor	= ',',
-		Wall		= '|',
-		ClosedDoor	= '+',
-		OpenDoor	= '-',
-		UpStairs	= '<',
-		DownStairs	= '>'
-	};
- 
-	enum Direction
-	{
-		North,
-		South,
-		West,
-		East,
-		DirectionCount
-	};
-
-	enum TileFeatures
-	{
-        NorthWestFloor  = (1<<0),
-        NorthEastFloor  = (1<<1),
-        SouthWestFloor  = (1<<2),
-        SouthEastFloor  = (1<<3),
-        NorthWall       = (1<<4),
-        SouthWall       = (1<<5),
-        EastWall        = (1<<6),
-        WestWall        = (1<<7),
-        NorthWallCap    = (1<<8),
-        SouthWallCap    = (1<<9),
-        EastWallCap     = (1<<10),
-        WestWallCap     = (1<<11),
-        VertDoorway     = (1<<12),
-        HorizDoorway    = (1<<13)
+		Unused		= DungeonGenerator::Unused,
+		Floor		= DungeonGenerator::Floor,
+		Corridor	= DungeonGenerator::Corridor,
+		Wall		= DungeonGenerator::Wall,
+		ClosedDoor	= DungeonGenerator::ClosedDoor,
+		OpenDoor	= DungeonGenerator::OpenDoor,
+		UpStairs	= DungeonGenerator::UpStairs,
+		DownStairs	= DungeonGenerator::DownStairs
 	};
 
 private:
-	struct gameWorldVertex_t
-	{
-		D3DXVECTOR3 position;
-	    D3DXVECTOR2 texture;
-	    D3DXVECTOR3 normal;
-	    D3DXVECTOR4 color;
-	};
+	typedef DungeonFloor::floorVertex_t gameWorldVertex_t;
 
 	struct gameWorldGrid_t 
 	{ 
@@ -103,12 +85,6 @@ private:
 		unsigned long* indices;
 	};
 
-	struct Rect
-    {
-	    int x, y;
-	    int xSize, ySize;
-    };
-
 public:
 	GameWorld();
 	~GameWorld();
@@ -133,36 +109,37 @@ public:
 	int GetVertexCount();
 	void CopyVertexArray(void*);
 
+	void SetSeed(uint64);
+	uint64 GetSeed();
+
+	uint32 GetCurrentFloor();
+	bool SetCurrentFloor(ID3D11Device*, uint32, int, int);
+	bool UpdateAround(ID3D11Device*, Gumshoe::Vector3_t&, bool&);
+	bool SetTile(ID3D11Device*, ID3D11DeviceContext*, int, int, char, Gumshoe::QuadTree* = nullptr);
+
 	void GetWorldSize(int&, int&);
-	void GetUpStairsLocation(float&, float&);
+	void GetWindowOrigin(int&, int&);
+	bool GetEntranceLocation(float&, float&);
+	bool FindStairsLink(int, int, uint32&, int&, int&);
 
 	Gumshoe::Vector3_t GetTileNormal(int, int);
+	Gumshoe::Physics::TileCollider* GetCollider();
+	Gumshoe::EntityStore* GetEntities();
+	Gumshoe::Physics::Movement* GetPhysics();
 
 private:
 	bool LoadHeightMap(char*);
 	void ScaleHeightMap();
 	bool CalculateNormals();
 
-	bool GenerateWorld(uint32, int);
+	bool LoadFloor(uint32, int, int);
+	bool BuildCollider();
 	void ReleaseWorldGrid();
 
 	// Procedural generation functions
-	bool GenerateRandomWorld(int);
 	void PrintWorld();
 	char GetTile(int, int);
-	void SetTile(int, int, char);
-	bool CreateFeature();
-	bool CreateFeature(int, int, Direction);
-	bool MakeRoom(int, int, Direction, bool);
-	bool MakeCorridor(int, int, Direction);
-	bool PlaceRect(const Rect&, char);
-	bool PlaceObject(char);
-
-	void AddTileFloorGeometry(uint32, std::vector<gameWorldVertex_t>&, std::vector<unsigned long>&, uint32&);
-	void AddTileWallGeometry(uint32, std::vector<gameWorldVertex_t>&, std::vector<unsigned long>&, uint32&);
-	void AddTileWallCapGeometry(uint32, std::vector<gameWorldVertex_t>&, std::vector<unsigned long>&, uint32&);
-	void AddTileDoorwayGeometry(uint32, std::vector<gameWorldVertex_t>&, std::vector<unsigned long>&, uint32&);
-	
+
     void CalculateTextureCoordinates();
 	bool LoadTextures(ID3D11Device*, LPCSTR*, LPCSTR*);
 	void ReleaseTextures();
@@ -179,21 +156,25 @@ private:
 	void RenderBuffers(ID3D11DeviceContext*);
 	
 private:
-	uint32 m_worldLength, m_worldWidth, m_worldHeight;
+	uint32 m_worldLength, m_worldWidth;
 	int m_vertexCount, m_indexCount;
+	bool m_shortIndices;
 	ID3D11Buffer *m_vertexBuffer, *m_indexBuffer;
 	gameWorldGrid_t* m_gameWorldGrid;
 	//Gumshoe::Texture *m_Texture, *m_DetailTexture;
     Gumshoe::Texture *m_GroundTexture, *m_WallTexture;
 
-	std::vector<gameWorldVertex_t> m_vertices;
-
 	// Procedural generation variables
-	int m_procWorldLength, m_procWorldWidth;
-	uint32 m_tileCount;
-	std::vector<char> m_tiles;
-	std::vector<Rect> m_rooms; // rooms to put items, stairs, enemies, etc.
-	std::vector<Rect> m_exits; // could be an exit on any of the 4 room sides
+	uint64 m_seed;
+	bool m_seedSet;
+	ChunkedWorld m_chunks;
+	DungeonFloor m_floor; // the window around the player on the current floor
+	uint32 m_currentFloor;
+	int m_windowX, m_windowZ; // dungeon tile at the window's 0,0
+	Gumshoe::JobPool m_jobPool; // for the window's geometry jobs
+	Gumshoe::Physics::TileCollider m_collider; // solid tiles of the current floor
+	Gumshoe::EntityStore m_entities;
+	Gumshoe::Physics::Movement m_physics; // collides with m_collider
 
 	//uint32 m_textureCount, m_materialCount;
 };
@@ -0,0 +1,68 @@
+/*!
+  @file
+  game_sim.h
+
+  @brief
+  The part of the game that runs on fixed steps: the player and the
+  entities on the current floor.
+
+  @detail
+  Nothing in a step depends on DirectX, the frame rate or the clock, only
+  on the floor's solid tiles and the step's input, so the game and the
+  headless replay tool run the exact same steps from the same input log.
+  The player's body lives in its own one entity store, and moves the same
+  way Entity::Move moves it. The floor's rigid bodies step after the
+  entities. Rendering reads positions blended between
+  the last two steps.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include "gumshoe_math.h"
+#include "physics_tile_collider.h"
+#include "entity_store.h"
+#include "physics_movement.h"
+#include "input_log.h"
+
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const Gumshoe::Vector3_t PLAYER_AABB = { 0.5f, 1.83f, 0.25f }; // same size as Entity::Init gives the player's model
+const uint32 MAX_WORLD_ENTITIES = 16384; // enemies and projectiles on the current floor
+const uint32 MAX_WORLD_BODIES = 4096;    // rigid bodies on the current floor
+
+
+//--------------------------------------------
+// GameSim class definition
+//--------------------------------------------
+class GameSim
+{
+public:
+	GameSim();
+	~GameSim();
+
+	bool Init(Gumshoe::Physics::TileCollider*, Gumshoe::EntityStore*, Gumshoe::Vector3_t, float, Gumshoe::Physics::Movement* = nullptr);
+	void Shutdown();
+
+	void Step(const Gumshoe::InputLog::simInput_t&);
+
+	uint32 GetStepCount();
+	void GetPlayerPosition(float, Gumshoe::Vector3_t&);
+	Gumshoe::Vector3_t GetPlayerRotation();
+	uint64 GetStateHash();
+
+private:
+	Gumshoe::Physics::TileCollider* m_collider;
+	Gumshoe::EntityStore* m_entities; // the floor's entities, can be null
+	Gumshoe::Physics::Movement* m_physics; // the floor's rigid bodies, can be null
+	Gumshoe::EntityStore m_player;
+	uint32 m_playerId;
+	Gumshoe::Vector3_t m_playerRotation;
+	float m_stepMs;
+	uint32 m_stepCount;
+};
@@ -0,0 +1,109 @@
+/*!
+  @file
+  tile_grid.h
+
+  @brief
+  Storage for a 2D map of tiles, in one of a few memory layouts.
+
+  @detail
+  Row-major storage puts the tiles above and below a tile a whole row away,
+  so a 3x3 neighbourhood or a square region touches a cache line per row.
+  Blocked storage keeps each 8x8 block of tiles in one 64 byte line, and
+  Morton (Z-order) storage interleaves the x and y bits so any aligned
+  square is contiguous at every size. Callers only see Get/Set by position,
+  and GetRow and GetRect, which copy tiles out in row-major order whatever
+  the layout, stepping through the storage instead of indexing every tile.
+*/
+
+#pragma once
+
+//--------------------------------------------
+// Globals
+//--------------------------------------------
+const int TILE_GRID_BLOCK_BITS = 3; // blocked layout uses 8x8 blocks
+const int TILE_GRID_BLOCK_SIZE = 1 << TILE_GRID_BLOCK_BITS;
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include <vector>
+
+
+//--------------------------------------------
+// TileGrid class definition
+//--------------------------------------------
+class TileGrid
+{
+public:
+	enum Layout
+	{
+		RowMajor,
+		Blocked,
+		Morton,
+		LayoutCount
+	};
+
+public:
+	TileGrid();
+	~TileGrid();
+
+	void Init(int, int, char, Layout = RowMajor);
+	void Assign(const std::vector<char>&, int, int, Layout = RowMajor);
+	void SetLayout(Layout);
+	Layout GetLayout();
+	static const char* GetLayoutName(Layout);
+
+	int GetLength();
+	int GetWidth();
+	uint64 GetMemoryBytes();
+
+	const char* GetRow(int, char*);
+	void GetRect(int, int, int, int, char*);
+
+	// Position to storage index, no bounds checks
+	inline uint32 GetIndex(int x, int y) const
+	{
+		switch (m_layout)
+		{
+		case Blocked:
+			return ((uint32)((y >> TILE_GRID_BLOCK_BITS) * m_blocksPerRow + (x >> TILE_GRID_BLOCK_BITS)) << (2 * TILE_GRID_BLOCK_BITS)) |
+			       ((uint32)(y & (TILE_GRID_BLOCK_SIZE - 1)) << TILE_GRID_BLOCK_BITS) | (uint32)(x & (TILE_GRID_BLOCK_SIZE - 1));
+		case Morton:
+			return SpreadBits((uint32)x) | (SpreadBits((uint32)y) << 1);
+		default:
+			return (uint32)(y * m_length + x);
+		}
+	}
+
+	inline char Get(int x, int y) const
+	{
+		return m_tiles[GetIndex(x, y)];
+	}
+
+	inline void Set(int x, int y, char tile)
+	{
+		m_tiles[GetIndex(x, y)] = tile;
+	}
+
+private:
+	// Puts the low 16 bits of a value in the even bits
+	static inline uint32 SpreadBits(uint32 value)
+	{
+		value &= 0x0000FFFF;
+		value = (value | (value << 8)) & 0x00FF00FF;
+		value = (value | (value << 4)) & 0x0F0F0F0F;
+		value = (value | (value << 2)) & 0x33333333;
+		value = (value | (value << 1)) & 0x55555555;
+
+		return value;
+	}
+
+	void Resize(Layout, char);
+
+private:
+	Layout m_layout;
+	int m_length, m_width;
+	int m_blocksPerRow;
+	std::vector<char> m_tiles; // padding past the map edges holds the fill tile
+};
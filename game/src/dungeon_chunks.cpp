@@ -0,0 +1,418 @@
+/*!
+  @file
+  dungeon_chunks.cpp
+
+  @brief
+  Unbounded multi-floor dungeon, stored as fixed-size tile chunks.
+
+  @detail
+  Each chunk is a small dungeon from DungeonGenerator, seeded from the world seed and the
+  chunk's floor and position. Every shared chunk edge gets one gate tile, placed from a hash
+  of the edge, and both chunks carve a corridor from it to their first room. That way
+  neighbouring chunks agree on the connection without either one being resident.
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "dungeon_chunks.h"
+#include <algorithm>
+#include <string.h>
+
+
+//--------------------------------------------
+// Helper Functions
+//--------------------------------------------
+// splitmix64 step, used to hash the chunk coordinates into a seed
+static uint64 MixSeed(uint64 value)
+{
+	uint64 z = value + 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Rounds towards negative infinity, so tile -1 is in chunk -1
+static int ChunkCoord(int tile)
+{
+	return (tile >= 0) ? (tile / CHUNK_SIZE) : ((tile + 1) / CHUNK_SIZE - 1);
+}
+
+static bool IsWalkable(char tile)
+{
+	return tile != DungeonGenerator::Unused && tile != DungeonGenerator::Wall;
+}
+
+
+ChunkedWorld::ChunkedWorld()
+{
+	m_seed = 0;
+	m_chunkBudget = DEFAULT_CHUNK_BUDGET;
+	m_stats = {};
+}
+
+
+ChunkedWorld::~ChunkedWorld()
+{
+	Shutdown();
+}
+
+
+void ChunkedWorld::Init(uint64 seed, uint32 chunkBudget)
+{
+	Shutdown();
+
+	m_seed = seed;
+	m_chunkBudget = (chunkBudget > 0) ? chunkBudget : 1;
+	m_stats = {};
+
+	return;
+}
+
+
+void ChunkedWorld::Shutdown()
+{
+	for (std::unordered_map<uint64, chunk_t*>::iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+	{
+		delete it->second;
+	}
+
+	m_chunks.clear();
+	m_lru.clear();
+	m_stats.residentChunks = 0;
+	m_stats.residentBytes = 0;
+
+	return;
+}
+
+
+char ChunkedWorld::GetTile(int floor, int x, int y)
+{
+	if (floor < 0)
+		return DungeonGenerator::Unused;
+
+	int chunkX = ChunkCoord(x);
+	int chunkY = ChunkCoord(y);
+	chunk_t* chunk = GetChunk(floor, chunkX, chunkY);
+	if (!chunk)
+		return DungeonGenerator::Unused;
+
+	return chunk->tiles[(x - chunkX * CHUNK_SIZE) + (y - chunkY * CHUNK_SIZE) * CHUNK_SIZE];
+}
+
+
+void ChunkedWorld::GetTileRect(int floor, int x, int y, int columns, int rows, char* tiles)
+{
+	// Copy each row a chunk's span at a time, so every chunk is looked up once a row
+	for (int row = 0; row < rows; row++)
+	{
+		int tileY = y + row;
+		int chunkY = ChunkCoord(tileY);
+		int column = 0;
+
+		while (column < columns)
+		{
+			int tileX = x + column;
+			int chunkX = ChunkCoord(tileX);
+			int chunkColumn = tileX - chunkX * CHUNK_SIZE;
+			int span = std::min(CHUNK_SIZE - chunkColumn, columns - column);
+			char* out = &tiles[row * columns + column];
+
+			chunk_t* chunk = (floor >= 0) ? GetChunk(floor, chunkX, chunkY) : nullptr;
+			if (chunk)
+				memcpy(out, &chunk->tiles[chunkColumn + (tileY - chunkY * CHUNK_SIZE) * CHUNK_SIZE], span);
+			else
+				memset(out, DungeonGenerator::Unused, span);
+
+			column += span;
+		}
+	}
+
+	return;
+}
+
+
+void ChunkedWorld::UpdateAround(int floor, int x, int y, int radius)
+{
+	int centerX = ChunkCoord(x);
+	int centerY = ChunkCoord(y);
+
+	// Load the ring first and the player's chunk last, so it ends up the most recently used.
+	// The budget should hold (2*radius+1)^2 chunks, otherwise the ring evicts itself.
+	for (int chunkY = centerY - radius; chunkY <= centerY + radius; chunkY++)
+	{
+		for (int chunkX = centerX - radius; chunkX <= centerX + radius; chunkX++)
+		{
+			if (chunkX != centerX || chunkY != centerY)
+				GetChunk(floor, chunkX, chunkY);
+		}
+	}
+	GetChunk(floor, centerX, centerY);
+
+	return;
+}
+
+
+void ChunkedWorld::GetWindowOrigin(int x, int y, int& windowX, int& windowY)
+{
+	// First tile of the CHUNK_WINDOW chunks square with the tile's chunk in the middle
+	windowX = (ChunkCoord(x) - CHUNK_WINDOW / 2) * CHUNK_SIZE;
+	windowY = (ChunkCoord(y) - CHUNK_WINDOW / 2) * CHUNK_SIZE;
+
+	return;
+}
+
+
+bool ChunkedWorld::GetEntranceLocation(int& x, int& y)
+{
+	// The up stairs of the first chunk on the top floor lead out of the dungeon
+	chunk_t* chunk = GetChunk(0, 0, 0);
+	if (!chunk || chunk->upX < 0)
+		return false;
+
+	x = chunk->upX;
+	y = chunk->upY;
+
+	return true;
+}
+
+
+bool ChunkedWorld::FindStairsLink(int floor, int x, int y, int& linkFloor, int& linkX, int& linkY)
+{
+	char tile = GetTile(floor, x, y);
+	int chunkX = ChunkCoord(x);
+	int chunkY = ChunkCoord(y);
+	chunk_t* chunk;
+
+	if (tile == DungeonGenerator::DownStairs)
+	{
+		linkFloor = floor + 1;
+		chunk = GetChunk(linkFloor, chunkX, chunkY);
+		if (!chunk || chunk->upX < 0)
+			return false;
+
+		linkX = chunkX * CHUNK_SIZE + chunk->upX;
+		linkY = chunkY * CHUNK_SIZE + chunk->upY;
+		return true;
+	}
+
+	if (tile == DungeonGenerator::UpStairs && floor > 0)
+	{
+		linkFloor = floor - 1;
+		chunk = GetChunk(linkFloor, chunkX, chunkY);
+		if (!chunk || chunk->downX < 0)
+			return false;
+
+		linkX = chunkX * CHUNK_SIZE + chunk->downX;
+		linkY = chunkY * CHUNK_SIZE + chunk->downY;
+		return true;
+	}
+
+	return false;
+}
+
+
+const ChunkedWorld::chunkStats_t& ChunkedWorld::GetStats()
+{
+	return m_stats;
+}
+
+
+ChunkedWorld::chunk_t* ChunkedWorld::GetChunk(int floor, int chunkX, int chunkY)
+{
+	uint64 key = ChunkKey(floor, chunkX, chunkY);
+	chunk_t* chunk;
+
+	std::unordered_map<uint64, chunk_t*>::iterator it = m_chunks.find(key);
+	if (it != m_chunks.end())
+	{
+		// Move it to the front of the LRU list
+		chunk = it->second;
+		m_lru.splice(m_lru.begin(), m_lru, chunk->lruEntry);
+		return chunk;
+	}
+
+	chunk = GenerateChunk(floor, chunkX, chunkY);
+	if (!chunk)
+	{
+		return nullptr;
+	}
+
+	m_lru.push_front(key);
+	chunk->lruEntry = m_lru.begin();
+	m_chunks[key] = chunk;
+
+	m_stats.generatedChunks++;
+	m_stats.residentChunks++;
+	m_stats.residentBytes += sizeof(chunk_t) + chunk->tiles.size();
+
+	EvictChunks(chunk);
+
+	return chunk;
+}
+
+
+ChunkedWorld::chunk_t* ChunkedWorld::GenerateChunk(int floor, int chunkX, int chunkY)
+{
+	static const int maxAttempts = 8;
+	uint64 seed = ChunkSeed(floor, chunkX, chunkY);
+	bool result = false;
+
+
+	// A chunk too cramped for both stairs is regenerated from the next seed in the sequence
+	for (int attempt = 0; attempt < maxAttempts && !result; attempt++)
+	{
+		result = m_generator.Generate(MixSeed(seed + (uint64)attempt), CHUNK_SIZE, CHUNK_SIZE, CHUNK_MAX_FEATURES);
+	}
+
+	if (!result)
+	{
+		return nullptr;
+	}
+
+	chunk_t* chunk = new chunk_t;
+	if (!chunk)
+	{
+		return nullptr;
+	}
+
+	chunk->floor = floor;
+	chunk->chunkX = chunkX;
+	chunk->chunkY = chunkY;
+	chunk->tiles = m_generator.GetTiles();
+
+	// Connect to the four neighbours through the gates on the shared edges
+	const DungeonGenerator::Rect& firstRoom = m_generator.GetRooms()[0];
+	int targetX = firstRoom.x + firstRoom.xSize / 2;
+	int targetY = firstRoom.y + firstRoom.ySize / 2;
+
+	CarveGate(chunk, CHUNK_SIZE - 1, GatePosition(floor, chunkX, chunkY, true), targetX, targetY);
+	CarveGate(chunk, 0, GatePosition(floor, chunkX - 1, chunkY, true), targetX, targetY);
+	CarveGate(chunk, GatePosition(floor, chunkX, chunkY, false), CHUNK_SIZE - 1, targetX, targetY);
+	CarveGate(chunk, GatePosition(floor, chunkX, chunkY - 1, false), 0, targetX, targetY);
+
+	// Remember where the stairs are so floors can be linked without a search
+	chunk->upX = chunk->upY = chunk->downX = chunk->downY = -1;
+	for (int y = 0; y < CHUNK_SIZE; y++)
+	{
+		for (int x = 0; x < CHUNK_SIZE; x++)
+		{
+			char tile = chunk->tiles[x + y * CHUNK_SIZE];
+			if (tile == DungeonGenerator::UpStairs)
+			{
+				chunk->upX = x;
+				chunk->upY = y;
+			}
+			else if (tile == DungeonGenerator::DownStairs)
+			{
+				chunk->downX = x;
+				chunk->downY = y;
+			}
+		}
+	}
+
+	return chunk;
+}
+
+
+void ChunkedWorld::CarveGate(chunk_t* chunk, int x, int y, int targetX, int targetY)
+{
+	std::vector<char>& tiles = chunk->tiles;
+
+	// Leave the edge straight in, then turn towards the first room once level with it.
+	// The target is a floor tile, so the walk always ends on something walkable.
+	bool alongX = (x == 0 || x == CHUNK_SIZE - 1);
+
+	while (!IsWalkable(tiles[x + y * CHUNK_SIZE]))
+	{
+		int dx = 0;
+		int dy = 0;
+
+		if (alongX)
+		{
+			if (x != targetX)
+				dx = (targetX > x) ? 1 : -1;
+			else
+				dy = (targetY > y) ? 1 : -1;
+		}
+		else
+		{
+			if (y != targetY)
+				dy = (targetY > y) ? 1 : -1;
+			else
+				dx = (targetX > x) ? 1 : -1;
+		}
+
+		char& tile = tiles[x + y * CHUNK_SIZE];
+
+		// Knock a door through a room wall
+		if (tile == DungeonGenerator::Wall && tiles[(x + dx) + (y + dy) * CHUNK_SIZE] == DungeonGenerator::Floor)
+		{
+			tile = DungeonGenerator::ClosedDoor;
+			return;
+		}
+
+		tile = DungeonGenerator::Corridor;
+
+		// Wall in the new corridor on both sides
+		for (int side = -1; side <= 1; side += 2)
+		{
+			int sideX = x + side * dy;
+			int sideY = y + side * dx;
+			if (sideX < 0 || sideY < 0 || sideX >= CHUNK_SIZE || sideY >= CHUNK_SIZE)
+				continue;
+
+			if (tiles[sideX + sideY * CHUNK_SIZE] == DungeonGenerator::Unused)
+				tiles[sideX + sideY * CHUNK_SIZE] = DungeonGenerator::Wall;
+		}
+
+		x += dx;
+		y += dy;
+	}
+
+	return;
+}
+
+
+void ChunkedWorld::EvictChunks(chunk_t* keep)
+{
+	while (m_chunks.size() > m_chunkBudget)
+	{
+		uint64 key = m_lru.back();
+		std::unordered_map<uint64, chunk_t*>::iterator it = m_chunks.find(key);
+		if (it->second == keep)
+			break;
+
+		m_stats.evictedChunks++;
+		m_stats.residentChunks--;
+		m_stats.residentBytes -= sizeof(chunk_t) + it->second->tiles.size();
+
+		delete it->second;
+		m_chunks.erase(it);
+		m_lru.pop_back();
+	}
+
+	return;
+}
+
+
+uint64 ChunkedWorld::ChunkKey(int floor, int chunkX, int chunkY)
+{
+	// 16 bits of floor and 24 bits for each chunk coordinate
+	return ((uint64)(floor & 0xFFFF) << 48) | ((uint64)(chunkX & 0xFFFFFF) << 24) | (uint64)(chunkY & 0xFFFFFF);
+}
+
+
+uint64 ChunkedWorld::ChunkSeed(int floor, int chunkX, int chunkY)
+{
+	return MixSeed(m_seed ^ MixSeed(ChunkKey(floor, chunkX, chunkY)));
+}
+
+
+int ChunkedWorld::GatePosition(int floor, int chunkX, int chunkY, bool eastEdge)
+{
+	// The gate on the east (or north) edge of a chunk, keeping clear of the corners
+	uint64 hash = MixSeed(ChunkSeed(floor, chunkX, chunkY) + (eastEdge ? 1 : 2));
+
+	return 4 + (int)(hash % (uint64)(CHUNK_SIZE - 8));
+}
@@ -21,12 +21,21 @@
 #include "camera.cpp"
 #include "shader.cpp"
 #include "timer.cpp"
+#include "job_pool.cpp"
 #include "fps_count.cpp"
 #include "cpu_load.cpp"
 #include "font_shader.cpp"
 #include "text.cpp"
 #include "light.cpp"
 #include "frustum.cpp"
+#include "quadtree.cpp"
+#include "spatial_hash.cpp"
+#include "physics_tile_collider.cpp"
+#include "physics_aabb.cpp"
+#include "physics_movement.cpp"
+#include "entity_store.cpp"
+#include "sim_scheduler.cpp"
+#include "input_log.cpp"
 #include "entity.cpp"
 /*
 #include "debug_window.cpp"
@@ -34,7 +43,12 @@
 #include "render_texture.cpp"
 #include "depth_shader.cpp"
 */
+#include "dungeon_gen.cpp"
+#include "dungeon_chunks.cpp"
+#include "tile_grid.cpp"
+#include "dungeon_floor.cpp"
 #include "dungeon_world.cpp"
+#include "game_sim.cpp"
 
 
 Game::Game()
@@ -57,6 +71,9 @@ Game::Game()
 	m_DepthShader = nullptr;
 */
 	m_World = nullptr;
+	m_PendingInput = {};
+	m_PlayerTileX = 0;
+	m_PlayerTileZ = 0;
 }
 
 
@@ -386,7 +403,7 @@ bool Game::Init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeigh
 	playerPosition.y = 1.0f;
 	playerPosition.z = 0.0f;
 
-	m_World->GetUpStairsLocation(playerPosition.x, playerPosition.z);
+	m_World->GetEntranceLocation(playerPosition.x, playerPosition.z);
 	m_Player->SetPosition(playerPosition);
 
 	m_Camera->SetPosition(playerPosition.x+3.0f, playerPosition.y+10.0f, playerPosition.z-3.0f);
@@ -410,6 +427,26 @@ bool Game::Init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeigh
 	}
 
 
+	//--------------------------------------------
+    // Simulation Initialization
+    //--------------------------------------------
+	// The player and the entities move in fixed steps, and every step's input is logged for replays
+	m_Scheduler.Init(SIM_STEP_MS, SIM_MAX_STEPS_PER_FRAME);
+
+	result = m_Sim.Init(m_World->GetCollider(), m_World->GetEntities(), playerPosition, SIM_STEP_MS, m_World->GetPhysics());
+	if(!result)
+	{
+		MessageBox(hwnd, reinterpret_cast<LPCSTR>("Could not initialize the simulation."), reinterpret_cast<LPCSTR>("Error"), MB_OK);
+		return false;
+	}
+
+	BeginInputLog(playerPosition);
+
+	// The player starts on the up stairs, which only work once stepped off and back onto
+	m_PlayerTileX = (int)floorf(playerPosition.x);
+	m_PlayerTileZ = (int)floorf(playerPosition.z);
+
+
 	return true;
 }
 
@@ -456,6 +493,10 @@ void Game::Shutdown()
 	}
 */
 
+	// Keep the session's input so it can be replayed, then stop the simulation before its world goes.
+	m_InputLog.Save(SESSION_LOG_FILENAME);
+	m_Sim.Shutdown();
+
 	// Release the game world object.
 	if(m_World)
 	{
@@ -611,53 +652,40 @@ bool Game::Frame()
 bool Game::HandleInput(float frameTime)
 {
 	bool result;
-	int inputRotX, inputRotY;
-	Vector3_t playerMove = {0.0f, 0.0f, 0.0f};
+	uint32 steps;
+	Vector3_t playerPos, playerRot;
 
-	// Handle the input.
-	// Use the mouse location for the rotation
-	m_Input->GetMouseMovement(inputRotX, inputRotY);
-
-	// TODO(ebd): Update the keyboard/gamepad to use game specific action buttons
-	// instead of using the direct key or gamepad button
-	// For example, mapping jump to space or a-button, then calling m_Input->JumpButton()
-	// Need to add a MapKey() function to the Input class, and have a xml file to describe mappings
-
-	// Check for W Key input for move forward
-	if (m_Input->IsKeyPressed(DIK_W))
-	    playerMove.z += 1.0f;
 
-    // Check for S Key input for move backward
-	if (m_Input->IsKeyPressed(DIK_S))
-	    playerMove.z -= 1.0f;
-
-	// Check for A Key input for strafe left
-	if(m_Input->IsKeyPressed(DIK_A))
-	    playerMove.x -= 1.0f;
+	// Read the input for the steps this frame runs.
+	ReadInput();
 
-	// Check for D Key input for strafe right
-	if(m_Input->IsKeyPressed(DIK_D))
-	    playerMove.x += 1.0f;
-
-	// Check for Jump action
-	if (m_Input->IsKeyPressedStrobe(DIK_SPACE))
-		playerMove.y += 1.0f;
+	// Run however many fixed steps this frame's time adds up to, logging the input each one gets.
+	// Look movement and a jump only go to the first step, the buttons stay held for the rest.
+	steps = m_Scheduler.Advance(frameTime);
+	for (uint32 i = 0; i < steps; i++)
+	{
+		m_InputLog.Record(m_PendingInput);
+		m_Sim.Step(m_PendingInput);
 
-	
-    Vector3_t playerPos, playerRot;
+		m_PendingInput.buttons &= ~InputLog::ButtonJump;
+		m_PendingInput.lookX = 0;
+		m_PendingInput.lookY = 0;
+	}
 
-    playerRot.x = (float)(inputRotY);
-    playerRot.y = (float)(inputRotX);
-    playerRot.z = 0.0f;
+	// Stairs take the player to the floor they lead to, and the floor loads around them as they walk.
+	result = FollowPlayer();
+	if(!result)
+	{
+		return false;
+	}
 
-	// Move and rotate the player based on inputs.
-	m_Player->Move(m_Direct3DSystem->GetDevice(), playerMove, m_World, frameTime);
-	m_Player->Rotate(playerRot, frameTime);
-    //m_Player->SetRotation(playerRot);
+	// Place the player between the last two steps, by how far this frame is into the next one.
+	m_Sim.GetPlayerPosition(m_Scheduler.GetAlpha(), playerPos);
+	playerRot = m_Sim.GetPlayerRotation();
 
-	// Get the position of the player.
-	m_Player->GetPosition(playerPos);
-	m_Player->GetRotation(playerRot);
+	m_Player->SetPosition(playerPos);
+	m_Player->SetRotation(playerRot);
+	m_Player->UpdateModel(m_Direct3DSystem->GetDevice());
 
 	// Set the position of the camera.
 	m_Camera->SetPosition(playerPos.x+3.0f, 10.0f, playerPos.z-3.0f);
@@ -684,6 +712,149 @@ bool Game::HandleInput(float frameTime)
 }
 
 
+bool Game::FollowPlayer()
+{
+	bool result, moved;
+	Vector3_t position;
+	int tileX, tileZ, windowX, windowZ, linkX, linkZ;
+	uint32 linkFloor;
+
+
+	// Only stepping onto a new tile takes the stairs or moves the floor, standing on them doesn't
+	m_Sim.GetPlayerPosition(1.0f, position);
+	tileX = (int)floorf(position.x);
+	tileZ = (int)floorf(position.z);
+	if (tileX == m_PlayerTileX && tileZ == m_PlayerTileZ)
+	{
+		return true;
+	}
+
+	m_PlayerTileX = tileX;
+	m_PlayerTileZ = tileZ;
+
+	if (m_World->FindStairsLink(tileX, tileZ, linkFloor, linkX, linkZ))
+	{
+		// The new floor is built around the stairs the player comes out on. Its walls go into the same
+		// collider, and the entities and bodies of the old one are cleared.
+		result = m_World->SetCurrentFloor(m_Direct3DSystem->GetDevice(), linkFloor, linkX, linkZ);
+		if(!result)
+		{
+			return false;
+		}
+
+		m_World->GetWindowOrigin(windowX, windowZ);
+		position.x = (float)(linkX - windowX);
+		position.y = 1.0f;
+		position.z = (float)(linkZ - windowZ);
+	}
+	else
+	{
+		// Nearing the edge of the floor moves it along, and the player into its new tiles
+		result = m_World->UpdateAround(m_Direct3DSystem->GetDevice(), position, moved);
+		if(!result)
+		{
+			return false;
+		}
+
+		if (!moved)
+		{
+			return true;
+		}
+	}
+
+	return RestartSim(position);
+}
+
+
+bool Game::RestartSim(Vector3_t position)
+{
+	bool result;
+
+
+	// The simulation and the input log start again where the player is on the new floor, the same way a
+	// session starts, so the log always replays from the start of the floor.
+	m_Sim.Shutdown();
+	result = m_Sim.Init(m_World->GetCollider(), m_World->GetEntities(), position, SIM_STEP_MS, m_World->GetPhysics());
+	if(!result)
+	{
+		return false;
+	}
+
+	BeginInputLog(position);
+
+	m_PlayerTileX = (int)floorf(position.x);
+	m_PlayerTileZ = (int)floorf(position.z);
+
+	return true;
+}
+
+
+void Game::BeginInputLog(Vector3_t spawn)
+{
+	InputLog::logHeader_t logHeader = {};
+
+
+	logHeader.seed = m_World->GetSeed();
+	logHeader.floor = m_World->GetCurrentFloor();
+	logHeader.stepMs = SIM_STEP_MS;
+	logHeader.spawnX = spawn.x;
+	logHeader.spawnY = spawn.y;
+	logHeader.spawnZ = spawn.z;
+	m_World->GetWindowOrigin(logHeader.windowX, logHeader.windowZ);
+	m_InputLog.Begin(logHeader);
+
+	return;
+}
+
+
+void Game::ReadInput()
+{
+	int inputRotX, inputRotY;
+	uint8 buttons = 0;
+
+
+	// Handle the input.
+	// Use the mouse location for the rotation
+	m_Input->GetMouseMovement(inputRotX, inputRotY);
+
+	// TODO(ebd): Update the keyboard/gamepad to use game specific action buttons
+	// instead of using the direct key or gamepad button
+	// For example, mapping jump to space or a-button, then calling m_Input->JumpButton()
+	// Need to add a MapKey() function to the Input class, and have a xml file to describe mappings
+
+	// Check for W Key input for move forward
+	if (m_Input->IsKeyPressed(DIK_W))
+	    buttons |= InputLog::ButtonForward;
+
+    // Check for S Key input for move backward
+	if (m_Input->IsKeyPressed(DIK_S))
+	    buttons |= InputLog::ButtonBack;
+
+	// Check for A Key input for strafe left
+	if(m_Input->IsKeyPressed(DIK_A))
+	    buttons |= InputLog::ButtonLeft;
+
+	// Check for D Key input for strafe right
+	if(m_Input->IsKeyPressed(DIK_D))
+	    buttons |= InputLog::ButtonRight;
+
+	// Check for Jump action, a frame without a step keeps it for the next step
+	if (m_Input->IsKeyPressedStrobe(DIK_SPACE))
+		buttons |= InputLog::ButtonJump;
+	buttons |= (m_PendingInput.buttons & InputLog::ButtonJump);
+
+	m_PendingInput.buttons = buttons;
+
+	// Frames without a step add their mouse movement up for the next one
+	inputRotX += m_PendingInput.lookX;
+	inputRotY += m_PendingInput.lookY;
+	m_PendingInput.lookX = (int16)((inputRotX > 32767) ? 32767 : ((inputRotX < -32768) ? -32768 : inputRotX));
+	m_PendingInput.lookY = (int16)((inputRotY > 32767) ? 32767 : ((inputRotY < -32768) ? -32768 : inputRotY));
+
+	return;
+}
+
+
 bool Game::RenderSceneToTexture()
 {
 /*
@@ -0,0 +1,1870 @@
+/*!
+  @file
+  dungeon_floor.cpp
+
+  @brief
+  One floor of the dungeon: its tile map, tile features and geometry.
+
+  @detail
+  Everything up to the vertex and index arrays is built on the CPU without
+  DirectX, so floors can be built in parallel and by the headless tools.
+  GameWorld uploads the arrays of the floor the player is on.
+  The tile records only say where a tile is, what pieces it has and what it
+  is made of, the vertex attributes come from the material table below.
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "dungeon_floor.h"
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+
+
+//--------------------------------------------
+// Wall Feature Table
+//--------------------------------------------
+// What a neighbouring tile looks like to a wall, two bits each
+enum NeighbourClass
+{
+	OtherNeighbour	= 0,
+	OpenNeighbour	= 1,
+	DoorNeighbour	= 2,
+	WallNeighbour	= 3
+};
+
+// Key bits 0-3: the NW, NE, SW and SE neighbours are open or a door.
+// Key bits 4-11: the classes of the N, S, E and W neighbours.
+const int WALL_FEATURE_KEYS = 1 << 12;
+
+struct wallFeatureTable_t
+{
+	uint16 features[WALL_FEATURE_KEYS];
+};
+
+struct neighbourClassTable_t
+{
+	uint8 classes[256];
+};
+
+static constexpr neighbourClassTable_t BuildNeighbourClassTable()
+{
+	neighbourClassTable_t table = {};
+
+	table.classes[(uint8)DungeonFloor::Open] = OpenNeighbour;
+	table.classes[(uint8)DungeonFloor::ClosedDoor] = DoorNeighbour;
+	table.classes[(uint8)DungeonFloor::Wall] = WallNeighbour;
+
+	return table;
+}
+
+static constexpr neighbourClassTable_t s_neighbourClasses = BuildNeighbourClassTable();
+
+// 1 for OpenNeighbour and DoorNeighbour, 0 otherwise
+static inline int IsOpenOrDoor(uint8 neighbourClass)
+{
+	return (neighbourClass ^ (neighbourClass >> 1)) & 1;
+}
+
+// The features of a wall tile, worked out the long way for one neighbourhood key
+static constexpr uint16 ClassifyWall(int key)
+{
+	int north = (key >> 4) & 3;
+	int south = (key >> 6) & 3;
+	int east = (key >> 8) & 3;
+	int west = (key >> 10) & 3;
+	uint32 features = (uint32)(key & 0x0F); // the diagonal floors
+
+	// Check the North tile to add walls
+	if (north == OpenNeighbour)
+	{
+		features |= DungeonFloor::NorthWestFloor | DungeonFloor::NorthEastFloor | DungeonFloor::WestWall | DungeonFloor::EastWall;
+		if (east == OpenNeighbour)
+			features &= ~DungeonFloor::EastWall;
+		if (west == OpenNeighbour)
+			features &= ~DungeonFloor::WestWall;
+	}
+	else if (north == DoorNeighbour)
+		features |= DungeonFloor::NorthWestFloor | DungeonFloor::NorthEastFloor | DungeonFloor::NorthWall | DungeonFloor::NorthWallCap;
+	else if (north == WallNeighbour && (features & (DungeonFloor::NorthEastFloor | DungeonFloor::NorthWestFloor)))
+		features |= DungeonFloor::NorthWall;
+
+	// Check the South tile to add walls
+	if (south == OpenNeighbour)
+	{
+		features |= DungeonFloor::SouthWestFloor | DungeonFloor::SouthEastFloor | DungeonFloor::WestWall | DungeonFloor::EastWall;
+		if (east == OpenNeighbour)
+			features &= ~DungeonFloor::EastWall;
+		if (west == OpenNeighbour)
+			features &= ~DungeonFloor::WestWall;
+	}
+	else if (south == DoorNeighbour)
+		features |= DungeonFloor::SouthWestFloor | DungeonFloor::SouthEastFloor | DungeonFloor::SouthWall | DungeonFloor::SouthWallCap;
+	else if (south == WallNeighbour && (features & (DungeonFloor::SouthEastFloor | DungeonFloor::SouthWestFloor)))
+		features |= DungeonFloor::SouthWall;
+
+	// Check the East tile to add walls
+	if (east == OpenNeighbour)
+	{
+		features |= DungeonFloor::NorthEastFloor | DungeonFloor::SouthEastFloor | DungeonFloor::NorthWall | DungeonFloor::SouthWall;
+		if (north == OpenNeighbour)
+			features &= ~DungeonFloor::NorthWall;
+		if (south == OpenNeighbour)
+			features &= ~DungeonFloor::SouthWall;
+	}
+	else if (east == DoorNeighbour)
+		features |= DungeonFloor::NorthEastFloor | DungeonFloor::SouthEastFloor | DungeonFloor::EastWall | DungeonFloor::EastWallCap;
+	else if (east == WallNeighbour && (features & (DungeonFloor::NorthEastFloor | DungeonFloor::SouthEastFloor)))
+		features |= DungeonFloor::EastWall;
+
+	// Check the West tile to add walls
+	if (west == OpenNeighbour)
+	{
+		features |= DungeonFloor::NorthWestFloor | DungeonFloor::SouthWestFloor | DungeonFloor::NorthWall | DungeonFloor::SouthWall;
+		if (north == OpenNeighbour)
+			features &= ~DungeonFloor::NorthWall;
+		if (south == OpenNeighbour)
+			features &= ~DungeonFloor::SouthWall;
+	}
+	else if (west == DoorNeighbour)
+		features |= DungeonFloor::NorthWestFloor | DungeonFloor::SouthWestFloor | DungeonFloor::WestWall | DungeonFloor::WestWallCap;
+	else if (west == WallNeighbour && (features & (DungeonFloor::NorthWestFloor | DungeonFloor::SouthWestFloor)))
+		features |= DungeonFloor::WestWall;
+
+	// Check to add in the walls that just come to an end and don't connect
+	if (north == OpenNeighbour && south == WallNeighbour && east == OpenNeighbour && west == OpenNeighbour)
+		features |= DungeonFloor::NorthWall;
+	if (north == WallNeighbour && south == OpenNeighbour && east == OpenNeighbour && west == OpenNeighbour)
+		features |= DungeonFloor::SouthWall;
+	if (north == OpenNeighbour && south == OpenNeighbour && east == WallNeighbour && west == OpenNeighbour)
+		features |= DungeonFloor::WestWall;
+	if (north == OpenNeighbour && south == OpenNeighbour && east == OpenNeighbour && west == WallNeighbour)
+		features |= DungeonFloor::EastWall;
+
+	// Lastly, check if any walls need an end cap
+	if ((features & DungeonFloor::NorthWall) && north != WallNeighbour)
+		features |= DungeonFloor::NorthWallCap;
+	if ((features & DungeonFloor::SouthWall) && south != WallNeighbour)
+		features |= DungeonFloor::SouthWallCap;
+	if ((features & DungeonFloor::EastWall) && east != WallNeighbour)
+		features |= DungeonFloor::EastWallCap;
+	if ((features & DungeonFloor::WestWall) && west != WallNeighbour)
+		features |= DungeonFloor::WestWallCap;
+
+	return (uint16)features;
+}
+
+static constexpr wallFeatureTable_t BuildWallFeatureTable()
+{
+	wallFeatureTable_t table = {};
+
+	for (int key = 0; key < WALL_FEATURE_KEYS; key++)
+	{
+		table.features[key] = ClassifyWall(key);
+	}
+
+	return table;
+}
+
+// Built by the compiler, 8KB
+static constexpr wallFeatureTable_t s_wallFeatures = BuildWallFeatureTable();
+
+// Features of the used tile at x, from the class rows above, on and below it
+static inline void ClassifyTile(char tile, int x, int y, const uint8* north, const uint8* middle, const uint8* south,
+                                DungeonFloor::floorTile_t& gridTile)
+{
+	gridTile.x = (uint16)x;
+	gridTile.z = (uint16)y;
+
+	if (tile == DungeonFloor::Wall)
+	{
+		uint32 key = (uint32)(IsOpenOrDoor(north[x-1])) |
+		             (uint32)(IsOpenOrDoor(north[x+1]) << 1) |
+		             (uint32)(IsOpenOrDoor(south[x-1]) << 2) |
+		             (uint32)(IsOpenOrDoor(south[x+1]) << 3) |
+		             (uint32)(north[x] << 4) | (uint32)(south[x] << 6) |
+		             (uint32)(middle[x+1] << 8) | (uint32)(middle[x-1] << 10);
+
+		gridTile.geoFeatures = s_wallFeatures.features[key];
+		gridTile.material = DungeonFloor::WallMaterial;
+	}
+	else if (tile == DungeonFloor::ClosedDoor)
+	{
+		gridTile.geoFeatures = DungeonFloor::NorthWestFloor | DungeonFloor::NorthEastFloor |
+		                       DungeonFloor::SouthWestFloor | DungeonFloor::SouthEastFloor |
+		                       ((north[x] == WallNeighbour) ? DungeonFloor::VertDoorway : DungeonFloor::HorizDoorway);
+		gridTile.material = DungeonFloor::DoorMaterial;
+	}
+	else
+	{
+		gridTile.geoFeatures = DungeonFloor::NorthWestFloor | DungeonFloor::NorthEastFloor |
+		                       DungeonFloor::SouthWestFloor | DungeonFloor::SouthEastFloor;
+		gridTile.material = DungeonFloor::FloorMaterial;
+	}
+}
+
+
+//--------------------------------------------
+// Tile Materials
+//--------------------------------------------
+// Vertex attributes every tile of a material shares
+struct tileMaterial_t
+{
+	float r, g, b;
+	float normalY; // of the wall and cap faces, floors and doorways set their own
+};
+
+// Tiles aren't coloured yet
+static const tileMaterial_t s_tileMaterials[DungeonFloor::MaterialCount] =
+{
+	{ 0.0f, 0.0f, 0.0f, 1.0f }, // FloorMaterial
+	{ 0.0f, 0.0f, 0.0f, 0.0f }, // WallMaterial
+	{ 0.0f, 0.0f, 0.0f, 1.0f }  // DoorMaterial
+};
+
+// A tile record unpacked into what its vertices start from
+struct tileAttributes_t
+{
+	float x, y, z;
+	float tu, tv;
+	float ny;
+	float r, g, b;
+};
+
+static inline void DeriveTileAttributes(const DungeonFloor::floorTile_t& tile, tileAttributes_t& attributes)
+{
+	const tileMaterial_t& material = s_tileMaterials[tile.material];
+
+	attributes.x = (float)tile.x;
+	attributes.y = 0.0f;
+	attributes.z = (float)tile.z;
+	attributes.tu = 0.0f;
+	attributes.tv = 1.0f;
+	attributes.ny = material.normalY;
+	attributes.r = material.r;
+	attributes.g = material.g;
+	attributes.b = material.b;
+}
+
+
+//--------------------------------------------
+// Geometry Helpers
+//--------------------------------------------
+// Tiles written by one geometry job
+static const uint32 GEOMETRY_JOB_TILES = 1024;
+
+// Two triangles over the last four vertices written: bottom left, top left, top right, bottom right
+static void AddQuadIndices(uint32*& indices, uint32& index)
+{
+	indices[0] = index;
+	indices[1] = index + 1;
+	indices[2] = index + 2;
+	indices[3] = index + 2;
+	indices[4] = index + 3;
+	indices[5] = index;
+
+	indices += 6;
+	index += 4;
+}
+
+static int BitCount(uint32 value)
+{
+	int count = 0;
+	for (; value; value &= value - 1)
+		count++;
+
+	return count;
+}
+
+// Wall and wall-cap quads of a tile: each wall has both sides of its three 1m sections, each cap one side
+static uint32 CountTileQuads(uint32 geoFeatures)
+{
+	uint32 walls = geoFeatures & (DungeonFloor::NorthWall | DungeonFloor::SouthWall |
+	                              DungeonFloor::EastWall | DungeonFloor::WestWall);
+	uint32 caps = geoFeatures & (DungeonFloor::NorthWallCap | DungeonFloor::SouthWallCap |
+	                             DungeonFloor::EastWallCap | DungeonFloor::WestWallCap);
+
+	return 6 * BitCount(walls) + 3 * BitCount(caps);
+}
+
+// Floor quarters of a tile on the half tile grid, bit (row * 2 + column) from the south west
+static uint32 FloorCellMask(uint32 geoFeatures)
+{
+	return ((geoFeatures & DungeonFloor::SouthWestFloor) ? 0x1 : 0) | ((geoFeatures & DungeonFloor::SouthEastFloor) ? 0x2 : 0) |
+	       ((geoFeatures & DungeonFloor::NorthWestFloor) ? 0x4 : 0) | ((geoFeatures & DungeonFloor::NorthEastFloor) ? 0x8 : 0);
+}
+
+// Wall top cells of a tile on the third tile grid, bit (row * 3 + column) from the south west
+static uint32 WallTopCellMask(uint32 geoFeatures)
+{
+	uint32 mask = 0;
+
+	if (geoFeatures & DungeonFloor::NorthWall)
+		mask |= (1 << 4) | (1 << 7);
+	if (geoFeatures & DungeonFloor::SouthWall)
+		mask |= (1 << 4) | (1 << 1);
+	if (geoFeatures & DungeonFloor::EastWall)
+		mask |= (1 << 4) | (1 << 5);
+	if (geoFeatures & DungeonFloor::WestWall)
+		mask |= (1 << 4) | (1 << 3);
+
+	return mask;
+}
+
+static uint32 TileCellMask(uint32 geoFeatures, int cellsPerTile)
+{
+	return (cellsPerTile == 2) ? FloorCellMask(geoFeatures) : WallTopCellMask(geoFeatures);
+}
+
+// Hash of the position bits, vertices that share a corner land in the same bucket
+static uint32 HashVertexPosition(const DungeonFloor::floorVertex_t& vertex)
+{
+	uint32 bits[3];
+	memcpy(bits, &vertex.position, sizeof(bits));
+
+	uint32 hash = bits[0] * 0x9E3779B1u;
+	hash = (hash ^ bits[1]) * 0x85EBCA77u;
+	hash = (hash ^ bits[2]) * 0xC2B2AE3Du;
+
+	return hash ^ (hash >> 16);
+}
+
+
+
+DungeonFloor::DungeonFloor()
+{
+	m_length = 0;
+	m_width = 0;
+	m_error = nullptr;
+	m_geometryStats = {};
+}
+
+
+DungeonFloor::~DungeonFloor()
+{
+}
+
+
+bool DungeonFloor::Build(Gumshoe::Random& random, int length, int width, int maxFeatures, Gumshoe::JobPool* jobPool)
+{
+	bool result;
+
+
+	// First generate the random dungeon
+	result = Generate(random, length, width, maxFeatures);
+	if (!result)
+	{
+		return false;
+	}
+
+	// Then work out the tile features and build the geometry from them
+	ClassifyTiles();
+	BuildGeometry(jobPool);
+
+	return true;
+}
+
+
+bool DungeonFloor::Build(ChunkedWorld& chunks, int floor, int x, int y, int length, int width, Gumshoe::JobPool* jobPool)
+{
+	if (!SetSize(length, width))
+	{
+		return false;
+	}
+
+	// Take the tiles from the chunks under the rect, the floor's tile 0,0 is chunk tile x,y
+	std::vector<char> tiles(length * width);
+	chunks.GetTileRect(floor, x, y, length, width, tiles.data());
+	AssignTiles(tiles);
+	m_error = nullptr;
+
+	ClassifyTiles();
+	BuildGeometry(jobPool);
+
+	return true;
+}
+
+
+bool DungeonFloor::Generate(Gumshoe::Random& random, int length, int width, int maxFeatures)
+{
+	DungeonGenerator generator;
+	bool result;
+
+
+	if (!SetSize(length, width))
+	{
+		return false;
+	}
+
+	// Generate the tile map with the headless generator
+	result = generator.Generate(random, m_length, m_width, maxFeatures);
+	m_error = generator.GetError();
+
+	std::vector<char> tiles = generator.GetTiles();
+	AssignTiles(tiles);
+
+	return result;
+}
+
+
+bool DungeonFloor::SetSize(int length, int width)
+{
+	// Tile records keep their position in 16 bits
+	if (length < 1 || width < 1 || length > 0x10000 || width > 0x10000)
+	{
+		m_error = "Floors can be at most 65536 tiles along each side.";
+		return false;
+	}
+
+	m_length = length;
+	m_width = width;
+
+	return true;
+}
+
+
+void DungeonFloor::AssignTiles(std::vector<char>& tiles)
+{
+	// Replace all unused tiles with '.' and set the rooms and corridors to ' '
+	for (char& tile : tiles)
+	{
+		if (tile == DungeonGenerator::Unused)
+			tile = Empty;
+		else if (tile == DungeonGenerator::Floor || tile == DungeonGenerator::Corridor)
+			tile = Open;
+	}
+	m_map.Assign(tiles, m_length, m_width, m_map.GetLayout());
+
+	return;
+}
+
+
+void DungeonFloor::ClassifyTiles()
+{
+	uint32 index;
+	uint32 tileCount = 0;
+	int stride = m_length + 2;
+	std::vector<char> rowBuffer(m_length);
+
+
+	// Class map with a one tile border. Outside the map reads as open, same as GetTile().
+	m_classes.assign(stride * (m_width + 2), OpenNeighbour);
+	for (int y = 0; y < m_width; ++y)
+	{
+		const char* row = m_map.GetRow(y, rowBuffer.data());
+		uint8* classRow = &m_classes[(y + 1) * stride + 1];
+
+		for (int x = 0; x < m_length; ++x)
+		{
+			classRow[x] = s_neighbourClasses.classes[(uint8)row[x]];
+			if (row[x] != Empty)
+				tileCount++;
+		}
+	}
+
+	// Create the structure to hold the game world data.
+	m_tiles.assign(tileCount, floorTile_t());
+
+	// Work out which floor, wall and cap pieces each used tile needs from its neighbours.
+	// The rows above and below are always there thanks to the border, so nothing is bounds checked.
+	index = 0;
+	for (int y = 0; y < m_width; ++y)
+	{
+		const char* row = m_map.GetRow(y, rowBuffer.data());
+		const uint8* north = &m_classes[(y + 2) * stride + 1];
+		const uint8* middle = &m_classes[(y + 1) * stride + 1];
+		const uint8* south = &m_classes[y * stride + 1];
+
+		for (int x = 0; x < m_length; ++x)
+		{
+			char tile = row[x];
+			if (tile == Empty)
+				continue;
+
+			ClassifyTile(tile, x, y, north, middle, south, m_tiles[index++]);
+		}
+	}
+
+	// The tiles may have moved, so the update lookups are built again when needed
+	m_dirtyTiles.clear();
+	m_tileLookup.clear();
+
+	return;
+}
+
+
+void DungeonFloor::BuildGeometry(Gumshoe::JobPool* jobPool)
+{
+	uint32 tileCount = (uint32)m_tiles.size();
+	uint32 quadCount, mergedQuads;
+
+
+	m_shortIndices.clear();
+	m_geometryStats = {};
+	m_tileLookup.clear();
+
+	// First merge the floors and the wall tops into as few rectangles as possible
+	MergeFloorCells();
+	MergeWallTopCells();
+	mergedQuads = (uint32)(m_floorRects.size() + m_wallTopRects.size());
+
+	// Then count the wall quads of every tile, a running total gives each tile its place in the arrays
+	m_quadOffsets.resize(tileCount + 1);
+	quadCount = mergedQuads;
+	for (uint32 i = 0; i < tileCount; i++)
+	{
+		m_quadOffsets[i] = quadCount;
+		quadCount += CountTileQuads(m_tiles[i].geoFeatures);
+	}
+	m_quadOffsets[tileCount] = quadCount;
+
+	// Every quad is four vertices and six indices, so both arrays are sized once and written in place
+	m_vertices.resize(quadCount * 4);
+	m_indices.resize(quadCount * 6);
+
+	floorVertex_t* vertices = m_vertices.data();
+	uint32* indices = m_indices.data();
+	uint32 index = 0;
+	AddMergedGeometry(vertices, indices, index);
+
+	if (jobPool)
+	{
+		// Tile ranges write to their own parts of the arrays, so they can be built in parallel
+		std::vector<geometryJob_t> jobs;
+		for (uint32 firstTile = 0; firstTile < tileCount; firstTile += GEOMETRY_JOB_TILES)
+		{
+			geometryJob_t job = { this, firstTile, (tileCount - firstTile > GEOMETRY_JOB_TILES) ? firstTile + GEOMETRY_JOB_TILES : tileCount };
+			jobs.push_back(job);
+		}
+
+		Gumshoe::JobCounter counter(0);
+		for (size_t i = 0; i < jobs.size(); i++)
+		{
+			jobPool->Submit(AddTileGeometryJob, &jobs[i], &counter);
+		}
+		jobPool->Wait(counter);
+	}
+	else
+	{
+		AddTileGeometry(0, tileCount);
+	}
+
+	m_geometryStats.triangles = (uint32)m_indices.size() / 3;
+	m_geometryStats.unmergedTriangles += 2 * (quadCount - mergedQuads);
+	m_geometryStats.emittedVertices = (uint32)m_vertices.size();
+
+	// Share the corners that neighbouring quads have in common
+	WeldVertices();
+	m_geometryStats.vertices = (uint32)m_vertices.size();
+
+	// Halve the index buffer when every vertex can be reached with 16 bits
+	if (m_vertices.size() <= 0x10000)
+	{
+		m_shortIndices.assign(m_indices.begin(), m_indices.end());
+	}
+
+	return;
+}
+
+
+void DungeonFloor::WeldVertices()
+{
+	const uint32 emptySlot = 0xFFFFFFFF;
+	uint32 vertexCount = (uint32)m_vertices.size();
+	uint32 weldedCount = 0;
+	uint32 slotCount = 1;
+
+
+	// Open addressing table of welded vertex numbers, kept under half full
+	while (slotCount < vertexCount * 2)
+		slotCount <<= 1;
+
+	std::vector<uint32> slots(slotCount, emptySlot);
+	std::vector<uint32> remap(vertexCount);
+
+	// Move every first occurrence down to the front of the array, in order
+	for (uint32 i = 0; i < vertexCount; i++)
+	{
+		uint32 slot = HashVertexPosition(m_vertices[i]) & (slotCount - 1);
+
+		while (slots[slot] != emptySlot &&
+		       memcmp(&m_vertices[slots[slot]], &m_vertices[i], sizeof(floorVertex_t)) != 0)
+		{
+			slot = (slot + 1) & (slotCount - 1);
+		}
+
+		if (slots[slot] == emptySlot)
+		{
+			m_vertices[weldedCount] = m_vertices[i];
+			slots[slot] = weldedCount++;
+		}
+
+		remap[i] = slots[slot];
+	}
+
+	m_vertices.resize(weldedCount);
+
+	for (size_t i = 0; i < m_indices.size(); i++)
+	{
+		m_indices[i] = remap[m_indices[i]];
+	}
+
+	return;
+}
+
+
+bool DungeonFloor::UpdateGeometry(geometryPatch_t& patch)
+{
+	std::vector<uint32> changedTiles, oldFeatures;
+	floorVertex_t* vertices;
+	uint32* indices;
+	uint32 index, tileIndex, firstQuad, quadCount;
+	int stride = m_length + 2;
+
+
+	patch.removedTriangles.clear();
+	patch.firstVertex = (uint32)m_vertices.size();
+	patch.firstTriangle = (uint32)m_indices.size() / 3;
+	patch.vertexCount = 0;
+	patch.triangleCount = 0;
+
+	if (m_vertices.empty())
+	{
+		return false;
+	}
+
+	if (m_dirtyTiles.empty())
+	{
+		return true;
+	}
+
+	if (m_tileLookup.empty())
+	{
+		BuildUpdateLookup();
+	}
+
+	// Work out the dirty tiles again, and keep the ones that came out different
+	std::sort(m_dirtyTiles.begin(), m_dirtyTiles.end());
+	m_dirtyTiles.erase(std::unique(m_dirtyTiles.begin(), m_dirtyTiles.end()), m_dirtyTiles.end());
+	for (size_t i = 0; i < m_dirtyTiles.size(); i++)
+	{
+		int x = m_dirtyTiles[i] % m_length;
+		int y = m_dirtyTiles[i] / m_length;
+		floorTile_t gridTile;
+
+		tileIndex = m_tileLookup[m_dirtyTiles[i]];
+		ClassifyTile(m_map.Get(x, y), x, y, &m_classes[(y + 2) * stride + 1], &m_classes[(y + 1) * stride + 1],
+		             &m_classes[y * stride + 1], gridTile);
+
+		if (gridTile.geoFeatures == m_tiles[tileIndex].geoFeatures && gridTile.material == m_tiles[tileIndex].material)
+			continue;
+
+		changedTiles.push_back(tileIndex);
+		oldFeatures.push_back(m_tiles[tileIndex].geoFeatures);
+		m_tiles[tileIndex] = gridTile;
+	}
+	m_dirtyTiles.clear();
+
+	// Walls and caps belong to one tile, so a changed tile swaps its quads for new ones at the end
+	for (size_t i = 0; i < changedTiles.size(); i++)
+	{
+		quadRange_t& quads = m_tileQuads[changedTiles[i]];
+
+		for (uint32 quad = quads.firstQuad; quad < quads.firstQuad + quads.quadCount; quad++)
+		{
+			RemoveQuad(quad, patch);
+		}
+
+		quadCount = CountTileQuads(m_tiles[changedTiles[i]].geoFeatures);
+		firstQuad = AppendQuads(quadCount, vertices, indices, index);
+		AddTileWallGeometry(changedTiles[i], vertices, indices, index);
+		AddTileWallCapGeometry(changedTiles[i], vertices, indices, index);
+
+		quads.firstQuad = firstQuad;
+		quads.quadCount = quadCount;
+	}
+
+	// Floors and wall tops are merged across tiles, so the rects around the changes are merged again
+	PatchMergedCells(m_floorRects, m_floorRectCells, 2, changedTiles, oldFeatures, patch);
+	PatchMergedCells(m_wallTopRects, m_wallTopRectCells, 3, changedTiles, oldFeatures, patch);
+
+	patch.vertexCount = (uint32)m_vertices.size() - patch.firstVertex;
+	patch.triangleCount = (uint32)m_indices.size() / 3 - patch.firstTriangle;
+
+	// The new quads aren't welded, so the short copy only lasts while they fit in 16 bits
+	if (!m_shortIndices.empty() && m_vertices.size() <= 0x10000)
+	{
+		m_shortIndices.insert(m_shortIndices.end(), m_indices.begin() + patch.firstTriangle * 3, m_indices.end());
+	}
+	else
+	{
+		m_shortIndices.clear();
+	}
+
+	m_geometryStats.triangles = (uint32)m_indices.size() / 3;
+	m_geometryStats.vertices = (uint32)m_vertices.size();
+
+	return true;
+}
+
+
+void DungeonFloor::BuildUpdateLookup()
+{
+	// Which tile is where
+	m_tileLookup.assign(m_length * m_width, 0xFFFFFFFF);
+	for (uint32 i = 0; i < (uint32)m_tiles.size(); i++)
+	{
+		m_tileLookup[m_tiles[i].z * m_length + m_tiles[i].x] = i;
+	}
+
+	// Where each tile's wall quads are
+	m_tileQuads.resize(m_tiles.size());
+	for (uint32 i = 0; i < (uint32)m_tiles.size(); i++)
+	{
+		m_tileQuads[i].firstQuad = m_quadOffsets[i];
+		m_tileQuads[i].quadCount = m_quadOffsets[i + 1] - m_quadOffsets[i];
+	}
+
+	// Room for the quads updates append, so the arrays aren't copied in the middle of play
+	m_vertices.reserve(m_vertices.size() + m_vertices.size() / 4);
+	m_indices.reserve(m_indices.size() + m_indices.size() / 4);
+
+	// And which merged rect covers each cell
+	std::vector<cellRect_t>* rects[2] = { &m_floorRects, &m_wallTopRects };
+	std::vector<uint32>* rectCells[2] = { &m_floorRectCells, &m_wallTopRectCells };
+	for (int grid = 0; grid < 2; grid++)
+	{
+		int columns = m_length * (grid + 2);
+
+		rectCells[grid]->assign(columns * m_width * (grid + 2), 0xFFFFFFFF);
+		for (uint32 i = 0; i < (uint32)rects[grid]->size(); i++)
+		{
+			const cellRect_t& rect = (*rects[grid])[i];
+
+			for (int row = rect.row; row < rect.row + rect.rows; row++)
+			{
+				for (int column = rect.column; column < rect.column + rect.columns; column++)
+				{
+					(*rectCells[grid])[row * columns + column] = i;
+				}
+			}
+		}
+	}
+
+	return;
+}
+
+
+void DungeonFloor::PatchMergedCells(std::vector<cellRect_t>& rects, std::vector<uint32>& rectCells, int cellsPerTile,
+                                    const std::vector<uint32>& changedTiles, const std::vector<uint32>& oldFeatures,
+                                    geometryPatch_t& patch)
+{
+	std::vector<uint32> oldRects;
+	std::vector<cellRect_t> newRects;
+	floorVertex_t* vertices;
+	uint32* indices;
+	uint32 index, firstQuad;
+	int columns = m_length * cellsPerTile;
+	int minColumn = columns, minRow = m_width * cellsPerTile, maxColumn = -1, maxRow = -1;
+
+
+	// The region merged again is the box around the tiles whose cells changed, and the rects over them are replaced
+	for (size_t i = 0; i < changedTiles.size(); i++)
+	{
+		const floorTile_t& tile = m_tiles[changedTiles[i]];
+		int column = tile.x * cellsPerTile;
+		int row = tile.z * cellsPerTile;
+
+		if (TileCellMask(oldFeatures[i], cellsPerTile) == TileCellMask(tile.geoFeatures, cellsPerTile))
+			continue;
+
+		minColumn = std::min(minColumn, column);
+		maxColumn = std::max(maxColumn, column + cellsPerTile - 1);
+		minRow = std::min(minRow, row);
+		maxRow = std::max(maxRow, row + cellsPerTile - 1);
+
+		for (int cell = 0; cell < cellsPerTile * cellsPerTile; cell++)
+		{
+			uint32 rect = rectCells[(row + cell / cellsPerTile) * columns + column + cell % cellsPerTile];
+
+			if (rect != 0xFFFFFFFF && std::find(oldRects.begin(), oldRects.end(), rect) == oldRects.end())
+				oldRects.push_back(rect);
+		}
+	}
+
+	if (maxColumn < 0)
+	{
+		return;
+	}
+
+	// Inside the region the old rects' cells are merged again, outside it they are kept as up to four smaller rects
+	int regionColumns = maxColumn - minColumn + 1;
+	int regionRows = maxRow - minRow + 1;
+	m_cells.assign(regionColumns * regionRows, 0);
+	for (size_t i = 0; i < oldRects.size(); i++)
+	{
+		cellRect_t& rect = rects[oldRects[i]];
+		int lastColumn = rect.column + rect.columns - 1;
+		int lastRow = rect.row + rect.rows - 1;
+		int innerFirstRow = std::max(rect.row, minRow);
+		int innerLastRow = std::min(lastRow, maxRow);
+		int innerFirstColumn = std::max(rect.column, minColumn);
+		int innerLastColumn = std::min(lastColumn, maxColumn);
+
+		// The cells outside get the pieces' numbers below
+		for (int row = innerFirstRow; row <= innerLastRow; row++)
+		{
+			memset(&m_cells[(row - minRow) * regionColumns + (innerFirstColumn - minColumn)], 1, innerLastColumn - innerFirstColumn + 1);
+			for (int column = innerFirstColumn; column <= innerLastColumn; column++)
+			{
+				rectCells[row * columns + column] = 0xFFFFFFFF;
+			}
+		}
+
+		if (rect.row < minRow)
+		{
+			cellRect_t piece = { rect.column, rect.row, rect.columns, minRow - rect.row, 0 };
+			newRects.push_back(piece);
+		}
+		if (lastRow > maxRow)
+		{
+			cellRect_t piece = { rect.column, maxRow + 1, rect.columns, lastRow - maxRow, 0 };
+			newRects.push_back(piece);
+		}
+		if (rect.column < minColumn)
+		{
+			cellRect_t piece = { rect.column, innerFirstRow, minColumn - rect.column, innerLastRow - innerFirstRow + 1, 0 };
+			newRects.push_back(piece);
+		}
+		if (lastColumn > maxColumn)
+		{
+			cellRect_t piece = { maxColumn + 1, innerFirstRow, lastColumn - maxColumn, innerLastRow - innerFirstRow + 1, 0 };
+			newRects.push_back(piece);
+		}
+
+		RemoveQuad(rect.quad, patch);
+		rect.columns = 0;
+	}
+
+	// Then the changed tiles' cells are set to what they are now
+	for (size_t i = 0; i < changedTiles.size(); i++)
+	{
+		const floorTile_t& tile = m_tiles[changedTiles[i]];
+		uint32 mask = TileCellMask(tile.geoFeatures, cellsPerTile);
+		int column = tile.x * cellsPerTile - minColumn;
+		int row = tile.z * cellsPerTile - minRow;
+
+		if (TileCellMask(oldFeatures[i], cellsPerTile) == mask)
+			continue;
+
+		for (int cell = 0; cell < cellsPerTile * cellsPerTile; cell++)
+		{
+			m_cells[(row + cell / cellsPerTile) * regionColumns + column + cell % cellsPerTile] = (mask & (1 << cell)) ? 1 : 0;
+		}
+	}
+
+	// Merge the region on its own and add all the new rects at the end
+	std::vector<cellRect_t> regionRects;
+	MergeCells(m_cells, regionColumns, regionRows, regionRects);
+	for (size_t i = 0; i < regionRects.size(); i++)
+	{
+		regionRects[i].column += minColumn;
+		regionRects[i].row += minRow;
+		newRects.push_back(regionRects[i]);
+	}
+
+	firstQuad = AppendQuads((uint32)newRects.size(), vertices, indices, index);
+	for (size_t i = 0; i < newRects.size(); i++)
+	{
+		cellRect_t& rect = newRects[i];
+
+		rect.quad = firstQuad + (uint32)i;
+		AddRectGeometry(rect, cellsPerTile, vertices, indices, index);
+
+		for (int row = rect.row; row < rect.row + rect.rows; row++)
+		{
+			for (int column = rect.column; column < rect.column + rect.columns; column++)
+			{
+				rectCells[row * columns + column] = (uint32)rects.size();
+			}
+		}
+		rects.push_back(rect);
+	}
+
+	return;
+}
+
+
+void DungeonFloor::RemoveQuad(uint32 quad, geometryPatch_t& patch)
+{
+	uint32* indices = &m_indices[quad * 6];
+
+
+	patch.removedTriangles.insert(patch.removedTriangles.end(), indices, indices + 6);
+
+	// Collapse both triangles onto one corner, so nothing else in the arrays moves
+	for (int i = 1; i < 6; i++)
+	{
+		indices[i] = indices[0];
+	}
+
+	if (!m_shortIndices.empty())
+	{
+		for (int i = 1; i < 6; i++)
+		{
+			m_shortIndices[quad * 6 + i] = m_shortIndices[quad * 6];
+		}
+	}
+
+	return;
+}
+
+
+uint32 DungeonFloor::AppendQuads(uint32 quadCount, floorVertex_t*& vertices, uint32*& indices, uint32& index)
+{
+	uint32 firstQuad = (uint32)m_indices.size() / 6;
+
+
+	// Room for the quads at the end of the arrays, written through the same pointers the build uses
+	index = (uint32)m_vertices.size();
+	m_vertices.resize(m_vertices.size() + quadCount * 4);
+	m_indices.resize(m_indices.size() + quadCount * 6);
+	vertices = m_vertices.data() + index;
+	indices = m_indices.data() + firstQuad * 6;
+
+	return firstQuad;
+}
+
+
+int DungeonFloor::GetLength()
+{
+	return m_length;
+}
+
+
+int DungeonFloor::GetWidth()
+{
+	return m_width;
+}
+
+
+const char* DungeonFloor::GetError()
+{
+	return m_error;
+}
+
+
+char DungeonFloor::GetTile(int x, int y)
+{
+	// Outside the map reads as ' ', the same as an open tile
+	if (x < 0 || y < 0 || x >= m_length || y >= m_width)
+		return DungeonGenerator::Unused;
+
+	return m_map.Get(x, y);
+}
+
+
+void DungeonFloor::GetTileRect(int x, int y, int columns, int rows, char* tiles)
+{
+	// Rects inside the map are copied straight out of the storage, ones over the edge a tile at a time
+	if (x >= 0 && y >= 0 && x + columns <= m_length && y + rows <= m_width)
+	{
+		m_map.GetRect(x, y, columns, rows, tiles);
+		return;
+	}
+
+	for (int row = y; row < y + rows; row++)
+		for (int column = x; column < x + columns; column++)
+			*tiles++ = GetTile(column, row);
+
+	return;
+}
+
+
+bool DungeonFloor::SetTile(int x, int y, char tile)
+{
+	int stride = m_length + 2;
+
+
+	// Only used tiles can change, and they stay used, so the tile list keeps its order
+	if (x < 0 || y < 0 || x >= m_length || y >= m_width || m_tiles.empty())
+		return false;
+
+	char mapTile = m_map.Get(x, y);
+	if (mapTile == Empty || tile == Empty)
+		return false;
+
+	if (mapTile == tile)
+		return true;
+
+	m_map.Set(x, y, tile);
+	m_classes[(y + 1) * stride + x + 1] = s_neighbourClasses.classes[(uint8)tile];
+
+	// The tile and its neighbours may all look different now
+	for (int dy = -1; dy <= 1; dy++)
+	{
+		for (int dx = -1; dx <= 1; dx++)
+		{
+			int neighbourX = x + dx;
+			int neighbourY = y + dy;
+
+			if (neighbourX >= 0 && neighbourY >= 0 && neighbourX < m_length && neighbourY < m_width &&
+			    m_map.Get(neighbourX, neighbourY) != Empty)
+				m_dirtyTiles.push_back(neighbourX + neighbourY * m_length);
+		}
+	}
+
+	return true;
+}
+
+
+void DungeonFloor::SetTileLayout(TileGrid::Layout layout)
+{
+	// Only the storage order changes, every position keeps its tile
+	m_map.SetLayout(layout);
+
+	return;
+}
+
+
+TileGrid::Layout DungeonFloor::GetTileLayout()
+{
+	return m_map.GetLayout();
+}
+
+
+bool DungeonFloor::IsSolid(char tile)
+{
+	// Doors are open archways, only walls and the rock outside the rooms block movement
+	return tile == Wall || tile == Empty;
+}
+
+
+void DungeonFloor::GetSolidTiles(std::vector<uint8>& solid)
+{
+	std::vector<char> rowBuffer(m_length);
+
+
+	solid.resize((size_t)m_length * m_width);
+	for (int y = 0; y < m_width; y++)
+	{
+		const char* row = m_map.GetRow(y, rowBuffer.data());
+
+		for (int x = 0; x < m_length; x++)
+		{
+			solid[(size_t)y * m_length + x] = IsSolid(row[x]) ? 1 : 0;
+		}
+	}
+
+	return;
+}
+
+
+void DungeonFloor::GetSolidCells(std::vector<uint8>& solid)
+{
+	// Where the three wall top columns and rows of a tile start and end, in cells
+	static const int cellEdges[4] = { 0, 2, 3, COLLIDER_CELLS_PER_TILE };
+	int columns = m_length * COLLIDER_CELLS_PER_TILE;
+
+
+	// Rock is solid and every used tile is open, apart from the wall tops drawn on it.
+	// The wall top cells come from the features, so this has to run after ClassifyTiles.
+	solid.assign((size_t)columns * m_width * COLLIDER_CELLS_PER_TILE, 1);
+	for (uint32 i = 0; i < (uint32)m_tiles.size(); i++)
+	{
+		const floorTile_t& tile = m_tiles[i];
+		uint32 mask = (GetTile(tile.x, tile.z) == Wall) ? WallTopCellMask(tile.geoFeatures) : 0;
+		uint8* cells = &solid[(size_t)tile.z * COLLIDER_CELLS_PER_TILE * columns + tile.x * COLLIDER_CELLS_PER_TILE];
+
+		for (int row = 0; row < COLLIDER_CELLS_PER_TILE; row++)
+			memset(cells + (size_t)row * columns, 0, COLLIDER_CELLS_PER_TILE);
+
+		for (int cell = 0; cell < 9; cell++)
+		{
+			if (!(mask & (1 << cell)))
+				continue;
+
+			for (int row = cellEdges[cell / 3]; row < cellEdges[cell / 3 + 1]; row++)
+				for (int column = cellEdges[cell % 3]; column < cellEdges[cell % 3 + 1]; column++)
+					cells[(size_t)row * columns + column] = 1;
+		}
+	}
+
+	return;
+}
+
+
+bool DungeonFloor::GetUpStairsLocation(int& xPos, int& zPos)
+{
+	return FindTile(UpStairs, xPos, zPos);
+}
+
+
+bool DungeonFloor::GetDownStairsLocation(int& xPos, int& zPos)
+{
+	return FindTile(DownStairs, xPos, zPos);
+}
+
+
+bool DungeonFloor::FindTile(char tile, int& xPos, int& zPos)
+{
+	for (int y = 0; y < m_width; y++)
+	{
+		for (int x = 0; x < m_length; x++)
+		{
+			if (GetTile(x, y) == tile)
+			{
+				xPos = x;
+				zPos = y;
+
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+uint32 DungeonFloor::GetTileCount()
+{
+	return (uint32)m_tiles.size();
+}
+
+
+const std::vector<DungeonFloor::floorTile_t>& DungeonFloor::GetTiles()
+{
+	return m_tiles;
+}
+
+
+const std::vector<DungeonFloor::floorVertex_t>& DungeonFloor::GetVertices()
+{
+	return m_vertices;
+}
+
+
+const std::vector<uint32>& DungeonFloor::GetIndices()
+{
+	return m_indices;
+}
+
+
+bool DungeonFloor::HasShortIndices()
+{
+	return !m_shortIndices.empty();
+}
+
+
+const std::vector<uint16>& DungeonFloor::GetShortIndices()
+{
+	return m_shortIndices;
+}
+
+
+const DungeonFloor::geometryStats_t& DungeonFloor::GetGeometryStats()
+{
+	return m_geometryStats;
+}
+
+
+bool DungeonFloor::PrintWorld(const char* filename, uint64 seed)
+{
+	std::ofstream fout;
+
+	// Open the output map file
+	fout.open(filename);
+	if (fout.fail())
+	{
+		return false;
+	}
+
+	// Record the seed so the same world can be generated again
+	fout << "seed: " << seed << std::endl;
+
+	for (int y = m_width-1; y >= 0; --y)
+	{
+		for (int x = 0; x < m_length; ++x)
+			fout << GetTile(x, y);
+
+		fout << std::endl;
+	}
+
+	// Close the file.
+	fout.close();
+
+	return true;
+}
+
+
+void DungeonFloor::MergeCells(std::vector<uint8>& cells, int columns, int rows, std::vector<cellRect_t>& rects)
+{
+	rects.clear();
+
+	// Greedy meshing: grow each covered cell as wide as it goes, then as tall as the whole
+	// width allows, and clear the cells it took so nothing is covered twice
+	for (int row = 0; row < rows; row++)
+	{
+		uint8* rowCells = &cells[row * columns];
+
+		for (int column = 0; column < columns; column++)
+		{
+			if (!rowCells[column])
+				continue;
+
+			int width = 1;
+			while (column + width < columns && rowCells[column + width])
+				width++;
+
+			int height = 1;
+			while (row + height < rows)
+			{
+				const uint8* nextRow = &cells[(row + height) * columns + column];
+				int i = 0;
+				while (i < width && nextRow[i])
+					i++;
+				if (i < width)
+					break;
+				height++;
+			}
+
+			for (int y = row; y < row + height; y++)
+				memset(&cells[y * columns + column], 0, width);
+
+			cellRect_t rect = { column, row, width, height, 0 };
+			rects.push_back(rect);
+		}
+	}
+
+	return;
+}
+
+
+void DungeonFloor::MergeFloorCells()
+{
+	int columns = m_length * 2;
+	int rows = m_width * 2;
+
+
+	// Mark the floor quarters of every tile on a half tile grid
+	m_cells.assign(columns * rows, 0);
+	for (uint32 i = 0; i < (uint32)m_tiles.size(); i++)
+	{
+		uint32 features = m_tiles[i].geoFeatures;
+		uint32 mask = FloorCellMask(features);
+		int column = m_tiles[i].x * 2;
+		int row = m_tiles[i].z * 2;
+
+		for (int cell = 0; cell < 4; cell++)
+		{
+			if (mask & (1 << cell))
+				m_cells[(row + cell / 2) * columns + column + cell % 2] = 1;
+		}
+
+		// The old builder used one quad for a whole floor, otherwise one per quarter
+		m_geometryStats.unmergedTriangles += ((features & 0x0F) == 0x0F) ? 2 : 2 * BitCount(features & 0x0F);
+	}
+
+	MergeCells(m_cells, columns, rows, m_floorRects);
+
+	return;
+}
+
+
+void DungeonFloor::MergeWallTopCells()
+{
+	// Wall tops are 0.2 wide strips along the middle of the tile, so a tile splits into
+	// three columns and rows: [0, 0.4], [0.4, 0.6] and [0.6, 1]
+	int columns = m_length * 3;
+	int rows = m_width * 3;
+
+
+	m_cells.assign(columns * rows, 0);
+	for (uint32 i = 0; i < (uint32)m_tiles.size(); i++)
+	{
+		uint32 features = m_tiles[i].geoFeatures;
+		uint32 mask = WallTopCellMask(features);
+		int column = m_tiles[i].x * 3;
+		int row = m_tiles[i].z * 3;
+
+		for (int cell = 0; cell < 9; cell++)
+		{
+			if (mask & (1 << cell))
+				m_cells[(row + cell / 3) * columns + column + cell % 3] = 1;
+		}
+
+		// The old builder capped every wall piece with its own quad
+		m_geometryStats.unmergedTriangles += 2 * BitCount(features & (NorthWall | SouthWall | EastWall | WestWall));
+	}
+
+	MergeCells(m_cells, columns, rows, m_wallTopRects);
+
+	return;
+}
+
+
+void DungeonFloor::AddMergedGeometry(floorVertex_t*& vertices, uint32*& indices, uint32& index)
+{
+	// The merged quads come first, floors then wall tops
+	for (size_t i = 0; i < m_floorRects.size(); i++)
+	{
+		m_floorRects[i].quad = (uint32)i;
+		AddRectGeometry(m_floorRects[i], 2, vertices, indices, index);
+	}
+
+	for (size_t i = 0; i < m_wallTopRects.size(); i++)
+	{
+		m_wallTopRects[i].quad = (uint32)(m_floorRects.size() + i);
+		AddRectGeometry(m_wallTopRects[i], 3, vertices, indices, index);
+	}
+
+	return;
+}
+
+
+void DungeonFloor::AddRectGeometry(const cellRect_t& rect, int cellsPerTile, floorVertex_t*& vertices, uint32*& indices, uint32& index)
+{
+	// Edges of the wall top cells within a tile
+	static const float cellEdges[4] = { 0.0f, 0.4f, 0.6f, 1.0f };
+
+
+	// Floors are on the half tile grid
+	if (cellsPerTile == 2)
+	{
+		AddHorizontalQuad((float)rect.column * 0.5f, (float)(rect.column + rect.columns) * 0.5f,
+		                  (float)rect.row * 0.5f, (float)(rect.row + rect.rows) * 0.5f,
+		                  0.0f, vertices, indices, index);
+		return;
+	}
+
+	int lastColumn = rect.column + rect.columns;
+	int lastRow = rect.row + rect.rows;
+
+	AddHorizontalQuad((float)(rect.column / 3) + cellEdges[rect.column % 3],
+	                  (float)(lastColumn / 3) + cellEdges[lastColumn % 3],
+	                  (float)(rect.row / 3) + cellEdges[rect.row % 3],
+	                  (float)(lastRow / 3) + cellEdges[lastRow % 3],
+	                  3.0f, vertices, indices, index);
+
+	return;
+}
+
+
+void DungeonFloor::AddTileGeometry(uint32 firstTile, uint32 lastTile)
+{
+	// The tiles of a range are next to each other in the arrays
+	floorVertex_t* vertices = m_vertices.data() + m_quadOffsets[firstTile] * 4;
+	uint32* indices = m_indices.data() + m_quadOffsets[firstTile] * 6;
+	uint32 index = m_quadOffsets[firstTile] * 4;
+
+	for (uint32 i = firstTile; i < lastTile; i++)
+	{
+        // Add the wall polygons for the tile
+        AddTileWallGeometry(i, vertices, indices, index);
+
+        // Then add the wall-cap polygons for the tile
+        AddTileWallCapGeometry(i, vertices, indices, index);
+
+        // TODO(ebd): Don't add doorway geometry for now.
+        // Need to look at how doorways should be handled from a design perspective later on
+
+        // Finally, add the doorway geometry if needed (and count its quads in CountTileQuads)
+        // AddTileDoorwayGeometry(i, vertices, indices, index);
+	}
+
+	return;
+}
+
+
+void DungeonFloor::AddTileGeometryJob(void* data)
+{
+	geometryJob_t* job = (geometryJob_t*)data;
+
+	job->floor->AddTileGeometry(job->firstTile, job->lastTile);
+
+	return;
+}
+
+
+void DungeonFloor::AddHorizontalQuad(float xMin, float xMax, float zMin, float zMax, float yPos,
+	                                 floorVertex_t*& vertices, uint32*& indices, uint32& index)
+{
+	floorVertex_t currVertex;
+
+	// Texture coordinates run on from tile to tile, measured from the first tile of the quad,
+	// so the texture repeats once per tile just like it did with one quad per tile
+	float tuOrigin = floorf(xMin);
+	float tvOrigin = floorf(zMin);
+
+	// Tiles aren't coloured
+	currVertex.normal = Gumshoe::V3(0.0f, 1.0f, 0.0f);
+	currVertex.color = Gumshoe::V4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// Bottom left corner
+	currVertex.position = Gumshoe::V3(xMin, yPos, zMin);
+	currVertex.texture = Gumshoe::V2(xMin - tuOrigin, 1.0f - (zMin - tvOrigin));
+	*vertices++ = currVertex;
+
+	// Top left corner
+	currVertex.position = Gumshoe::V3(xMin, yPos, zMax);
+	currVertex.texture = Gumshoe::V2(xMin - tuOrigin, 1.0f - (zMax - tvOrigin));
+	*vertices++ = currVertex;
+
+	// Top right corner
+	currVertex.position = Gumshoe::V3(xMax, yPos, zMax);
+	currVertex.texture = Gumshoe::V2(xMax - tuOrigin, 1.0f - (zMax - tvOrigin));
+	*vertices++ = currVertex;
+
+	// Bottom right corner
+	currVertex.position = Gumshoe::V3(xMax, yPos, zMin);
+	currVertex.texture = Gumshoe::V2(xMax - tuOrigin, 1.0f - (zMin - tvOrigin));
+	*vertices++ = currVertex;
+	AddQuadIndices(indices, index);
+
+	return;
+}
+
+
+void DungeonFloor::AddTileWallGeometry(uint32 tileIndex, floorVertex_t* &vertices,
+	                                uint32* &indices, uint32 &index)
+{
+    const floorTile_t& tile = m_tiles[tileIndex];
+    tileAttributes_t attributes;
+    floorVertex_t currVertex;
+    int i, j;
+    bool addWall = false;
+
+    float xWallOffset = 0.6f;
+    float zWallOffset = 0.4f;
+    
+    float xWallPos1 = 0.0f;
+    float xWallPos2 = -0.2f;
+    float xWallPos3 = -0.2f;
+    float zWallPos1 = 0.6f;
+    float zWallPos2 = 0.6f;
+    float zWallPos3 = 0.0f;
+   
+    float xNormFront = 1.0f;
+    float xNormBack = -1.0f;
+    float zNormFront = 0.0f;
+    float zNormBack = 0.0f;
+
+    // Unpack the tile, every vertex of it has the material colour
+    DeriveTileAttributes(tile, attributes);
+    currVertex.color = Gumshoe::V4(attributes.r, attributes.g, attributes.b, 1.0f);
+
+    for (i = 0; i < 4; i++)
+    {
+    	addWall = false;
+
+	    if (tile.geoFeatures & (1<<(i+4)))
+	    {
+	        addWall = true;
+	        
+	        if (i == 1)
+	        {
+                if (tile.geoFeatures & NorthWall)
+                {
+                    xWallOffset = 0.6f;
+	                zWallOffset = 0.0f;
+
+	                xWallPos1 = 0.0f;
+				    xWallPos2 = -0.2f;
+				    xWallPos3 = -0.2f;
+				    zWallPos1 = 0.4f;
+				    zWallPos2 = 0.4f;
+				    zWallPos3 = 0.0f;
+                }
+                else
+                {
+                    xWallOffset = 0.6f;
+	                zWallOffset = 0.0f;
+
+	                xWallPos1 = 0.0f;
+				    xWallPos2 = -0.2f;
+				    xWallPos3 = -0.2f;
+				    zWallPos1 = 0.6f;
+				    zWallPos2 = 0.6f;
+				    zWallPos3 = 0.0f;	
+                }
+
+                xNormFront = 1.0f;
+                xNormBack = -1.0f;
+                zNormFront = 0.0f;
+                zNormBack = 0.0f;
+	        }
+	        else if (i == 2)
+	        {
+                xWallOffset = 0.4f;
+                zWallOffset = 0.6f;
+
+                xWallPos1 = 0.6f;
+			    xWallPos2 = 0.0f;
+			    xWallPos3 = 0.6f;
+			    zWallPos1 = 0.0f;
+			    zWallPos2 = -0.2f;
+			    zWallPos3 = -0.2f;
+
+                xNormFront = 0.0f;
+                xNormBack = 0.0f;
+                zNormFront = 1.0f;
+                zNormBack = -1.0f;
+	        }
+	        else if (i == 3)
+	        {
+                if (tile.geoFeatures & EastWall)
+                {
+                    xWallOffset = 0.0f;
+	                zWallOffset = 0.6f;
+
+	                xWallPos1 = 0.4f;
+				    xWallPos2 = 0.0f;
+				    xWallPos3 = 0.4f;
+				    zWallPos1 = 0.0f;
+				    zWallPos2 = -0.2f;
+				    zWallPos3 = -0.2f;
+                }
+                else
+                {
+                    xWallOffset = 0.0f;
+	                zWallOffset = 0.6f;
+
+	                xWallPos1 = 0.6f;
+				    xWallPos2 = 0.0f;
+				    xWallPos3 = 0.6f;
+				    zWallPos1 = 0.0f;
+				    zWallPos2 = -0.2f;
+				    zWallPos3 = -0.2f;	
+                }
+
+                xNormFront = 0.0f;
+                xNormBack = 0.0f;
+                zNormFront = 1.0f;
+                zNormBack = -1.0f;
+	        }
+	    }
+
+	    if (addWall)
+	    {
+		    // Wall is 3m high
+		    for (j = 0; j < 3; j++)
+		    {
+		        float yPos = attributes.y + ((float)j*1.0f);
+
+		        // Bottom left corner of tile
+		        currVertex.position = Gumshoe::V3(attributes.x + (xWallOffset + xWallPos1), yPos, attributes.z + zWallOffset);
+		        currVertex.texture = Gumshoe::V2(attributes.tu, attributes.tv);
+			    currVertex.normal = Gumshoe::V3(xNormFront, attributes.ny, zNormFront);
+				*vertices++ = currVertex;
+
+				// Top left corner of tile
+				currVertex.position = Gumshoe::V3(attributes.x + (xWallOffset + xWallPos1), yPos + 1.0f, attributes.z + zWallOffset);
+		        currVertex.texture = Gumshoe::V2(attributes.tu, attributes.tv - 1.0f);
+				*vertices++ = currVertex;
+
+				// Top right corner of tile
+				currVertex.position = Gumshoe::V3(attributes.x + xWallOffset, yPos + 1.0f, attributes.z + (zWallOffset + zWallPos1));
+		        currVertex.texture = Gumshoe::V2(attributes.tu + 1.0f, attributes.tv - 1.0f);
+				*vertices++ = currVertex;
+
+				// Bottom right corner of tile
+				currVertex.position = Gumshoe::V3(attributes.x + xWallOffset, yPos, attributes.z + (zWallOffset + zWallPos1));
+		        currVertex.texture = Gumshoe::V2(attributes.tu + 1.0f, attributes.tv);
+				*vertices++ = currVertex;
+			    AddQuadIndices(indices, index);
+
+		        // Other side of the wall
+				// Bottom left corner of tile
+		        currVertex.position = Gumshoe::V3(attributes.x + (xWallOffset + xWallPos2), yPos, attributes.z + (zWallOffset + zWallPos2));
+		        currVertex.texture = Gumshoe::V2(attributes.tu, attributes.tv);
+			    currVertex.normal = Gumshoe::V3(xNormBack, attributes.ny, zNormBack);
+				*vertices++ = currVertex;
+
+				// Top left corner of tile
+				currVertex.position = Gumshoe::V3(attributes.x + (xWallOffset + xWallPos2), yPos + 1.0f, attributes.z + (zWallOffset + zWallPos2));
+		        currVertex.texture = Gumshoe::V2(attributes.tu, attributes.tv - 1.0f);
+				*vertices++ = currVertex;
+
+				// Top right corner of tile
+				currVertex.position = Gumshoe::V3(attributes.x + (xWallOffset + xWallPos3), yPos + 1.0f, attributes.z + (zWallOffset + zWallPos3));
+		        currVertex.texture = Gumshoe::V2(attributes.tu + 1.0f, attributes.tv - 1.0f);
+				*vertices++ = currVertex;
+
+				// Bottom right corner of tile
+				currVertex.position = Gumshoe::V3(attributes.x + (xWallOffset + xWallPos3), yPos, attributes.z + (zWallOffset + zWallPos3));
+		        currVertex.texture = Gumshoe::V2(attributes.tu + 1.0f, attributes.tv);
+				*vertices++ = currVertex;
+			    AddQuadIndices(indices, index);
+		    }
+		}
+	}
+}
+
+
+void DungeonFloor::AddTileWallCapGeometry(uint32 tileIndex, floorVertex_t* &vertices,
+	                                   uint32* &indices, uint32 &index)
+{
+	const floorTile_t& tile = m_tiles[tileIndex];
+	tileAttributes_t attributes;
+	floorVertex_t currVertex;
+    int i, j;
+
+    float xCapOffset = 0.6f;
+    float zCapOffset = 1.0f;
+    float xCapWidth = -0.2f;
+    float zCapWidth = 0.0f;
+   
+    float xNorm = 0.0f;
+    float zNorm = 1.0f;
+
+    // Unpack the tile, every vertex of it has the material colour
+    DeriveTileAttributes(tile, attributes);
+    currVertex.color = Gumshoe::V4(attributes.r, attributes.g, attributes.b, 1.0f);
+
+    for (i = 0; i < 4; i++)
+    {
+    	if (tile.geoFeatures & (1<<(i+8)))
+	    {
+	        if (i == 1)
+	        {
+	        	xCapOffset = 0.4f;
+	        	zCapOffset = 0.0f;
+	        	xCapWidth  = 0.2f;
+	        	zCapWidth  = 0.0f;
+	        	xNorm = 0.0f;
+	        	zNorm = -1.0f;
+	        }
+	        else if (i == 2)
+	        {
+                xCapOffset = 1.0f;
+	        	zCapOffset = 0.4f;
+	        	xCapWidth  = 0.0f;
+	        	zCapWidth  = 0.2f;
+	        	xNorm = 1.0f;
+	        	zNorm = 0.0f;
+	        }
+	        else if (i == 3)
+	        {
+                xCapOffset = 0.0f;
+	        	zCapOffset = 0.6f;
+	        	xCapWidth  = 0.0f;
+	        	zCapWidth  = -0.2f;
+	        	xNorm = -1.0f;
+	        	zNorm = 0.0f;
+	        }
+ 
+            // Wall is 3m high
+		    for (j = 0; j < 3; j++)
+		    {
+		        float yPos = attributes.y + ((float)j*1.0f);
+            
+	            // Bottom left corner of tile
+			    currVertex.position = Gumshoe::V3(attributes.x + xCapOffset, yPos, attributes.z + zCapOffset);
+			    currVertex.texture = Gumshoe::V2(attributes.tu, attributes.tv);
+			    currVertex.normal = Gumshoe::V3(xNorm, attributes.ny, zNorm);
+				*vertices++ = currVertex;
+
+				// Top left corner of tile
+				currVertex.position = Gumshoe::V3(attributes.x + xCapOffset, yPos + 1.0f, attributes.z + zCapOffset);
+			    currVertex.texture = Gumshoe::V2(attributes.tu, attributes.tv - 1.0f);
+				*vertices++ = currVertex;
+
+				// Top right corner of tile
+				currVertex.position = Gumshoe::V3(attributes.x + (xCapOffset + xCapWidth), yPos + 1.0f, attributes.z + (zCapOffset + zCapWidth));
+			    currVertex.texture = Gumshoe::V2(attributes.tu + 1.0f, attributes.tv - 1.0f);
+				*vertices++ = currVertex;
+
+				// Bottom right corner of tile
+				currVertex.position = Gumshoe::V3(attributes.x + (xCapOffset + xCapWidth), yPos, attributes.z + (zCapOffset + zCapWidth));
+			    currVertex.texture = Gumshoe::V2(attributes.tu + 1.0f, attributes.tv);
+				*vertices++ = currVertex;
+			    AddQuadIndices(indices, index);
+			}
+		}
+	}
+}
+
+
+void DungeonFloor::AddTileDoorwayGeometry(uint32 tileIndex, floorVertex_t* &vertices,
+	                                   uint32* &indices, uint32 &index)
+{
+	const floorTile_t& tile = m_tiles[tileIndex];
+	tileAttributes_t attributes;
+	floorVertex_t currVertex;
+    int j;
+    bool addDoorway = false;
+
+    float xMin = 0.4f;
+    float xMax = 0.4f;
+    float xWidth = 0.2f;
+
+    float zMin = 0.0f;
+    float zMax = 0.0f;
+    float zWidth = 1.0f;
+
+    float xNorm = 0.0f;
+    float zNorm = 0.0f;
+
+    // Unpack the tile, every vertex of it has the material colour
+    DeriveTileAttributes(tile, attributes);
+    currVertex.color = Gumshoe::V4(attributes.r, attributes.g, attributes.b, 1.0f);
+
+    // Check if it is a vertical doorway
+    if (tile.geoFeatures & VertDoorway)
+    {
+    	addDoorway = true;
+
+        xMin = 0.4f;
+        xMax = 0.4f;
+        xWidth = 0.2f;
+
+        zMin = 0.0f;
+        zMax = 1.0f;
+        zWidth = 1.0f;
+
+        xNorm = 1.0f;
+        zNorm = 0.0f;
+    }
+    // Check if there is a horizontal doorway
+    else if (tile.geoFeatures & HorizDoorway)
+    {
+    	addDoorway = true;
+
+        xMin = 0.0f;
+        xMax = 1.0f;
+        xWidth = 1.0f;
+
+        zMin = 0.4f;
+        zMax = 0.4f;
+        zWidth = 0.2f;
+
+        xNorm = 0.0f;
+        zNorm = 1.0f;
+    }
+    
+    // Add in the doorway if needed
+    if (addDoorway)
+    {
+        // There are 4 sides to the doorway
+        for (j = 0; j < 4; j++)
+	    {
+	        float xOff0 = 0.0f;
+	        float xOff1 = 0.0f;
+	        float yOff0 = 0.0f;
+	        float yOff1 = 0.0f;
+	        float zOff0 = 0.0f;
+	        float zOff1 = 0.0f;
+
+	        float tuOff0 = 0.0f;
+	        float tuOff1 = 0.0f;
+	        float tvOff0 = 0.0f;
+	        float tvOff1 = 0.0f;
+
+	        float xNormPoly = 0.0f;
+            float yNormPoly = 0.0f;
+            float zNormPoly = 0.0f;
+
+	        // The walls are added as follows:
+	        // j = 0 : Up facing wall
+	        // j = 1 : Down facing wall
+	        // j = 2 : West/North facing wall
+	        // j = 3 : East/South facing wall
+            if (j == 0)
+            {
+                xOff0 = xMin;
+            	xOff1 = xMin + xWidth;
+                yOff0 = 3.0f;
+            	yOff1 = 3.0f;
+                zOff0 = zMin;
+            	zOff1 = zMin + zWidth;
+
+            	tuOff0 = xOff0;
+                tuOff1 = xOff1;
+                tvOff0 = zOff0;
+                tvOff1 = zOff1;
+
+            	xNormPoly = 0.0f;
+            	yNormPoly = 1.0f;
+            	zNormPoly = 0.0f;
+            }
+            else if (j == 1)
+            {
+                xOff0 = xMin + xWidth;
+            	xOff1 = xMin;
+                yOff0 = 2.2f;
+            	yOff1 = 2.2f;
+                zOff0 = zMin;
+            	zOff1 = zMin + zWidth;
+
+            	tuOff0 = xOff0;
+                tuOff1 = xOff1;
+                tvOff0 = zOff0;
+                tvOff1 = zOff1;
+
+            	xNormPoly = 0.0f;
+            	yNormPoly = -1.0f;
+            	zNormPoly = 0.0f;
+            }
+            // TODO(ebd): Need to fix the vertical walls for the doorways
+            else if (j == 2)
+            {
+            	xOff0 = xMin;
+            	xOff1 = xMax;
+            	yOff0 = 2.2f;
+            	yOff1 = 3.0f;
+            	zOff0 = zMax;
+            	zOff1 = zMin;
+            	
+                tuOff0 = zOff0;
+                tuOff1 = zOff1;
+                tvOff0 = yOff0 - 2.0f;
+                tvOff1 = yOff1 - 2.0f;
+
+            	xNormPoly = -1.0f * xNorm;
+            	yNormPoly = 0.0f;
+            	zNormPoly = 1.0f * zNorm;
+            }
+            else if (j == 3)
+            {
+            	xOff0 = xMin + xWidth;
+            	xOff1 = xMax + xWidth;
+            	yOff0 = 2.2f;
+            	yOff1 = 3.0f;
+            	zOff0 = zMin + zWidth;
+            	zOff1 = zMax + zWidth;
+            	
+                tuOff0 = zOff0;
+                tuOff1 = zOff1;
+                tvOff0 = yOff0 - 2.0f;
+                tvOff1 = yOff1 - 2.0f;
+                
+            	xNormPoly = 1.0f * xNorm;
+            	yNormPoly = 0.0f;
+            	zNormPoly = -1.0f * zNorm;
+            }
+        
+            // Bottom left corner of tile
+		    currVertex.position = Gumshoe::V3(attributes.x + xOff0, attributes.y + yOff0, attributes.z + zOff0);
+		    currVertex.texture = Gumshoe::V2(attributes.tu + tuOff0, attributes.tv - tvOff0);
+		    currVertex.normal = Gumshoe::V3(xNormPoly, yNormPoly, zNormPoly);
+			*vertices++ = currVertex;
+
+			// Top left corner of tile
+			currVertex.position = Gumshoe::V3(attributes.x + xOff0, attributes.y + yOff0, attributes.z + zOff1);
+		    currVertex.texture = Gumshoe::V2(attributes.tu + tuOff0, attributes.tv - tvOff1);
+			*vertices++ = currVertex;
+
+			// Top right corner of tile
+			currVertex.position = Gumshoe::V3(attributes.x + xOff1, attributes.y + yOff1, attributes.z + zOff1);
+		    currVertex.texture = Gumshoe::V2(attributes.tu + tuOff1, attributes.tv - tvOff1);
+			*vertices++ = currVertex;
+
+			// Bottom right corner of tile
+			currVertex.position = Gumshoe::V3(attributes.x + xOff1, attributes.y + yOff1, attributes.z + zOff0);
+		    currVertex.texture = Gumshoe::V2(attributes.tu + tuOff1, attributes.tv - tvOff0);
+			*vertices++ = currVertex;
+		    AddQuadIndices(indices, index);
+		}
+	}
+}
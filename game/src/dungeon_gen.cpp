@@ -0,0 +1,727 @@
+/*!
+  @file
+  dungeon_gen.cpp
+
+  @brief
+  Procedural generator for the dungeon tile map.
+
+  @detail
+  Has no DirectX dependencies, so it can be built headless and used by tools.
+  The same seed, size and feature budget always produce the same dungeon.
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "dungeon_gen.h"
+#include <fstream>
+#include <chrono>
+#include <climits>
+
+
+//--------------------------------------------
+// Helper Functions
+//--------------------------------------------
+static int GreatestCommonDivisor(int a, int b)
+{
+	while (b != 0)
+	{
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+
+OccupancyMap::OccupancyMap()
+{
+	m_length = 0;
+	m_width = 0;
+	m_wordsPerRow = 0;
+}
+
+
+OccupancyMap::~OccupancyMap()
+{
+}
+
+
+void OccupancyMap::Init(int length, int width)
+{
+	m_length = length;
+	m_width = width;
+	m_wordsPerRow = (length + 63) / 64;
+
+	m_bits.assign(m_wordsPerRow * m_width, 0);
+
+	return;
+}
+
+
+void OccupancyMap::Set(int x, int y)
+{
+	m_bits[y * m_wordsPerRow + (x >> 6)] |= (1ULL << (x & 63));
+
+	return;
+}
+
+
+void OccupancyMap::SetRect(int x, int y, int xSize, int ySize)
+{
+	int firstWord = x >> 6;
+	int lastWord = (x + xSize - 1) >> 6;
+	uint64 firstMask = ~0ULL << (x & 63);
+	uint64 lastMask = ~0ULL >> (63 - ((x + xSize - 1) & 63));
+
+	for (int row = y; row < y + ySize; row++)
+	{
+		uint64* words = &m_bits[row * m_wordsPerRow];
+
+		if (firstWord == lastWord)
+		{
+			words[firstWord] |= (firstMask & lastMask);
+			continue;
+		}
+
+		words[firstWord] |= firstMask;
+		for (int i = firstWord + 1; i < lastWord; i++)
+		{
+			words[i] = ~0ULL;
+		}
+		words[lastWord] |= lastMask;
+	}
+
+	return;
+}
+
+
+bool OccupancyMap::IsSet(int x, int y)
+{
+	return (m_bits[y * m_wordsPerRow + (x >> 6)] >> (x & 63)) & 1;
+}
+
+
+bool OccupancyMap::IsRectFree(int x, int y, int xSize, int ySize)
+{
+	// The rect has to be inside the map, this is checked by the caller
+	int firstWord = x >> 6;
+	int lastWord = (x + xSize - 1) >> 6;
+	uint64 firstMask = ~0ULL << (x & 63);
+	uint64 lastMask = ~0ULL >> (63 - ((x + xSize - 1) & 63));
+
+	for (int row = y; row < y + ySize; row++)
+	{
+		const uint64* words = &m_bits[row * m_wordsPerRow];
+
+		if (firstWord == lastWord)
+		{
+			if (words[firstWord] & firstMask & lastMask)
+				return false;
+			continue;
+		}
+
+		if (words[firstWord] & firstMask)
+			return false;
+		for (int i = firstWord + 1; i < lastWord; i++)
+		{
+			if (words[i])
+				return false;
+		}
+		if (words[lastWord] & lastMask)
+			return false;
+	}
+
+	return true;
+}
+
+
+DungeonGenerator::DungeonGenerator()
+{
+	m_length = 0;
+	m_width = 0;
+	m_featureCount = 0;
+	m_error = nullptr;
+	m_stats = {};
+}
+
+
+DungeonGenerator::~DungeonGenerator()
+{
+}
+
+
+bool DungeonGenerator::Generate(uint64 seed, int length, int width, int maxFeatures)
+{
+	Gumshoe::Random random(seed);
+
+	return Generate(random, length, width, maxFeatures);
+}
+
+
+bool DungeonGenerator::Generate(Gumshoe::Random& random, int length, int width, int maxFeatures)
+{
+	bool result = true;
+
+	m_featureCount = 0;
+	m_error = nullptr;
+	m_random = random;
+	m_stats = {};
+	m_rooms.clear();
+	m_exits.clear();
+
+	// Nothing fits in a smaller world, and the tile count has to fit in an int
+	if (length < MIN_WORLD_SIZE || width < MIN_WORLD_SIZE)
+	{
+		m_error = "World is too small for the first room.";
+	}
+	else if ((int64)length * (int64)width > (int64)INT_MAX)
+	{
+		m_error = "World has too many tiles.";
+	}
+	else if (maxFeatures < 1)
+	{
+		m_error = "World needs at least one feature.";
+	}
+
+	if (m_error)
+	{
+		m_length = 0;
+		m_width = 0;
+		m_tiles.clear();
+		return false;
+	}
+
+	m_length = length;
+	m_width = width;
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	m_tiles.assign(m_length*m_width, Unused);
+	m_occupancy.Init(m_length, m_width);
+	m_exitProbes.clear();
+	m_freeRooms.clear();
+
+	// place the first room in the center
+	if (!MakeRoom(m_length / 2, m_width / 2, static_cast<Direction>(m_random.RandomInt(4)), true))
+	{
+		m_error = "Unable to place the first room.";
+		random = m_random;
+		return false;
+	}
+	m_featureCount = 1;
+
+	// we already placed 1 feature (the first room)
+	for (int i = 1; i < maxFeatures; i++)
+	{
+		if (!CreateFeature())
+		{
+			m_error = "Unable to place more features.";
+			break;
+		}
+		m_featureCount++;
+	}
+
+	for (int i = 0; i < (int)m_rooms.size(); i++)
+	{
+		m_freeRooms.push_back(i);
+	}
+
+	if (!PlaceObject(UpStairs))
+	{
+		m_error = "Unable to place up stairs.";
+		result = false;
+	}
+
+	if (!PlaceObject(DownStairs))
+	{
+		m_error = "Unable to place down stairs.";
+		result = false;
+	}
+
+	// Hand the advanced stream back so the caller can keep drawing from it
+	random = m_random;
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	m_stats.features = (uint32)m_featureCount;
+	m_stats.timeMs = elapsed.count();
+
+	return result;
+}
+
+
+bool DungeonGenerator::Validate()
+{
+	int upCount = 0;
+	int downCount = 0;
+	int walkableCount = 0;
+	int start = -1;
+
+	// Count the stairs and walkable tiles, and make sure nothing is placed on the border
+	for (int y = 0; y < m_width; y++)
+	{
+		for (int x = 0; x < m_length; x++)
+		{
+			char tile = GetTile(x, y);
+			bool border = (x == 0 || y == 0 || x == m_length - 1 || y == m_width - 1);
+
+			if (tile == UpStairs)
+			{
+				upCount++;
+				start = x + y * m_length;
+			}
+			else if (tile == DownStairs)
+			{
+				downCount++;
+			}
+
+			if (tile != Unused && tile != Wall)
+			{
+				if (border)
+				{
+					m_error = "Walkable tile on the world border.";
+					return false;
+				}
+				walkableCount++;
+			}
+		}
+	}
+
+	if (upCount != 1 || downCount != 1)
+	{
+		m_error = "World does not have exactly one up and one down stairs.";
+		return false;
+	}
+
+	// Flood fill from the up stairs, every walkable tile has to be reachable
+	std::vector<char> visited(m_tiles.size(), 0);
+	std::vector<int> stack;
+	int reached = 0;
+
+	stack.push_back(start);
+	visited[start] = 1;
+	while (!stack.empty())
+	{
+		int index = stack.back();
+		stack.pop_back();
+		reached++;
+
+		int x = index % m_length;
+		int y = index / m_length;
+		const int neighbours[4][2] = { { x, y+1 }, { x, y-1 }, { x+1, y }, { x-1, y } };
+		for (int i = 0; i < 4; i++)
+		{
+			char tile = GetTile(neighbours[i][0], neighbours[i][1]);
+			int neighbour = neighbours[i][0] + neighbours[i][1] * m_length;
+			if (tile != Unused && tile != Wall && !visited[neighbour])
+			{
+				visited[neighbour] = 1;
+				stack.push_back(neighbour);
+			}
+		}
+	}
+
+	if (reached != walkableCount)
+	{
+		m_error = "Not every walkable tile is reachable from the up stairs.";
+		return false;
+	}
+
+	return true;
+}
+
+
+int DungeonGenerator::GetLength()
+{
+	return m_length;
+}
+
+
+int DungeonGenerator::GetWidth()
+{
+	return m_width;
+}
+
+
+int DungeonGenerator::GetFeatureCount()
+{
+	return m_featureCount;
+}
+
+
+const DungeonGenerator::genStats_t& DungeonGenerator::GetStats()
+{
+	return m_stats;
+}
+
+
+const char* DungeonGenerator::GetError()
+{
+	return m_error;
+}
+
+
+const std::vector<char>& DungeonGenerator::GetTiles()
+{
+	return m_tiles;
+}
+
+
+const std::vector<DungeonGenerator::Rect>& DungeonGenerator::GetRooms()
+{
+	return m_rooms;
+}
+
+
+const std::vector<DungeonGenerator::Rect>& DungeonGenerator::GetExits()
+{
+	return m_exits;
+}
+
+
+bool DungeonGenerator::PrintWorld(const char* filename)
+{
+	std::ofstream fout;
+
+	// Open the output map file
+	fout.open(filename);
+	if (fout.fail())
+	{
+		return false;
+	}
+
+	for (int y = m_width-1; y >= 0; --y)
+	{
+		for (int x = 0; x < m_length; ++x)
+			fout << GetTile(x, y);
+
+		fout << std::endl;
+	}
+
+	// Close the file.
+	fout.close();
+
+	return true;
+}
+
+
+char DungeonGenerator::GetTile(int x, int y)
+{
+	if (x < 0 || y < 0 || x >= m_length || y >= m_width)
+		return Unused;
+
+	return m_tiles[x + y * m_length];
+}
+
+
+void DungeonGenerator::SetTile(int x, int y, char tile)
+{
+    m_tiles[x + y * m_length] = tile;
+
+    if (tile != Unused)
+    	m_occupancy.Set(x, y);
+}
+
+
+void DungeonGenerator::AddExit(const Rect& exit)
+{
+	exitProbe_t probe = { 0, 1, 0 };
+
+	m_exits.push_back(exit);
+	m_exitProbes.push_back(probe);
+}
+
+
+void DungeonGenerator::RemoveExit(int index)
+{
+	// Swap with the last exit and pop, the order of the pool doesn't matter
+	m_exits[index] = m_exits.back();
+	m_exits.pop_back();
+
+	m_exitProbes[index] = m_exitProbes.back();
+	m_exitProbes.pop_back();
+}
+
+
+bool DungeonGenerator::CreateFeature()
+{
+    for (int i = 0; i < 1000; i++)
+	{
+		if (m_exits.empty())
+			break;
+
+		// choose a random side of a random room or corridor
+		int r = m_random.RandomInt((int)m_exits.size());
+		Rect exit = m_exits[r];
+		exitProbe_t& probe = m_exitProbes[r];
+		int exitLength = exit.xSize * exit.ySize; // exits are always 1 tile thick
+
+		// On the first probe pick a random start and a step that is coprime with the
+		// length, so stepping through the exit visits every tile exactly once
+		if (probe.tried == 0)
+		{
+			probe.start = m_random.RandomInt(exitLength);
+			probe.stride = m_random.RandomInt(1, exitLength);
+			while (GreatestCommonDivisor(probe.stride, exitLength) != 1)
+				probe.stride++;
+		}
+
+		int position = (probe.start + probe.tried * probe.stride) % exitLength;
+		int x = exit.x + ((exit.xSize > 1) ? position : 0);
+		int y = exit.y + ((exit.ySize > 1) ? position : 0);
+		probe.tried++;
+		m_stats.probes++;
+
+		// north, south, west, east
+		for (int j = 0; j < DirectionCount; ++j)
+		{
+			if (CreateFeature(x, y, static_cast<Direction>(j)))
+			{
+				RemoveExit(r);
+				return true;
+			}
+		}
+
+		// Every tile of this exit has failed, so never probe it again
+		if (m_exitProbes[r].tried >= exitLength)
+		{
+			RemoveExit(r);
+			m_stats.exhaustedExits++;
+		}
+	}
+
+	return false;
+}
+
+bool DungeonGenerator::CreateFeature(int x, int y, Direction dir)
+{
+	static const int roomChance = 50; // corridorChance = 100 - roomChance
+
+	int dx = 0;
+	int dy = 0;
+
+	if (dir == North)
+		dy = 1;
+	else if (dir == South)
+		dy = -1;
+	else if (dir == West)
+		dx = 1;
+	else if (dir == East)
+		dx = -1;
+
+	if (GetTile(x + dx, y + dy) != Floor && GetTile(x + dx, y + dy) != Corridor)
+		return false;
+
+	if (m_random.RandomInt(100) < roomChance)
+	{
+		if (MakeRoom(x, y, dir, false))
+		{
+			SetTile(x, y, ClosedDoor);
+			return true;
+		}
+	}
+    else
+	{
+		if (MakeCorridor(x, y, dir))
+		{
+			if (GetTile(x + dx, y + dy) == Floor)
+				SetTile(x, y, ClosedDoor);
+			else // don't place a door between corridors
+				SetTile(x, y, Corridor);
+			return true;
+		}
+	}
+
+	m_stats.rejects++;
+
+	return false;
+}
+
+
+bool DungeonGenerator::MakeRoom(int x, int y, Direction dir, bool firstRoom)
+{
+	Rect room;
+	room.xSize = m_random.RandomInt(MIN_ROOM_SIZE, MAX_ROOM_SIZE);
+	room.ySize = m_random.RandomInt(MIN_ROOM_SIZE, MAX_ROOM_SIZE);
+
+	if (dir == North)
+	{
+		room.x = x - room.xSize / 2;
+		room.y = y - room.ySize;
+	}
+
+	else if (dir == South)
+	{
+		room.x = x - room.xSize / 2;
+		room.y = y + 1;
+	}
+
+	else if (dir == West)
+	{
+		room.x = x - room.xSize;
+		room.y = y - room.ySize / 2;
+	}
+
+	else if (dir == East)
+	{
+		room.x = x + 1;
+		room.y = y - room.ySize / 2;
+	}
+
+	if (PlaceRect(room, Floor))
+	{
+		m_rooms.push_back(room);
+
+		// Put exits in the room
+		if (dir != South || firstRoom) // north side
+			AddExit(Rect{ room.x, room.y - 1, room.xSize, 1 });
+		if (dir != North || firstRoom) // south side
+			AddExit(Rect{ room.x, room.y + room.ySize, room.xSize, 1 });
+		if (dir != East || firstRoom)  // west side
+			AddExit(Rect{ room.x - 1, room.y, 1, room.ySize });
+		if (dir != West || firstRoom)  // east side
+			AddExit(Rect{ room.x + room.xSize, room.y, 1, room.ySize });
+
+		return true;
+	}
+
+	return false;
+}
+
+
+bool DungeonGenerator::MakeCorridor(int x, int y, Direction dir)
+{
+	static const int minCorridorLength = 3;
+	static const int maxCorridorLength = 6;
+
+	Rect corridor;
+	corridor.x = x;
+	corridor.y = y;
+
+	if (m_random.RandomBool()) // horizontal corridor
+	{
+		corridor.xSize = m_random.RandomInt(minCorridorLength, maxCorridorLength);
+		corridor.ySize = 1;
+
+		if (dir == North)
+		{
+			corridor.y = y - 1;
+
+			if (m_random.RandomBool()) // west
+				corridor.x = x - corridor.xSize + 1;
+		}
+
+		else if (dir == South)
+		{
+			corridor.y = y + 1;
+
+			if (m_random.RandomBool()) // west
+				corridor.x = x - corridor.xSize + 1;
+		}
+
+		else if (dir == West)
+			corridor.x = x - corridor.xSize;
+
+		else if (dir == East)
+			corridor.x = x + 1;
+	}
+
+	else // vertical corridor
+	{
+		corridor.xSize = 1;
+		corridor.ySize = m_random.RandomInt(minCorridorLength, maxCorridorLength);
+
+		if (dir == North)
+			corridor.y = y - corridor.ySize;
+
+		else if (dir == South)
+			corridor.y = y + 1;
+
+		else if (dir == West)
+		{
+			corridor.x = x - 1;
+
+			if (m_random.RandomBool()) // north
+				corridor.y = y - corridor.ySize + 1;
+		}
+
+		else if (dir == East)
+		{
+			corridor.x = x + 1;
+
+			if (m_random.RandomBool()) // north
+				corridor.y = y - corridor.ySize + 1;
+		}
+	}
+
+	if (PlaceRect(corridor, Corridor))
+	{
+		if (dir != South && corridor.xSize != 1) // north side
+			AddExit(Rect{ corridor.x, corridor.y - 1, corridor.xSize, 1 });
+		if (dir != North && corridor.xSize != 1) // south side
+			AddExit(Rect{ corridor.x, corridor.y + corridor.ySize, corridor.xSize, 1 });
+		if (dir != East && corridor.ySize != 1)   // west side
+			AddExit(Rect{ corridor.x - 1, corridor.y, 1, corridor.ySize });
+		if (dir != West && corridor.ySize != 1)   // east side
+			AddExit(Rect{ corridor.x + corridor.xSize, corridor.y, 1, corridor.ySize });
+
+		return true;
+	}
+
+	return false;
+}
+
+
+bool DungeonGenerator::PlaceRect(const Rect& rect, char tile)
+{
+	if (rect.x < 1 || rect.y < 1 || rect.x + rect.xSize >= m_length - 1 || rect.y + rect.ySize >= m_width - 1)
+		return false;
+
+    // Make sure the Rect is all in unused space, a row of the occupancy map at a time
+	if (!m_occupancy.IsRectFree(rect.x, rect.y, rect.xSize, rect.ySize))
+		return false; // the area already used
+
+	// Now place the Rect, putting walls at the edges
+	for (int y = rect.y - 1; y < rect.y + rect.ySize + 1; ++y)
+	{
+		char* row = &m_tiles[y * m_length];
+		for (int x = rect.x - 1; x < rect.x + rect.xSize + 1; ++x)
+		{
+			if (x == rect.x - 1 || y == rect.y - 1 || x == rect.x + rect.xSize || y == rect.y + rect.ySize)
+				row[x] = Wall;
+			else
+				row[x] = tile;
+		}
+	}
+
+	m_occupancy.SetRect(rect.x - 1, rect.y - 1, rect.xSize + 2, rect.ySize + 2);
+
+	return true;
+}
+
+
+bool DungeonGenerator::PlaceObject(char tile)
+{
+	if (m_freeRooms.empty())
+		return false;
+
+	int r = m_random.RandomInt((int)m_freeRooms.size()); // choose a random room
+	const Rect& room = m_rooms[m_freeRooms[r]];
+	int x = m_random.RandomInt(room.x + 1, room.x + room.xSize - 2);
+	int y = m_random.RandomInt(room.y + 1, room.y + room.ySize - 2);
+
+	if (GetTile(x, y) == Floor)
+	{
+		SetTile(x, y, tile);
+
+		// remove that room from the free list so that there is only 1 item per room,
+		// the room itself stays in m_rooms for the callers
+		// TODO(ebd): This method should be changed later on
+		m_freeRooms.erase(m_freeRooms.begin() + r);
+
+		return true;
+	}
+
+	return false;
+}
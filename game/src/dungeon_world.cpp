@@ -22,6 +22,13 @@ GameWorld::GameWorld()
 	m_GroundTexture = nullptr;
 	m_WallTexture = nullptr;
 
+	m_seed = 0;
+	m_seedSet = false;
+	m_currentFloor = 0;
+	m_windowX = 0;
+	m_windowZ = 0;
+	m_shortIndices = false;
+
 	//m_vertices = nullptr;
 
 	//m_tiles = nullptr;
@@ -41,21 +48,49 @@ GameWorld::~GameWorld()
 bool GameWorld::Init(ID3D11Device* device, LPCSTR* groundTextureFilename, LPCSTR* wallTextureFilename)
 {
 	bool result;
+	int entranceX, entranceZ;
 
 
-	// Manually set the height of the game world. There is only 1 level for now
-	m_worldHeight = 1;
+    // Pick a random seed unless one was requested with SetSeed()
+    if (!m_seedSet)
+    {
+        std::random_device rd;
+        m_seed = ((uint64)rd() << 32) | (uint64)rd();
+    }
 
-    int maxFeatures = 60;
+    // Start the job pool the floor geometry is built on, one worker per spare core
+	result = m_jobPool.Init(-1);
+	if(!result)
+	{
+		return false;
+	}
 
-    // Generate the dungeon
-	result = GenerateWorld(m_worldHeight, maxFeatures);
+    // The dungeon's chunks are generated from the seed as the player gets near them
+	m_chunks.Init(m_seed, DEFAULT_CHUNK_BUDGET);
+	result = m_chunks.GetEntranceLocation(entranceX, entranceZ);
 	if(!result)
 	{
 		return false;
 	}
 
-	PrintWorld();
+	// Build the top floor around the entrance, with the collider entities walk in
+	result = LoadFloor(0, entranceX, entranceZ);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_entities.Init(MAX_WORLD_ENTITIES);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_physics.Init(MAX_WORLD_BODIES, &m_collider);
+	if(!result)
+	{
+		return false;
+	}
 /*
     // Calculate the normals for the world data.
 	result = CalculateNormals();
@@ -98,6 +133,13 @@ void GameWorld::Shutdown()
 
 	// Release the game world itself.
 	ReleaseWorldGrid();
+	m_chunks.Shutdown();
+	m_collider.Shutdown();
+	m_entities.Shutdown();
+	m_physics.Shutdown();
+
+	// Stop the job pool workers.
+	m_jobPool.Shutdown();
 
 	return;
 }
@@ -201,6 +243,126 @@ void GameWorld::CopyVertexArray(void* vertexList)
 }
 
 
+void GameWorld::SetSeed(uint64 seed)
+{
+	// Use a fixed seed for the next Init(), so a world can be reproduced
+	m_seed = seed;
+	m_seedSet = true;
+
+	return;
+}
+
+
+uint64 GameWorld::GetSeed()
+{
+	return m_seed;
+}
+
+
+uint32 GameWorld::GetCurrentFloor()
+{
+	return m_currentFloor;
+}
+
+
+bool GameWorld::SetCurrentFloor(ID3D11Device* device, uint32 floor, int x, int z)
+{
+	// Build the window around dungeon tile x,z and replace the buffers with it
+	ShutdownBuffers();
+	if (!LoadFloor(floor, x, z))
+	{
+		return false;
+	}
+
+	// The entities were placed in the old window's tiles, so they go with it
+	m_entities.Clear();
+	m_physics.Clear();
+
+	return InitializeBuffers(device);
+}
+
+
+bool GameWorld::UpdateAround(ID3D11Device* device, Gumshoe::Vector3_t& position, bool& moved)
+{
+	int x = (int)floorf(position.x);
+	int z = (int)floorf(position.z);
+	int windowX = m_windowX;
+	int windowZ = m_windowZ;
+
+
+	// Keep the chunks around the window loaded, so moving it doesn't wait on the generator
+	m_chunks.UpdateAround((int)m_currentFloor, m_windowX + x, m_windowZ + z, CHUNK_WINDOW / 2 + 1);
+
+	moved = false;
+	if (x >= CHUNK_WINDOW_MARGIN && z >= CHUNK_WINDOW_MARGIN &&
+	    x < (int)m_worldLength - CHUNK_WINDOW_MARGIN && z < (int)m_worldWidth - CHUNK_WINDOW_MARGIN)
+	{
+		return true;
+	}
+
+	// Close to the edge, so the window moves to have the player's chunk in the middle
+	if (!SetCurrentFloor(device, m_currentFloor, m_windowX + x, m_windowZ + z))
+	{
+		return false;
+	}
+
+	position.x += (float)(windowX - m_windowX);
+	position.z += (float)(windowZ - m_windowZ);
+	moved = true;
+
+	return true;
+}
+
+
+bool GameWorld::SetTile(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int x, int y, char tile, Gumshoe::QuadTree* quadTree)
+{
+	DungeonFloor& floor = m_floor;
+	DungeonFloor::geometryPatch_t patch;
+
+
+	// Opening a door or breaking a wall only rebuilds the pieces of the tiles around it
+	if (!floor.SetTile(x, y, tile) || !floor.UpdateGeometry(patch))
+	{
+		return false;
+	}
+
+	// The walls around the tile change shape with it
+	if (!BuildCollider())
+	{
+		return false;
+	}
+
+	if (patch.removedTriangles.empty() && patch.triangleCount == 0)
+	{
+		return true;
+	}
+
+	// The vertex array grew, so the buffers are made again from the floor's arrays
+	ShutdownBuffers();
+	if (!InitializeBuffers(device))
+	{
+		return false;
+	}
+
+	// A tree built from this floor only has the changed triangles patched
+	if (quadTree)
+	{
+		const std::vector<gameWorldVertex_t>& vertices = floor.GetVertices();
+
+		if (!quadTree->UpdateTriangles(&vertices[0].position, sizeof(gameWorldVertex_t), (uint32)vertices.size(), floor.GetIndices().data(),
+		                               patch.removedTriangles.data(), (uint32)patch.removedTriangles.size() / 3,
+		                               patch.firstTriangle, patch.triangleCount))
+		{
+			return false;
+		}
+
+		return quadTree->UpdateBuffers(device, deviceContext);
+	}
+
+	return true;
+}
+
+
 void GameWorld::GetWorldSize(int& length, int& width)
 {
 	// Return the length and width of the world.
@@ -211,21 +373,45 @@ void GameWorld::GetWorldSize(int& length, int& width)
 }
 
 
-void GameWorld::GetUpStairsLocation(float& xPos, float& zPos)
+void GameWorld::GetWindowOrigin(int& x, int& z)
 {
-	for (int y = 0; y < m_procWorldWidth; y++)
+	x = m_windowX;
+	z = m_windowZ;
+
+	return;
+}
+
+
+bool GameWorld::GetEntranceLocation(float& xPos, float& zPos)
+{
+	int x, z;
+
+	// The entrance is on the top floor, in the window's tiles
+	if (m_currentFloor != 0 || !m_chunks.GetEntranceLocation(x, z))
 	{
-		for (int x = 0; x < m_procWorldLength; x++)
-		{
-			if (GetTile(x, y) == UpStairs)
-			{
-				xPos = (float)x;
-				zPos = (float)y;
+		return false;
+	}
 
-				return;
-			}
-		}
+	xPos = (float)(x - m_windowX);
+	zPos = (float)(z - m_windowZ);
+
+	return true;
+}
+
+
+bool GameWorld::FindStairsLink(int xPos, int zPos, uint32& linkFloor, int& linkX, int& linkZ)
+{
+	int floor;
+
+	// Stairs lead to the other stairs of their chunk one floor up or down, given in dungeon tiles
+	if (!m_chunks.FindStairsLink((int)m_currentFloor, m_windowX + xPos, m_windowZ + zPos, floor, linkX, linkZ))
+	{
+		return false;
 	}
+
+	linkFloor = (uint32)floor;
+
+	return true;
 }
 
 
@@ -246,6 +432,24 @@ Gumshoe::Vector3_t GameWorld::GetTileNormal(int xPos, int zPos)
 }
 
 
+Gumshoe::Physics::TileCollider* GameWorld::GetCollider()
+{
+	return &m_collider;
+}
+
+
+Gumshoe::EntityStore* GameWorld::GetEntities()
+{
+	return &m_entities;
+}
+
+
+Gumshoe::Physics::Movement* GameWorld::GetPhysics()
+{
+	return &m_physics;
+}
+
+
 bool GameWorld::LoadHeightMap(char* filename)
 {
 	FILE* filePtr;
@@ -499,259 +703,45 @@ bool GameWorld::CalculateNormals()
 }
 
 
-bool GameWorld::GenerateWorld(uint32 worldFloors, int maxFeatures)
+bool GameWorld::LoadFloor(uint32 floor, int x, int z)
 {
-	//uint32 i, j;
-	uint32 index;
-
-    m_worldLength = 96;
-    m_worldWidth = 96;
-	
-	// First generate the random dungeon
-	bool result = GenerateRandomWorld(maxFeatures);
-	if (!result)
-	{
-		return false;
-	}
+	ofstream fout;
 
-	// Create the structure to hold the game world data.
-	m_gameWorldGrid = new gameWorldGrid_t[m_tileCount];
-	if(!m_gameWorldGrid)
+
+	// The window of chunks with dungeon tile x,z's chunk in the middle
+	m_worldLength = CHUNK_WINDOW * CHUNK_SIZE;
+	m_worldWidth = CHUNK_WINDOW * CHUNK_SIZE;
+	ChunkedWorld::GetWindowOrigin(x, z, m_windowX, m_windowZ);
+	m_currentFloor = floor;
+
+	// Classify the tiles and build the geometry with the job pool
+	if (!m_floor.Build(m_chunks, (int)floor, m_windowX, m_windowZ, (int)m_worldLength, (int)m_worldWidth, &m_jobPool))
 	{
+		// Open a file to write the error message to.
+		fout.open("world-gen-error.txt");
+		fout << "floor " << floor << " at " << m_windowX << ", " << m_windowZ << ": " << m_floor.GetError() << " (seed " << m_seed << ")\n";
+		fout.close();
 		return false;
 	}
 
-	// Generate the game world geometry from the tilemap
-	index = 0;
-	for (int y = 0; y < m_procWorldWidth; ++y)
-	{
-	  for (int x = 0; x < m_procWorldLength; ++x)
-	  {
-		char tile = GetTile(x, y);
-		
-        // If the tile is used, fill the grid and increment the index
-		if (tile != '.')
-		{
-		  m_gameWorldGrid[index].x = (float)x;
-          m_gameWorldGrid[index].y = 0.0f;
-          m_gameWorldGrid[index].z = (float)y;
-
-          m_gameWorldGrid[index].tu = 0.0f;
-		  m_gameWorldGrid[index].tv = 1.0f;
-
-		  m_gameWorldGrid[index].nx = 0.0f;
-		  m_gameWorldGrid[index].ny = 0.0f;
-		  m_gameWorldGrid[index].nz = 0.0f;
-
-		  m_gameWorldGrid[index].r = 0.0f;
-		  m_gameWorldGrid[index].g = 0.0f;
-		  m_gameWorldGrid[index].b = 0.0f;
-
-		  m_gameWorldGrid[index].geoFeatures = 0;
-
-		  // Get the adjacent tiles
-	      char northTile = GetTile(x, y+1);
-	      char southTile = GetTile(x, y-1);
-	      char eastTile  = GetTile(x+1, y);
-	      char westTile  = GetTile(x-1, y);
-	      char northEastTile = GetTile(x+1, y+1);
-	      char southEastTile = GetTile(x+1, y-1);
-	      char northWestTile = GetTile(x-1, y+1);
-	      char southWestTile = GetTile(x-1, y-1);
-
-		  if (tile == Wall)
-          {
-          	// Check each adjacent tile to set the floor features
-            if (northWestTile == ' ' || northWestTile == ClosedDoor)
-            {
-                m_gameWorldGrid[index].geoFeatures |= NorthWestFloor;
-            }
-            
-            if (northEastTile == ' ' || northEastTile == ClosedDoor)
-            {
-                m_gameWorldGrid[index].geoFeatures |= NorthEastFloor;
-            }
-
-            if (southWestTile == ' ' || southWestTile == ClosedDoor)
-            {
-                m_gameWorldGrid[index].geoFeatures |= SouthWestFloor;
-            }
-
-            if (southEastTile == ' ' || southEastTile == ClosedDoor)
-            {
-                m_gameWorldGrid[index].geoFeatures |= SouthEastFloor;
-            }
-
-            // Check the North tile to add walls
-            if (northTile == ' ')
-            {
-                m_gameWorldGrid[index].geoFeatures |= NorthWestFloor;
-                m_gameWorldGrid[index].geoFeatures |= NorthEastFloor;
-                m_gameWorldGrid[index].geoFeatures |= WestWall;
-                m_gameWorldGrid[index].geoFeatures |= EastWall;
-                if (eastTile == ' ')
-                	m_gameWorldGrid[index].geoFeatures &= ~EastWall;
-                if (westTile == ' ')
-                	m_gameWorldGrid[index].geoFeatures &= ~WestWall;
-            }
-            else if (northTile == ClosedDoor)
-            {
-            	m_gameWorldGrid[index].geoFeatures |= NorthWestFloor;
-                m_gameWorldGrid[index].geoFeatures |= NorthEastFloor;
-                m_gameWorldGrid[index].geoFeatures |= NorthWall;
-                m_gameWorldGrid[index].geoFeatures |= NorthWallCap;
-            }
-            else if (northTile == Wall &&
-            	    ((m_gameWorldGrid[index].geoFeatures & NorthEastFloor) || 
-            	     (m_gameWorldGrid[index].geoFeatures & NorthWestFloor)))
-            {
-            	m_gameWorldGrid[index].geoFeatures |= NorthWall;
-            }
-
-            // Check the South tile to add walls
-            if (southTile == ' ')
-            {
-                m_gameWorldGrid[index].geoFeatures |= SouthWestFloor;
-                m_gameWorldGrid[index].geoFeatures |= SouthEastFloor;
-                m_gameWorldGrid[index].geoFeatures |= WestWall;
-                m_gameWorldGrid[index].geoFeatures |= EastWall;
-                if (eastTile == ' ')
-                	m_gameWorldGrid[index].geoFeatures &= ~EastWall;
-                if (westTile == ' ')
-                	m_gameWorldGrid[index].geoFeatures &= ~WestWall;
-            }
-            else if (southTile == ClosedDoor)
-            {
-            	m_gameWorldGrid[index].geoFeatures |= SouthWestFloor;
-                m_gameWorldGrid[index].geoFeatures |= SouthEastFloor;
-                m_gameWorldGrid[index].geoFeatures |= SouthWall;
-                m_gameWorldGrid[index].geoFeatures |= SouthWallCap;
-            }
-            else if (southTile == Wall &&
-            	    ((m_gameWorldGrid[index].geoFeatures & SouthEastFloor) || 
-            	     (m_gameWorldGrid[index].geoFeatures & SouthWestFloor)))
-            {
-            	m_gameWorldGrid[index].geoFeatures |= SouthWall;
-            }
-
-          	// Check the East tile to add walls
-            if (eastTile == ' ')
-            {
-                m_gameWorldGrid[index].geoFeatures |= NorthEastFloor;
-                m_gameWorldGrid[index].geoFeatures |= SouthEastFloor;
-                m_gameWorldGrid[index].geoFeatures |= NorthWall;
-                m_gameWorldGrid[index].geoFeatures |= SouthWall;
-                if (northTile == ' ')
-                	m_gameWorldGrid[index].geoFeatures &= ~NorthWall;
-                if (southTile == ' ')
-                	m_gameWorldGrid[index].geoFeatures &= ~SouthWall;
-            }
-            else if (eastTile == ClosedDoor)
-            {
-            	m_gameWorldGrid[index].geoFeatures |= NorthEastFloor;
-                m_gameWorldGrid[index].geoFeatures |= SouthEastFloor;
-                m_gameWorldGrid[index].geoFeatures |= EastWall;
-                m_gameWorldGrid[index].geoFeatures |= EastWallCap;
-            }
-            else if (eastTile == Wall &&
-            	    ((m_gameWorldGrid[index].geoFeatures & NorthEastFloor) || 
-            	     (m_gameWorldGrid[index].geoFeatures & SouthEastFloor)))
-            {
-            	m_gameWorldGrid[index].geoFeatures |= EastWall;
-            }
-
-            // Check the West tile to add walls
-            if (westTile == ' ')
-            {
-                m_gameWorldGrid[index].geoFeatures |= NorthWestFloor;
-                m_gameWorldGrid[index].geoFeatures |= SouthWestFloor;
-                m_gameWorldGrid[index].geoFeatures |= NorthWall;
-                m_gameWorldGrid[index].geoFeatures |= SouthWall;
-                if (northTile == ' ')
-                	m_gameWorldGrid[index].geoFeatures &= ~NorthWall;
-                if (southTile == ' ')
-                	m_gameWorldGrid[index].geoFeatures &= ~SouthWall;
-            }
-            else if (westTile == ClosedDoor)
-            {
-            	m_gameWorldGrid[index].geoFeatures |= NorthWestFloor;
-                m_gameWorldGrid[index].geoFeatures |= SouthWestFloor;
-                m_gameWorldGrid[index].geoFeatures |= WestWall;
-                m_gameWorldGrid[index].geoFeatures |= WestWallCap;
-            }
-            else if (westTile == Wall &&
-            	    ((m_gameWorldGrid[index].geoFeatures & NorthWestFloor) || 
-            	     (m_gameWorldGrid[index].geoFeatures & SouthWestFloor)))
-            {
-            	m_gameWorldGrid[index].geoFeatures |= WestWall;
-            }
-
-
-            // Check to add in the walls that just come to an end and don't connect
-            if (northTile == ' ' && southTile == Wall && eastTile == ' ' && westTile == ' ')
-            {
-            	m_gameWorldGrid[index].geoFeatures |= NorthWall;
-            }
-
-            if (northTile == Wall && southTile == ' ' && eastTile == ' ' && westTile == ' ')
-            {
-            	m_gameWorldGrid[index].geoFeatures |= SouthWall;
-            }
-
-            if (northTile == ' ' && southTile == ' ' && eastTile == Wall && westTile == ' ')
-            {
-            	m_gameWorldGrid[index].geoFeatures |= WestWall;
-            }
-
-            if (northTile == ' ' && southTile == ' ' && eastTile == ' ' && westTile == Wall)
-            {
-            	m_gameWorldGrid[index].geoFeatures |= EastWall;
-            }
-
-
-            // Lastly, check if any walls need an end cap
-            if ((m_gameWorldGrid[index].geoFeatures & NorthWall) && (northTile != Wall))
-                m_gameWorldGrid[index].geoFeatures |= NorthWallCap;
-
-            if ((m_gameWorldGrid[index].geoFeatures & SouthWall) && (southTile != Wall))
-                m_gameWorldGrid[index].geoFeatures |= SouthWallCap;
-
-            if ((m_gameWorldGrid[index].geoFeatures & EastWall) && (eastTile != Wall))
-                m_gameWorldGrid[index].geoFeatures |= EastWallCap;
-
-            if ((m_gameWorldGrid[index].geoFeatures & WestWall) && (westTile != Wall))
-                m_gameWorldGrid[index].geoFeatures |= WestWallCap;
-
-            // Set the y-direction normal to 0
-            m_gameWorldGrid[index].ny = 0.0f;
-          }
-          else if (tile == ClosedDoor)
-          {
-          	m_gameWorldGrid[index].geoFeatures |= NorthWestFloor;
-          	m_gameWorldGrid[index].geoFeatures |= NorthEastFloor;
-          	m_gameWorldGrid[index].geoFeatures |= SouthWestFloor;
-          	m_gameWorldGrid[index].geoFeatures |= SouthEastFloor;
-          	if (northTile == Wall)
-          	    m_gameWorldGrid[index].geoFeatures |= VertDoorway;
-          	else
-          		m_gameWorldGrid[index].geoFeatures |= HorizDoorway;
-          	m_gameWorldGrid[index].ny = 1.0f;
-          }
-          else
-          {
-          	m_gameWorldGrid[index].geoFeatures |= NorthWestFloor;
-          	m_gameWorldGrid[index].geoFeatures |= NorthEastFloor;
-          	m_gameWorldGrid[index].geoFeatures |= SouthWestFloor;
-          	m_gameWorldGrid[index].geoFeatures |= SouthEastFloor;
-           	m_gameWorldGrid[index].ny = 1.0f;
-          }
-
-          index++;
-		}
-	  }
-	}	
+	PrintWorld();
 
-	return true;
+	// Entities collide with the walls of the window they are in
+	return BuildCollider();
+}
+
+
+bool GameWorld::BuildCollider()
+{
+	std::vector<uint8> solid;
+	DungeonFloor& floor = m_floor;
+
+
+	// Walls collide where their thin tops are drawn, not as whole tiles
+	floor.GetSolidCells(solid);
+
+	return m_collider.Init(solid.data(), floor.GetLength() * COLLIDER_CELLS_PER_TILE, floor.GetWidth() * COLLIDER_CELLS_PER_TILE,
+	                       COLLIDER_CELLS_PER_TILE);
 }
 
 
@@ -995,792 +985,21 @@ bool GameWorld::LoadColorMap(char* filename)
 }
 
 
-void GameWorld::AddTileFloorGeometry(uint32 tileIndex, std::vector<gameWorldVertex_t> &vertices,
-	                                 std::vector<unsigned long> &indices, uint32 &index)
-{
-    gameWorldVertex_t currVertex;
-    int j;
-    bool wholeFloor = false;
-    
-    float xFloorOffset;
-    float zFloorOffset;
-    float xFloorWidth;
-    float zFloorWidth;
-
-    // Check if the whole tile should have a floor, to save polygons
-    if ((m_gameWorldGrid[tileIndex].geoFeatures & (NorthWestFloor | NorthEastFloor | SouthWestFloor | SouthEastFloor)) == 0x0F)
-    {
-    	xFloorOffset = 0.0f;
-    	zFloorOffset = 0.0f;
-    	xFloorWidth  = 1.0f;
-    	zFloorWidth  = 1.0f;
-    	j = 3;
-    	wholeFloor = true;
-    }
-    else
-    {
-    	xFloorOffset = 0.0f;
-    	zFloorOffset = 0.0f;
-    	xFloorWidth  = 0.5f;
-    	zFloorWidth  = 0.5f;
-    	j = 0;
-    }
-
-    for (; j < 4; j++)
-    {
-    	bool addFloor = false;
-    	if (wholeFloor)
-    	{
-    		addFloor = true;
-    	}
-	    else if (m_gameWorldGrid[tileIndex].geoFeatures & (1<<j))
-	    {
-	    	addFloor = true;
-	    	// xFloorOffset = ((float)(j % 2)) * 0.5f;
-	    	// zFloorOffset = ((float)(((j+2) & 0x02)>>1)) * 0.5f;
-
-	    	if (j == 0)
-	    	{
-                xFloorOffset = 0.0f;
-                zFloorOffset = 0.5f;
-	    	}
-	    	else if (j == 1)
-	    	{
-                xFloorOffset = 0.5f;
-                zFloorOffset = 0.5f;
-	    	}
-	    	else if (j == 2)
-	    	{
-                xFloorOffset = 0.0f;
-                zFloorOffset = 0.0f;
-	    	}
-	    	else
-	    	{
-                xFloorOffset = 0.5f;
-                zFloorOffset = 0.0f;
-	    	}
-	    }
-
-	    if (addFloor)
-	    {
-		    // Bottom left corner of tile (vertex 0)
-		    currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xFloorOffset, m_gameWorldGrid[tileIndex].y, m_gameWorldGrid[tileIndex].z + zFloorOffset);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + xFloorOffset, m_gameWorldGrid[tileIndex].tv - zFloorOffset);
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-			// Top left corner of tile (vertex 0)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xFloorOffset, m_gameWorldGrid[tileIndex].y, m_gameWorldGrid[tileIndex].z + (zFloorOffset + zFloorWidth));
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + xFloorOffset, m_gameWorldGrid[tileIndex].tv - (zFloorOffset + zFloorWidth));
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-			// Top right corner of tile (vertex 0)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xFloorOffset + xFloorWidth), m_gameWorldGrid[tileIndex].y, m_gameWorldGrid[tileIndex].z + (zFloorOffset + zFloorWidth));
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + (xFloorOffset + xFloorWidth), m_gameWorldGrid[tileIndex].tv - (zFloorOffset + zFloorWidth));
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-
-			// Top right corner of tile (vertex 1)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xFloorOffset + xFloorWidth), m_gameWorldGrid[tileIndex].y, m_gameWorldGrid[tileIndex].z + (zFloorOffset + zFloorWidth));
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + (xFloorOffset + xFloorWidth), m_gameWorldGrid[tileIndex].tv - (zFloorOffset + zFloorWidth));
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-			// Bottom right corner of tile (vertex 1)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xFloorOffset + xFloorWidth), m_gameWorldGrid[tileIndex].y, m_gameWorldGrid[tileIndex].z + zFloorOffset);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + (xFloorOffset + xFloorWidth), m_gameWorldGrid[tileIndex].tv - zFloorOffset);
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-			// Bottom left corner of tile (vertex 1)
-		    currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xFloorOffset, m_gameWorldGrid[tileIndex].y, m_gameWorldGrid[tileIndex].z + zFloorOffset);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + xFloorOffset, m_gameWorldGrid[tileIndex].tv - zFloorOffset);
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-		}
-	}
-}
-
-
-void GameWorld::AddTileWallGeometry(uint32 tileIndex, std::vector<gameWorldVertex_t> &vertices,
-	                                std::vector<unsigned long> &indices, uint32 &index)
-{
-    gameWorldVertex_t currVertex;
-    int i, j;
-    bool addWall = false;
-
-    float xWallOffset = 0.6f;
-    float zWallOffset = 0.4f;
-    float xWallWidth = -0.2f;
-    float zWallWidth = 0.6f;
-    
-    float xWallPos1 = 0.0f;
-    float xWallPos2 = -0.2f;
-    float xWallPos3 = -0.2f;
-    float zWallPos1 = 0.6f;
-    float zWallPos2 = 0.6f;
-    float zWallPos3 = 0.0f;
-   
-    float xNormFront = 1.0f;
-    float xNormBack = -1.0f;
-    float zNormFront = 0.0f;
-    float zNormBack = 0.0f;
-
-    for (i = 0; i < 4; i++)
-    {
-    	addWall = false;
-
-	    if (m_gameWorldGrid[tileIndex].geoFeatures & (1<<(i+4)))
-	    {
-	        addWall = true;
-	        
-	        if (i == 1)
-	        {
-                if (m_gameWorldGrid[tileIndex].geoFeatures & NorthWall)
-                {
-                    xWallOffset = 0.6f;
-	                zWallOffset = 0.0f;
-	                xWallWidth = -0.2f;
-	                zWallWidth = 0.4f;
-
-	                xWallPos1 = 0.0f;
-				    xWallPos2 = -0.2f;
-				    xWallPos3 = -0.2f;
-				    zWallPos1 = 0.4f;
-				    zWallPos2 = 0.4f;
-				    zWallPos3 = 0.0f;
-                }
-                else
-                {
-                    xWallOffset = 0.6f;
-	                zWallOffset = 0.0f;
-	                xWallWidth = -0.2f;
-	                zWallWidth = 0.6f;
-
-	                xWallPos1 = 0.0f;
-				    xWallPos2 = -0.2f;
-				    xWallPos3 = -0.2f;
-				    zWallPos1 = 0.6f;
-				    zWallPos2 = 0.6f;
-				    zWallPos3 = 0.0f;	
-                }
-
-                xNormFront = 1.0f;
-                xNormBack = -1.0f;
-                zNormFront = 0.0f;
-                zNormBack = 0.0f;
-	        }
-	        else if (i == 2)
-	        {
-                xWallOffset = 0.4f;
-                zWallOffset = 0.6f;
-                xWallWidth = 0.6f;
-                zWallWidth = -0.2f;
-
-                xWallPos1 = 0.6f;
-			    xWallPos2 = 0.0f;
-			    xWallPos3 = 0.6f;
-			    zWallPos1 = 0.0f;
-			    zWallPos2 = -0.2f;
-			    zWallPos3 = -0.2f;
-
-                xNormFront = 0.0f;
-                xNormBack = 0.0f;
-                zNormFront = 1.0f;
-                zNormBack = -1.0f;
-	        }
-	        else if (i == 3)
-	        {
-                if (m_gameWorldGrid[tileIndex].geoFeatures & EastWall)
-                {
-                    xWallOffset = 0.0f;
-	                zWallOffset = 0.6f;
-	                xWallWidth = 0.4f;
-	                zWallWidth = -0.2f;
-
-	                xWallPos1 = 0.4f;
-				    xWallPos2 = 0.0f;
-				    xWallPos3 = 0.4f;
-				    zWallPos1 = 0.0f;
-				    zWallPos2 = -0.2f;
-				    zWallPos3 = -0.2f;
-                }
-                else
-                {
-                    xWallOffset = 0.0f;
-	                zWallOffset = 0.6f;
-	                xWallWidth = 0.6f;
-	                zWallWidth = -0.2f;
-
-	                xWallPos1 = 0.6f;
-				    xWallPos2 = 0.0f;
-				    xWallPos3 = 0.6f;
-				    zWallPos1 = 0.0f;
-				    zWallPos2 = -0.2f;
-				    zWallPos3 = -0.2f;	
-                }
-
-                xNormFront = 0.0f;
-                xNormBack = 0.0f;
-                zNormFront = 1.0f;
-                zNormBack = -1.0f;
-	        }
-	    }
-
-	    if (addWall)
-	    {
-		    // Add in the top of the wall
-		    // Bottom left corner of tile (vertex 0)
-		    currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallWidth), m_gameWorldGrid[tileIndex].y + 3.0f, m_gameWorldGrid[tileIndex].z + zWallOffset);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + (xWallOffset + xWallWidth), m_gameWorldGrid[tileIndex].tv - zWallOffset);
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-			// Top left corner of tile (vertex 0)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallWidth), m_gameWorldGrid[tileIndex].y + 3.0f, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallWidth));
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + (xWallOffset + xWallWidth), m_gameWorldGrid[tileIndex].tv - (zWallOffset + zWallWidth));
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-			// Top right corner of tile (vertex 0)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xWallOffset, m_gameWorldGrid[tileIndex].y + 3.0f, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallWidth));
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + xWallOffset, m_gameWorldGrid[tileIndex].tv - (zWallOffset + zWallWidth));
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-			// Top right corner of tile (vertex 1)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xWallOffset, m_gameWorldGrid[tileIndex].y + 3.0f, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallWidth));
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + xWallOffset, m_gameWorldGrid[tileIndex].tv - (zWallOffset + zWallWidth));
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-			// Bottom right corner of tile (vertex 1)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xWallOffset, m_gameWorldGrid[tileIndex].y + 3.0f, m_gameWorldGrid[tileIndex].z + zWallOffset);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + xWallOffset, m_gameWorldGrid[tileIndex].tv - zWallOffset);
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-			// Bottom left corner of tile (vertex 1)
-		    currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallWidth), m_gameWorldGrid[tileIndex].y + 3.0f, m_gameWorldGrid[tileIndex].z + zWallOffset);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + (xWallOffset + xWallWidth), m_gameWorldGrid[tileIndex].tv - zWallOffset);
-		    currVertex.normal = D3DXVECTOR3(0.0f, 1.0f, 0.0f);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-			indices.push_back(index);
-			index++;
-
-		    // Wall is 3m high
-		    for (j = 0; j < 3; j++)
-		    {
-		        float yPos = m_gameWorldGrid[tileIndex].y + ((float)j*1.0f);
-
-		        // Bottom left corner of tile (vertex 0)
-		        currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallPos1), yPos, m_gameWorldGrid[tileIndex].z + zWallOffset);
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu, m_gameWorldGrid[tileIndex].tv);
-			    currVertex.normal = D3DXVECTOR3(xNormFront, m_gameWorldGrid[tileIndex].ny, zNormFront);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Top left corner of tile (vertex 0)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallPos1), yPos + 1.0f, m_gameWorldGrid[tileIndex].z + zWallOffset);
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu, m_gameWorldGrid[tileIndex].tv - 1.0f);
-			    currVertex.normal = D3DXVECTOR3(xNormFront, m_gameWorldGrid[tileIndex].ny, zNormFront);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Top right corner of tile (vertex 0)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xWallOffset, yPos + 1.0f, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallPos1));
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + 1.0f, m_gameWorldGrid[tileIndex].tv - 1.0f);
-			    currVertex.normal = D3DXVECTOR3(xNormFront, m_gameWorldGrid[tileIndex].ny, zNormFront);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-
-				// Top right corner of tile (vertex 1)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xWallOffset, yPos + 1.0f, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallPos1));
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + 1.0f, m_gameWorldGrid[tileIndex].tv - 1.0f);
-			    currVertex.normal = D3DXVECTOR3(xNormFront, m_gameWorldGrid[tileIndex].ny, zNormFront);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Bottom right corner of tile (vertex 1)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xWallOffset, yPos, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallPos1));
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + 1.0f, m_gameWorldGrid[tileIndex].tv);
-			    currVertex.normal = D3DXVECTOR3(xNormFront, m_gameWorldGrid[tileIndex].ny, zNormFront);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Bottom left corner of tile (vertex 1)
-		        currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallPos1), yPos, m_gameWorldGrid[tileIndex].z + zWallOffset);
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu, m_gameWorldGrid[tileIndex].tv);
-			    currVertex.normal = D3DXVECTOR3(xNormFront, m_gameWorldGrid[tileIndex].ny, zNormFront);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-
-		        // Other side of the wall
-				// Bottom left corner of tile (vertex 2)
-		        currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallPos2), yPos, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallPos2));
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu, m_gameWorldGrid[tileIndex].tv);
-			    currVertex.normal = D3DXVECTOR3(xNormBack, m_gameWorldGrid[tileIndex].ny, zNormBack);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Top left corner of tile (vertex 2)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallPos2), yPos + 1.0f, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallPos2));
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu, m_gameWorldGrid[tileIndex].tv - 1.0f);
-			    currVertex.normal = D3DXVECTOR3(xNormBack, m_gameWorldGrid[tileIndex].ny, zNormBack);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Top right corner of tile (vertex 2)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallPos3), yPos + 1.0f, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallPos3));
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + 1.0f, m_gameWorldGrid[tileIndex].tv - 1.0f);
-			    currVertex.normal = D3DXVECTOR3(xNormBack, m_gameWorldGrid[tileIndex].ny, zNormBack);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-
-				// Top right corner of tile (vertex 3)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallPos3), yPos + 1.0f, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallPos3));
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + 1.0f, m_gameWorldGrid[tileIndex].tv - 1.0f);
-			    currVertex.normal = D3DXVECTOR3(xNormBack, m_gameWorldGrid[tileIndex].ny, zNormBack);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Bottom right corner of tile (vertex 3)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallPos3), yPos, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallPos3));
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + 1.0f, m_gameWorldGrid[tileIndex].tv);
-			    currVertex.normal = D3DXVECTOR3(xNormBack, m_gameWorldGrid[tileIndex].ny, zNormBack);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Bottom left corner of tile (vertex 3)
-		        currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xWallOffset + xWallPos2), yPos, m_gameWorldGrid[tileIndex].z + (zWallOffset + zWallPos2));
-		        currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu, m_gameWorldGrid[tileIndex].tv);
-			    currVertex.normal = D3DXVECTOR3(xNormBack, m_gameWorldGrid[tileIndex].ny, zNormBack);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-		    }
-		}
-	}
-}
-
-
-void GameWorld::AddTileWallCapGeometry(uint32 tileIndex, std::vector<gameWorldVertex_t> &vertices,
-	                                   std::vector<unsigned long> &indices, uint32 &index)
-{
-	gameWorldVertex_t currVertex;
-    int i, j;
-
-    float xCapOffset = 0.6f;
-    float zCapOffset = 1.0f;
-    float xCapWidth = -0.2f;
-    float zCapWidth = 0.0f;
-   
-    float xNorm = 0.0f;
-    float zNorm = 1.0f;
-
-    for (i = 0; i < 4; i++)
-    {
-    	if (m_gameWorldGrid[tileIndex].geoFeatures & (1<<(i+8)))
-	    {
-	        if (i == 1)
-	        {
-	        	xCapOffset = 0.4f;
-	        	zCapOffset = 0.0f;
-	        	xCapWidth  = 0.2f;
-	        	zCapWidth  = 0.0f;
-	        	xNorm = 0.0f;
-	        	zNorm = -1.0f;
-	        }
-	        else if (i == 2)
-	        {
-                xCapOffset = 1.0f;
-	        	zCapOffset = 0.4f;
-	        	xCapWidth  = 0.0f;
-	        	zCapWidth  = 0.2f;
-	        	xNorm = 1.0f;
-	        	zNorm = 0.0f;
-	        }
-	        else if (i == 3)
-	        {
-                xCapOffset = 0.0f;
-	        	zCapOffset = 0.6f;
-	        	xCapWidth  = 0.0f;
-	        	zCapWidth  = -0.2f;
-	        	xNorm = -1.0f;
-	        	zNorm = 0.0f;
-	        }
- 
-            // Wall is 3m high
-		    for (j = 0; j < 3; j++)
-		    {
-		        float yPos = m_gameWorldGrid[tileIndex].y + ((float)j*1.0f);
-            
-	            // Bottom left corner of tile (vertex 0)
-			    currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xCapOffset, yPos, m_gameWorldGrid[tileIndex].z + zCapOffset);
-			    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu, m_gameWorldGrid[tileIndex].tv);
-			    currVertex.normal = D3DXVECTOR3(xNorm, m_gameWorldGrid[tileIndex].ny, zNorm);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Top left corner of tile (vertex 0)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xCapOffset, yPos + 1.0f, m_gameWorldGrid[tileIndex].z + zCapOffset);
-			    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu, m_gameWorldGrid[tileIndex].tv - 1.0f);
-			    currVertex.normal = D3DXVECTOR3(xNorm, m_gameWorldGrid[tileIndex].ny, zNorm);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Top right corner of tile (vertex 0)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xCapOffset + xCapWidth), yPos + 1.0f, m_gameWorldGrid[tileIndex].z + (zCapOffset + zCapWidth));
-			    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + 1.0f, m_gameWorldGrid[tileIndex].tv - 1.0f);
-			    currVertex.normal = D3DXVECTOR3(xNorm, m_gameWorldGrid[tileIndex].ny, zNorm);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-
-				// Top right corner of tile (vertex 1)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xCapOffset + xCapWidth), yPos + 1.0f, m_gameWorldGrid[tileIndex].z + (zCapOffset + zCapWidth));
-			    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + 1.0f, m_gameWorldGrid[tileIndex].tv - 1.0f);
-			    currVertex.normal = D3DXVECTOR3(xNorm, m_gameWorldGrid[tileIndex].ny, zNorm);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Bottom right corner of tile (vertex 1)
-				currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + (xCapOffset + xCapWidth), yPos, m_gameWorldGrid[tileIndex].z + (zCapOffset + zCapWidth));
-			    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + 1.0f, m_gameWorldGrid[tileIndex].tv);
-			    currVertex.normal = D3DXVECTOR3(xNorm, m_gameWorldGrid[tileIndex].ny, zNorm);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-
-				// Bottom left corner of tile (vertex 1)
-			    currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xCapOffset, yPos, m_gameWorldGrid[tileIndex].z + zCapOffset);
-			    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu, m_gameWorldGrid[tileIndex].tv);
-			    currVertex.normal = D3DXVECTOR3(xNorm, m_gameWorldGrid[tileIndex].ny, zNorm);
-				currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-				vertices.push_back(currVertex);
-			    indices.push_back(index);
-				index++;
-			}
-		}
-	}
-}
-
-
-void GameWorld::AddTileDoorwayGeometry(uint32 tileIndex, std::vector<gameWorldVertex_t> &vertices,
-	                                   std::vector<unsigned long> &indices, uint32 &index)
-{
-	gameWorldVertex_t currVertex;
-    int j;
-    bool addDoorway = false;
-
-    float xMin = 0.4f;
-    float xMax = 0.4f;
-    float xWidth = 0.2f;
-
-    float zMin = 0.0f;
-    float zMax = 0.0f;
-    float zWidth = 1.0f;
-
-    float xNorm = 0.0f;
-    float zNorm = 0.0f;
-
-    // Check if it is a vertical doorway
-    if (m_gameWorldGrid[tileIndex].geoFeatures & VertDoorway)
-    {
-    	addDoorway = true;
-
-        xMin = 0.4f;
-        xMax = 0.4f;
-        xWidth = 0.2f;
-
-        zMin = 0.0f;
-        zMax = 1.0f;
-        zWidth = 1.0f;
-
-        xNorm = 1.0f;
-        zNorm = 0.0f;
-    }
-    // Check if there is a horizontal doorway
-    else if (m_gameWorldGrid[tileIndex].geoFeatures & HorizDoorway)
-    {
-    	addDoorway = true;
-
-        xMin = 0.0f;
-        xMax = 1.0f;
-        xWidth = 1.0f;
-
-        zMin = 0.4f;
-        zMax = 0.4f;
-        zWidth = 0.2f;
-
-        xNorm = 0.0f;
-        zNorm = 1.0f;
-    }
-    
-    // Add in the doorway if needed
-    if (addDoorway)
-    {
-        // There are 4 sides to the doorway
-        for (j = 0; j < 4; j++)
-	    {
-	        float xOff0 = 0.0f;
-	        float xOff1 = 0.0f;
-	        float yOff0 = 0.0f;
-	        float yOff1 = 0.0f;
-	        float zOff0 = 0.0f;
-	        float zOff1 = 0.0f;
-
-	        float tuOff0 = 0.0f;
-	        float tuOff1 = 0.0f;
-	        float tvOff0 = 0.0f;
-	        float tvOff1 = 0.0f;
-
-	        float xNormPoly = 0.0f;
-            float yNormPoly = 0.0f;
-            float zNormPoly = 0.0f;
-
-	        // The walls are added as follows:
-	        // j = 0 : Up facing wall
-	        // j = 1 : Down facing wall
-	        // j = 2 : West/North facing wall
-	        // j = 3 : East/South facing wall
-            if (j == 0)
-            {
-                xOff0 = xMin;
-            	xOff1 = xMin + xWidth;
-                yOff0 = 3.0f;
-            	yOff1 = 3.0f;
-                zOff0 = zMin;
-            	zOff1 = zMin + zWidth;
-
-            	tuOff0 = xOff0;
-                tuOff1 = xOff1;
-                tvOff0 = zOff0;
-                tvOff1 = zOff1;
-
-            	xNormPoly = 0.0f;
-            	yNormPoly = 1.0f;
-            	zNormPoly = 0.0f;
-            }
-            else if (j == 1)
-            {
-                xOff0 = xMin + xWidth;
-            	xOff1 = xMin;
-                yOff0 = 2.2f;
-            	yOff1 = 2.2f;
-                zOff0 = zMin;
-            	zOff1 = zMin + zWidth;
-
-            	tuOff0 = xOff0;
-                tuOff1 = xOff1;
-                tvOff0 = zOff0;
-                tvOff1 = zOff1;
-
-            	xNormPoly = 0.0f;
-            	yNormPoly = -1.0f;
-            	zNormPoly = 0.0f;
-            }
-            // TODO(ebd): Need to fix the vertical walls for the doorways
-            else if (j == 2)
-            {
-            	xOff0 = xMin;
-            	xOff1 = xMax;
-            	yOff0 = 2.2f;
-            	yOff1 = 3.0f;
-            	zOff0 = zMax;
-            	zOff1 = zMin;
-            	
-                tuOff0 = zOff0;
-                tuOff1 = zOff1;
-                tvOff0 = yOff0 - 2.0f;
-                tvOff1 = yOff1 - 2.0f;
-
-            	xNormPoly = -1.0f * xNorm;
-            	yNormPoly = 0.0f;
-            	zNormPoly = 1.0f * zNorm;
-            }
-            else if (j == 3)
-            {
-            	xOff0 = xMin + xWidth;
-            	xOff1 = xMax + xWidth;
-            	yOff0 = 2.2f;
-            	yOff1 = 3.0f;
-            	zOff0 = zMin + zWidth;
-            	zOff1 = zMax + zWidth;
-            	
-                tuOff0 = zOff0;
-                tuOff1 = zOff1;
-                tvOff0 = yOff0 - 2.0f;
-                tvOff1 = yOff1 - 2.0f;
-                
-            	xNormPoly = 1.0f * xNorm;
-            	yNormPoly = 0.0f;
-            	zNormPoly = -1.0f * zNorm;
-            }
-        
-            // Bottom left corner of tile (vertex 0)
-		    currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xOff0, m_gameWorldGrid[tileIndex].y + yOff0, m_gameWorldGrid[tileIndex].z + zOff0);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + tuOff0, m_gameWorldGrid[tileIndex].tv - tvOff0);
-		    currVertex.normal = D3DXVECTOR3(xNormPoly, yNormPoly, zNormPoly);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-		    indices.push_back(index);
-			index++;
-
-			// Top left corner of tile (vertex 0)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xOff0, m_gameWorldGrid[tileIndex].y + yOff0, m_gameWorldGrid[tileIndex].z + zOff1);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + tuOff0, m_gameWorldGrid[tileIndex].tv - tvOff1);
-		    currVertex.normal = D3DXVECTOR3(xNormPoly, yNormPoly, zNormPoly);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-		    indices.push_back(index);
-			index++;
-
-			// Top right corner of tile (vertex 0)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xOff1, m_gameWorldGrid[tileIndex].y + yOff1, m_gameWorldGrid[tileIndex].z + zOff1);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + tuOff1, m_gameWorldGrid[tileIndex].tv - tvOff1);
-		    currVertex.normal = D3DXVECTOR3(xNormPoly, yNormPoly, zNormPoly);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-		    indices.push_back(index);
-			index++;
-
-
-			// Top right corner of tile (vertex 1)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xOff1, m_gameWorldGrid[tileIndex].y + yOff1, m_gameWorldGrid[tileIndex].z + zOff1);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + tuOff1, m_gameWorldGrid[tileIndex].tv - tvOff1);
-		    currVertex.normal = D3DXVECTOR3(xNormPoly, yNormPoly, zNormPoly);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-		    indices.push_back(index);
-			index++;
-
-			// Bottom right corner of tile (vertex 1)
-			currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xOff1, m_gameWorldGrid[tileIndex].y + yOff1, m_gameWorldGrid[tileIndex].z + zOff0);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + tuOff1, m_gameWorldGrid[tileIndex].tv - tvOff0);
-		    currVertex.normal = D3DXVECTOR3(xNormPoly, yNormPoly, zNormPoly);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-		    indices.push_back(index);
-			index++;
-
-			// Bottom left corner of tile (vertex 1)
-		    currVertex.position = D3DXVECTOR3(m_gameWorldGrid[tileIndex].x + xOff0, m_gameWorldGrid[tileIndex].y + yOff0, m_gameWorldGrid[tileIndex].z + zOff0);
-		    currVertex.texture = D3DXVECTOR2(m_gameWorldGrid[tileIndex].tu + tuOff0, m_gameWorldGrid[tileIndex].tv - tvOff0);
-		    currVertex.normal = D3DXVECTOR3(xNormPoly, yNormPoly, zNormPoly);
-			currVertex.color = D3DXVECTOR4(m_gameWorldGrid[tileIndex].r, m_gameWorldGrid[tileIndex].g, m_gameWorldGrid[tileIndex].b, 1.0f);
-			vertices.push_back(currVertex);
-		    indices.push_back(index);
-			index++;
-		}
-	}
-}
-
-
 bool GameWorld::InitializeBuffers(ID3D11Device* device)
 {
-	//gameWorldVertex_t* vertices;
-	std::vector<unsigned long> indices;
-	uint32 index, i;
 	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
     D3D11_SUBRESOURCE_DATA vertexData, indexData;
 	HRESULT result;
 
-	// Initialize the index to the vertex array.
-	index = 0;
-
-	gameWorldVertex_t currVertex;
-
-	for (i = 0; i < m_tileCount; i++)
-	{
-        // First add the floor polygons for the tile
-        AddTileFloorGeometry(i, m_vertices, indices, index);
-
-        // Then add the wall polygons for the tile
-        AddTileWallGeometry(i, m_vertices, indices, index);
-
-        // Then add the wall-cap polygons for the tile
-        AddTileWallCapGeometry(i, m_vertices, indices, index);
+	// The geometry was built on the CPU with the floor, it only needs uploading
+	const std::vector<gameWorldVertex_t>& vertices = m_floor.GetVertices();
+	const std::vector<uint32>& indices = m_floor.GetIndices();
+	const std::vector<uint16>& shortIndices = m_floor.GetShortIndices();
 
-        // TODO(ebd): Don't add doorway geometry for now.
-        // Need to look at how doorways should be handled from a design perspective later on
+	// Use 16-bit indices when the floor has few enough vertices
+	m_shortIndices = m_floor.HasShortIndices();
 
-        // Finally, add the doorway geometry if needed
-        // AddTileDoorwayGeometry(i, m_vertices, indices, index);
-	}
-	
-	m_vertexCount = (int)m_vertices.size();
+	m_vertexCount = (int)vertices.size();
 	m_indexCount = (int)indices.size();
 
 	// Set up the description of the static vertex buffer.
@@ -1792,7 +1011,7 @@ bool GameWorld::InitializeBuffers(ID3D11Device* device)
 	vertexBufferDesc.StructureByteStride = 0;
 
     // Give the subresource structure a pointer to the vertex data.
-    vertexData.pSysMem = &(m_vertices[0]);
+    vertexData.pSysMem = &(vertices[0]);
 	vertexData.SysMemPitch = 0;
 	vertexData.SysMemSlicePitch = 0;
 
@@ -1805,14 +1024,14 @@ bool GameWorld::InitializeBuffers(ID3D11Device* device)
 
     // Set up the description of the static index buffer.
     indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    indexBufferDesc.ByteWidth = sizeof(unsigned long) * m_indexCount;
+    indexBufferDesc.ByteWidth = (m_shortIndices ? sizeof(uint16) : sizeof(uint32)) * m_indexCount;
     indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
     indexBufferDesc.CPUAccessFlags = 0;
     indexBufferDesc.MiscFlags = 0;
 	indexBufferDesc.StructureByteStride = 0;
 
 	// Give the subresource structure a pointer to the index data.
-    indexData.pSysMem = &(indices[0]);
+    indexData.pSysMem = m_shortIndices ? (const void*)&(shortIndices[0]) : (const void*)&(indices[0]);
 	indexData.SysMemPitch = 0;
 	indexData.SysMemSlicePitch = 0;
 
@@ -1872,7 +1091,7 @@ void GameWorld::RenderBuffers(ID3D11DeviceContext* deviceContext)
 	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
 
     // Set the index buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetIndexBuffer(m_indexBuffer, m_shortIndices ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
 
     // Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
 	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -1884,377 +1103,16 @@ void GameWorld::RenderBuffers(ID3D11DeviceContext* deviceContext)
 //--------------------------------------------
 // Procedurally Generated GameWorld
 //--------------------------------------------
-bool GameWorld::GenerateRandomWorld(int maxFeatures)
-{
-	bool result = true;
-	m_procWorldLength = 96;
-	m_procWorldWidth = 96;
-	m_tiles = std::vector<char>(m_procWorldLength*m_procWorldWidth, Unused);
-	ofstream fout;
-
-/*	
-	m_tiles = new std::vector<char>(m_procWorldLength*m_procWorldWidth, Unused);
-	if (!m_tiles)
-	{
-		return false;
-	}
-
-    m_rooms = new std::vector<Rect>();
-    if (!m_rooms)
-	{
-		return false;
-	}
-
-	m_exits = new std::vector<Rect>();
-	if (!m_exits)
-	{
-		return false;
-	}
-*/
-
-	// Open a file to write the error message to.
-	fout.open("world-gen-error.txt");
-
-	// place the first room in the center
-	if (!MakeRoom(m_procWorldLength / 2, m_procWorldWidth / 2, static_cast<Direction>(Gumshoe::RandomInt(4)), true))
-	{
-		fout << "Unable to place the first room.\n";
-		result = false;
-	}
-
-	// we already placed 1 feature (the first room)
-	for (int i = 1; i < maxFeatures; i++)
-	{
-		if (!CreateFeature())
-		{
-			fout << "Unable to place more features (placed " << i << ").\n";
-			break;
-		}
-	}
-
-	if (!PlaceObject(UpStairs))
-	{
-		fout << "Unable to place up stairs.\n";	
-		result = false;
-	}
-
-	if (!PlaceObject(DownStairs))
-	{
-		fout << "Unable to place down stairs.\n";		
-		result = false;
-	}
-
-	// Replace all unused tiles with '.' and set the rooms and corridors to ' '
-	m_tileCount = 0;
-	for (char& tile : m_tiles)
-	{
-		if (tile == Unused)
-			tile = '.';
-		else if (tile == Floor || tile == Corridor)
-		{
-			tile = ' ';
-			m_tileCount++;
-		}
-		else
-		{
-            m_tileCount++;
-		}
-	}
-
-    // Close the file.
-	fout.close();
-
-	return result;
-}
-
-
 void GameWorld::PrintWorld()
 {
-	ofstream fout;
-
-	// Open the output map file
-	fout.open("game_world.txt");
-
-	for (int y = m_procWorldWidth-1; y >= 0; --y)
-	{
-		for (int x = 0; x < m_procWorldLength; ++x)
-			fout << GetTile(x, y);
-
-		fout << std::endl;
-	}
+	// Write out the map of the current floor
+	m_floor.PrintWorld("game_world.txt", m_seed);
 
-	// Close the file.
-	fout.close();
+	return;
 }
 
 
 char GameWorld::GetTile(int x, int y)
 {
-	if (x < 0 || y < 0 || x >= m_procWorldLength || y >= m_procWorldWidth)
-		return Unused;
-
-	return m_tiles[x + y * m_procWorldLength];
-}
-
-
-void GameWorld::SetTile(int x, int y, char tile)
-{
-    m_tiles[x + y * m_procWorldLength] = tile;
-}
-
-
-bool GameWorld::CreateFeature()
-{
-    for (int i = 0; i < 1000; i++)
-	{
-		if (m_exits.empty())
-			break;
-
-		// choose a random side of a random room or corridor
-		int r = Gumshoe::RandomInt((int)m_exits.size());
-		int x = Gumshoe::RandomInt(m_exits[r].x, m_exits[r].x + m_exits[r].xSize - 1);
-		int y = Gumshoe::RandomInt(m_exits[r].y, m_exits[r].y + m_exits[r].ySize - 1);
-
-		// north, south, west, east
-		for (int j = 0; j < DirectionCount; ++j)
-		{
-			if (CreateFeature(x, y, static_cast<Direction>(j)))
-			{
-				m_exits.erase(m_exits.begin() + r);
-				return true;
-			}
-		}
-	}
-
-	return false;
-}
-
-bool GameWorld::CreateFeature(int x, int y, Direction dir)
-{
-	static const int roomChance = 50; // corridorChance = 100 - roomChance
-
-	int dx = 0;
-	int dy = 0;
-
-	if (dir == North)
-		dy = 1;
-	else if (dir == South)
-		dy = -1;
-	else if (dir == West)
-		dx = 1;
-	else if (dir == East)
-		dx = -1;
-
-	if (GetTile(x + dx, y + dy) != Floor && GetTile(x + dx, y + dy) != Corridor)
-		return false;
-
-	if (Gumshoe::RandomInt(100) < roomChance)
-	{
-		if (MakeRoom(x, y, dir, false))
-		{
-			SetTile(x, y, ClosedDoor);
-			return true;
-		}
-	}
-    else
-	{
-		if (MakeCorridor(x, y, dir))
-		{
-			if (GetTile(x + dx, y + dy) == Floor)
-				SetTile(x, y, ClosedDoor);
-			else // don't place a door between corridors
-				SetTile(x, y, Corridor);
-			return true;
-		}
-	}
-
-	return false;
-}
-
-
-bool GameWorld::MakeRoom(int x, int y, Direction dir, bool firstRoom)
-{
-	static const int minRoomSize = 3;
-	static const int maxRoomSize = 6;
-
-	Rect room;
-	room.xSize = Gumshoe::RandomInt(minRoomSize, maxRoomSize);
-	room.ySize = Gumshoe::RandomInt(minRoomSize, maxRoomSize);
-
-	if (dir == North)
-	{
-		room.x = x - room.xSize / 2;
-		room.y = y - room.ySize;
-	}
-
-	else if (dir == South)
-	{
-		room.x = x - room.xSize / 2;
-		room.y = y + 1;
-	}
-
-	else if (dir == West)
-	{
-		room.x = x - room.xSize;
-		room.y = y - room.ySize / 2;
-	}
-
-	else if (dir == East)
-	{
-		room.x = x + 1;
-		room.y = y - room.ySize / 2;
-	}
-
-	if (PlaceRect(room, Floor))
-	{
-		m_rooms.push_back(room);
-
-		// Put exits in the room
-		if (dir != South || firstRoom) // north side
-			m_exits.push_back(Rect{ room.x, room.y - 1, room.xSize, 1 });
-		if (dir != North || firstRoom) // south side
-			m_exits.push_back(Rect{ room.x, room.y + room.ySize, room.xSize, 1 });
-		if (dir != East || firstRoom)  // west side
-			m_exits.push_back(Rect{ room.x - 1, room.y, 1, room.ySize });
-		if (dir != West || firstRoom)  // east side
-			m_exits.push_back(Rect{ room.x + room.xSize, room.y, 1, room.ySize });
-
-		return true;
-	}
-
-	return false;
-}
-
-
-bool GameWorld::MakeCorridor(int x, int y, Direction dir)
-{
-	static const int minCorridorLength = 3;
-	static const int maxCorridorLength = 6;
-
-	Rect corridor;
-	corridor.x = x;
-	corridor.y = y;
-
-	if (Gumshoe::RandomBool()) // horizontal corridor
-	{
-		corridor.xSize = Gumshoe::RandomInt(minCorridorLength, maxCorridorLength);
-		corridor.ySize = 1;
-
-		if (dir == North)
-		{
-			corridor.y = y - 1;
-
-			if (Gumshoe::RandomBool()) // west
-				corridor.x = x - corridor.xSize + 1;
-		}
-
-		else if (dir == South)
-		{
-			corridor.y = y + 1;
-
-			if (Gumshoe::RandomBool()) // west
-				corridor.x = x - corridor.xSize + 1;
-		}
-
-		else if (dir == West)
-			corridor.x = x - corridor.xSize;
-
-		else if (dir == East)
-			corridor.x = x + 1;
-	}
-
-	else // vertical corridor
-	{
-		corridor.xSize = 1;
-		corridor.ySize = Gumshoe::RandomInt(minCorridorLength, maxCorridorLength);
-
-		if (dir == North)
-			corridor.y = y - corridor.ySize;
-
-		else if (dir == South)
-			corridor.y = y + 1;
-
-		else if (dir == West)
-		{
-			corridor.x = x - 1;
-
-			if (Gumshoe::RandomBool()) // north
-				corridor.y = y - corridor.ySize + 1;
-		}
-
-		else if (dir == East)
-		{
-			corridor.x = x + 1;
-
-			if (Gumshoe::RandomBool()) // north
-				corridor.y = y - corridor.ySize + 1;
-		}
-	}
-
-	if (PlaceRect(corridor, Corridor))
-	{
-		if (dir != South && corridor.xSize != 1) // north side
-			m_exits.emplace_back(Rect{ corridor.x, corridor.y - 1, corridor.xSize, 1 });
-		if (dir != North && corridor.xSize != 1) // south side
-			m_exits.emplace_back(Rect{ corridor.x, corridor.y + corridor.ySize, corridor.xSize, 1 });
-		if (dir != East && corridor.ySize != 1)   // west side
-			m_exits.emplace_back(Rect{ corridor.x - 1, corridor.y, 1, corridor.ySize });
-		if (dir != West && corridor.ySize != 1)   // east side
-			m_exits.emplace_back(Rect{ corridor.x + corridor.xSize, corridor.y, 1, corridor.ySize });
-
-		return true;
-	}
-
-	return false;
-}
-
-
-bool GameWorld::PlaceRect(const Rect& rect, char tile)
-{
-	if (rect.x < 1 || rect.y < 1 || rect.x + rect.xSize >= m_procWorldLength - 1 || rect.y + rect.ySize >= m_procWorldWidth - 1)
-		return false;
-
-    // Loop through the current Rect tiles to make sure it is all in unused space
-	for (int y = rect.y; y < rect.y + rect.ySize; ++y)
-		for (int x = rect.x; x < rect.x + rect.xSize; ++x)
-		{
-			if (GetTile(x, y) != Unused)
-				return false; // the area already used
-		}
-
-	// Now place the Rect, putting walls at the edges
-	for (int y = rect.y - 1; y < rect.y + rect.ySize + 1; ++y)
-		for (int x = rect.x - 1; x < rect.x + rect.xSize + 1; ++x)
-		{
-			if (x == rect.x - 1 || y == rect.y - 1 || x == rect.x + rect.xSize || y == rect.y + rect.ySize)
-				SetTile(x, y, Wall);
-			else
-				SetTile(x, y, tile);
-		}
-
-	return true;
-}
-
-
-bool GameWorld::PlaceObject(char tile)
-{
-	if (m_rooms.empty())
-		return false;
-
-	int r = Gumshoe::RandomInt((int)m_rooms.size()); // choose a random room
-	int x = Gumshoe::RandomInt(m_rooms[r].x + 1, m_rooms[r].x + m_rooms[r].xSize - 2);
-	int y = Gumshoe::RandomInt(m_rooms[r].y + 1, m_rooms[r].y + m_rooms[r].ySize - 2);
-
-	if (GetTile(x, y) == Floor)
-	{
-		SetTile(x, y, tile);
-
-		// remove that room from the vector so that there is only 1 item per room
-		// TODO(ebd): This method should be changed later on
-		m_rooms.erase(m_rooms.begin() + r);
-
-		return true;
-	}
-
-	return false;
+	return m_floor.GetTile(x, y);
 }
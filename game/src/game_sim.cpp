@@ -0,0 +1,169 @@
+/*!
+  @file
+  game_sim.cpp
+
+  @brief
+  The part of the game that runs on fixed steps: the player and the
+  entities on the current floor.
+
+  @detail
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "game_sim.h"
+
+
+GameSim::GameSim()
+{
+	m_collider = nullptr;
+	m_entities = nullptr;
+	m_physics = nullptr;
+	m_playerId = ENTITY_STORE_NONE;
+	m_playerRotation = {0.0f, 0.0f, 0.0f};
+	m_stepMs = 0.0f;
+	m_stepCount = 0;
+}
+
+
+GameSim::~GameSim()
+{
+}
+
+
+bool GameSim::Init(Gumshoe::Physics::TileCollider* collider, Gumshoe::EntityStore* entities, Gumshoe::Vector3_t spawn, float stepMs, Gumshoe::Physics::Movement* physics)
+{
+	if (!collider || stepMs <= 0.0f)
+	{
+		return false;
+	}
+
+	if (!m_player.Init(1))
+	{
+		return false;
+	}
+
+	m_playerId = m_player.Add(spawn, 0.5f*PLAYER_AABB, WALK_SPEED);
+	m_collider = collider;
+	m_entities = entities;
+	m_physics = physics;
+	m_playerRotation = {0.0f, 0.0f, 0.0f};
+	m_stepMs = stepMs;
+	m_stepCount = 0;
+
+	return true;
+}
+
+
+void GameSim::Shutdown()
+{
+	m_player.Shutdown();
+	m_playerId = ENTITY_STORE_NONE;
+	m_collider = nullptr;
+	m_entities = nullptr;
+	m_physics = nullptr;
+
+	return;
+}
+
+
+void GameSim::Step(const Gumshoe::InputLog::simInput_t& input)
+{
+	Gumshoe::Vector3_t playerMove = {0.0f, 0.0f, 0.0f};
+
+
+	// The buttons map to a move the same way the keys did
+	if (input.buttons & Gumshoe::InputLog::ButtonForward)
+		playerMove.z += 1.0f;
+	if (input.buttons & Gumshoe::InputLog::ButtonBack)
+		playerMove.z -= 1.0f;
+	if (input.buttons & Gumshoe::InputLog::ButtonLeft)
+		playerMove.x -= 1.0f;
+	if (input.buttons & Gumshoe::InputLog::ButtonRight)
+		playerMove.x += 1.0f;
+	if (input.buttons & Gumshoe::InputLog::ButtonJump)
+		playerMove.y += 1.0f;
+
+	m_player.SetMoveAccel(m_playerId, playerMove);
+	m_player.Update(m_stepMs, m_collider);
+
+	// Same as Entity::Rotate
+	m_playerRotation.x += (float)input.lookY/2;
+	m_playerRotation.y += (float)input.lookX/2;
+
+	if (m_entities)
+	{
+		m_entities->Update(m_stepMs, m_collider);
+	}
+
+	if (m_physics)
+	{
+		m_physics->Step(m_stepMs);
+	}
+
+	m_stepCount++;
+
+	return;
+}
+
+
+uint32 GameSim::GetStepCount()
+{
+	return m_stepCount;
+}
+
+
+void GameSim::GetPlayerPosition(float alpha, Gumshoe::Vector3_t& position)
+{
+	m_player.GetRenderPosition(m_playerId, alpha, position);
+
+	return;
+}
+
+
+Gumshoe::Vector3_t GameSim::GetPlayerRotation()
+{
+	return m_playerRotation;
+}
+
+
+uint64 GameSim::GetStateHash()
+{
+	uint64 hash = 0xCBF29CE484222325ULL;
+	Gumshoe::Vector3_t state[3];
+
+
+	// FNV-1a over the bits of everything a step changes, any difference in any step shows up here
+	m_player.GetPosition(m_playerId, state[0]);
+	m_player.GetVelocity(m_playerId, state[1]);
+	state[2] = m_playerRotation;
+
+	const uint8* bytes = (const uint8*)state;
+	for (size_t i = 0; i < sizeof(state); i++)
+		hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+
+	if (m_entities)
+	{
+		const float* positions[3] = { m_entities->GetPositionsX(), m_entities->GetPositionsY(), m_entities->GetPositionsZ() };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			bytes = (const uint8*)positions[axis];
+			for (size_t i = 0; i < sizeof(float)*m_entities->GetCount(); i++)
+				hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+		}
+	}
+
+	if (m_physics)
+	{
+		const float* positions[3] = { m_physics->GetPositionsX(), m_physics->GetPositionsY(), m_physics->GetPositionsZ() };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			bytes = (const uint8*)positions[axis];
+			for (size_t i = 0; i < sizeof(float)*m_physics->GetBodyCount(); i++)
+				hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+		}
+	}
+
+	return hash;
+}
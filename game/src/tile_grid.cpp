@@ -0,0 +1,225 @@
+/*!
+  @file
+  tile_grid.cpp
+
+  @brief
+  Storage for a 2D map of tiles, in one of a few memory layouts.
+
+  @detail
+  Blocked storage is padded to whole blocks, and Morton storage to a power
+  of two square (Z-order up to 65536 tiles a side), so every position in the
+  map has its own index.
+*/
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "tile_grid.h"
+#include <string.h>
+
+
+TileGrid::TileGrid()
+{
+	m_layout = RowMajor;
+	m_length = 0;
+	m_width = 0;
+	m_blocksPerRow = 0;
+}
+
+
+TileGrid::~TileGrid()
+{
+}
+
+
+void TileGrid::Init(int length, int width, char fill, Layout layout)
+{
+	m_length = length;
+	m_width = width;
+	Resize(layout, fill);
+
+	return;
+}
+
+
+void TileGrid::Assign(const std::vector<char>& tiles, int length, int width, Layout layout)
+{
+	m_length = length;
+	m_width = width;
+
+	// Row-major input goes straight in
+	if (layout == RowMajor)
+	{
+		m_layout = RowMajor;
+		m_blocksPerRow = 0;
+		m_tiles.assign(tiles.begin(), tiles.begin() + (size_t)length * width);
+		return;
+	}
+
+	Resize(layout, tiles.empty() ? 0 : tiles[0]);
+	for (int y = 0; y < m_width; y++)
+	{
+		const char* row = &tiles[(size_t)y * m_length];
+
+		for (int x = 0; x < m_length; x++)
+		{
+			Set(x, y, row[x]);
+		}
+	}
+
+	return;
+}
+
+
+void TileGrid::SetLayout(Layout layout)
+{
+	std::vector<char> rowMajor((size_t)m_length * m_width);
+	std::vector<char> rowBuffer(m_length);
+
+
+	if (layout == m_layout)
+	{
+		return;
+	}
+
+	for (int y = 0; y < m_width; y++)
+	{
+		memcpy(&rowMajor[(size_t)y * m_length], GetRow(y, rowBuffer.data()), m_length);
+	}
+
+	Assign(rowMajor, m_length, m_width, layout);
+
+	return;
+}
+
+
+TileGrid::Layout TileGrid::GetLayout()
+{
+	return m_layout;
+}
+
+
+const char* TileGrid::GetLayoutName(Layout layout)
+{
+	static const char* names[LayoutCount] = { "row-major", "8x8 blocks", "Morton" };
+
+	return (layout < LayoutCount) ? names[layout] : "unknown";
+}
+
+
+int TileGrid::GetLength()
+{
+	return m_length;
+}
+
+
+int TileGrid::GetWidth()
+{
+	return m_width;
+}
+
+
+uint64 TileGrid::GetMemoryBytes()
+{
+	return (uint64)m_tiles.size();
+}
+
+
+const char* TileGrid::GetRow(int y, char* buffer)
+{
+	// Row-major rows are already in one piece, the other layouts copy the row out
+	if (m_layout == RowMajor)
+	{
+		return &m_tiles[(size_t)y * m_length];
+	}
+
+	GetRect(0, y, m_length, 1, buffer);
+
+	return buffer;
+}
+
+
+void TileGrid::GetRect(int x, int y, int columns, int rows, char* buffer)
+{
+	int row, column, count;
+
+
+	switch (m_layout)
+	{
+	case Blocked:
+		// A block's row of tiles is up to eight in a row in memory
+		for (row = y; row < y + rows; row++)
+		{
+			for (column = x; column < x + columns; column += count)
+			{
+				count = TILE_GRID_BLOCK_SIZE - (column & (TILE_GRID_BLOCK_SIZE - 1));
+				count = (x + columns - column < count) ? x + columns - column : count;
+				memcpy(buffer, &m_tiles[GetIndex(column, row)], count);
+				buffer += count;
+			}
+		}
+		break;
+
+	case Morton:
+		{
+			// Step the interleaved coordinates with a carry through the other axis' bits
+			uint32 yBits = SpreadBits((uint32)y) << 1;
+			uint32 firstXBits = SpreadBits((uint32)x);
+
+			for (row = 0; row < rows; row++)
+			{
+				uint32 xBits = firstXBits;
+				for (column = 0; column < columns; column++)
+				{
+					*buffer++ = m_tiles[xBits | yBits];
+					xBits = ((xBits | 0xAAAAAAAA) + 1) & 0x55555555;
+				}
+				yBits = ((yBits | 0x55555555) + 1) & 0xAAAAAAAA;
+			}
+		}
+		break;
+
+	default:
+		for (row = y; row < y + rows; row++)
+		{
+			memcpy(buffer, &m_tiles[(size_t)row * m_length + x], columns);
+			buffer += columns;
+		}
+		break;
+	}
+
+	return;
+}
+
+
+void TileGrid::Resize(Layout layout, char fill)
+{
+	int side;
+
+
+	m_layout = layout;
+	m_blocksPerRow = 0;
+
+	switch (layout)
+	{
+	case Blocked:
+		m_blocksPerRow = (m_length + TILE_GRID_BLOCK_SIZE - 1) >> TILE_GRID_BLOCK_BITS;
+		m_tiles.assign((size_t)m_blocksPerRow * ((m_width + TILE_GRID_BLOCK_SIZE - 1) >> TILE_GRID_BLOCK_BITS) *
+		               TILE_GRID_BLOCK_SIZE * TILE_GRID_BLOCK_SIZE, fill);
+		break;
+
+	case Morton:
+		side = 1;
+		while (side < m_length || side < m_width)
+			side <<= 1;
+		m_tiles.assign((size_t)side * side, fill);
+		break;
+
+	default:
+		m_layout = RowMajor;
+		m_tiles.assign((size_t)m_length * m_width, fill);
+		break;
+	}
+
+	return;
+}
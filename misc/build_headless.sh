@@ -0,0 +1,24 @@
+#!/bin/sh
+
+# Headless (no DirectX) build for Linux build servers.
+# Builds the portable engine/game code into a static library plus the command line tools.
+
+CommonCompilerFlags="-std=c++14 -O2 -g -Wall -Werror -Wno-unused-variable -Wno-unused-function -pthread -DBUILD_DEBUG=0 -DBUILD_WIN32=0"
+IncludeDirs="-I ../engine/common -I ../engine/core/inc -I ../engine/core/src -I ../game/inc -I ../game/src"
+
+HeadlessSources="../engine/core/src/job_pool.cpp ../engine/core/src/frustum.cpp ../engine/core/src/quadtree.cpp ../engine/core/src/spatial_hash.cpp ../engine/core/src/physics_tile_collider.cpp ../engine/core/src/physics_aabb.cpp ../engine/core/src/physics_movement.cpp ../engine/core/src/entity_store.cpp ../engine/core/src/sim_scheduler.cpp ../engine/core/src/input_log.cpp ../game/src/dungeon_gen.cpp ../game/src/dungeon_chunks.cpp ../game/src/tile_grid.cpp ../game/src/dungeon_floor.cpp ../game/src/game_sim.cpp"
+
+mkdir -p ../build
+cd ../build || exit 1
+
+# -- BUILD THE HEADLESS LIBRARY --
+rm -f *.o libgumshoe_headless.a
+for source in $HeadlessSources; do
+	g++ $CommonCompilerFlags $IncludeDirs -c $source -o $(basename $source .cpp).o || exit 1
+done
+ar rcs libgumshoe_headless.a *.o || exit 1
+
+# -- BUILD THE TOOLS --
+g++ $CommonCompilerFlags $IncludeDirs ../util/dungeon_gen_tool.cpp -L. -lgumshoe_headless -o dungeon_gen || exit 1
+g++ $CommonCompilerFlags $IncludeDirs ../util/gumshoe_bench.cpp -L. -lgumshoe_headless -o gumshoe_bench || exit 1
+g++ $CommonCompilerFlags $IncludeDirs ../util/gumshoe_replay.cpp -L. -lgumshoe_headless -o gumshoe_replay || exit 1
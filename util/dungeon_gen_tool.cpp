@@ -0,0 +1,105 @@
+/*!
+  @file
+  dungeon_gen_tool.cpp
+
+  @brief
+  Headless dungeon generator and validator.
+
+  @detail
+  Generates dungeons from seeds without any DirectX dependencies.
+  Usage: dungeon_gen [first seed] [seed count] [length] [width] [max features] [-print]
+  Every level is validated, and the seeds that fail are reported so they can be bisected.
+*/
+
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "dungeon_gen.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+int main(int argc, char** argv)
+{
+	uint64 firstSeed = 1;
+	int seedCount = 1000;
+	int length = DEFAULT_WORLD_SIZE;
+	int width = DEFAULT_WORLD_SIZE;
+	int maxFeatures = DEFAULT_MAX_FEATURES;
+	bool print = false;
+	int failures = 0;
+	uint64 featureTotal = 0;
+	uint64 probeTotal = 0;
+	uint64 rejectTotal = 0;
+	DungeonGenerator generator;
+
+
+	// Read in the command line arguments, in order.
+	int argIndex = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-print") == 0)
+		{
+			print = true;
+			continue;
+		}
+
+		switch (argIndex++)
+		{
+			case 0: firstSeed = strtoull(argv[i], nullptr, 10); break;
+			case 1: seedCount = atoi(argv[i]); break;
+			case 2: length = atoi(argv[i]); break;
+			case 3: width = atoi(argv[i]); break;
+			case 4: maxFeatures = atoi(argv[i]); break;
+		}
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	for (int i = 0; i < seedCount; i++)
+	{
+		uint64 seed = firstSeed + (uint64)i;
+
+		// Generate and validate the level for this seed.
+		bool result = generator.Generate(seed, length, width, maxFeatures);
+		if (result)
+		{
+			result = generator.Validate();
+		}
+
+		if (!result)
+		{
+			printf("seed %llu: %s\n", (unsigned long long)seed, generator.GetError());
+			failures++;
+		}
+
+		featureTotal += (uint64)generator.GetFeatureCount();
+		probeTotal += generator.GetStats().probes;
+		rejectTotal += generator.GetStats().rejects;
+
+		if (print)
+		{
+			printf("seed %llu (%d rooms, %d open exits)\n", (unsigned long long)seed,
+			       (int)generator.GetRooms().size(), (int)generator.GetExits().size());
+			for (int y = width-1; y >= 0; --y)
+			{
+				for (int x = 0; x < length; ++x)
+					putchar(generator.GetTile(x, y));
+				putchar('\n');
+			}
+		}
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	printf("%d levels (%dx%d, %d max features): %d failed, %.1f features/level, %.3f ms total, %.1f levels/s\n",
+	       seedCount, length, width, maxFeatures, failures,
+	       (seedCount > 0) ? (double)featureTotal / (double)seedCount : 0.0,
+	       elapsed.count(), (elapsed.count() > 0.0) ? (1000.0 * seedCount) / elapsed.count() : 0.0);
+	printf("%llu exit probes, %llu rejected features\n", (unsigned long long)probeTotal, (unsigned long long)rejectTotal);
+
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,3263 @@
+/*!
+  @file
+  gumshoe_bench.cpp
+
+  @brief
+  Headless micro-benchmarks for the Gumshoe Engine and the dungeon crawler.
+
+  @detail
+  Builds without DirectX so it can run on build servers.
+  Usage: gumshoe_bench [benchmark name]   (runs every benchmark when no name is given)
+  Exits with 1 when any of the yes/NO checks the benchmarks print comes out NO.
+*/
+
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include "gumshoe_math.h"
+#include "dungeon_gen.h"
+#include "dungeon_chunks.h"
+#include "dungeon_floor.h"
+#include "job_pool.h"
+#include "quadtree.h"
+#include "frustum.h"
+#include "spatial_hash.h"
+#include "physics_tile_collider.h"
+#include "physics_aabb.h"
+#include "physics_movement.h"
+#include "entity_store.h"
+#include "sim_scheduler.h"
+#include "input_log.h"
+#include "game_sim.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+
+//--------------------------------------------
+// Timing Helpers
+//--------------------------------------------
+typedef std::chrono::high_resolution_clock BenchClock;
+
+static double ElapsedMs(BenchClock::time_point start)
+{
+	std::chrono::duration<double, std::milli> elapsed = BenchClock::now() - start;
+	return elapsed.count();
+}
+
+static void ReportResult(const char* name, double ms, uint64 iterations)
+{
+	printf("  %-36s %10.3f ms  %10.2f ns/op\n", name, ms, (ms * 1000000.0) / (double)iterations);
+}
+
+
+//--------------------------------------------
+// Check Helpers
+//--------------------------------------------
+// Set by any check that fails, so a build server sees it in the exit code
+static bool g_checkFailed = false;
+
+static const char* Check(bool passed)
+{
+	if (!passed)
+		g_checkFailed = true;
+
+	return passed ? "yes" : "NO";
+}
+
+
+//--------------------------------------------
+// RNG Benchmark
+//--------------------------------------------
+// Copies of the original per-call RNG functions, kept for comparison
+static int LegacyRandomInt(int min, int max)
+{
+	std::random_device rd;
+	std::mt19937 mt(rd());
+
+	std::uniform_int_distribution<> dist(0, max - min);
+	return dist(mt) + min;
+}
+
+static bool LegacyRandomBool(double probability = 0.5)
+{
+	std::random_device rd;
+	std::mt19937 mt(rd());
+
+	std::bernoulli_distribution dist(probability);
+	return dist(mt);
+}
+
+static void BenchRandom()
+{
+	const uint64 legacyIterations = 20000;
+	const uint64 iterations = 20000000;
+	volatile int sink = 0;
+
+	printf("random:\n");
+
+	BenchClock::time_point start = BenchClock::now();
+	for (uint64 i = 0; i < legacyIterations; i++)
+	{
+		sink += LegacyRandomInt(3, 6);
+		sink += LegacyRandomBool() ? 1 : 0;
+	}
+	ReportResult("legacy RandomInt+RandomBool", ElapsedMs(start), legacyIterations);
+
+	Gumshoe::Random random(1234);
+	start = BenchClock::now();
+	for (uint64 i = 0; i < iterations; i++)
+	{
+		sink += random.RandomInt(3, 6);
+		sink += random.RandomBool() ? 1 : 0;
+	}
+	ReportResult("Random::RandomInt+RandomBool", ElapsedMs(start), iterations);
+
+	start = BenchClock::now();
+	for (uint64 i = 0; i < 1000; i++)
+	{
+		Gumshoe::Random stream = random.Split();
+		sink += (int)stream.NextUint32();
+	}
+	ReportResult("Random::Split", ElapsedMs(start), 1000);
+
+	// Make sure a fixed seed is reproducible
+	Gumshoe::Random a(42), b(42);
+	bool match = true;
+	for (int i = 0; i < 1000; i++)
+	{
+		if (a.RandomInt(0, 95) != b.RandomInt(0, 95))
+			match = false;
+	}
+	printf("  seeded streams reproducible: %s\n", Check(match));
+}
+
+
+//--------------------------------------------
+// Dungeon Generation Benchmark
+//--------------------------------------------
+static void BenchGenerate()
+{
+	const int sizes[][3] = { { 96, 96, 60 }, { 256, 256, 200 }, { 1024, 1024, 500 }, { 2048, 2048, 1000 }, { 2048, 2048, 10000 } };
+	DungeonGenerator generator;
+	char name[64];
+
+	printf("generate:\n");
+
+	for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+	{
+		int runs = (sizes[i][0] > 256) ? 4 : 100;
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int run = 0; run < runs; run++)
+		{
+			generator.Generate((uint64)run + 1, sizes[i][0], sizes[i][1], sizes[i][2]);
+		}
+
+		snprintf(name, sizeof(name), "%dx%d, %d features (%d placed)", sizes[i][0], sizes[i][1], sizes[i][2], generator.GetFeatureCount());
+		ReportResult(name, ElapsedMs(start) / runs, 1);
+
+		const DungeonGenerator::genStats_t& stats = generator.GetStats();
+		printf("    last run: %llu probes, %llu rejects, %u exits exhausted, %.3f ms\n",
+		       (unsigned long long)stats.probes, (unsigned long long)stats.rejects, stats.exhaustedExits, stats.timeMs);
+	}
+
+	// Compare the occupancy map rect test against scanning the tiles
+	generator.Generate(1, 1024, 1024, 500);
+	OccupancyMap occupancy;
+	occupancy.Init(1024, 1024);
+	for (int y = 0; y < 1024; y++)
+	{
+		for (int x = 0; x < 1024; x++)
+		{
+			if (generator.GetTile(x, y) != DungeonGenerator::Unused)
+				occupancy.Set(x, y);
+		}
+	}
+
+	const int rectCount = 200000;
+	Gumshoe::Random random(7);
+	std::vector<DungeonGenerator::Rect> rects(rectCount);
+	for (int i = 0; i < rectCount; i++)
+	{
+		rects[i].xSize = random.RandomInt(1, 24);
+		rects[i].ySize = random.RandomInt(1, 24);
+		rects[i].x = random.RandomInt(0, 1023 - rects[i].xSize);
+		rects[i].y = random.RandomInt(0, 1023 - rects[i].ySize);
+	}
+
+	int scanFree = 0;
+	BenchClock::time_point start = BenchClock::now();
+	for (int i = 0; i < rectCount; i++)
+	{
+		bool free = true;
+		for (int y = rects[i].y; y < rects[i].y + rects[i].ySize && free; ++y)
+			for (int x = rects[i].x; x < rects[i].x + rects[i].xSize; ++x)
+			{
+				if (generator.GetTile(x, y) != DungeonGenerator::Unused)
+				{
+					free = false;
+					break;
+				}
+			}
+		scanFree += free ? 1 : 0;
+	}
+	ReportResult("rect test, tile scan", ElapsedMs(start), rectCount);
+
+	int bitmapFree = 0;
+	start = BenchClock::now();
+	for (int i = 0; i < rectCount; i++)
+	{
+		bitmapFree += occupancy.IsRectFree(rects[i].x, rects[i].y, rects[i].xSize, rects[i].ySize) ? 1 : 0;
+	}
+	ReportResult("rect test, occupancy map", ElapsedMs(start), rectCount);
+	printf("  results match: %s\n", Check(scanFree == bitmapFree));
+
+	// The smallest world the generator takes has to fit the first room whichever way it faces
+	int roomlessSeeds = 0;
+	int smallFailures = 0;
+	for (uint64 seed = 1; seed <= 10000; seed++)
+	{
+		if (!generator.Generate(seed, MIN_WORLD_SIZE, MIN_WORLD_SIZE, 10))
+			smallFailures++;
+		if (generator.GetRooms().empty())
+			roomlessSeeds++;
+	}
+	printf("  %dx%d worlds: %d of 10000 seeds fail (too few rooms for both stairs)\n", MIN_WORLD_SIZE, MIN_WORLD_SIZE, smallFailures);
+	printf("  the first room fits at the smallest world size: %s\n", Check(roomlessSeeds == 0));
+}
+
+
+//--------------------------------------------
+// Chunked World Benchmark
+//--------------------------------------------
+static void BenchChunks()
+{
+	const int walkSteps = 20000;
+	const int windowSteps = 5000;
+	const int blockChunks = 8;
+	ChunkedWorld world;
+	Gumshoe::Random random(99);
+	int floor = 0;
+	int x = 0, y = 0;
+	int floorChanges = 0;
+	uint64 maxResidentBytes = 0;
+
+	printf("chunks:\n");
+
+	world.Init(1, DEFAULT_CHUNK_BUDGET);
+	if (!world.GetEntranceLocation(x, y))
+	{
+		printf("  no entrance\n");
+		return;
+	}
+
+	// Sweep the player east through the dungeon, dropping a floor every few hundred steps.
+	// Streaming only cares where the player is, so walls are ignored here.
+	BenchClock::time_point start = BenchClock::now();
+	for (int step = 0; step < walkSteps; step++)
+	{
+		world.UpdateAround(floor, x, y, 1);
+
+		x += 4;
+		y += random.RandomInt(-2, 2);
+		if (step % 500 == 499)
+		{
+			floor++;
+			floorChanges++;
+		}
+
+		if (world.GetStats().residentBytes > maxResidentBytes)
+			maxResidentBytes = world.GetStats().residentBytes;
+	}
+	double ms = ElapsedMs(start);
+
+	const ChunkedWorld::chunkStats_t& stats = world.GetStats();
+	ReportResult("walk, per chunk generated", ms, stats.generatedChunks);
+	printf("    %d steps, ended on floor %d at (%d, %d), %d floor changes\n", walkSteps, floor, x, y, floorChanges);
+	printf("    %llu generated, %llu evicted, %u resident, %llu KB peak (budget %u chunks)\n",
+	       (unsigned long long)stats.generatedChunks, (unsigned long long)stats.evictedChunks, stats.residentChunks,
+	       (unsigned long long)(maxResidentBytes / 1024), DEFAULT_CHUNK_BUDGET);
+
+	// An evicted chunk has to come back exactly as it was
+	ChunkedWorld fresh;
+	fresh.Init(1, DEFAULT_CHUNK_BUDGET);
+	bool match = true;
+	for (int i = 0; i < 4096 && match; i++)
+	{
+		int tileX = random.RandomInt(-4 * CHUNK_SIZE, 4 * CHUNK_SIZE);
+		int tileY = random.RandomInt(-4 * CHUNK_SIZE, 4 * CHUNK_SIZE);
+		match = (world.GetTile(0, tileX, tileY) == fresh.GetTile(0, tileX, tileY));
+	}
+	printf("  regenerated chunks match: %s\n", Check(match));
+
+	// Every walkable tile in a block of chunks has to be reachable from the entrance
+	const int blockSize = blockChunks * CHUNK_SIZE;
+	std::vector<char> block(blockSize * blockSize);
+	std::vector<uint8> reached(blockSize * blockSize, 0);
+	std::vector<int> open;
+	for (int tileY = 0; tileY < blockSize; tileY++)
+		for (int tileX = 0; tileX < blockSize; tileX++)
+			block[tileX + tileY * blockSize] = fresh.GetTile(0, tileX, tileY);
+
+	fresh.GetEntranceLocation(x, y);
+	open.push_back(x + y * blockSize);
+	reached[x + y * blockSize] = 1;
+	while (!open.empty())
+	{
+		int index = open.back();
+		open.pop_back();
+
+		const int neighbours[4] = { index - 1, index + 1, index - blockSize, index + blockSize };
+		for (int i = 0; i < 4; i++)
+		{
+			int n = neighbours[i];
+			if (n < 0 || n >= blockSize * blockSize || (i < 2 && n / blockSize != index / blockSize))
+				continue;
+			if (reached[n] || block[n] == DungeonGenerator::Unused || block[n] == DungeonGenerator::Wall)
+				continue;
+			reached[n] = 1;
+			open.push_back(n);
+		}
+	}
+
+	int unreached = 0;
+	for (int i = 0; i < blockSize * blockSize; i++)
+	{
+		if (!reached[i] && block[i] != DungeonGenerator::Unused && block[i] != DungeonGenerator::Wall)
+			unreached++;
+	}
+	printf("  %dx%d chunks connected: %s (%d tiles unreached)\n", blockChunks, blockChunks, Check(unreached == 0), unreached);
+
+	// Down the stairs and back up again should land on the same tile
+	bool linked = true;
+	for (int chunkX = 0; chunkX < blockChunks; chunkX++)
+	{
+		for (int tileY = 0; tileY < CHUNK_SIZE; tileY++)
+			for (int tileX = chunkX * CHUNK_SIZE; tileX < (chunkX + 1) * CHUNK_SIZE; tileX++)
+			{
+				int downFloor, downX, downY, upFloor, upX, upY;
+				if (fresh.GetTile(2, tileX, tileY) != DungeonGenerator::DownStairs)
+					continue;
+				if (!fresh.FindStairsLink(2, tileX, tileY, downFloor, downX, downY) ||
+				    !fresh.FindStairsLink(downFloor, downX, downY, upFloor, upX, upY) ||
+				    upFloor != 2 || upX != tileX || upY != tileY)
+					linked = false;
+			}
+	}
+	printf("  stairs link both ways: %s\n", Check(linked));
+
+	// GameWorld's floor is a window of chunks around the player, built again further on when they near its edge
+	const int windowSize = CHUNK_WINDOW * CHUNK_SIZE;
+	ChunkedWorld streamed;
+	DungeonFloor window;
+	int windowX, windowY;
+	int windowMoves = 0;
+	double windowMs = 0.0;
+	bool windowMatches = true;
+
+	streamed.Init(1, DEFAULT_CHUNK_BUDGET);
+	streamed.GetEntranceLocation(x, y);
+	ChunkedWorld::GetWindowOrigin(x, y, windowX, windowY);
+	window.Build(streamed, 0, windowX, windowY, windowSize, windowSize);
+	maxResidentBytes = 0;
+	for (int step = 0; step < windowSteps; step++)
+	{
+		x += 1;
+		y += random.RandomInt(-1, 1);
+		streamed.UpdateAround(0, x, y, CHUNK_WINDOW / 2 + 1);
+		if (streamed.GetStats().residentBytes > maxResidentBytes)
+			maxResidentBytes = streamed.GetStats().residentBytes;
+
+		int localX = x - windowX;
+		int localY = y - windowY;
+		if (localX >= CHUNK_WINDOW_MARGIN && localY >= CHUNK_WINDOW_MARGIN &&
+		    localX < windowSize - CHUNK_WINDOW_MARGIN && localY < windowSize - CHUNK_WINDOW_MARGIN)
+			continue;
+
+		ChunkedWorld::GetWindowOrigin(x, y, windowX, windowY);
+		start = BenchClock::now();
+		window.Build(streamed, 0, windowX, windowY, windowSize, windowSize);
+		windowMs += ElapsedMs(start);
+		windowMoves++;
+
+		// The window's walls and open tiles are the chunks' ones
+		for (int i = 0; i < 1024; i++)
+		{
+			int tileX = random.RandomInt(windowSize);
+			int tileY = random.RandomInt(windowSize);
+			char tile = streamed.GetTile(0, windowX + tileX, windowY + tileY);
+			bool solid = (tile == DungeonGenerator::Unused || tile == DungeonGenerator::Wall);
+			if (DungeonFloor::IsSolid(window.GetTile(tileX, tileY)) != solid)
+				windowMatches = false;
+		}
+	}
+	ReportResult("window floor build", windowMs, (windowMoves > 0) ? windowMoves : 1);
+	printf("    %d tiles walked, %d window moves, %llu KB of chunks resident at most\n", windowSteps, windowMoves,
+	       (unsigned long long)(maxResidentBytes / 1024));
+	printf("  window floors match the chunks: %s\n", Check(windowMatches && windowMoves > 0));
+}
+
+
+//--------------------------------------------
+// Parallel Floor Build Benchmark
+//--------------------------------------------
+struct benchFloorJob_t
+{
+	DungeonFloor* floor;
+	Gumshoe::Random random;
+	bool result;
+};
+
+static void BenchFloorJob(void* data)
+{
+	benchFloorJob_t* job = (benchFloorJob_t*)data;
+	job->result = job->floor->Build(job->random, DEFAULT_WORLD_SIZE, DEFAULT_WORLD_SIZE, DEFAULT_MAX_FEATURES);
+}
+
+// A job on one pool that hands work to another pool and waits for it
+struct benchNestedJob_t
+{
+	Gumshoe::JobPool* pool;
+	uint32 result;
+};
+
+static void BenchSquareJob(void* data)
+{
+	uint32* value = (uint32*)data;
+	*value = *value * *value;
+}
+
+static void BenchNestedJob(void* data)
+{
+	benchNestedJob_t* job = (benchNestedJob_t*)data;
+	Gumshoe::JobCounter counter(0);
+	uint32 values[4] = { 1, 2, 3, 4 };
+
+	for (int i = 0; i < 4; i++)
+		job->pool->Submit(BenchSquareJob, &values[i], &counter);
+	job->pool->Wait(counter);
+
+	job->result = values[0] + values[1] + values[2] + values[3];
+}
+
+// FNV-1a over the maps and geometry of every floor
+static uint64 HashFloors(std::vector<DungeonFloor>& floors)
+{
+	uint64 hash = 0xCBF29CE484222325ULL;
+
+	for (size_t i = 0; i < floors.size(); i++)
+	{
+		for (int y = 0; y < floors[i].GetWidth(); y++)
+			for (int x = 0; x < floors[i].GetLength(); x++)
+				hash = (hash ^ (uint8)floors[i].GetTile(x, y)) * 0x100000001B3ULL;
+
+		const std::vector<DungeonFloor::floorVertex_t>& vertices = floors[i].GetVertices();
+		const uint8* bytes = (const uint8*)vertices.data();
+		for (size_t j = 0; j < vertices.size() * sizeof(DungeonFloor::floorVertex_t); j++)
+			hash = (hash ^ bytes[j]) * 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+static void BenchFloors()
+{
+	const int floorCount = 20;
+	const int workerCounts[] = { 0, 1, 3, 7 };
+	uint64 firstHash = 0;
+	bool match = true;
+	bool stairs = true;
+	char name[64];
+
+	printf("floors:\n");
+
+	for (int w = 0; w < (int)(sizeof(workerCounts) / sizeof(workerCounts[0])); w++)
+	{
+		Gumshoe::JobPool pool;
+		pool.Init(workerCounts[w]);
+
+		std::vector<DungeonFloor> floors(floorCount);
+		std::vector<benchFloorJob_t> jobs(floorCount);
+		Gumshoe::Random random(1234);
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int i = 0; i < floorCount; i++)
+		{
+			jobs[i].floor = &floors[i];
+			jobs[i].random = random.Split();
+			jobs[i].result = false;
+			pool.Submit(BenchFloorJob, &jobs[i]);
+		}
+		pool.Wait();
+		double ms = ElapsedMs(start);
+
+		snprintf(name, sizeof(name), "%d floors, %d workers (%llu stolen)", floorCount, workerCounts[w],
+		         (unsigned long long)pool.GetStats().jobsStolen);
+		ReportResult(name, ms, 1);
+
+		uint64 hash = HashFloors(floors);
+		if (w == 0)
+			firstHash = hash;
+		else if (hash != firstHash)
+			match = false;
+
+		// Every floor the generator makes has both kinds of stairs
+		for (int i = 0; i < floorCount; i++)
+		{
+			int x, z;
+			if (!floors[i].GetUpStairsLocation(x, z) || !floors[i].GetDownStairsLocation(x, z))
+				stairs = false;
+		}
+
+		pool.Shutdown();
+	}
+
+	printf("  same floors for every worker count: %s (%u hardware threads)\n", Check(match),
+	       std::thread::hardware_concurrency());
+	printf("  every floor has up and down stairs: %s\n", Check(stairs));
+
+	// Workers of a big pool submitting to and waiting on a pool without workers
+	Gumshoe::JobPool outerPool, innerPool;
+	benchNestedJob_t nested[16];
+	bool nestedDone = true;
+
+	outerPool.Init(7);
+	innerPool.Init(0);
+	for (int i = 0; i < 16; i++)
+	{
+		nested[i].pool = &innerPool;
+		nested[i].result = 0;
+		outerPool.Submit(BenchNestedJob, &nested[i]);
+	}
+	outerPool.Wait();
+
+	for (int i = 0; i < 16; i++)
+		nestedDone &= (nested[i].result == 30);
+
+	outerPool.Shutdown();
+	innerPool.Shutdown();
+
+	printf("  workers of one pool can wait on another: %s\n", Check(nestedDone));
+}
+
+
+//--------------------------------------------
+// Tile Classification Benchmark
+//--------------------------------------------
+// Copy of the branchy classifier GameWorld::GenerateWorld used before the feature table
+static void LegacyClassifyTiles(DungeonFloor& floor, std::vector<DungeonFloor::floorTile_t>& tiles)
+{
+	uint32 index;
+	uint32 tileCount = 0;
+
+
+	for (int y = 0; y < floor.GetWidth(); ++y)
+		for (int x = 0; x < floor.GetLength(); ++x)
+			if (floor.GetTile(x, y) != DungeonFloor::Empty)
+				tileCount++;
+
+	// Create the structure to hold the game world data.
+	tiles.assign(tileCount, DungeonFloor::floorTile_t());
+
+	// Work out which floor, wall and cap pieces each used tile needs from its neighbours
+	index = 0;
+	for (int y = 0; y < floor.GetWidth(); ++y)
+	{
+	  for (int x = 0; x < floor.GetLength(); ++x)
+	  {
+		char tile = floor.GetTile(x, y);
+		
+        // If the tile is used, fill the grid and increment the index
+		if (tile != '.')
+		{
+		  tiles[index].x = (uint16)x;
+          tiles[index].z = (uint16)y;
+
+		  tiles[index].geoFeatures = 0;
+
+		  // Get the adjacent tiles
+	      char northTile = floor.GetTile(x, y+1);
+	      char southTile = floor.GetTile(x, y-1);
+	      char eastTile  = floor.GetTile(x+1, y);
+	      char westTile  = floor.GetTile(x-1, y);
+	      char northEastTile = floor.GetTile(x+1, y+1);
+	      char southEastTile = floor.GetTile(x+1, y-1);
+	      char northWestTile = floor.GetTile(x-1, y+1);
+	      char southWestTile = floor.GetTile(x-1, y-1);
+
+		  if (tile == DungeonFloor::Wall)
+          {
+          	// Check each adjacent tile to set the floor features
+            if (northWestTile == ' ' || northWestTile == DungeonFloor::ClosedDoor)
+            {
+                tiles[index].geoFeatures |= DungeonFloor::NorthWestFloor;
+            }
+            
+            if (northEastTile == ' ' || northEastTile == DungeonFloor::ClosedDoor)
+            {
+                tiles[index].geoFeatures |= DungeonFloor::NorthEastFloor;
+            }
+
+            if (southWestTile == ' ' || southWestTile == DungeonFloor::ClosedDoor)
+            {
+                tiles[index].geoFeatures |= DungeonFloor::SouthWestFloor;
+            }
+
+            if (southEastTile == ' ' || southEastTile == DungeonFloor::ClosedDoor)
+            {
+                tiles[index].geoFeatures |= DungeonFloor::SouthEastFloor;
+            }
+
+            // Check the North tile to add walls
+            if (northTile == ' ')
+            {
+                tiles[index].geoFeatures |= DungeonFloor::NorthWestFloor;
+                tiles[index].geoFeatures |= DungeonFloor::NorthEastFloor;
+                tiles[index].geoFeatures |= DungeonFloor::WestWall;
+                tiles[index].geoFeatures |= DungeonFloor::EastWall;
+                if (eastTile == ' ')
+                	tiles[index].geoFeatures &= ~DungeonFloor::EastWall;
+                if (westTile == ' ')
+                	tiles[index].geoFeatures &= ~DungeonFloor::WestWall;
+            }
+            else if (northTile == DungeonFloor::ClosedDoor)
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::NorthWestFloor;
+                tiles[index].geoFeatures |= DungeonFloor::NorthEastFloor;
+                tiles[index].geoFeatures |= DungeonFloor::NorthWall;
+                tiles[index].geoFeatures |= DungeonFloor::NorthWallCap;
+            }
+            else if (northTile == DungeonFloor::Wall &&
+            	    ((tiles[index].geoFeatures & DungeonFloor::NorthEastFloor) || 
+            	     (tiles[index].geoFeatures & DungeonFloor::NorthWestFloor)))
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::NorthWall;
+            }
+
+            // Check the South tile to add walls
+            if (southTile == ' ')
+            {
+                tiles[index].geoFeatures |= DungeonFloor::SouthWestFloor;
+                tiles[index].geoFeatures |= DungeonFloor::SouthEastFloor;
+                tiles[index].geoFeatures |= DungeonFloor::WestWall;
+                tiles[index].geoFeatures |= DungeonFloor::EastWall;
+                if (eastTile == ' ')
+                	tiles[index].geoFeatures &= ~DungeonFloor::EastWall;
+                if (westTile == ' ')
+                	tiles[index].geoFeatures &= ~DungeonFloor::WestWall;
+            }
+            else if (southTile == DungeonFloor::ClosedDoor)
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::SouthWestFloor;
+                tiles[index].geoFeatures |= DungeonFloor::SouthEastFloor;
+                tiles[index].geoFeatures |= DungeonFloor::SouthWall;
+                tiles[index].geoFeatures |= DungeonFloor::SouthWallCap;
+            }
+            else if (southTile == DungeonFloor::Wall &&
+            	    ((tiles[index].geoFeatures & DungeonFloor::SouthEastFloor) || 
+            	     (tiles[index].geoFeatures & DungeonFloor::SouthWestFloor)))
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::SouthWall;
+            }
+
+          	// Check the East tile to add walls
+            if (eastTile == ' ')
+            {
+                tiles[index].geoFeatures |= DungeonFloor::NorthEastFloor;
+                tiles[index].geoFeatures |= DungeonFloor::SouthEastFloor;
+                tiles[index].geoFeatures |= DungeonFloor::NorthWall;
+                tiles[index].geoFeatures |= DungeonFloor::SouthWall;
+                if (northTile == ' ')
+                	tiles[index].geoFeatures &= ~DungeonFloor::NorthWall;
+                if (southTile == ' ')
+                	tiles[index].geoFeatures &= ~DungeonFloor::SouthWall;
+            }
+            else if (eastTile == DungeonFloor::ClosedDoor)
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::NorthEastFloor;
+                tiles[index].geoFeatures |= DungeonFloor::SouthEastFloor;
+                tiles[index].geoFeatures |= DungeonFloor::EastWall;
+                tiles[index].geoFeatures |= DungeonFloor::EastWallCap;
+            }
+            else if (eastTile == DungeonFloor::Wall &&
+            	    ((tiles[index].geoFeatures & DungeonFloor::NorthEastFloor) || 
+            	     (tiles[index].geoFeatures & DungeonFloor::SouthEastFloor)))
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::EastWall;
+            }
+
+            // Check the West tile to add walls
+            if (westTile == ' ')
+            {
+                tiles[index].geoFeatures |= DungeonFloor::NorthWestFloor;
+                tiles[index].geoFeatures |= DungeonFloor::SouthWestFloor;
+                tiles[index].geoFeatures |= DungeonFloor::NorthWall;
+                tiles[index].geoFeatures |= DungeonFloor::SouthWall;
+                if (northTile == ' ')
+                	tiles[index].geoFeatures &= ~DungeonFloor::NorthWall;
+                if (southTile == ' ')
+                	tiles[index].geoFeatures &= ~DungeonFloor::SouthWall;
+            }
+            else if (westTile == DungeonFloor::ClosedDoor)
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::NorthWestFloor;
+                tiles[index].geoFeatures |= DungeonFloor::SouthWestFloor;
+                tiles[index].geoFeatures |= DungeonFloor::WestWall;
+                tiles[index].geoFeatures |= DungeonFloor::WestWallCap;
+            }
+            else if (westTile == DungeonFloor::Wall &&
+            	    ((tiles[index].geoFeatures & DungeonFloor::NorthWestFloor) || 
+            	     (tiles[index].geoFeatures & DungeonFloor::SouthWestFloor)))
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::WestWall;
+            }
+
+
+            // Check to add in the walls that just come to an end and don't connect
+            if (northTile == ' ' && southTile == DungeonFloor::Wall && eastTile == ' ' && westTile == ' ')
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::NorthWall;
+            }
+
+            if (northTile == DungeonFloor::Wall && southTile == ' ' && eastTile == ' ' && westTile == ' ')
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::SouthWall;
+            }
+
+            if (northTile == ' ' && southTile == ' ' && eastTile == DungeonFloor::Wall && westTile == ' ')
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::WestWall;
+            }
+
+            if (northTile == ' ' && southTile == ' ' && eastTile == ' ' && westTile == DungeonFloor::Wall)
+            {
+            	tiles[index].geoFeatures |= DungeonFloor::EastWall;
+            }
+
+
+            // Lastly, check if any walls need an end cap
+            if ((tiles[index].geoFeatures & DungeonFloor::NorthWall) && (northTile != DungeonFloor::Wall))
+                tiles[index].geoFeatures |= DungeonFloor::NorthWallCap;
+
+            if ((tiles[index].geoFeatures & DungeonFloor::SouthWall) && (southTile != DungeonFloor::Wall))
+                tiles[index].geoFeatures |= DungeonFloor::SouthWallCap;
+
+            if ((tiles[index].geoFeatures & DungeonFloor::EastWall) && (eastTile != DungeonFloor::Wall))
+                tiles[index].geoFeatures |= DungeonFloor::EastWallCap;
+
+            if ((tiles[index].geoFeatures & DungeonFloor::WestWall) && (westTile != DungeonFloor::Wall))
+                tiles[index].geoFeatures |= DungeonFloor::WestWallCap;
+
+            tiles[index].material = DungeonFloor::WallMaterial;
+          }
+          else if (tile == DungeonFloor::ClosedDoor)
+          {
+          	tiles[index].geoFeatures |= DungeonFloor::NorthWestFloor;
+          	tiles[index].geoFeatures |= DungeonFloor::NorthEastFloor;
+          	tiles[index].geoFeatures |= DungeonFloor::SouthWestFloor;
+          	tiles[index].geoFeatures |= DungeonFloor::SouthEastFloor;
+          	if (northTile == DungeonFloor::Wall)
+          	    tiles[index].geoFeatures |= DungeonFloor::VertDoorway;
+          	else
+          		tiles[index].geoFeatures |= DungeonFloor::HorizDoorway;
+          	tiles[index].material = DungeonFloor::DoorMaterial;
+          }
+          else
+          {
+          	tiles[index].geoFeatures |= DungeonFloor::NorthWestFloor;
+          	tiles[index].geoFeatures |= DungeonFloor::NorthEastFloor;
+          	tiles[index].geoFeatures |= DungeonFloor::SouthWestFloor;
+          	tiles[index].geoFeatures |= DungeonFloor::SouthEastFloor;
+           	tiles[index].material = DungeonFloor::FloorMaterial;
+          }
+
+          index++;
+		}
+	  }
+	}
+
+	return;
+}
+
+static bool SameTiles(const std::vector<DungeonFloor::floorTile_t>& a, const std::vector<DungeonFloor::floorTile_t>& b)
+{
+	return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0);
+}
+
+static void BenchClassify()
+{
+	const int seedCount = 2000;
+	const int sizes[][3] = { { 96, 96, 60 }, { 1024, 1024, 2000 }, { 2048, 2048, 10000 } };
+	std::vector<DungeonFloor::floorTile_t> legacyTiles;
+	DungeonFloor floor;
+	int mismatches = 0;
+	char name[64];
+
+	printf("classify:\n");
+
+	// The table has to give exactly the same tiles as the old code
+	for (int i = 0; i < seedCount; i++)
+	{
+		Gumshoe::Random random((uint64)i + 1);
+		floor.Generate(random, DEFAULT_WORLD_SIZE, DEFAULT_WORLD_SIZE, DEFAULT_MAX_FEATURES);
+		floor.ClassifyTiles();
+		LegacyClassifyTiles(floor, legacyTiles);
+
+		if (!SameTiles(floor.GetTiles(), legacyTiles))
+			mismatches++;
+	}
+	printf("  bit-identical to the legacy classifier over %d seeds: %s (%d mismatches)\n",
+	       seedCount, Check(mismatches == 0), mismatches);
+
+	for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+	{
+		int runs = (sizes[i][0] > 256) ? 5 : 200;
+		Gumshoe::Random random(7);
+		floor.Generate(random, sizes[i][0], sizes[i][1], sizes[i][2]);
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int run = 0; run < runs; run++)
+			LegacyClassifyTiles(floor, legacyTiles);
+		snprintf(name, sizeof(name), "%dx%d legacy, per tile", sizes[i][0], sizes[i][1]);
+		ReportResult(name, ElapsedMs(start) / runs, (uint64)sizes[i][0] * sizes[i][1]);
+
+		start = BenchClock::now();
+		for (int run = 0; run < runs; run++)
+			floor.ClassifyTiles();
+		snprintf(name, sizeof(name), "%dx%d table, per tile", sizes[i][0], sizes[i][1]);
+		ReportResult(name, ElapsedMs(start) / runs, (uint64)sizes[i][0] * sizes[i][1]);
+
+		printf("    %u used tiles, match: %s\n", floor.GetTileCount(), Check(SameTiles(floor.GetTiles(), legacyTiles)));
+		printf("    tile records: %u KB at %u bytes each, %u KB as 48 byte float records\n",
+		       (uint32)(floor.GetTileCount() * sizeof(DungeonFloor::floorTile_t) / 1024),
+		       (uint32)sizeof(DungeonFloor::floorTile_t), floor.GetTileCount() * 48 / 1024);
+	}
+}
+
+
+//--------------------------------------------
+// Tile Layout Benchmark
+//--------------------------------------------
+// Used tiles of a square, split in four until the squares are small, the order a quadtree build reads the map in
+static uint64 CountRegionTiles(DungeonFloor& floor, int x, int y, int size)
+{
+	char tiles[16 * 16];
+	uint64 count = 0;
+
+	if (size > 16)
+	{
+		int half = size / 2;
+		return CountRegionTiles(floor, x, y, half) + CountRegionTiles(floor, x + half, y, half) +
+		       CountRegionTiles(floor, x, y + half, half) + CountRegionTiles(floor, x + half, y + half, half);
+	}
+
+	floor.GetTileRect(x, y, size, size, tiles);
+	for (int t = 0; t < size * size; t++)
+		count += (tiles[t] != DungeonFloor::Empty) ? 1 : 0;
+
+	return count;
+}
+
+static void BenchLayout()
+{
+	const int sizes[][3] = { { 1024, 1024, 2000 }, { 2048, 2048, 10000 }, { 4096, 4096, 40000 } };
+	const int lookups = 1 << 22;
+	bool match = true;
+	char name[96];
+
+	printf("layout:\n");
+
+	for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+	{
+		DungeonFloor base;
+		Gumshoe::Random random(7);
+		base.Generate(random, sizes[i][0], sizes[i][1], sizes[i][2]);
+		base.ClassifyTiles();
+		std::vector<DungeonFloor::floorTile_t> rowMajorTiles = base.GetTiles();
+
+		// The same spots for every layout, like entities checking the tiles around them
+		std::vector<int> positions(lookups * 2);
+		for (int q = 0; q < lookups; q++)
+		{
+			positions[q * 2] = 1 + random.RandomInt(sizes[i][0] - 2);
+			positions[q * 2 + 1] = 1 + random.RandomInt(sizes[i][1] - 2);
+		}
+
+		uint64 rowMajorWalls = 0, rowMajorUsed = 0;
+		for (int layout = 0; layout < TileGrid::LayoutCount; layout++)
+		{
+			DungeonFloor floor = base;
+			floor.SetTileLayout((TileGrid::Layout)layout);
+			const char* layoutName = TileGrid::GetLayoutName((TileGrid::Layout)layout);
+
+			BenchClock::time_point start = BenchClock::now();
+			floor.ClassifyTiles();
+			snprintf(name, sizeof(name), "%dx%d %s, classify", sizes[i][0], sizes[i][1], layoutName);
+			ReportResult(name, ElapsedMs(start), (uint64)sizes[i][0] * sizes[i][1]);
+
+			start = BenchClock::now();
+			uint64 walls = 0;
+			for (int q = 0; q < lookups; q++)
+			{
+				char tiles[9];
+				floor.GetTileRect(positions[q * 2] - 1, positions[q * 2 + 1] - 1, 3, 3, tiles);
+
+				for (int t = 0; t < 9; t++)
+					walls += (tiles[t] == DungeonFloor::Wall) ? 1 : 0;
+			}
+			snprintf(name, sizeof(name), "%dx%d %s, 3x3 lookup", sizes[i][0], sizes[i][1], layoutName);
+			ReportResult(name, ElapsedMs(start), lookups);
+
+			start = BenchClock::now();
+			uint64 used = CountRegionTiles(floor, 0, 0, std::max(sizes[i][0], sizes[i][1]));
+			snprintf(name, sizeof(name), "%dx%d %s, quadtree regions", sizes[i][0], sizes[i][1], layoutName);
+			ReportResult(name, ElapsedMs(start), (uint64)sizes[i][0] * sizes[i][1]);
+
+			if (layout == TileGrid::RowMajor)
+			{
+				rowMajorWalls = walls;
+				rowMajorUsed = used;
+			}
+			else if (walls != rowMajorWalls || used != rowMajorUsed || !SameTiles(floor.GetTiles(), rowMajorTiles))
+			{
+				match = false;
+			}
+		}
+	}
+
+	printf("  every layout gives the same tiles, lookups and region counts: %s\n", Check(match));
+}
+
+
+//--------------------------------------------
+// Indexed Mesh Benchmark
+//--------------------------------------------
+static void BenchMesh()
+{
+	const int seedCount = 100;
+	uint64 triangles = 0, unmergedTriangles = 0, emittedVertices = 0, vertices = 0, shortFloors = 0;
+	uint64 oldBytes = 0, newBytes = 0;
+	DungeonFloor floor;
+
+	printf("mesh:\n");
+
+	BenchClock::time_point start = BenchClock::now();
+	for (int i = 0; i < seedCount; i++)
+	{
+		Gumshoe::Random random((uint64)i + 1);
+		floor.Build(random, DEFAULT_WORLD_SIZE, DEFAULT_WORLD_SIZE, DEFAULT_MAX_FEATURES);
+
+		const DungeonFloor::geometryStats_t& stats = floor.GetGeometryStats();
+		triangles += stats.triangles;
+		unmergedTriangles += stats.unmergedTriangles;
+		emittedVertices += stats.emittedVertices;
+		vertices += stats.vertices;
+		shortFloors += floor.HasShortIndices() ? 1 : 0;
+
+		// Before: 3 unique vertices and a 32-bit index per triangle corner
+		oldBytes += (uint64)stats.triangles * 3 * (sizeof(DungeonFloor::floorVertex_t) + sizeof(uint32));
+		newBytes += (uint64)stats.vertices * sizeof(DungeonFloor::floorVertex_t) +
+		            (uint64)stats.triangles * 3 * (floor.HasShortIndices() ? sizeof(uint16) : sizeof(uint32));
+	}
+	ReportResult("build 96x96 floor", ElapsedMs(start), seedCount);
+
+	printf("    per floor: %llu triangles, %llu vertices unindexed, %llu as quads, %llu welded\n",
+	       (unsigned long long)(triangles / seedCount), (unsigned long long)(triangles * 3 / seedCount),
+	       (unsigned long long)(emittedVertices / seedCount), (unsigned long long)(vertices / seedCount));
+	printf("    merging floors and wall tops: %llu -> %llu triangles per floor (%.1f%% fewer)\n",
+	       (unsigned long long)(unmergedTriangles / seedCount), (unsigned long long)(triangles / seedCount),
+	       100.0 - 100.0 * (double)triangles / (double)unmergedTriangles);
+	printf("    vertex+index memory per floor: %llu KB -> %llu KB, %llu/%d floors use 16-bit indices\n",
+	       (unsigned long long)(oldBytes / seedCount / 1024), (unsigned long long)(newBytes / seedCount / 1024),
+	       (unsigned long long)shortFloors, seedCount);
+}
+
+
+//--------------------------------------------
+// Parallel Geometry Benchmark
+//--------------------------------------------
+// FNV-1a over the vertices and indices of a floor
+static uint64 HashGeometry(DungeonFloor& floor)
+{
+	uint64 hash = 0xCBF29CE484222325ULL;
+	const std::vector<DungeonFloor::floorVertex_t>& vertices = floor.GetVertices();
+	const std::vector<uint32>& indices = floor.GetIndices();
+
+	const uint8* bytes = (const uint8*)vertices.data();
+	for (size_t i = 0; i < vertices.size() * sizeof(DungeonFloor::floorVertex_t); i++)
+		hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+
+	bytes = (const uint8*)indices.data();
+	for (size_t i = 0; i < indices.size() * sizeof(uint32); i++)
+		hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+
+	return hash;
+}
+
+static void BenchGeometry()
+{
+	const int sizes[][3] = { { 96, 96, 60 }, { 1024, 1024, 2000 }, { 2048, 2048, 10000 } };
+	const int workerCounts[] = { -1, 0, 1, 3, 7 }; // -1 builds without a pool
+	DungeonFloor floor;
+	bool match = true;
+	char name[64];
+
+	printf("geometry:\n");
+
+	for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+	{
+		int runs = (sizes[i][0] > 256) ? 3 : 100;
+		uint64 firstHash = 0;
+		Gumshoe::Random random(7);
+		floor.Generate(random, sizes[i][0], sizes[i][1], sizes[i][2]);
+		floor.ClassifyTiles();
+
+		for (int w = 0; w < (int)(sizeof(workerCounts) / sizeof(workerCounts[0])); w++)
+		{
+			Gumshoe::JobPool pool;
+			if (workerCounts[w] >= 0)
+				pool.Init(workerCounts[w]);
+
+			BenchClock::time_point start = BenchClock::now();
+			for (int run = 0; run < runs; run++)
+				floor.BuildGeometry((workerCounts[w] >= 0) ? &pool : nullptr);
+			if (workerCounts[w] < 0)
+				snprintf(name, sizeof(name), "%dx%d, no pool", sizes[i][0], sizes[i][1]);
+			else
+				snprintf(name, sizeof(name), "%dx%d, %d workers", sizes[i][0], sizes[i][1], workerCounts[w]);
+			ReportResult(name, ElapsedMs(start) / runs, 1);
+
+			uint64 hash = HashGeometry(floor);
+			if (w == 0)
+				firstHash = hash;
+			else if (hash != firstHash)
+				match = false;
+
+			pool.Shutdown();
+		}
+
+		printf("    %u tiles, %u triangles\n", floor.GetTileCount(), floor.GetGeometryStats().triangles);
+	}
+
+	printf("  same geometry for every worker count: %s (%u hardware threads)\n", Check(match),
+	       std::thread::hardware_concurrency());
+}
+
+
+//--------------------------------------------
+// Quad Tree Build Benchmark
+//--------------------------------------------
+// Copy of the old QuadTree build: every node counts its triangles, and each of its
+// four children's, by testing every triangle in the mesh
+struct legacyQuadTree_t
+{
+	std::vector<Gumshoe::Vector3_t> corners; // three per triangle
+	int triangleCount;
+	uint32 nodes, leaves;
+	uint64 leafTriangles, trianglesTested;
+};
+
+static bool LegacyIsTriangleContained(legacyQuadTree_t& tree, int index, float positionX, float positionZ, float width)
+{
+	float radius = width / 2.0f;
+	const Gumshoe::Vector3_t* v = &tree.corners[index * 3];
+
+	tree.trianglesTested++;
+	if (fminf(v[0].x, fminf(v[1].x, v[2].x)) > (positionX + radius))
+		return false;
+	if (fmaxf(v[0].x, fmaxf(v[1].x, v[2].x)) < (positionX - radius))
+		return false;
+	if (fminf(v[0].z, fminf(v[1].z, v[2].z)) > (positionZ + radius))
+		return false;
+	if (fmaxf(v[0].z, fmaxf(v[1].z, v[2].z)) < (positionZ - radius))
+		return false;
+
+	return true;
+}
+
+static int LegacyCountTriangles(legacyQuadTree_t& tree, float positionX, float positionZ, float width)
+{
+	int count = 0;
+
+	for (int i = 0; i < tree.triangleCount; i++)
+		if (LegacyIsTriangleContained(tree, i, positionX, positionZ, width))
+			count++;
+
+	return count;
+}
+
+static void LegacyCreateTreeNode(legacyQuadTree_t& tree, float positionX, float positionZ, float width)
+{
+	int numTriangles = LegacyCountTriangles(tree, positionX, positionZ, width);
+
+	tree.nodes++;
+	if (numTriangles == 0)
+		return;
+
+	if (numTriangles > MAX_TRIANGLES)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			float offsetX = (((i % 2) < 1) ? -1.0f : 1.0f) * (width / 4.0f);
+			float offsetZ = (((i % 4) < 2) ? -1.0f : 1.0f) * (width / 4.0f);
+
+			if (LegacyCountTriangles(tree, (positionX + offsetX), (positionZ + offsetZ), (width / 2.0f)) > 0)
+				LegacyCreateTreeNode(tree, (positionX + offsetX), (positionZ + offsetZ), (width / 2.0f));
+		}
+		return;
+	}
+
+	// The leaf then went over the whole mesh once more to copy out its triangles
+	int leafCount = 0;
+	for (int i = 0; i < tree.triangleCount; i++)
+		if (LegacyIsTriangleContained(tree, i, positionX, positionZ, width))
+			leafCount++;
+
+	tree.leaves++;
+	tree.leafTriangles += leafCount;
+}
+
+static void LegacyBuildQuadTree(legacyQuadTree_t& tree, float centerX, float centerZ, float width)
+{
+	tree.nodes = 0;
+	tree.leaves = 0;
+	tree.leafTriangles = 0;
+	tree.trianglesTested = 0;
+	LegacyCreateTreeNode(tree, centerX, centerZ, width);
+}
+
+// Square heightmap of gridSize x gridSize quads, for meshes bigger than any floor
+static void BuildTerrainMesh(int gridSize, std::vector<Gumshoe::Vector3_t>& positions, std::vector<uint32>& indices)
+{
+	Gumshoe::Random random(99);
+
+	positions.resize((size_t)(gridSize + 1) * (gridSize + 1));
+	for (int z = 0; z <= gridSize; z++)
+		for (int x = 0; x <= gridSize; x++)
+			positions[(size_t)z * (gridSize + 1) + x] = Gumshoe::V3((float)x, (float)(random.Next() % 100) * 0.01f, (float)z);
+
+	indices.clear();
+	indices.reserve((size_t)gridSize * gridSize * 6);
+	for (int z = 0; z < gridSize; z++)
+	{
+		for (int x = 0; x < gridSize; x++)
+		{
+			uint32 bottomLeft = (uint32)(z * (gridSize + 1) + x);
+			uint32 topLeft = bottomLeft + gridSize + 1;
+
+			indices.push_back(bottomLeft);
+			indices.push_back(topLeft);
+			indices.push_back(topLeft + 1);
+			indices.push_back(topLeft + 1);
+			indices.push_back(bottomLeft + 1);
+			indices.push_back(bottomLeft);
+		}
+	}
+}
+
+// Copy of QuadTree::CheckHeightOfTriangle, for the brute force height reference
+static bool ReferenceHeightOfTriangle(float x, float z, float& height, float v0[3], float v1[3], float v2[3])
+{
+	float startVector[3], directionVector[3], edge1[3], edge2[3], normal[3];
+	float Q[3], e1[3], e2[3], e3[3], edgeNormal[3], temp[3];
+	float magnitude, D, denominator, numerator, t, determinant;
+
+
+	// Starting position of the ray that is being cast.
+	startVector[0] = x;
+	startVector[1] = 0.0f;
+	startVector[2] = z;
+
+	// The direction the ray is being cast.
+	directionVector[0] =  0.0f;
+	directionVector[1] = -1.0f;
+	directionVector[2] =  0.0f;
+
+	// Calculate the two edges from the three points given.
+	edge1[0] = v1[0] - v0[0];
+	edge1[1] = v1[1] - v0[1];
+	edge1[2] = v1[2] - v0[2];
+
+	edge2[0] = v2[0] - v0[0];
+	edge2[1] = v2[1] - v0[1];
+	edge2[2] = v2[2] - v0[2];
+
+	// Calculate the normal of the triangle from the two edges.
+	normal[0] = (edge1[1] * edge2[2]) - (edge1[2] * edge2[1]);
+	normal[1] = (edge1[2] * edge2[0]) - (edge1[0] * edge2[2]);
+	normal[2] = (edge1[0] * edge2[1]) - (edge1[1] * edge2[0]);
+
+	magnitude = (float)sqrt((normal[0] * normal[0]) + (normal[1] * normal[1]) + (normal[2] * normal[2]));
+	normal[0] = normal[0] / magnitude;
+	normal[1] = normal[1] / magnitude;
+	normal[2] = normal[2] / magnitude;
+
+	// Find the distance from the origin to the plane.
+	D = ((-normal[0] * v0[0]) + (-normal[1] * v0[1]) + (-normal[2] * v0[2]));
+
+	// Get the denominator of the equation.
+	denominator = ((normal[0] * directionVector[0]) + (normal[1] * directionVector[1]) + (normal[2] * directionVector[2]));
+
+	// Make sure the result doesn't get too close to zero to prevent divide by zero.
+	if(fabs(denominator) < 0.0001f)
+	{
+		return false;
+	}
+
+	// Get the numerator of the equation.
+	numerator = -1.0f * (((normal[0] * startVector[0]) + (normal[1] * startVector[1]) + (normal[2] * startVector[2])) + D);
+
+	// Calculate where we intersect the triangle.
+	t = numerator / denominator;
+
+	// Find the intersection vector.
+	Q[0] = startVector[0] + (directionVector[0] * t);
+	Q[1] = startVector[1] + (directionVector[1] * t);
+	Q[2] = startVector[2] + (directionVector[2] * t);
+
+	// Find the three edges of the triangle.
+	e1[0] = v1[0] - v0[0];
+	e1[1] = v1[1] - v0[1];
+	e1[2] = v1[2] - v0[2];
+
+	e2[0] = v2[0] - v1[0];
+	e2[1] = v2[1] - v1[1];
+	e2[2] = v2[2] - v1[2];
+
+	e3[0] = v0[0] - v2[0];
+	e3[1] = v0[1] - v2[1];
+	e3[2] = v0[2] - v2[2];
+
+	// Calculate the normal for the first edge.
+	edgeNormal[0] = (e1[1] * normal[2]) - (e1[2] * normal[1]);
+	edgeNormal[1] = (e1[2] * normal[0]) - (e1[0] * normal[2]);
+	edgeNormal[2] = (e1[0] * normal[1]) - (e1[1] * normal[0]);
+
+	// Calculate the determinant to see if it is on the inside, outside, or directly on the edge.
+	temp[0] = Q[0] - v0[0];
+	temp[1] = Q[1] - v0[1];
+	temp[2] = Q[2] - v0[2];
+
+	determinant = ((edgeNormal[0] * temp[0]) + (edgeNormal[1] * temp[1]) + (edgeNormal[2] * temp[2]));
+
+	// Check if it is outside.
+	if(determinant > 0.001f)
+	{
+		return false;
+	}
+
+	// Calculate the normal for the second edge.
+	edgeNormal[0] = (e2[1] * normal[2]) - (e2[2] * normal[1]);
+	edgeNormal[1] = (e2[2] * normal[0]) - (e2[0] * normal[2]);
+	edgeNormal[2] = (e2[0] * normal[1]) - (e2[1] * normal[0]);
+
+	// Calculate the determinant to see if it is on the inside, outside, or directly on the edge.
+	temp[0] = Q[0] - v1[0];
+	temp[1] = Q[1] - v1[1];
+	temp[2] = Q[2] - v1[2];
+
+	determinant = ((edgeNormal[0] * temp[0]) + (edgeNormal[1] * temp[1]) + (edgeNormal[2] * temp[2]));
+
+	// Check if it is outside.
+	if(determinant > 0.001f)
+	{
+		return false;
+	}
+
+	// Calculate the normal for the third edge.
+	edgeNormal[0] = (e3[1] * normal[2]) - (e3[2] * normal[1]);
+	edgeNormal[1] = (e3[2] * normal[0]) - (e3[0] * normal[2]);
+	edgeNormal[2] = (e3[0] * normal[1]) - (e3[1] * normal[0]);
+
+	// Calculate the determinant to see if it is on the inside, outside, or directly on the edge.
+	temp[0] = Q[0] - v2[0];
+	temp[1] = Q[1] - v2[1];
+	temp[2] = Q[2] - v2[2];
+
+	determinant = ((edgeNormal[0] * temp[0]) + (edgeNormal[1] * temp[1]) + (edgeNormal[2] * temp[2]));
+
+	// Check if it is outside.
+	if(determinant > 0.001f)
+	{
+		return false;
+	}
+
+	// Now we have our height.
+	height = Q[1];
+
+	return true;
+}
+
+
+// First triangle of the whole mesh under the point, in mesh order, as a tree query without any acceleration
+static bool ReferenceHeightAtPosition(const std::vector<Gumshoe::Vector3_t>& positions, const std::vector<uint32>& indices, float x, float z, float& height)
+{
+	float v0[3], v1[3], v2[3];
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const Gumshoe::Vector3_t& p0 = positions[indices[i]];
+		const Gumshoe::Vector3_t& p1 = positions[indices[i + 1]];
+		const Gumshoe::Vector3_t& p2 = positions[indices[i + 2]];
+
+		// Most triangles are nowhere near, skip them before the ray test
+		if ((x < fminf(p0.x, fminf(p1.x, p2.x)) - 0.01f) || (x > fmaxf(p0.x, fmaxf(p1.x, p2.x)) + 0.01f) ||
+		    (z < fminf(p0.z, fminf(p1.z, p2.z)) - 0.01f) || (z > fmaxf(p0.z, fmaxf(p1.z, p2.z)) + 0.01f))
+			continue;
+
+		v0[0] = p0.x; v0[1] = p0.y; v0[2] = p0.z;
+		v1[0] = p1.x; v1[1] = p1.y; v1[2] = p1.z;
+		v2[0] = p2.x; v2[1] = p2.y; v2[2] = p2.z;
+		if (ReferenceHeightOfTriangle(x, z, height, v0, v1, v2))
+			return true;
+	}
+
+	return false;
+}
+
+static void BenchQuadTree()
+{
+	const int floorSizes[][3] = { { 96, 96, 60 }, { 1024, 1024, 2000 }, { 2048, 2048, 10000 } };
+	const int terrainSize = 1500;
+	const int legacyLimit = 1000000; // the old build takes minutes past this
+	Gumshoe::JobPool pool;
+	bool match = true;
+	char name[96];
+
+	printf("quadtree:\n");
+	pool.Init(3);
+
+	for (int i = 0; i < (int)(sizeof(floorSizes) / sizeof(floorSizes[0])) + 1; i++)
+	{
+		std::vector<Gumshoe::Vector3_t> positions;
+		std::vector<uint32> indices;
+		char meshName[32];
+
+		if (i < (int)(sizeof(floorSizes) / sizeof(floorSizes[0])))
+		{
+			DungeonFloor floor;
+			Gumshoe::Random random(7);
+			floor.Build(random, floorSizes[i][0], floorSizes[i][1], floorSizes[i][2]);
+
+			const std::vector<DungeonFloor::floorVertex_t>& vertices = floor.GetVertices();
+			positions.resize(vertices.size());
+			for (size_t v = 0; v < vertices.size(); v++)
+				positions[v] = vertices[v].position;
+			indices = floor.GetIndices();
+			snprintf(meshName, sizeof(meshName), "%dx%d floor", floorSizes[i][0], floorSizes[i][1]);
+		}
+		else
+		{
+			BuildTerrainMesh(terrainSize, positions, indices);
+			snprintf(meshName, sizeof(meshName), "%dx%d terrain", terrainSize, terrainSize);
+		}
+
+		uint32 triangleCount = (uint32)indices.size() / 3;
+		Gumshoe::QuadTree tree;
+
+		BenchClock::time_point start = BenchClock::now();
+		tree.Init(positions.data(), sizeof(Gumshoe::Vector3_t), (uint32)positions.size(), indices.data(), triangleCount);
+		snprintf(name, sizeof(name), "%s, partitioned", meshName);
+		ReportResult(name, ElapsedMs(start), triangleCount);
+		Gumshoe::QuadTree::buildStats_t stats = tree.GetBuildStats();
+
+		start = BenchClock::now();
+		tree.Init(positions.data(), sizeof(Gumshoe::Vector3_t), (uint32)positions.size(), indices.data(), triangleCount, &pool);
+		snprintf(name, sizeof(name), "%s, partitioned, 3 workers", meshName);
+		ReportResult(name, ElapsedMs(start), triangleCount);
+		const Gumshoe::QuadTree::buildStats_t& parallelStats = tree.GetBuildStats();
+		if (parallelStats.nodes != stats.nodes || parallelStats.leafTriangles != stats.leafTriangles)
+			match = false;
+
+		printf("    %u triangles, %u nodes, %u leaves, depth %u, %.2f containment tests per triangle\n",
+		       triangleCount, stats.nodes, stats.leaves, stats.maxDepth, (double)stats.trianglesTested / (double)triangleCount);
+
+		// Height queries go through the ground grid, and have to find the same triangle as a scan of the whole mesh
+		const int queryCount = 100000;
+		const int referenceCount = 200;
+		float meshMaxX = 0.0f, meshMaxZ = 0.0f;
+		for (size_t v = 0; v < positions.size(); v++)
+		{
+			meshMaxX = fmaxf(meshMaxX, positions[v].x);
+			meshMaxZ = fmaxf(meshMaxZ, positions[v].z);
+		}
+
+		std::vector<float> queries(queryCount * 2), heights(queryCount);
+		std::vector<Gumshoe::Vector2_t> batch(queryCount);
+		Gumshoe::Random queryRandom(5);
+		for (int q = 0; q < queryCount; q++)
+		{
+			queries[q * 2] = queryRandom.RandomFloat() * meshMaxX;
+			queries[q * 2 + 1] = queryRandom.RandomFloat() * meshMaxZ;
+			batch[q].x = queries[q * 2];
+			batch[q].y = queries[q * 2 + 1];
+		}
+
+		int hits = 0;
+		start = BenchClock::now();
+		for (int q = 0; q < queryCount; q++)
+		{
+			heights[q] = -1.0f;
+			if (tree.GetHeightAtPosition(queries[q * 2], queries[q * 2 + 1], heights[q]))
+				hits++;
+		}
+		snprintf(name, sizeof(name), "%s, height query", meshName);
+		ReportResult(name, ElapsedMs(start), queryCount);
+
+		std::vector<float> batchHeights(queryCount, -1.0f), pooledHeights(queryCount, -1.0f);
+		bool* batchFound = new bool[queryCount];
+		start = BenchClock::now();
+		uint32 batchHits = tree.GetHeightsAtPositions(batch.data(), queryCount, batchHeights.data(), batchFound);
+		snprintf(name, sizeof(name), "%s, batched height queries", meshName);
+		ReportResult(name, ElapsedMs(start), queryCount);
+
+		start = BenchClock::now();
+		uint32 pooledHits = tree.GetHeightsAtPositions(batch.data(), queryCount, pooledHeights.data(), nullptr, &pool);
+		snprintf(name, sizeof(name), "%s, batched height queries, 3 workers", meshName);
+		ReportResult(name, ElapsedMs(start), queryCount);
+
+		int batchMismatches = 0;
+		for (int q = 0; q < queryCount; q++)
+		{
+			if ((batchHeights[q] != heights[q]) || (pooledHeights[q] != heights[q]) || (batchFound[q] != (heights[q] != -1.0f)))
+				batchMismatches++;
+		}
+		delete[] batchFound;
+		if ((batchHits != (uint32)hits) || (pooledHits != (uint32)hits))
+			batchMismatches++;
+
+		int referenceMismatches = 0;
+		start = BenchClock::now();
+		for (int q = 0; q < referenceCount; q++)
+		{
+			float height = -1.0f;
+			ReferenceHeightAtPosition(positions, indices, queries[q * 2], queries[q * 2 + 1], height);
+			if (height != heights[q])
+				referenceMismatches++;
+		}
+		snprintf(name, sizeof(name), "%s, height query, whole mesh scan", meshName);
+		ReportResult(name, ElapsedMs(start), referenceCount);
+
+		printf("    %ux%u height grid, %.2f triangles per cell, %d/%d queries hit the ground, mismatches: %d batched, %d of %d against the scan\n",
+		       stats.groundCells, stats.groundCells, (double)stats.groundTriangles / ((double)stats.groundCells * stats.groundCells),
+		       hits, queryCount, batchMismatches, referenceMismatches, referenceCount);
+		if (batchMismatches || referenceMismatches)
+			match = false;
+
+		Gumshoe::QuadTree loaded;
+		bool sameLoaded = tree.Save("quadtree_bench.bin") && loaded.Load("quadtree_bench.bin") &&
+		                  (loaded.GetBuildStats().nodes == stats.nodes) && (loaded.GetBuildStats().leafTriangles == stats.leafTriangles);
+		for (int q = 0; sameLoaded && (q < queryCount); q++)
+		{
+			float height = -1.0f;
+			loaded.GetHeightAtPosition(queries[q * 2], queries[q * 2 + 1], height);
+			sameLoaded = (height == heights[q]);
+		}
+		remove("quadtree_bench.bin");
+		printf("    saved and loaded tree answers the same: %s\n", Check(sameLoaded));
+		if (!sameLoaded)
+			match = false;
+
+		if (triangleCount > (uint32)legacyLimit)
+			continue;
+
+		// The old build as it was, for the same mesh and the same root square
+		legacyQuadTree_t legacy;
+		legacy.triangleCount = (int)triangleCount;
+		legacy.corners.resize(indices.size());
+		for (size_t c = 0; c < indices.size(); c++)
+			legacy.corners[c] = positions[indices[c]];
+
+		float centerX = 0.0f, centerZ = 0.0f, maxX = 0.0f, maxZ = 0.0f;
+		for (size_t c = 0; c < legacy.corners.size(); c++)
+		{
+			centerX += legacy.corners[c].x;
+			centerZ += legacy.corners[c].z;
+		}
+		centerX /= (float)legacy.corners.size();
+		centerZ /= (float)legacy.corners.size();
+		for (size_t c = 0; c < legacy.corners.size(); c++)
+		{
+			maxX = fmaxf(maxX, fabsf(legacy.corners[c].x - centerX));
+			maxZ = fmaxf(maxZ, fabsf(legacy.corners[c].z - centerZ));
+		}
+
+		start = BenchClock::now();
+		LegacyBuildQuadTree(legacy, centerX, centerZ, fmaxf(maxX, maxZ) * 2.0f);
+		snprintf(name, sizeof(name), "%s, legacy rescans", meshName);
+		ReportResult(name, ElapsedMs(start), triangleCount);
+
+		// Node counts include the empty children the legacy build counted and skipped
+		bool same = (legacy.leaves == stats.leaves) && (legacy.leafTriangles == stats.leafTriangles);
+		printf("    legacy: %u leaves, %.2f containment tests per triangle, same leaves: %s\n", legacy.leaves,
+		       (double)legacy.trianglesTested / (double)triangleCount, Check(same));
+		if (!same)
+			match = false;
+	}
+
+	printf("  same tree and heights with and without workers, after loading, and as the legacy build and mesh scan: %s\n", Check(match));
+}
+
+
+//--------------------------------------------
+// Frustum Benchmarks
+//--------------------------------------------
+// Left handed look-at and perspective matrices, row-major like the D3DX ones the game passes in
+static void BuildCameraMatrices(Gumshoe::Vector3_t eye, Gumshoe::Vector3_t at, float* view, float* projection)
+{
+	const float fieldOfView = 3.14159265f / 4.0f, aspect = 16.0f / 9.0f, screenNear = 0.1f, screenDepth = 1000.0f;
+	Gumshoe::Vector3_t up = Gumshoe::V3(0.0f, 1.0f, 0.0f);
+
+	Gumshoe::Vector3_t zAxis = at - eye;
+	zAxis = zAxis * (1.0f / sqrtf(Gumshoe::Inner(zAxis, zAxis)));
+	Gumshoe::Vector3_t xAxis = Gumshoe::V3(up.y * zAxis.z - up.z * zAxis.y, up.z * zAxis.x - up.x * zAxis.z, up.x * zAxis.y - up.y * zAxis.x);
+	xAxis = xAxis * (1.0f / sqrtf(Gumshoe::Inner(xAxis, xAxis)));
+	Gumshoe::Vector3_t yAxis = Gumshoe::V3(zAxis.y * xAxis.z - zAxis.z * xAxis.y, zAxis.z * xAxis.x - zAxis.x * xAxis.z, zAxis.x * xAxis.y - zAxis.y * xAxis.x);
+
+	float viewMatrix[16] = { xAxis.x, yAxis.x, zAxis.x, 0.0f,
+	                         xAxis.y, yAxis.y, zAxis.y, 0.0f,
+	                         xAxis.z, yAxis.z, zAxis.z, 0.0f,
+	                         -Gumshoe::Inner(xAxis, eye), -Gumshoe::Inner(yAxis, eye), -Gumshoe::Inner(zAxis, eye), 1.0f };
+	float yScale = 1.0f / tanf(fieldOfView / 2.0f);
+	float projectionMatrix[16] = { yScale / aspect, 0.0f, 0.0f, 0.0f,
+	                               0.0f, yScale, 0.0f, 0.0f,
+	                               0.0f, 0.0f, screenDepth / (screenDepth - screenNear), 1.0f,
+	                               0.0f, 0.0f, -screenNear * screenDepth / (screenDepth - screenNear), 0.0f };
+
+	memcpy(view, viewMatrix, sizeof(viewMatrix));
+	memcpy(projection, projectionMatrix, sizeof(projectionMatrix));
+}
+
+// The old CheckRectangle: a box is culled when all eight corners are behind one plane
+static bool LegacyCheckRectangle(const float planes[6][4], float xCenter, float yCenter, float zCenter, float xSize, float ySize, float zSize)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		bool inside = false;
+		for (int corner = 0; corner < 8 && !inside; corner++)
+		{
+			float x = (corner & 1) ? (xCenter + xSize) : (xCenter - xSize);
+			float y = (corner & 2) ? (yCenter + ySize) : (yCenter - ySize);
+			float z = (corner & 4) ? (zCenter + zSize) : (zCenter - zSize);
+			inside = ((planes[i][0] * x) + (planes[i][1] * y) + (planes[i][2] * z) + planes[i][3]) >= 0.0f;
+		}
+
+		if (!inside)
+			return false;
+	}
+
+	return true;
+}
+
+// Walks a full quadtree the way QuadTree::RenderNode does, children of node n are 4n + 1 to 4n + 4
+struct cullWalk_t
+{
+	Gumshoe::Frustum* frustum;
+	std::vector<uint8> lastFailedPlanes;
+	bool propagateMask, cachePlanes;
+	int maxDepth;
+	uint32 visibleLeaves;
+};
+
+static void CullWalkNode(cullWalk_t& walk, uint32 node, float x, float z, float width, int depth, uint32 planeMask)
+{
+	uint8 uncached = 0;
+	uint8& lastFailedPlane = walk.cachePlanes ? walk.lastFailedPlanes[node] : uncached;
+
+	if (!walk.propagateMask)
+		planeMask = FRUSTUM_ALL_PLANES;
+	if (!walk.frustum->CheckRectangleMasked(x, 0.0f, z, width / 2.0f, width / 2.0f, width / 2.0f, planeMask, lastFailedPlane))
+		return;
+
+	if (depth == walk.maxDepth)
+	{
+		walk.visibleLeaves++;
+		return;
+	}
+
+	for (uint32 i = 0; i < 4; i++)
+	{
+		float offsetX = (i & 1) ? (width / 4.0f) : (-width / 4.0f);
+		float offsetZ = (i & 2) ? (width / 4.0f) : (-width / 4.0f);
+		CullWalkNode(walk, node * 4 + 1 + i, x + offsetX, z + offsetZ, width / 2.0f, depth + 1, planeMask);
+	}
+}
+
+static void BenchFrustum()
+{
+	const int boxCount = 1 << 16;
+	const int rounds = 128;
+	const float screenDepth = 1000.0f;
+	float view[16], projection[16];
+	Gumshoe::Frustum frustum;
+	Gumshoe::Random random(21);
+	char name[64];
+
+	printf("frustum:\n");
+
+	// Boxes the size of quadtree nodes and entities over a big floor, seen from above one corner
+	BuildCameraMatrices(Gumshoe::V3(256.0f, 40.0f, 256.0f), Gumshoe::V3(1024.0f, 0.0f, 1024.0f), view, projection);
+	frustum.ConstructFrustum(screenDepth, projection, view);
+
+	std::vector<float> centerX(boxCount), centerY(boxCount), centerZ(boxCount), extentX(boxCount), extentY(boxCount), extentZ(boxCount);
+	for (int i = 0; i < boxCount; i++)
+	{
+		centerX[i] = random.RandomFloat() * 2048.0f;
+		centerY[i] = random.RandomFloat() * 8.0f;
+		centerZ[i] = random.RandomFloat() * 2048.0f;
+		extentX[i] = 0.5f + random.RandomFloat() * 16.0f;
+		extentY[i] = 0.5f + random.RandomFloat() * 4.0f;
+		extentZ[i] = 0.5f + random.RandomFloat() * 16.0f;
+	}
+
+	// The planes the way the old D3DX code built them, for the eight corner test
+	float planes[6][4], matrix[16];
+	float zMinimum = -projection[14] / projection[10];
+	float r = screenDepth / (screenDepth - zMinimum);
+	float adjusted[16];
+	memcpy(adjusted, projection, sizeof(adjusted));
+	adjusted[10] = r;
+	adjusted[14] = -r * zMinimum;
+	for (int row = 0; row < 4; row++)
+		for (int column = 0; column < 4; column++)
+			matrix[row * 4 + column] = (view[row * 4] * adjusted[column]) + (view[row * 4 + 1] * adjusted[4 + column]) +
+			                           (view[row * 4 + 2] * adjusted[8 + column]) + (view[row * 4 + 3] * adjusted[12 + column]);
+	for (int i = 0; i < 4; i++)
+	{
+		planes[0][i] = matrix[i * 4 + 3] + matrix[i * 4 + 2];
+		planes[1][i] = matrix[i * 4 + 3] - matrix[i * 4 + 2];
+		planes[2][i] = matrix[i * 4 + 3] + matrix[i * 4];
+		planes[3][i] = matrix[i * 4 + 3] - matrix[i * 4];
+		planes[4][i] = matrix[i * 4 + 3] - matrix[i * 4 + 1];
+		planes[5][i] = matrix[i * 4 + 3] + matrix[i * 4 + 1];
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		float length = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+		for (int j = 0; j < 4; j++)
+			planes[i][j] /= length;
+	}
+
+	std::vector<uint8> legacyVisible(boxCount), singleVisible(boxCount);
+	BenchClock::time_point start = BenchClock::now();
+	for (int round = 0; round < rounds; round++)
+		for (int i = 0; i < boxCount; i++)
+			legacyVisible[i] = LegacyCheckRectangle(planes, centerX[i], centerY[i], centerZ[i], extentX[i], extentY[i], extentZ[i]);
+	ReportResult("eight corners per plane, one box", ElapsedMs(start), (uint64)boxCount * rounds);
+
+	start = BenchClock::now();
+	for (int round = 0; round < rounds; round++)
+		for (int i = 0; i < boxCount; i++)
+			singleVisible[i] = frustum.CheckRectangle(centerX[i], centerY[i], centerZ[i], extentX[i], extentY[i], extentZ[i]);
+	ReportResult("centre and extents, one box", ElapsedMs(start), (uint64)boxCount * rounds);
+
+	Gumshoe::Frustum::boxArrays_t boxes = { centerX.data(), centerY.data(), centerZ.data(), extentX.data(), extentY.data(), extentZ.data() };
+	std::vector<uint32> visible((boxCount + 31) / 32);
+	uint32 visibleCount = 0;
+	start = BenchClock::now();
+	for (int round = 0; round < rounds; round++)
+		visibleCount = frustum.CheckRectangles(boxes, boxCount, visible.data());
+	snprintf(name, sizeof(name), "centre and extents, batched");
+	ReportResult(name, ElapsedMs(start), (uint64)boxCount * rounds);
+
+	// An odd count checks the boxes after the last full vector
+	std::vector<uint32> tailVisible((boxCount + 31) / 32);
+	frustum.CheckRectangles(boxes, boxCount - 5, tailVisible.data());
+
+	int batchMismatches = 0, cornerMismatches = 0, legacyCount = 0;
+	for (int i = 0; i < boxCount; i++)
+	{
+		bool batched = (visible[i >> 5] >> (i & 31)) & 1;
+		bool tail = (tailVisible[i >> 5] >> (i & 31)) & 1;
+		if ((batched != (singleVisible[i] != 0)) || ((i < boxCount - 5) && (tail != batched)) || ((i >= boxCount - 5) && tail))
+			batchMismatches++;
+		if (singleVisible[i] != legacyVisible[i])
+			cornerMismatches++;
+		legacyCount += legacyVisible[i];
+	}
+
+	printf("    %u/%d boxes visible (%d with eight corners), batched mismatches: %d, eight corner mismatches: %d\n",
+	       visibleCount, boxCount, legacyCount, batchMismatches, cornerMismatches);
+
+	// A camera turning on the spot over a quadtree of the same floor, a few degrees a frame
+	const int frames = 360;
+	const int treeDepth = 7;
+	const char* walkNames[3] = { "quadtree walk, all planes", "quadtree walk, parent plane mask", "quadtree walk, mask and last failed plane" };
+	uint32 walkVisible[3] = { 0, 0, 0 };
+
+	for (int mode = 0; mode < 3; mode++)
+	{
+		cullWalk_t walk;
+		uint64 planeTests = 0, planesSkipped = 0, cachedRejects = 0;
+
+		walk.frustum = &frustum;
+		walk.lastFailedPlanes.assign(((1 << (2 * (treeDepth + 1))) - 1) / 3, 0);
+		walk.propagateMask = (mode >= 1);
+		walk.cachePlanes = (mode >= 2);
+		walk.maxDepth = treeDepth;
+		walk.visibleLeaves = 0;
+
+		start = BenchClock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			float angle = (float)frame * (3.14159265f / 180.0f);
+			Gumshoe::Vector3_t eye = Gumshoe::V3(1024.0f, 40.0f, 1024.0f);
+			BuildCameraMatrices(eye, eye + Gumshoe::V3(cosf(angle), -0.2f, sinf(angle)), view, projection);
+			frustum.ConstructFrustum(screenDepth, projection, view);
+
+			CullWalkNode(walk, 0, 1024.0f, 1024.0f, 2048.0f, 0, FRUSTUM_ALL_PLANES);
+
+			const Gumshoe::Frustum::cullStats_t& cullStats = frustum.GetCullStats();
+			planeTests += cullStats.planeTests;
+			planesSkipped += cullStats.planesSkipped;
+			cachedRejects += cullStats.cachedRejects;
+		}
+		ReportResult(walkNames[mode], ElapsedMs(start), frames);
+		printf("    per frame: %u visible leaves, %.0f plane tests, %.0f skipped, %.0f rejected by the cached plane\n", walk.visibleLeaves / frames,
+		       (double)planeTests / frames, (double)planesSkipped / frames, (double)cachedRejects / frames);
+		walkVisible[mode] = walk.visibleLeaves;
+	}
+
+	printf("  batched test matches the single box test: %s\n", Check(batchMismatches == 0));
+	printf("  same leaves with and without the plane mask and cache: %s\n",
+	       Check((walkVisible[0] == walkVisible[1]) && (walkVisible[0] == walkVisible[2])));
+}
+
+
+static void BenchCull()
+{
+	const int floorSizes[][3] = { { 1024, 1024, 2000 }, { 2048, 2048, 10000 } };
+	const int frames = 360;
+	const float screenDepth = 1000.0f;
+	float view[16], projection[16];
+	bool match = true;
+	char name[64];
+
+	printf("cull:\n");
+
+	for (int i = 0; i < (int)(sizeof(floorSizes) / sizeof(floorSizes[0])); i++)
+	{
+		DungeonFloor floor;
+		Gumshoe::Random random(7);
+		floor.Build(random, floorSizes[i][0], floorSizes[i][1], floorSizes[i][2]);
+
+		const std::vector<DungeonFloor::floorVertex_t>& vertices = floor.GetVertices();
+		const std::vector<uint32>& indices = floor.GetIndices();
+		Gumshoe::QuadTree tree;
+		tree.Init(&vertices[0].position, sizeof(DungeonFloor::floorVertex_t), (uint32)vertices.size(), indices.data(), (uint32)indices.size() / 3);
+
+		// The camera turns on the spot in the middle of the floor, a degree a frame
+		Gumshoe::Frustum frustum;
+		std::vector<Gumshoe::QuadTree::drawRange_t> drawRanges;
+		uint64 nodesTested = 0, visibleLeaves = 0, ranges = 0, triangles = 0, planeTests = 0;
+		Gumshoe::Vector3_t eye = Gumshoe::V3((float)floorSizes[i][0] / 2.0f, 10.0f, (float)floorSizes[i][1] / 2.0f);
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			float angle = (float)frame * (3.14159265f / 180.0f);
+			BuildCameraMatrices(eye, eye + Gumshoe::V3(cosf(angle), -0.3f, sinf(angle)), view, projection);
+			frustum.ConstructFrustum(screenDepth, projection, view);
+
+			uint32 visibleTriangles = tree.Cull(&frustum, drawRanges);
+
+			const Gumshoe::QuadTree::visibilityStats_t& stats = tree.GetVisibilityStats();
+			uint64 rangeIndices = 0;
+			for (size_t r = 0; r < drawRanges.size(); r++)
+				rangeIndices += drawRanges[r].indexCount;
+			if ((rangeIndices != (uint64)visibleTriangles * 3) || (stats.drawRanges != drawRanges.size()) || (tree.GetDrawCount() != (int)visibleTriangles))
+				match = false;
+
+			nodesTested += stats.nodesTested;
+			visibleLeaves += stats.visibleLeaves;
+			ranges += stats.drawRanges;
+			triangles += stats.triangles;
+			planeTests += frustum.GetCullStats().planeTests;
+		}
+		snprintf(name, sizeof(name), "%dx%d floor, cull pass", floorSizes[i][0], floorSizes[i][1]);
+		ReportResult(name, ElapsedMs(start), frames);
+
+		printf("    per frame: %.0f nodes tested, %.0f plane tests, %.0f visible leaves in %.0f draw ranges, %.0f of %u triangles\n",
+		       (double)nodesTested / frames, (double)planeTests / frames, (double)visibleLeaves / frames, (double)ranges / frames,
+		       (double)triangles / frames, (uint32)indices.size() / 3);
+	}
+
+	printf("  draw ranges cover exactly the visible triangles: %s\n", Check(match));
+}
+
+
+// Area of the floor at ground level, of the wall tops and of the upright faces, degenerate triangles add nothing
+static void SumFloorAreas(DungeonFloor& floor, double areas[3])
+{
+	const std::vector<DungeonFloor::floorVertex_t>& vertices = floor.GetVertices();
+	const std::vector<uint32>& indices = floor.GetIndices();
+
+	areas[0] = areas[1] = areas[2] = 0.0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const Gumshoe::Vector3_t& v0 = vertices[indices[i]].position;
+		const Gumshoe::Vector3_t& v1 = vertices[indices[i + 1]].position;
+		const Gumshoe::Vector3_t& v2 = vertices[indices[i + 2]].position;
+		double e1[3] = { v1.x - v0.x, v1.y - v0.y, v1.z - v0.z };
+		double e2[3] = { v2.x - v0.x, v2.y - v0.y, v2.z - v0.z };
+		double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		double area = 0.5 * sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		if (fabs(n[1]) < 1e-9)
+			areas[2] += area;
+		else
+			areas[(v0.y > 1.0f) ? 1 : 0] += area;
+	}
+}
+
+static void BenchDynamic()
+{
+	const int floorSizes[][3] = { { 96, 96, 50 }, { 1024, 1024, 2000 } };
+	const int operations = 256;
+	const int heightQueries = 100000;
+	bool areasMatch = true, heightsMatch = true;
+	char name[96];
+
+	printf("dynamic:\n");
+
+	for (int i = 0; i < (int)(sizeof(floorSizes) / sizeof(floorSizes[0])); i++)
+	{
+		DungeonFloor floor;
+		Gumshoe::Random random(11);
+		floor.Build(random, floorSizes[i][0], floorSizes[i][1], floorSizes[i][2]);
+
+		const std::vector<DungeonFloor::floorVertex_t>& vertices = floor.GetVertices();
+		const std::vector<uint32>& indices = floor.GetIndices();
+		Gumshoe::QuadTree tree;
+		tree.Init(&vertices[0].position, sizeof(DungeonFloor::floorVertex_t), (uint32)vertices.size(), indices.data(), (uint32)indices.size() / 3);
+
+		// Doors to open, and walls next to open floor to knock through
+		std::vector<int> doors, walls;
+		for (int y = 0; y < floor.GetWidth(); y++)
+		{
+			for (int x = 0; x < floor.GetLength(); x++)
+			{
+				char tile = floor.GetTile(x, y);
+				if (tile == DungeonFloor::ClosedDoor)
+					doors.push_back(y * floor.GetLength() + x);
+				else if (tile == DungeonFloor::Wall && x > 0 && y > 0 && x + 1 < floor.GetLength() && y + 1 < floor.GetWidth() &&
+				         (floor.GetTile(x - 1, y) == DungeonFloor::Open || floor.GetTile(x, y - 1) == DungeonFloor::Open))
+					walls.push_back(y * floor.GetLength() + x);
+			}
+		}
+
+		// Time the floor update and the tree update for one changed tile at a time
+		DungeonFloor::geometryPatch_t patch;
+		uint64 removedTriangles = 0, addedTriangles = 0, nodesVisited = 0, movedNodes = 0;
+		int changes = 0;
+		double floorMs = 0.0, treeMs = 0.0, firstFloorMs = 0.0, firstTreeMs = 0.0;
+		for (int op = 0; op < operations; op++)
+		{
+			std::vector<int>& tiles = (op % 2 == 0 && !doors.empty()) ? doors : walls;
+			if (tiles.empty())
+				break;
+
+			int pick = random.RandomInt((int)tiles.size());
+			int position = tiles[pick];
+			tiles[pick] = tiles.back();
+			tiles.pop_back();
+
+			BenchClock::time_point start = BenchClock::now();
+			floor.SetTile(position % floor.GetLength(), position / floor.GetLength(),
+			              (&tiles == &doors) ? (char)DungeonFloor::OpenDoor : (char)DungeonFloor::Open);
+			floor.UpdateGeometry(patch);
+			if (op == 0)
+				firstFloorMs = ElapsedMs(start); // the first update builds the floor's lookups
+			else
+				floorMs += ElapsedMs(start);
+
+			start = BenchClock::now();
+			tree.UpdateTriangles(&vertices[0].position, sizeof(DungeonFloor::floorVertex_t), (uint32)vertices.size(), indices.data(),
+			                     patch.removedTriangles.data(), (uint32)patch.removedTriangles.size() / 3, patch.firstTriangle, patch.triangleCount);
+			if (op == 0)
+				firstTreeMs = ElapsedMs(start); // and makes room in the arrays
+			else
+				treeMs += ElapsedMs(start);
+
+			const Gumshoe::QuadTree::updateStats_t& stats = tree.GetUpdateStats();
+			removedTriangles += stats.removedTriangles;
+			addedTriangles += stats.addedTriangles;
+			nodesVisited += stats.nodesVisited;
+			movedNodes += stats.movedNodes;
+			changes++;
+		}
+
+		snprintf(name, sizeof(name), "%dx%d floor, first floor update", floorSizes[i][0], floorSizes[i][1]);
+		ReportResult(name, firstFloorMs, 1);
+		snprintf(name, sizeof(name), "%dx%d floor, first tree update", floorSizes[i][0], floorSizes[i][1]);
+		ReportResult(name, firstTreeMs, 1);
+		snprintf(name, sizeof(name), "%dx%d floor, update floor", floorSizes[i][0], floorSizes[i][1]);
+		ReportResult(name, floorMs, changes - 1);
+		snprintf(name, sizeof(name), "%dx%d floor, update tree", floorSizes[i][0], floorSizes[i][1]);
+		ReportResult(name, treeMs, changes - 1);
+		printf("    per change: %.1f triangles out, %.1f in, %.1f nodes visited, %.2f nodes moved\n", (double)removedTriangles / changes,
+		       (double)addedTriangles / changes, (double)nodesVisited / changes, (double)movedNodes / changes);
+
+		// The same map built from scratch, for the time and to check the patched floor covers the same ground
+		DungeonFloor fresh = floor;
+		Gumshoe::QuadTree freshTree;
+		BenchClock::time_point start = BenchClock::now();
+		fresh.ClassifyTiles();
+		fresh.BuildGeometry();
+		freshTree.Init(&fresh.GetVertices()[0].position, sizeof(DungeonFloor::floorVertex_t), (uint32)fresh.GetVertices().size(),
+		               fresh.GetIndices().data(), (uint32)fresh.GetIndices().size() / 3);
+		snprintf(name, sizeof(name), "%dx%d floor, rebuild floor and tree", floorSizes[i][0], floorSizes[i][1]);
+		ReportResult(name, ElapsedMs(start), 1);
+
+		double patchedAreas[3], freshAreas[3];
+		SumFloorAreas(floor, patchedAreas);
+		SumFloorAreas(fresh, freshAreas);
+		for (int a = 0; a < 3; a++)
+		{
+			if (fabs(patchedAreas[a] - freshAreas[a]) > 1e-6 * freshAreas[a] + 1e-3)
+				areasMatch = false;
+		}
+		printf("    areas patched/rebuilt: floor %.2f/%.2f, wall tops %.2f/%.2f, walls %.2f/%.2f\n", patchedAreas[0], freshAreas[0],
+		       patchedAreas[1], freshAreas[1], patchedAreas[2], freshAreas[2]);
+
+		// The patched tree against a tree built from the patched arrays, which have the same triangles in the same order
+		Gumshoe::QuadTree patchedMeshTree;
+		patchedMeshTree.Init(&vertices[0].position, sizeof(DungeonFloor::floorVertex_t), (uint32)vertices.size(), indices.data(), (uint32)indices.size() / 3);
+		int mismatches = 0;
+		for (int q = 0; q < heightQueries; q++)
+		{
+			float x = random.RandomFloat() * (float)floorSizes[i][0];
+			float z = random.RandomFloat() * (float)floorSizes[i][1];
+			float patchedHeight = 0.0f, builtHeight = 0.0f;
+			bool patchedFound = tree.GetHeightAtPosition(x, z, patchedHeight);
+			bool builtFound = patchedMeshTree.GetHeightAtPosition(x, z, builtHeight);
+
+			if ((patchedFound != builtFound) || (patchedFound && patchedHeight != builtHeight))
+				mismatches++;
+		}
+		printf("    %d changes, height mismatches against a tree built from the patched arrays: %d of %d\n", changes, mismatches, heightQueries);
+		if (mismatches != 0)
+			heightsMatch = false;
+	}
+
+	printf("  patched floors cover the same area as rebuilt ones: %s\n", Check(areasMatch));
+	printf("  patched trees give the same heights as rebuilt ones: %s\n", Check(heightsMatch));
+}
+
+
+//--------------------------------------------
+// Entity Broad Phase Benchmark
+//--------------------------------------------
+struct benchEntities_t
+{
+	std::vector<float> x, z, velocityX, velocityZ, extent;
+};
+
+// Random walkers in a square world, bouncing off its edges
+static void InitBenchEntities(benchEntities_t& entities, uint32 count, float worldSize, Gumshoe::Random& random)
+{
+	entities.x.resize(count);
+	entities.z.resize(count);
+	entities.velocityX.resize(count);
+	entities.velocityZ.resize(count);
+	entities.extent.resize(count);
+
+	for (uint32 i = 0; i < count; i++)
+	{
+		entities.x[i] = random.RandomFloat() * worldSize;
+		entities.z[i] = random.RandomFloat() * worldSize;
+		entities.velocityX[i] = (random.RandomFloat() * 2.0f - 1.0f) * 2.75f; // up to jogging speed
+		entities.velocityZ[i] = (random.RandomFloat() * 2.0f - 1.0f) * 2.75f; // up to jogging speed
+		entities.extent[i] = 0.25f + random.RandomFloat() * 0.25f;
+	}
+}
+
+static void StepBenchEntities(benchEntities_t& entities, float worldSize, float dt)
+{
+	for (size_t i = 0; i < entities.x.size(); i++)
+	{
+		entities.x[i] += entities.velocityX[i] * dt;
+		entities.z[i] += entities.velocityZ[i] * dt;
+
+		if (entities.x[i] < 0.0f || entities.x[i] > worldSize)
+			entities.velocityX[i] = -entities.velocityX[i];
+		if (entities.z[i] < 0.0f || entities.z[i] > worldSize)
+			entities.velocityZ[i] = -entities.velocityZ[i];
+	}
+}
+
+static bool PairLess(const Gumshoe::SpatialHash::entityPair_t& a, const Gumshoe::SpatialHash::entityPair_t& b)
+{
+	return (a.first != b.first) ? (a.first < b.first) : (a.second < b.second);
+}
+
+// Every overlapping pair by testing all of them
+static void BruteForcePairs(const benchEntities_t& entities, std::vector<Gumshoe::SpatialHash::entityPair_t>& pairs)
+{
+	uint32 count = (uint32)entities.x.size();
+
+	pairs.clear();
+	for (uint32 i = 0; i < count; i++)
+	{
+		for (uint32 j = i + 1; j < count; j++)
+		{
+			float sum = entities.extent[i] + entities.extent[j];
+			if (fabsf(entities.x[j] - entities.x[i]) <= sum && fabsf(entities.z[j] - entities.z[i]) <= sum)
+			{
+				Gumshoe::SpatialHash::entityPair_t pair = { i, j };
+				pairs.push_back(pair);
+			}
+		}
+	}
+}
+
+static void BenchEntities()
+{
+	const uint32 entityCounts[] = { 10000, 100000 };
+	const float density = 0.05f; // entities per square metre, about one per room tile of a crowded floor
+	const int ticks = 120;
+	const float dt = 1.0f / 60.0f;
+	const int queries = 100000;
+	bool pairsMatch = true, queriesMatch = true;
+	char name[96];
+
+	printf("entities:\n");
+
+	for (int c = 0; c < (int)(sizeof(entityCounts) / sizeof(entityCounts[0])); c++)
+	{
+		uint32 count = entityCounts[c];
+		float worldSize = sqrtf((float)count / density);
+		Gumshoe::Random random(5);
+		benchEntities_t entities;
+		InitBenchEntities(entities, count, worldSize, random);
+
+		// Two tile cells, twice the biggest entity, so a box reaches at most one cell past its own
+		Gumshoe::SpatialHash hash;
+		hash.Init(2.0f, count);
+
+		BenchClock::time_point start = BenchClock::now();
+		for (uint32 i = 0; i < count; i++)
+			hash.Insert(i, entities.x[i], entities.z[i], entities.extent[i]);
+		snprintf(name, sizeof(name), "%u entities, insert", count);
+		ReportResult(name, ElapsedMs(start), count);
+
+		// A tick is one batched move of every entity and a search for every overlapping pair
+		std::vector<Gumshoe::SpatialHash::entityPair_t> pairs;
+		double moveMs = 0.0, pairMs = 0.0;
+		uint64 pairCount = 0;
+		hash.ResetStats();
+		for (int tick = 0; tick < ticks; tick++)
+		{
+			StepBenchEntities(entities, worldSize, dt);
+
+			start = BenchClock::now();
+			hash.MoveEntities(nullptr, entities.x.data(), entities.z.data(), count);
+			moveMs += ElapsedMs(start);
+
+			pairs.clear();
+			start = BenchClock::now();
+			pairCount += hash.FindPairs(pairs);
+			pairMs += ElapsedMs(start);
+		}
+		snprintf(name, sizeof(name), "%u entities, batched move", count);
+		ReportResult(name, moveMs, (uint64)count * ticks);
+		snprintf(name, sizeof(name), "%u entities, find pairs", count);
+		ReportResult(name, pairMs, (uint64)count * ticks);
+		const Gumshoe::SpatialHash::hashStats_t& stats = hash.GetStats();
+		printf("    per tick: %.2f ms, %.1f pairs, %.1f cell changes, %.0f box tests\n", (moveMs + pairMs) / ticks,
+		       (double)pairCount / ticks, (double)stats.cellChanges / ticks, (double)stats.entitiesTested / ticks);
+
+		// One entity at a time, and taking entities out and putting them back
+		start = BenchClock::now();
+		for (uint32 i = 0; i < count; i++)
+			hash.Move(i, entities.x[i] + 0.75f, entities.z[i]);
+		snprintf(name, sizeof(name), "%u entities, single moves", count);
+		ReportResult(name, ElapsedMs(start), count);
+
+		start = BenchClock::now();
+		for (uint32 i = 0; i < count; i++)
+		{
+			hash.Remove(i);
+			hash.Insert(i, entities.x[i], entities.z[i], entities.extent[i]);
+		}
+		snprintf(name, sizeof(name), "%u entities, remove and insert", count);
+		ReportResult(name, ElapsedMs(start), count);
+
+		// Neighbourhood queries around random points
+		std::vector<uint32> found;
+		uint64 foundCount = 0;
+		int queryMismatches = 0;
+		start = BenchClock::now();
+		for (int q = 0; q < queries; q++)
+		{
+			float x = random.RandomFloat() * worldSize;
+			float z = random.RandomFloat() * worldSize;
+
+			found.clear();
+			foundCount += hash.Query(x - 2.0f, z - 2.0f, x + 2.0f, z + 2.0f, found);
+		}
+		snprintf(name, sizeof(name), "%u entities, 4x4m queries", count);
+		ReportResult(name, ElapsedMs(start), queries);
+		printf("    %.2f entities per query\n", (double)foundCount / queries);
+
+		if (count > 10000)
+			continue;
+
+		// The hash against testing every pair, and queries against testing every entity
+		start = BenchClock::now();
+		std::vector<Gumshoe::SpatialHash::entityPair_t> brutePairs;
+		BruteForcePairs(entities, brutePairs);
+		snprintf(name, sizeof(name), "%u entities, all pairs tested", count);
+		ReportResult(name, ElapsedMs(start), count);
+
+		pairs.clear();
+		hash.FindPairs(pairs);
+		std::sort(pairs.begin(), pairs.end(), PairLess);
+		if (pairs.size() != brutePairs.size() ||
+		    (!pairs.empty() && memcmp(pairs.data(), brutePairs.data(), pairs.size() * sizeof(pairs[0])) != 0))
+			pairsMatch = false;
+
+		for (int q = 0; q < 1000; q++)
+		{
+			float x = random.RandomFloat() * worldSize;
+			float z = random.RandomFloat() * worldSize;
+			std::vector<uint32> expected;
+
+			for (uint32 i = 0; i < count; i++)
+			{
+				if (entities.x[i] + entities.extent[i] >= x - 2.0f && entities.x[i] - entities.extent[i] <= x + 2.0f &&
+				    entities.z[i] + entities.extent[i] >= z - 2.0f && entities.z[i] - entities.extent[i] <= z + 2.0f)
+					expected.push_back(i);
+			}
+
+			found.clear();
+			hash.Query(x - 2.0f, z - 2.0f, x + 2.0f, z + 2.0f, found);
+			std::sort(found.begin(), found.end());
+			if (found != expected)
+				queryMismatches++;
+		}
+		if (queryMismatches != 0)
+			queriesMatch = false;
+		printf("    %u pairs, query mismatches: %d of 1000\n", (uint32)brutePairs.size(), queryMismatches);
+	}
+
+	printf("  hash pairs match testing every pair: %s\n", Check(pairsMatch));
+	printf("  hash queries match testing every entity: %s\n", Check(queriesMatch));
+}
+
+
+//--------------------------------------------
+// Tile Collision Benchmark
+//--------------------------------------------
+struct collisionEntities_t
+{
+	std::vector<Gumshoe::Vector3_t> position, velocity;
+};
+
+// Entities standing in the middle of random open tiles, heading off in random directions
+static void InitCollisionEntities(collisionEntities_t& entities, DungeonFloor& floor, uint32 count, float speed, Gumshoe::Random& random)
+{
+	std::vector<int> open;
+	for (int y = 0; y < floor.GetWidth(); y++)
+		for (int x = 0; x < floor.GetLength(); x++)
+			if (!DungeonFloor::IsSolid(floor.GetTile(x, y)))
+				open.push_back(y * floor.GetLength() + x);
+
+	entities.position.resize(count);
+	entities.velocity.resize(count);
+	for (uint32 i = 0; i < count; i++)
+	{
+		int tile = open[random.RandomInt((int)open.size())];
+		float angle = random.RandomFloat() * 6.2831853f;
+
+		entities.position[i] = Gumshoe::V3((float)(tile % floor.GetLength()) + 0.5f, 0.0f, (float)(tile / floor.GetLength()) + 0.5f);
+		entities.velocity[i] = Gumshoe::V3(cosf(angle) * speed, 0.0f, sinf(angle) * speed);
+	}
+}
+
+static void BenchCollision()
+{
+	const int floorSizes[][3] = { { 96, 96, 60 }, { 256, 256, 400 } };
+	const float speeds[] = { 2.75f, 10.0f, 100.0f }; // jogging, sprinting, and over a tile and a half per tick
+	const uint32 entityCount = 10000;
+	const int ticks = 600;
+	const float dt = 1.0f / 60.0f;
+	const Gumshoe::Vector3_t halfSize = { 0.25f, 0.915f, 0.125f }; // the player's box
+	bool neverInWalls = true;
+	bool reachesWallTops = true;
+	char name[96];
+
+	printf("collision:\n");
+
+	for (int f = 0; f < (int)(sizeof(floorSizes) / sizeof(floorSizes[0])); f++)
+	{
+		DungeonFloor floor;
+		Gumshoe::Random random(3);
+		floor.Build(random, floorSizes[f][0], floorSizes[f][1], floorSizes[f][2]);
+
+		// Walls are solid where their tops are drawn, the same as GameWorld's collider
+		std::vector<uint8> solid;
+		floor.GetSolidCells(solid);
+		Gumshoe::Physics::TileCollider collider;
+		collider.Init(solid.data(), floor.GetLength() * COLLIDER_CELLS_PER_TILE, floor.GetWidth() * COLLIDER_CELLS_PER_TILE,
+		              COLLIDER_CELLS_PER_TILE);
+
+		// Walking straight at a north to south wall from either side has to end at the face of its top,
+		// unless the wall turns towards that side there
+		const std::vector<DungeonFloor::floorTile_t>& tiles = floor.GetTiles();
+		uint32 wallWalks = 0;
+		for (size_t i = 0; i < tiles.size(); i++)
+		{
+			const DungeonFloor::floorTile_t& tile = tiles[i];
+			if (floor.GetTile(tile.x, tile.z) != DungeonFloor::Wall ||
+			    !(tile.geoFeatures & DungeonFloor::NorthWall) || !(tile.geoFeatures & DungeonFloor::SouthWall))
+				continue;
+
+			for (int side = -1; side <= 1; side += 2)
+			{
+				if (DungeonFloor::IsSolid(floor.GetTile(tile.x + side, tile.z)) ||
+				    (tile.geoFeatures & ((side < 0) ? DungeonFloor::WestWall : DungeonFloor::EastWall)))
+					continue;
+
+				Gumshoe::Vector3_t position = Gumshoe::V3((float)tile.x + 0.5f + (float)side, 0.0f, (float)tile.z + 0.5f);
+				Gumshoe::Vector3_t velocity = Gumshoe::V3(0.0f, 0.0f, 0.0f);
+				float face = (float)tile.x + ((side < 0) ? 0.4f : 0.6f);
+
+				collider.MoveBox(position, velocity, halfSize, Gumshoe::V3(-2.0f * (float)side, 0.0f, 0.0f));
+				float reached = position.x - (float)side * halfSize.x;
+				reachesWallTops &= (fabsf(reached - face) <= 2.0f * TILE_COLLIDER_SKIN) && collider.IsBoxClear(position, halfSize);
+				wallWalks++;
+			}
+		}
+		reachesWallTops &= (wallWalks > 0);
+
+		for (int s = 0; s < (int)(sizeof(speeds) / sizeof(speeds[0])); s++)
+		{
+			collisionEntities_t entities;
+			InitCollisionEntities(entities, floor, entityCount, speeds[s], random);
+			collisionEntities_t legacy = entities;
+
+			// The old move: no walls, and a walk over the tiles between the old and new positions for the floor
+			uint32 legacyTiles = 0;
+			BenchClock::time_point start = BenchClock::now();
+			for (int tick = 0; tick < ticks; tick++)
+			{
+				for (uint32 i = 0; i < entityCount; i++)
+				{
+					Gumshoe::Vector3_t oldPosition = legacy.position[i];
+					legacy.position[i] += legacy.velocity[i] * dt;
+
+					int minTileX = (int)floorf(std::min(legacy.position[i].x, oldPosition.x));
+					int maxTileX = (int)floorf(std::max(legacy.position[i].x, oldPosition.x));
+					int minTileZ = (int)floorf(std::min(legacy.position[i].z, oldPosition.z));
+					int maxTileZ = (int)floorf(std::max(legacy.position[i].z, oldPosition.z));
+					for (int x = minTileX; x <= maxTileX; x++)
+						for (int z = minTileZ; z <= maxTileZ; z++)
+							legacyTiles += (floor.GetTile(x, z) != DungeonFloor::Empty) ? 1 : 0;
+				}
+			}
+			double legacyMs = ElapsedMs(start);
+
+			uint32 legacyInWalls = 0;
+			for (uint32 i = 0; i < entityCount; i++)
+				legacyInWalls += collider.IsBoxClear(legacy.position[i], halfSize) ? 0 : 1;
+
+			// The swept move, bouncing off in a new direction after touching a wall
+			uint64 inWalls = 0;
+			double moveMs = 0.0;
+			collider.ResetStats();
+			for (int tick = 0; tick < ticks; tick++)
+			{
+				start = BenchClock::now();
+				for (uint32 i = 0; i < entityCount; i++)
+				{
+					uint32 contacts = collider.MoveBox(entities.position[i], entities.velocity[i], halfSize, entities.velocity[i] * dt);
+
+					if (contacts & (Gumshoe::Physics::TileCollider::ContactX | Gumshoe::Physics::TileCollider::ContactZ))
+					{
+						float angle = random.RandomFloat() * 6.2831853f;
+						entities.velocity[i] = Gumshoe::V3(cosf(angle) * speeds[s], 0.0f, sinf(angle) * speeds[s]);
+					}
+				}
+				moveMs += ElapsedMs(start);
+
+				for (uint32 i = 0; i < entityCount; i++)
+					inWalls += collider.IsBoxClear(entities.position[i], halfSize) ? 0 : 1;
+			}
+			if (inWalls != 0)
+				neverInWalls = false;
+
+			snprintf(name, sizeof(name), "%dx%d, %.2f m/s, legacy move", floorSizes[f][0], floorSizes[f][1], speeds[s]);
+			ReportResult(name, legacyMs, (uint64)entityCount * ticks);
+			snprintf(name, sizeof(name), "%dx%d, %.2f m/s, swept move", floorSizes[f][0], floorSizes[f][1], speeds[s]);
+			ReportResult(name, moveMs, (uint64)entityCount * ticks);
+
+			const Gumshoe::Physics::TileCollider::sweepStats_t& stats = collider.GetStats();
+			printf("    per move: %.2f sweeps, %.2f tiles tested (legacy %.2f), %.3f contacts\n", (double)stats.sweeps / stats.moves,
+			       (double)stats.tilesTested / stats.moves, (double)legacyTiles / ((double)entityCount * ticks), (double)stats.contacts / stats.moves);
+			printf("    in walls after the legacy moves: %u, after swept moves: %llu\n", legacyInWalls, (unsigned long long)inWalls);
+		}
+	}
+
+	// Moves too small to sweep, like the denormal velocities drag leaves behind, from the middle of a
+	// room and from resting the skin away from one of its walls
+	const uint8 room[4 * 4] = { 1, 1, 1, 1,
+	                            1, 0, 0, 1,
+	                            1, 0, 0, 1,
+	                            1, 1, 1, 1 };
+	const float tinyMoves[][2] = { { 1.0e-41f, 0.0f }, { -1.0e-41f, 1.0e-41f }, { 1.0e-41f, 0.5f }, { -3.0f, 1.0e-41f },
+	                               { 5.0e-7f, -5.0e-7f }, { -5.0e-7f, 2.0f }, { 1.0e-38f, -1.0e-38f }, { -1.0e-41f, -1.0e-41f } };
+	Gumshoe::Physics::TileCollider roomCollider;
+	roomCollider.Init(room, 4, 4);
+	bool tinyMovesSafe = true;
+
+	for (int m = 0; m < 2 * (int)(sizeof(tinyMoves) / sizeof(tinyMoves[0])); m++)
+	{
+		Gumshoe::Vector3_t position = Gumshoe::V3((m & 1) ? 1.0f + TILE_COLLIDER_SKIN + halfSize.x : 2.0f, 0.0f, 2.0f);
+		Gumshoe::Vector3_t velocity = Gumshoe::V3(0.0f, 0.0f, 0.0f);
+		const float* move = tinyMoves[m / 2];
+
+		for (int tick = 0; tick < 1000; tick++)
+		{
+			// A move can't take the box further than the move and the skin
+			Gumshoe::Vector3_t before = position;
+			roomCollider.MoveBox(position, velocity, halfSize, Gumshoe::V3(move[0], 0.0f, move[1]));
+			tinyMovesSafe &= (fabsf(position.x - before.x) <= fabsf(move[0]) + 2.0f*TILE_COLLIDER_SKIN);
+			tinyMovesSafe &= (fabsf(position.z - before.z) <= fabsf(move[1]) + 2.0f*TILE_COLLIDER_SKIN);
+			tinyMovesSafe &= roomCollider.IsBoxClear(position, halfSize);
+		}
+	}
+
+	printf("  swept boxes never end a move inside a wall: %s\n", Check(neverInWalls));
+	printf("  boxes walk up to the face of the wall tops: %s\n", Check(reachesWallTops));
+	printf("  moves too small to sweep stay out of the walls: %s\n", Check(tinyMovesSafe));
+}
+
+
+//--------------------------------------------
+// Entity Store Benchmark
+//--------------------------------------------
+// An entity laid out like Entity, one heap object each, with room for what its model would hold
+struct legacyEntity_t
+{
+	Gumshoe::Vector3_t position, rotation;
+	float maxVelocity;
+	Gumshoe::Vector3_t velocity, accel;
+	bool groundDragEn;
+	void* model;
+	Gumshoe::Vector3_t aabb;
+	Gumshoe::Vector3_t moveAccel;
+	char modelData[256];
+};
+
+// Copy of Entity::Move without the model update
+static void LegacyMoveEntity(legacyEntity_t& entity, Gumshoe::Physics::TileCollider* collider, float frameTime)
+{
+	float dt = frameTime/1000.0f;
+	Gumshoe::Vector3_t accelVec = {entity.moveAccel.x, 0.0f, entity.moveAccel.z};
+
+	float accelLength = Gumshoe::LengthSq(accelVec);
+	if(accelLength > 1.0f)
+	{
+		accelVec *= (1.0f / Gumshoe::SquareRoot(accelLength));
+	}
+
+	float entitySpeed = WALK_SPEED*GROUND_DRAG;
+	accelVec *= entitySpeed;
+
+	float drag = entity.groundDragEn ? GROUND_DRAG : AIR_DRAG;
+	accelVec.x += -drag*entity.velocity.x;
+	accelVec.z += -drag*entity.velocity.z;
+	accelVec.y = entity.moveAccel.y*entitySpeed*JUMP_SCALE - GRAVITY_ACCEL;
+
+	Gumshoe::Vector3_t positionDelta = (0.5f*accelVec*Gumshoe::Square(dt) + entity.velocity*dt);
+	entity.velocity = accelVec*dt + entity.velocity;
+
+	if (collider)
+	{
+		collider->MoveBox(entity.position, entity.velocity, 0.5f*entity.aabb, positionDelta);
+	}
+	else
+	{
+		entity.position += positionDelta;
+		if (entity.position.y < 0.0f)
+		{
+			entity.position.y = 0.0f;
+			entity.velocity.y = std::max(entity.velocity.y, 0.0f);
+		}
+	}
+}
+
+static void BenchStore()
+{
+	const uint32 entityCounts[] = { 1000, 10000, 50000 };
+	const Gumshoe::Vector3_t aabb = { 0.5f, 1.83f, 0.25f };
+	const float frameTime = 1000.0f / 60.0f;
+	bool storeMatches = true;
+	bool idsKept = true;
+	char name[96];
+
+	printf("store:\n");
+
+	DungeonFloor floor;
+	Gumshoe::Random floorRandom(3);
+	floor.Build(floorRandom, 256, 256, 400);
+
+	std::vector<uint8> solid;
+	floor.GetSolidTiles(solid);
+	Gumshoe::Physics::TileCollider collider;
+	collider.Init(solid.data(), floor.GetLength(), floor.GetWidth());
+
+	std::vector<int> open;
+	for (int y = 0; y < floor.GetWidth(); y++)
+		for (int x = 0; x < floor.GetLength(); x++)
+			if (!DungeonFloor::IsSolid(floor.GetTile(x, y)))
+				open.push_back(y * floor.GetLength() + x);
+
+	for (int c = 0; c < (int)(sizeof(entityCounts) / sizeof(entityCounts[0])); c++)
+	{
+		uint32 count = entityCounts[c];
+		int ticks = (int)(6000000 / count);
+
+		for (int walls = 0; walls < 2; walls++)
+		{
+			Gumshoe::Physics::TileCollider* tiles = walls ? &collider : nullptr;
+			Gumshoe::Random random(11);
+			Gumshoe::EntityStore store;
+			std::vector<legacyEntity_t*> legacy(count);
+			std::vector<uint32> ids(count);
+
+			// Same spawns for both, some of them in the air, every one pushing in its own direction
+			store.Init(count);
+			for (uint32 i = 0; i < count; i++)
+			{
+				int tile = open[random.RandomInt((int)open.size())];
+				Gumshoe::Vector3_t position = Gumshoe::V3((float)(tile % floor.GetLength()) + 0.5f, 0.0f, (float)(tile / floor.GetLength()) + 0.5f);
+				Gumshoe::Vector3_t moveAccel = Gumshoe::V3(random.RandomFloat() * 2.0f - 1.0f, 0.0f, random.RandomFloat() * 2.0f - 1.0f);
+				bool onGround = random.RandomInt(4) != 0;
+
+				legacy[i] = new legacyEntity_t();
+				legacy[i]->position = position;
+				legacy[i]->aabb = aabb;
+				legacy[i]->groundDragEn = onGround;
+				legacy[i]->moveAccel = moveAccel;
+
+				ids[i] = store.Add(position, 0.5f*aabb);
+				store.SetMoveAccel(ids[i], moveAccel);
+				store.SetOnGround(ids[i], onGround);
+			}
+
+			BenchClock::time_point start = BenchClock::now();
+			for (int tick = 0; tick < ticks; tick++)
+				for (uint32 i = 0; i < count; i++)
+					LegacyMoveEntity(*legacy[i], tiles, frameTime);
+			double legacyMs = ElapsedMs(start);
+
+			start = BenchClock::now();
+			for (int tick = 0; tick < ticks; tick++)
+				store.Update(frameTime, tiles);
+			double storeMs = ElapsedMs(start);
+
+			// The sums are grouped a little differently, so allow for rounding
+			float maxError = 0.0f;
+			for (uint32 i = 0; i < count; i++)
+			{
+				Gumshoe::Vector3_t position;
+				store.GetPosition(ids[i], position);
+				maxError = std::max(maxError, std::max(fabsf(position.x - legacy[i]->position.x), fabsf(position.z - legacy[i]->position.z)));
+			}
+			if (maxError > 0.01f)
+				storeMatches = false;
+
+			snprintf(name, sizeof(name), "%u entities, %s, heap objects", count, walls ? "walls" : "open");
+			ReportResult(name, legacyMs, (uint64)count * ticks);
+			snprintf(name, sizeof(name), "%u entities, %s, store", count, walls ? "walls" : "open");
+			ReportResult(name, storeMs, (uint64)count * ticks);
+			printf("    largest position difference: %g\n", maxError);
+
+			// Removing entities moves others around in the arrays, but not to other ids
+			for (uint32 i = 0; i < count; i += 3)
+				store.Remove(ids[i]);
+			for (uint32 i = 0; i < count; i++)
+			{
+				Gumshoe::Vector3_t position;
+				bool found = store.GetPosition(ids[i], position);
+				if (found != (i % 3 != 0) ||
+				    (found && (fabsf(position.x - legacy[i]->position.x) > 0.01f || fabsf(position.z - legacy[i]->position.z) > 0.01f)))
+					idsKept = false;
+			}
+
+			for (uint32 i = 0; i < count; i++)
+				delete legacy[i];
+		}
+	}
+
+	printf("  store moves match the heap objects: %s\n", Check(storeMatches));
+	printf("  ids find the same entities after removals: %s\n", Check(idsKept));
+}
+
+
+//--------------------------------------------
+// Fixed Step Replay Benchmark
+//--------------------------------------------
+// A player that changes direction every 40 steps, jumps now and then and looks around, the same every run
+static Gumshoe::InputLog::simInput_t ScriptedInput(uint32 step)
+{
+	Gumshoe::InputLog::simInput_t input = {};
+	uint32 hash = (step / 40 + 1) * 0x9E3779B1u;
+
+	input.buttons = (uint8)((hash >> 24) & 0x0F);
+	if (step % 97 == 0)
+		input.buttons |= Gumshoe::InputLog::ButtonJump;
+	if (step % 5 == 0)
+	{
+		input.lookX = (int16)((int)((hash >> 8) & 0x1F) - 16);
+		input.lookY = (int16)((int)((hash >> 16) & 0x0F) - 8);
+	}
+
+	return input;
+}
+
+// Entities on the floor, each pushing off in its own direction
+static void SpawnReplayEntities(Gumshoe::EntityStore& entities, DungeonFloor& floor, uint32 count)
+{
+	Gumshoe::Random random(5);
+	std::vector<int> open;
+	for (int y = 0; y < floor.GetWidth(); y++)
+		for (int x = 0; x < floor.GetLength(); x++)
+			if (!DungeonFloor::IsSolid(floor.GetTile(x, y)))
+				open.push_back(y * floor.GetLength() + x);
+
+	entities.Init(count);
+	for (uint32 i = 0; i < count; i++)
+	{
+		int tile = open[random.RandomInt((int)open.size())];
+		uint32 id = entities.Add(Gumshoe::V3((float)(tile % floor.GetLength()) + 0.5f, 0.0f, (float)(tile / floor.GetLength()) + 0.5f), 0.5f*PLAYER_AABB);
+		entities.SetMoveAccel(id, Gumshoe::V3(random.RandomFloat() * 2.0f - 1.0f, 0.0f, random.RandomFloat() * 2.0f - 1.0f));
+	}
+}
+
+// Frame times for a render rate, with some jitter and a long stall every so often when asked for
+static float NextFrameTime(Gumshoe::Random& random, float fps, bool stalls, uint32 frame)
+{
+	float frameTime = 1000.0f / fps;
+
+	if (stalls)
+	{
+		frameTime *= 0.5f + random.RandomFloat();
+		if (frame % 1000 == 999)
+			frameTime = 400.0f;
+	}
+
+	return frameTime;
+}
+
+static void BenchReplay()
+{
+	const float frameRates[] = { 30.0f, 60.0f, 144.0f, 60.0f };
+	const bool frameStalls[] = { false, false, false, true };
+	const uint32 stepCount = 36000; // ten minutes of play
+	const uint32 entityCount = 1000;
+	const char* logFilename = "gumshoe_bench_replay.gil";
+	bool sameState = true;
+	bool replayMatches = true;
+	char name[96];
+
+	printf("replay:\n");
+
+	// The floor a game with seed 7 starts on, around the entrance
+	ChunkedWorld chunks;
+	DungeonFloor floor;
+	int entranceX = 0, entranceZ = 0, windowX, windowZ;
+	chunks.Init(7, DEFAULT_CHUNK_BUDGET);
+	chunks.GetEntranceLocation(entranceX, entranceZ);
+	ChunkedWorld::GetWindowOrigin(entranceX, entranceZ, windowX, windowZ);
+	floor.Build(chunks, 0, windowX, windowZ, CHUNK_WINDOW * CHUNK_SIZE, CHUNK_WINDOW * CHUNK_SIZE);
+
+	std::vector<uint8> solid;
+	floor.GetSolidCells(solid);
+	Gumshoe::Physics::TileCollider collider;
+	collider.Init(solid.data(), floor.GetLength() * COLLIDER_CELLS_PER_TILE, floor.GetWidth() * COLLIDER_CELLS_PER_TILE,
+	              COLLIDER_CELLS_PER_TILE);
+
+	Gumshoe::Vector3_t spawn = Gumshoe::V3((float)(entranceX - windowX), 1.0f, (float)(entranceZ - windowZ));
+
+	uint64 firstHash = 0;
+	Gumshoe::Vector3_t firstVariable = {};
+	float variableSpread = 0.0f;
+	Gumshoe::InputLog log;
+
+	for (int r = 0; r < (int)(sizeof(frameRates) / sizeof(frameRates[0])); r++)
+	{
+		Gumshoe::Random frameRandom(13);
+		Gumshoe::SimScheduler scheduler;
+		Gumshoe::EntityStore entities;
+		GameSim sim;
+		uint32 frames = 0;
+
+		// Fixed steps: however the frames fall, the same steps get the same input
+		SpawnReplayEntities(entities, floor, entityCount);
+		scheduler.Init(SIM_STEP_MS, SIM_MAX_STEPS_PER_FRAME);
+		sim.Init(&collider, &entities, spawn, SIM_STEP_MS);
+
+		Gumshoe::InputLog::logHeader_t header = {};
+		header.seed = 7;
+		header.stepMs = SIM_STEP_MS;
+		header.spawnX = spawn.x;
+		header.spawnY = spawn.y;
+		header.spawnZ = spawn.z;
+		header.windowX = windowX;
+		header.windowZ = windowZ;
+		log.Begin(header);
+
+		BenchClock::time_point start = BenchClock::now();
+		while (sim.GetStepCount() < stepCount)
+		{
+			uint32 steps = scheduler.Advance(NextFrameTime(frameRandom, frameRates[r], frameStalls[r], frames++));
+			for (uint32 i = 0; i < steps && sim.GetStepCount() < stepCount; i++)
+			{
+				Gumshoe::InputLog::simInput_t input = ScriptedInput(sim.GetStepCount());
+				log.Record(input);
+				sim.Step(input);
+			}
+		}
+		double liveMs = ElapsedMs(start);
+
+		uint64 hash = sim.GetStateHash();
+		if (r == 0)
+			firstHash = hash;
+		else if (hash != firstHash)
+			sameState = false;
+
+		// Variable steps: the old way, one step per frame of whatever length the frame was
+		Gumshoe::EntityStore variable;
+		variable.Init(1);
+		uint32 variableId = variable.Add(spawn, 0.5f*PLAYER_AABB);
+		frameRandom = Gumshoe::Random(13);
+		double elapsed = 0.0;
+		for (frames = 0; elapsed < stepCount * SIM_STEP_MS; frames++)
+		{
+			float frameTime = NextFrameTime(frameRandom, frameRates[r], frameStalls[r], frames);
+			Gumshoe::InputLog::simInput_t input = ScriptedInput((uint32)(elapsed / SIM_STEP_MS));
+			Gumshoe::Vector3_t move = Gumshoe::V3(0.0f, 0.0f, 0.0f);
+			move.z += (input.buttons & Gumshoe::InputLog::ButtonForward) ? 1.0f : 0.0f;
+			move.z -= (input.buttons & Gumshoe::InputLog::ButtonBack) ? 1.0f : 0.0f;
+			move.x -= (input.buttons & Gumshoe::InputLog::ButtonLeft) ? 1.0f : 0.0f;
+			move.x += (input.buttons & Gumshoe::InputLog::ButtonRight) ? 1.0f : 0.0f;
+			variable.SetMoveAccel(variableId, move);
+			variable.Update(frameTime, &collider);
+			elapsed += frameTime;
+		}
+
+		Gumshoe::Vector3_t variableEnd;
+		variable.GetPosition(variableId, variableEnd);
+		if (r == 0)
+			firstVariable = variableEnd;
+		variableSpread = std::max(variableSpread, std::max(fabsf(variableEnd.x - firstVariable.x), fabsf(variableEnd.z - firstVariable.z)));
+
+		const Gumshoe::SimScheduler::schedulerStats_t& stats = scheduler.GetStats();
+		snprintf(name, sizeof(name), "%.0f fps%s, live", frameRates[r], frameStalls[r] ? " with stalls" : "");
+		ReportResult(name, liveMs, stepCount);
+		printf("    %llu frames, %.2f steps/frame, %llu frames hit the catch-up limit (%.0f ms dropped), state hash %016llx\n",
+		       (unsigned long long)stats.frames, (double)stats.steps / stats.frames, (unsigned long long)stats.clampedFrames,
+		       stats.droppedMs, (unsigned long long)hash);
+		printf("    variable step player ends at (%.3f, %.3f)\n", variableEnd.x, variableEnd.z);
+	}
+
+	// Replay the last session from its log, through a file
+	log.Save(logFilename);
+	Gumshoe::InputLog loaded;
+	if (!loaded.Load(logFilename))
+		replayMatches = false;
+
+	// The same log with its input size damaged has to be refused, not allocated
+	bool damagedRefused = false;
+	FILE* logFile = fopen(logFilename, "r+b");
+	if (logFile)
+	{
+		uint32 damagedSize = 0xFFFFFFF0;
+		fseek(logFile, 2 * sizeof(uint32) + sizeof(Gumshoe::InputLog::logHeader_t), SEEK_SET);
+		fwrite(&damagedSize, sizeof(damagedSize), 1, logFile);
+		fclose(logFile);
+
+		Gumshoe::InputLog damaged;
+		damagedRefused = !damaged.Load(logFilename);
+	}
+	remove(logFilename);
+
+	Gumshoe::EntityStore entities;
+	GameSim sim;
+	Gumshoe::InputLog::simInput_t input;
+	SpawnReplayEntities(entities, floor, entityCount);
+	const Gumshoe::InputLog::logHeader_t& header = loaded.GetHeader();
+	sim.Init(&collider, &entities, Gumshoe::V3(header.spawnX, header.spawnY, header.spawnZ), header.stepMs);
+
+	BenchClock::time_point start = BenchClock::now();
+	while (loaded.Replay(input))
+		sim.Step(input);
+	double replayMs = ElapsedMs(start);
+
+	if (sim.GetStepCount() != stepCount || sim.GetStateHash() != firstHash)
+		replayMatches = false;
+
+	ReportResult("headless replay", replayMs, stepCount);
+	printf("    %u bytes of input for %u steps (%.1f bytes a minute), %.0fx real time\n", loaded.GetSize(), header.stepCount,
+	       loaded.GetSize() / (header.stepCount * header.stepMs / 60000.0), (stepCount * SIM_STEP_MS) / replayMs);
+	printf("  variable steps end up to %.3f apart across frame rates\n", variableSpread);
+	printf("  fixed steps end in the same state at every frame rate: %s\n", Check(sameState));
+	printf("  replaying the log ends in the same state: %s\n", Check(replayMatches));
+	printf("  a log with a damaged input size is refused: %s\n", Check(damagedRefused));
+}
+
+
+//--------------------------------------------
+// Rigid Body Benchmark
+//--------------------------------------------
+static Gumshoe::Physics::AABB MakeShape(uint32 type, Gumshoe::Vector3_t position, Gumshoe::Vector3_t size, float radius)
+{
+	Gumshoe::Physics::AABB shape;
+	shape.SetType(type);
+	shape.SetSize(size);
+	shape.SetRadius(radius);
+	shape.SetPosition(&position);
+	return shape;
+}
+
+// One narrow phase case with a known answer
+static bool CheckCollide(const Gumshoe::Physics::AABB& first, const Gumshoe::Physics::AABB& second, bool touching, Gumshoe::Vector3_t normal, float depth)
+{
+	Gumshoe::Physics::AABB::contact_t contact;
+	bool result = Gumshoe::Physics::AABB::Collide(first, second, contact);
+
+	if (result != touching)
+		return false;
+	if (!touching)
+		return true;
+
+	return fabsf(contact.normal.x - normal.x) < 1.0e-4f && fabsf(contact.normal.y - normal.y) < 1.0e-4f &&
+	       fabsf(contact.normal.z - normal.z) < 1.0e-4f && fabsf(contact.depth - depth) < 1.0e-4f;
+}
+
+// Boxes and capsules about the size of a person, on random open tiles, heading off in random directions
+static void SpawnBodies(Gumshoe::Physics::Movement& physics, DungeonFloor* floor, uint32 count, float worldSize, Gumshoe::Random& random)
+{
+	std::vector<int> open;
+	if (floor)
+	{
+		for (int y = 0; y < floor->GetWidth(); y++)
+			for (int x = 0; x < floor->GetLength(); x++)
+				if (!DungeonFloor::IsSolid(floor->GetTile(x, y)))
+					open.push_back(y * floor->GetLength() + x);
+	}
+
+	for (uint32 i = 0; i < count; i++)
+	{
+		Gumshoe::Physics::Movement::bodyDesc_t desc = {};
+		Gumshoe::Vector3_t position;
+		if (floor)
+		{
+			int tile = open[random.RandomInt((int)open.size())];
+			position = Gumshoe::V3((float)(tile % floor->GetLength()) + 0.5f, 0.0f, (float)(tile / floor->GetLength()) + 0.5f);
+		}
+		else
+		{
+			position = Gumshoe::V3(random.RandomFloat() * worldSize, 0.0f, random.RandomFloat() * worldSize);
+		}
+
+		float angle = random.RandomFloat() * 6.2831853f;
+		float speed = 1.0f + random.RandomFloat() * 4.0f;
+		if (i & 1)
+			desc.shape = MakeShape(Gumshoe::Physics::AABB::CapsuleCollider, position, Gumshoe::V3(0.0f, 1.8f, 0.0f), 0.2f);
+		else
+			desc.shape = MakeShape(Gumshoe::Physics::AABB::BoxCollider, position, Gumshoe::V3(0.4f, 1.0f, 0.4f), 0.0f);
+		desc.velocity = Gumshoe::V3(cosf(angle) * speed, 0.0f, sinf(angle) * speed);
+		desc.mass = 1.0f + random.RandomFloat() * 3.0f;
+		desc.drag = 0.1f;
+		physics.CreateBody(desc);
+	}
+}
+
+// Every pair tested against every other, for the broad phase to be checked against
+static uint32 BruteForceContacts(Gumshoe::Physics::Movement& physics, std::vector<Gumshoe::Physics::Movement::bodyContact_t>& contacts)
+{
+	uint32 count = physics.GetBodyCount();
+	const uint32* ids = physics.GetIds();
+	std::vector<Gumshoe::Physics::AABB> shapes(count);
+	Gumshoe::Physics::AABB::contact_t contact;
+
+	for (uint32 i = 0; i < count; i++)
+		physics.GetShape(ids[i], shapes[i]);
+
+	for (uint32 i = 0; i < count; i++)
+	{
+		for (uint32 j = 0; j < count; j++)
+		{
+			if (ids[j] <= ids[i])
+				continue;
+			if (Gumshoe::Physics::AABB::Collide(shapes[i], shapes[j], contact))
+			{
+				Gumshoe::Physics::Movement::bodyContact_t bodyContact = { ids[i], ids[j], contact.normal, contact.depth };
+				contacts.push_back(bodyContact);
+			}
+		}
+	}
+
+	return (uint32)contacts.size();
+}
+
+static bool ContactLess(const Gumshoe::Physics::Movement::bodyContact_t& a, const Gumshoe::Physics::Movement::bodyContact_t& b)
+{
+	return (a.first != b.first) ? (a.first < b.first) : (a.second < b.second);
+}
+
+static void BenchPhysics()
+{
+	typedef Gumshoe::Physics::AABB AABB;
+	const int floorSizes[][4] = { { 96, 96, 60, 1000 }, { 256, 256, 400, 4000 }, { 256, 256, 400, 10000 } };
+	const int steps = 600;
+	const float stepMs = 1000.0f / 60.0f;
+	bool shapesCorrect = true;
+	bool broadPhaseComplete = true;
+	bool neverInWalls = true;
+	bool momentumKept = true;
+	char name[96];
+
+	printf("physics:\n");
+
+	// Narrow phase cases worked out by hand
+	Gumshoe::Vector3_t cube = Gumshoe::V3(1.0f, 1.0f, 1.0f);
+	Gumshoe::Vector3_t tall = Gumshoe::V3(0.0f, 2.0f, 0.0f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::BoxCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), cube, 0.0f),
+	                              MakeShape(AABB::BoxCollider, Gumshoe::V3(0.8f, 0.0f, 0.0f), cube, 0.0f), true, Gumshoe::V3(1.0f, 0.0f, 0.0f), 0.2f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::BoxCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), cube, 0.0f),
+	                              MakeShape(AABB::BoxCollider, Gumshoe::V3(0.0f, 0.0f, -1.5f), cube, 0.0f), false, Gumshoe::V3(0.0f, 0.0f, 0.0f), 0.0f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::BoxCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), cube, 0.0f),
+	                              MakeShape(AABB::BoxCollider, Gumshoe::V3(0.1f, 0.9f, 0.0f), cube, 0.0f), true, Gumshoe::V3(0.0f, 1.0f, 0.0f), 0.1f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::CapsuleCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), tall, 0.5f),
+	                              MakeShape(AABB::CapsuleCollider, Gumshoe::V3(0.6f, 0.0f, 0.0f), tall, 0.5f), true, Gumshoe::V3(1.0f, 0.0f, 0.0f), 0.4f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::CapsuleCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), tall, 0.5f),
+	                              MakeShape(AABB::CapsuleCollider, Gumshoe::V3(0.0f, 1.8f, 0.0f), tall, 0.5f), true, Gumshoe::V3(0.0f, 1.0f, 0.0f), 0.2f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::CapsuleCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), tall, 0.5f),
+	                              MakeShape(AABB::CapsuleCollider, Gumshoe::V3(0.8f, 0.0f, 0.8f), tall, 0.5f), false, Gumshoe::V3(0.0f, 0.0f, 0.0f), 0.0f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::BoxCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), cube, 0.0f),
+	                              MakeShape(AABB::CapsuleCollider, Gumshoe::V3(0.9f, 0.0f, 0.0f), tall, 0.5f), true, Gumshoe::V3(1.0f, 0.0f, 0.0f), 0.1f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::CapsuleCollider, Gumshoe::V3(0.9f, 0.0f, 0.0f), tall, 0.5f),
+	                              MakeShape(AABB::BoxCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), cube, 0.0f), true, Gumshoe::V3(-1.0f, 0.0f, 0.0f), 0.1f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::BoxCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), Gumshoe::V3(4.0f, 4.0f, 4.0f), 0.0f),
+	                              MakeShape(AABB::CapsuleCollider, Gumshoe::V3(1.5f, 1.0f, 0.0f), tall, 0.5f), true, Gumshoe::V3(1.0f, 0.0f, 0.0f), 1.0f);
+	shapesCorrect &= CheckCollide(MakeShape(AABB::BoxCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), cube, 0.0f),
+	                              MakeShape(AABB::CapsuleCollider, Gumshoe::V3(0.0f, 0.8f, 0.0f), tall, 0.5f), true, Gumshoe::V3(0.0f, 1.0f, 0.0f), 0.2f);
+
+	// Head on between two bodies with no grid, gravity or drag: momentum has to come out the same
+	{
+		Gumshoe::Physics::Movement physics;
+		physics.Init(2);
+		physics.SetGravity(0.0f);
+
+		Gumshoe::Physics::Movement::bodyDesc_t desc = {};
+		desc.shape = MakeShape(AABB::BoxCollider, Gumshoe::V3(0.0f, 0.0f, 0.0f), cube, 0.0f);
+		desc.velocity = Gumshoe::V3(3.0f, 0.0f, 0.0f);
+		desc.mass = 1.0f;
+		uint32 first = physics.CreateBody(desc);
+		desc.shape = MakeShape(AABB::CapsuleCollider, Gumshoe::V3(3.0f, 0.0f, 0.2f), tall, 0.5f);
+		desc.velocity = Gumshoe::V3(-1.0f, 0.0f, 0.0f);
+		desc.mass = 3.0f;
+		uint32 second = physics.CreateBody(desc);
+
+		uint32 touched = 0;
+		for (int step = 0; step < 120; step++)
+		{
+			physics.Step(stepMs);
+			touched += (uint32)physics.GetContacts().size();
+		}
+
+		Gumshoe::Vector3_t firstVelocity, secondVelocity;
+		physics.GetVelocity(first, firstVelocity);
+		physics.GetVelocity(second, secondVelocity);
+		Gumshoe::Vector3_t momentum = 1.0f*firstVelocity + 3.0f*secondVelocity;
+		if (touched == 0 || fabsf(momentum.x) > 1.0e-3f || fabsf(momentum.z) > 1.0e-3f)
+			momentumKept = false;
+		printf("  head on, 1 kg at 3 m/s into 3 kg at -1 m/s: %u steps touching, ends at %.3f and %.3f m/s\n",
+		       touched, firstVelocity.x, secondVelocity.x);
+	}
+
+	for (int f = 0; f < (int)(sizeof(floorSizes) / sizeof(floorSizes[0])); f++)
+	{
+		DungeonFloor floor;
+		Gumshoe::Random random(3);
+		floor.Build(random, floorSizes[f][0], floorSizes[f][1], floorSizes[f][2]);
+		uint32 bodyCount = (uint32)floorSizes[f][3];
+
+		std::vector<uint8> solid;
+		floor.GetSolidTiles(solid);
+		Gumshoe::Physics::TileCollider collider;
+		collider.Init(solid.data(), floor.GetLength(), floor.GetWidth());
+
+		Gumshoe::Physics::Movement physics;
+		physics.Init(bodyCount, &collider);
+		SpawnBodies(physics, &floor, bodyCount, 0.0f, random);
+
+		// Walls stop the bodies and they bump into each other for ten seconds
+		uint64 inWalls = 0;
+		double stepTotal = 0.0;
+		for (int step = 0; step < steps; step++)
+		{
+			BenchClock::time_point start = BenchClock::now();
+			physics.Step(stepMs);
+			stepTotal += ElapsedMs(start);
+
+			for (uint32 i = 0; i < physics.GetBodyCount(); i++)
+			{
+				Gumshoe::Physics::AABB shape;
+				physics.GetShape(physics.GetIds()[i], shape);
+				Gumshoe::Vector3_t size = shape.GetSize();
+				inWalls += collider.IsBoxClear(shape.GetPosition(), 0.5f*size) ? 0 : 1;
+			}
+		}
+		if (inWalls != 0)
+			neverInWalls = false;
+
+		// The broad phase has to find every touching pair that testing every pair finds
+		std::vector<Gumshoe::Physics::Movement::bodyContact_t> found, expected;
+		BenchClock::time_point start = BenchClock::now();
+		physics.FindContacts(found);
+		double findMs = ElapsedMs(start);
+		start = BenchClock::now();
+		BruteForceContacts(physics, expected);
+		double bruteMs = ElapsedMs(start);
+
+		std::sort(found.begin(), found.end(), ContactLess);
+		std::sort(expected.begin(), expected.end(), ContactLess);
+		bool same = (found.size() == expected.size());
+		uint32 deep = 0;
+		double totalDepth = 0.0;
+		for (size_t i = 0; same && i < found.size(); i++)
+		{
+			same = (found[i].first == expected[i].first && found[i].second == expected[i].second);
+			deep += (found[i].depth > 0.05f) ? 1 : 0;
+			totalDepth += found[i].depth;
+		}
+		if (!same)
+			broadPhaseComplete = false;
+
+		const Gumshoe::Physics::Movement::physicsStats_t& stats = physics.GetStats();
+		snprintf(name, sizeof(name), "%dx%d, %u bodies, step", floorSizes[f][0], floorSizes[f][1], bodyCount);
+		ReportResult(name, stepTotal, (uint64)steps);
+		snprintf(name, sizeof(name), "%dx%d, %u bodies, find contacts", floorSizes[f][0], floorSizes[f][1], bodyCount);
+		ReportResult(name, findMs, 1);
+		snprintf(name, sizeof(name), "%dx%d, %u bodies, every pair", floorSizes[f][0], floorSizes[f][1], bodyCount);
+		ReportResult(name, bruteMs, 1);
+		printf("    per step: %.1f broad phase pairs, %.1f contacts, %.1f bodies against a wall\n", (double)stats.broadPairs / stats.steps,
+		       (double)stats.contacts / stats.steps, (double)stats.gridContacts / stats.steps);
+		printf("    after the last step: %u pairs still touching, %.4f deep on average, %u deeper than 5 cm, %llu bodies ended a step in a wall\n",
+		       (uint32)found.size(), found.empty() ? 0.0 : totalDepth / found.size(), deep, (unsigned long long)inWalls);
+	}
+
+	printf("  narrow phase cases come out as worked out by hand: %s\n", Check(shapesCorrect));
+	printf("  momentum is kept through a collision: %s\n", Check(momentumKept));
+	printf("  broad phase finds every touching pair: %s\n", Check(broadPhaseComplete));
+	printf("  bodies never end a step inside a wall: %s\n", Check(neverInWalls));
+}
+
+
+//--------------------------------------------
+// Math Benchmark
+//--------------------------------------------
+// Plain loops to check the SIMD versions against, in the same order so the results match exactly
+static Gumshoe::Matrix4_t ReferenceMultiply(const Gumshoe::Matrix4_t& a, const Gumshoe::Matrix4_t& b)
+{
+	Gumshoe::Matrix4_t result;
+
+	for (int row = 0; row < 4; row++)
+		for (int column = 0; column < 4; column++)
+			result.m[row][column] = a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column] +
+			                        a.m[row][2] * b.m[2][column] + a.m[row][3] * b.m[3][column];
+
+	return result;
+}
+
+static Gumshoe::Matrix4_t RandomMatrix(Gumshoe::Random& random)
+{
+	Gumshoe::Matrix4_t result;
+
+	for (int i = 0; i < 16; i++)
+		result.e[i] = random.RandomFloat() * 2.0f - 1.0f;
+
+	return result;
+}
+
+// A rotation, a scale and a translation, the kind of matrix the game inverts
+static Gumshoe::Matrix4_t RandomTransform(Gumshoe::Random& random)
+{
+	Gumshoe::Matrix4_t result = Gumshoe::Matrix4Scaling(0.5f + random.RandomFloat() * 2.0f, 0.5f + random.RandomFloat() * 2.0f, 0.5f + random.RandomFloat() * 2.0f) *
+	                            Gumshoe::Matrix4RotationYawPitchRoll(random.RandomFloat() * 6.28f, random.RandomFloat() * 6.28f, random.RandomFloat() * 6.28f) *
+	                            Gumshoe::Matrix4Translation(random.RandomFloat() * 200.0f - 100.0f, random.RandomFloat() * 20.0f, random.RandomFloat() * 200.0f - 100.0f);
+
+	return result;
+}
+
+static float MatrixDifference(const Gumshoe::Matrix4_t& a, const Gumshoe::Matrix4_t& b)
+{
+	float difference = 0.0f;
+
+	for (int i = 0; i < 16; i++)
+		difference = std::max(difference, fabsf(a.e[i] - b.e[i]));
+
+	return difference;
+}
+
+static float VectorDifference(Gumshoe::Vector3_t a, Gumshoe::Vector3_t b)
+{
+	return std::max(fabsf(a.x - b.x), std::max(fabsf(a.y - b.y), fabsf(a.z - b.z)));
+}
+
+static void BenchMath()
+{
+	const int matrixCount = 1 << 12;
+	const int matrixRounds = 256;
+	const int pointCount = 1 << 20;
+	const int pointRounds = 32;
+	Gumshoe::Random random(25);
+	bool multiplyExact = true;
+	bool batchesExact = true;
+	bool cameraExact = true;
+	float inverseError = 0.0f;
+	float rotationError = 0.0f;
+	char name[96];
+
+	printf("math:\n");
+#if defined(GUMSHOE_MATH_SSE)
+	printf("  lanes: SSE\n");
+#elif defined(GUMSHOE_MATH_NEON)
+	printf("  lanes: NEON\n");
+#else
+	printf("  lanes: scalar\n");
+#endif
+
+	// Matrix products against the plain loop
+	std::vector<Gumshoe::Matrix4_t> matrices(matrixCount), products(matrixCount);
+	for (int i = 0; i < matrixCount; i++)
+		matrices[i] = RandomMatrix(random);
+
+	for (int i = 0; i < matrixCount; i++)
+	{
+		Gumshoe::Matrix4_t simd = matrices[i] * matrices[(i + 1) % matrixCount];
+		Gumshoe::Matrix4_t reference = ReferenceMultiply(matrices[i], matrices[(i + 1) % matrixCount]);
+		multiplyExact &= (memcmp(simd.e, reference.e, sizeof(simd.e)) == 0);
+	}
+
+	BenchClock::time_point start = BenchClock::now();
+	for (int round = 0; round < matrixRounds; round++)
+		for (int i = 0; i < matrixCount; i++)
+			products[i] = ReferenceMultiply(matrices[i], matrices[(i + round) % matrixCount]);
+	double referenceMs = ElapsedMs(start);
+	float checksum = products[matrixCount - 1].e[0];
+
+	start = BenchClock::now();
+	for (int round = 0; round < matrixRounds; round++)
+		for (int i = 0; i < matrixCount; i++)
+			products[i] = matrices[i] * matrices[(i + round) % matrixCount];
+	double simdMs = ElapsedMs(start);
+	checksum += products[matrixCount - 1].e[0];
+
+	ReportResult("matrix multiply, plain loop", referenceMs, (uint64)matrixCount * matrixRounds);
+	ReportResult("matrix multiply, lanes", simdMs, (uint64)matrixCount * matrixRounds);
+
+	// Inverses of transforms and of random matrices, the product with the matrix has to come back to identity
+	std::vector<Gumshoe::Matrix4_t> transforms(matrixCount), inverses(matrixCount);
+	for (int i = 0; i < matrixCount; i++)
+		transforms[i] = RandomTransform(random);
+
+	uint32 inverted = 0;
+	start = BenchClock::now();
+	for (int round = 0; round < matrixRounds; round++)
+		for (int i = 0; i < matrixCount; i++)
+			inverted += Gumshoe::Inverse(transforms[i], inverses[i]) ? 1 : 0;
+	double inverseMs = ElapsedMs(start);
+	ReportResult("matrix inverse", inverseMs, (uint64)matrixCount * matrixRounds);
+
+	Gumshoe::Matrix4_t inverse;
+	float randomInverseError = 0.0f;
+	for (int i = 0; i < matrixCount; i++)
+	{
+		inverseError = std::max(inverseError, MatrixDifference(transforms[i] * inverses[i], Gumshoe::Matrix4Identity()));
+		if (Gumshoe::Inverse(matrices[i], inverse))
+			randomInverseError = std::max(randomInverseError, MatrixDifference(matrices[i] * inverse, Gumshoe::Matrix4Identity()));
+	}
+
+	Gumshoe::Matrix4_t singular = Gumshoe::Matrix4Scaling(1.0f, 0.0f, 1.0f);
+	bool singularRefused = !Gumshoe::Inverse(singular, inverse);
+
+	// Quaternions against the matrices that rotate the same way
+	for (int i = 0; i < 1024; i++)
+	{
+		float yaw = random.RandomFloat() * 6.28f, pitch = random.RandomFloat() * 6.28f, roll = random.RandomFloat() * 6.28f;
+		Gumshoe::Quaternion_t first = Gumshoe::QuaternionRotationYawPitchRoll(yaw, pitch, roll);
+		Gumshoe::Quaternion_t second = Gumshoe::QuaternionRotationAxis(Gumshoe::V3(random.RandomFloat(), 1.0f, random.RandomFloat()), random.RandomFloat() * 6.28f);
+		Gumshoe::Vector3_t v = Gumshoe::V3(random.RandomFloat() * 10.0f, random.RandomFloat() * 10.0f, random.RandomFloat() * 10.0f);
+
+		rotationError = std::max(rotationError, MatrixDifference(Gumshoe::Matrix4RotationQuaternion(first), Gumshoe::Matrix4RotationYawPitchRoll(yaw, pitch, roll)));
+		rotationError = std::max(rotationError, MatrixDifference(Gumshoe::Matrix4RotationQuaternion(first * second),
+		                                                         Gumshoe::Matrix4RotationQuaternion(first) * Gumshoe::Matrix4RotationQuaternion(second)));
+		rotationError = std::max(rotationError, VectorDifference(Gumshoe::Rotate(v, first), Gumshoe::TransformNormal(v, Gumshoe::Matrix4RotationQuaternion(first))) / 10.0f);
+		rotationError = std::max(rotationError, VectorDifference(Gumshoe::Rotate(Gumshoe::Rotate(v, first), Gumshoe::Conjugate(first)), v) / 10.0f);
+
+		// Halfway along the slerp is half the rotation
+		Gumshoe::Quaternion_t half = Gumshoe::Slerp(Gumshoe::QuaternionIdentity(), second, 0.5f);
+		rotationError = std::max(rotationError, MatrixDifference(Gumshoe::Matrix4RotationQuaternion(half * half), Gumshoe::Matrix4RotationQuaternion(second)));
+	}
+	rotationError = std::max(rotationError, MatrixDifference(Gumshoe::Matrix4RotationQuaternion(Gumshoe::QuaternionRotationAxis(Gumshoe::V3(1.0f, 0.0f, 0.0f), 0.7f)), Gumshoe::Matrix4RotationX(0.7f)));
+	rotationError = std::max(rotationError, MatrixDifference(Gumshoe::Matrix4RotationQuaternion(Gumshoe::QuaternionRotationAxis(Gumshoe::V3(0.0f, 1.0f, 0.0f), 0.7f)), Gumshoe::Matrix4RotationY(0.7f)));
+	rotationError = std::max(rotationError, MatrixDifference(Gumshoe::Matrix4RotationQuaternion(Gumshoe::QuaternionRotationAxis(Gumshoe::V3(0.0f, 0.0f, 1.0f), 0.7f)), Gumshoe::Matrix4RotationZ(0.7f)));
+
+	// The camera matrices match the ones the frustum benchmark builds by hand the D3DX way
+	float view[16], projection[16];
+	Gumshoe::Vector3_t eye = Gumshoe::V3(256.0f, 40.0f, 256.0f);
+	Gumshoe::Vector3_t at = Gumshoe::V3(1024.0f, 0.0f, 1024.0f);
+	BuildCameraMatrices(eye, at, view, projection);
+	Gumshoe::Matrix4_t lookAt = Gumshoe::Matrix4LookAtLH(eye, at, Gumshoe::V3(0.0f, 1.0f, 0.0f));
+	Gumshoe::Matrix4_t perspective = Gumshoe::Matrix4PerspectiveFovLH(3.14159265f / 4.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+	cameraExact = (memcmp(lookAt.e, view, sizeof(view)) == 0) && (memcmp(perspective.e, projection, sizeof(projection)) == 0);
+
+	// Point batches against one point at a time
+	std::vector<float> x(pointCount), y(pointCount), z(pointCount), outX(pointCount), outY(pointCount), outZ(pointCount), outW(pointCount), dots(pointCount);
+	for (int i = 0; i < pointCount; i++)
+	{
+		x[i] = random.RandomFloat() * 2048.0f;
+		y[i] = random.RandomFloat() * 8.0f;
+		z[i] = random.RandomFloat() * 2048.0f;
+	}
+	Gumshoe::Matrix4_t viewProjection = lookAt * perspective;
+	Gumshoe::Plane_t plane = Gumshoe::PlaneNormalize(Gumshoe::PlaneFromPointNormal(eye, Gumshoe::V3(1.0f, 0.2f, 1.0f)));
+
+	// Odd counts leave a tail for the one by one loop
+	Gumshoe::TransformPoints(viewProjection, x.data(), y.data(), z.data(), pointCount - 3, outX.data(), outY.data(), outZ.data(), outW.data());
+	Gumshoe::DotProducts(x.data(), y.data(), z.data(), z.data(), x.data(), y.data(), pointCount - 3, dots.data());
+	for (int i = 0; i < pointCount - 3; i++)
+	{
+		Gumshoe::Vector4_t single = Gumshoe::Transform(Gumshoe::V4(x[i], y[i], z[i], 1.0f), viewProjection);
+		batchesExact &= (single.x == outX[i] && single.y == outY[i] && single.z == outZ[i] && single.w == outW[i]);
+		batchesExact &= (dots[i] == Gumshoe::Inner(Gumshoe::V3(x[i], y[i], z[i]), Gumshoe::V3(z[i], x[i], y[i])));
+	}
+	Gumshoe::PlaneDistances(plane, x.data(), y.data(), z.data(), pointCount - 3, dots.data());
+	for (int i = 0; i < pointCount - 3; i++)
+		batchesExact &= (dots[i] == Gumshoe::PlaneDotCoord(plane, Gumshoe::V3(x[i], y[i], z[i])));
+
+	start = BenchClock::now();
+	for (int round = 0; round < pointRounds; round++)
+	{
+		for (int i = 0; i < pointCount; i++)
+		{
+			Gumshoe::Vector4_t point = Gumshoe::V4(x[i], y[i], z[i], 1.0f);
+			float transformed[4];
+			for (int column = 0; column < 4; column++)
+				transformed[column] = point.x * viewProjection.m[0][column] + point.y * viewProjection.m[1][column] +
+				                      point.z * viewProjection.m[2][column] + point.w * viewProjection.m[3][column];
+			outX[i] = transformed[0];
+			outY[i] = transformed[1];
+			outZ[i] = transformed[2];
+			outW[i] = transformed[3];
+		}
+	}
+	referenceMs = ElapsedMs(start);
+	checksum += outW[pointCount / 2];
+
+	start = BenchClock::now();
+	for (int round = 0; round < pointRounds; round++)
+		Gumshoe::TransformPoints(viewProjection, x.data(), y.data(), z.data(), pointCount, outX.data(), outY.data(), outZ.data(), outW.data());
+	simdMs = ElapsedMs(start);
+	checksum += outW[pointCount / 2];
+
+	snprintf(name, sizeof(name), "%d points, one at a time", pointCount);
+	ReportResult(name, referenceMs, (uint64)pointCount * pointRounds);
+	snprintf(name, sizeof(name), "%d points, TransformPoints", pointCount);
+	ReportResult(name, simdMs, (uint64)pointCount * pointRounds);
+
+	start = BenchClock::now();
+	for (int round = 0; round < pointRounds; round++)
+		for (int i = 0; i < pointCount; i++)
+			dots[i] = Gumshoe::PlaneDotCoord(plane, Gumshoe::V3(x[i], y[i], z[i]));
+	referenceMs = ElapsedMs(start);
+	checksum += dots[pointCount / 2];
+
+	start = BenchClock::now();
+	for (int round = 0; round < pointRounds; round++)
+		Gumshoe::PlaneDistances(plane, x.data(), y.data(), z.data(), pointCount, dots.data());
+	simdMs = ElapsedMs(start);
+	checksum += dots[pointCount / 2];
+
+	snprintf(name, sizeof(name), "%d plane distances, one at a time", pointCount);
+	ReportResult(name, referenceMs, (uint64)pointCount * pointRounds);
+	snprintf(name, sizeof(name), "%d plane distances, PlaneDistances", pointCount);
+	ReportResult(name, simdMs, (uint64)pointCount * pointRounds);
+
+	printf("    (checksum %g)\n", checksum);
+	printf("  inverse times matrix is off identity by %.2e for transforms, %.2e for random matrices, singular matrix refused: %s\n",
+	       inverseError, randomInverseError, Check(singularRefused));
+	printf("  every transform inverted: %s\n", Check(inverted == (uint32)matrixCount * matrixRounds));
+	printf("  quaternions and matrices rotate the same way, largest difference %.2e\n", rotationError);
+	printf("  matrix products match the plain loop exactly: %s\n", Check(multiplyExact));
+	printf("  batches match one at a time exactly: %s\n", Check(batchesExact));
+	printf("  look at and perspective match the D3DX formulas exactly: %s\n", Check(cameraExact));
+}
+
+
+//--------------------------------------------
+// Benchmark Table
+//--------------------------------------------
+struct benchmark_t
+{
+	const char* name;
+	void (*function)();
+};
+
+static const benchmark_t g_benchmarks[] =
+{
+	{ "random", BenchRandom },
+	{ "generate", BenchGenerate },
+	{ "chunks", BenchChunks },
+	{ "floors", BenchFloors },
+	{ "classify", BenchClassify },
+	{ "layout", BenchLayout },
+	{ "mesh", BenchMesh },
+	{ "geometry", BenchGeometry },
+	{ "quadtree", BenchQuadTree },
+	{ "frustum", BenchFrustum },
+	{ "cull", BenchCull },
+	{ "dynamic", BenchDynamic },
+	{ "entities", BenchEntities },
+	{ "collision", BenchCollision },
+	{ "store", BenchStore },
+	{ "replay", BenchReplay },
+	{ "physics", BenchPhysics },
+	{ "math", BenchMath },
+};
+
+
+int main(int argc, char** argv)
+{
+	int count = sizeof(g_benchmarks) / sizeof(g_benchmarks[0]);
+	bool found = false;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (argc < 2 || strcmp(argv[1], g_benchmarks[i].name) == 0)
+		{
+			g_benchmarks[i].function();
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		printf("Unknown benchmark '%s'\n", argv[1]);
+		return -1;
+	}
+
+	return g_checkFailed ? 1 : 0;
+}
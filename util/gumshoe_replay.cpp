@@ -0,0 +1,112 @@
+/*!
+  @file
+  gumshoe_replay.cpp
+
+  @brief
+  Headless replay of a recorded game session.
+
+  @detail
+  Builds the floor the session was played on from the log's seed and
+  window, and runs the session's fixed steps from its input as fast as
+  they will go.
+  Usage: gumshoe_replay [log file] [replay count]
+  Every replay has to end in the same state, the state hash is printed so
+  it can be compared with other builds and machines.
+*/
+
+
+//--------------------------------------------
+// Includes
+//--------------------------------------------
+#include "gumshoe_typedefs.h"
+#include "gumshoe_math.h"
+#include "dungeon_floor.h"
+#include "physics_tile_collider.h"
+#include "entity_store.h"
+#include "physics_movement.h"
+#include "input_log.h"
+#include "game_sim.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main(int argc, char** argv)
+{
+	const char* filename = (argc > 1) ? argv[1] : "last_session.gil";
+	int replayCount = (argc > 2) ? atoi(argv[2]) : 1;
+	Gumshoe::InputLog log;
+	bool sameState = true;
+	uint64 firstHash = 0;
+	double totalMs = 0.0;
+
+
+	if (!log.Load(filename))
+	{
+		printf("could not load the input log %s\n", filename);
+		return 1;
+	}
+
+	const Gumshoe::InputLog::logHeader_t& header = log.GetHeader();
+	printf("%s: seed %llu, floor %u at (%d, %d), %u steps of %.3f ms (%.1f s), %u bytes of input\n", filename,
+	       (unsigned long long)header.seed, header.floor, header.windowX, header.windowZ, header.stepCount, header.stepMs,
+	       header.stepCount * header.stepMs / 1000.0f, log.GetSize());
+
+	// The same window of chunks GameWorld::LoadFloor builds
+	ChunkedWorld chunks;
+	chunks.Init(header.seed, DEFAULT_CHUNK_BUDGET);
+
+	DungeonFloor floor;
+	if (!floor.Build(chunks, (int)header.floor, header.windowX, header.windowZ, CHUNK_WINDOW * CHUNK_SIZE, CHUNK_WINDOW * CHUNK_SIZE))
+	{
+		printf("could not build floor %u: %s\n", header.floor, floor.GetError());
+		return 1;
+	}
+
+	std::vector<uint8> solid;
+	floor.GetSolidCells(solid);
+	Gumshoe::Physics::TileCollider collider;
+	collider.Init(solid.data(), floor.GetLength() * COLLIDER_CELLS_PER_TILE, floor.GetWidth() * COLLIDER_CELLS_PER_TILE,
+	              COLLIDER_CELLS_PER_TILE);
+
+	for (int replay = 0; replay < replayCount; replay++)
+	{
+		Gumshoe::EntityStore entities;
+		Gumshoe::Physics::Movement physics;
+		GameSim sim;
+		Gumshoe::InputLog::simInput_t input;
+
+		// The same entity store and rigid bodies GameWorld gives the game's simulation
+		entities.Init(MAX_WORLD_ENTITIES);
+		physics.Init(MAX_WORLD_BODIES, &collider);
+		sim.Init(&collider, &entities, Gumshoe::V3(header.spawnX, header.spawnY, header.spawnZ), header.stepMs, &physics);
+		log.StartReplay();
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		while (log.Replay(input))
+			sim.Step(input);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		totalMs += elapsed.count();
+
+		uint64 hash = sim.GetStateHash();
+		if (replay == 0)
+		{
+			Gumshoe::Vector3_t position;
+			sim.GetPlayerPosition(1.0f, position);
+			printf("player ends at (%.3f, %.3f, %.3f), state hash %016llx\n", position.x, position.y, position.z, (unsigned long long)hash);
+			firstHash = hash;
+		}
+		else if (hash != firstHash)
+		{
+			sameState = false;
+		}
+	}
+
+	printf("%d replays, %.3f ms each, %.0f steps/s (%.0fx real time)\n", replayCount, totalMs / replayCount,
+	       (totalMs > 0.0) ? (1000.0 * header.stepCount * replayCount) / totalMs : 0.0,
+	       (totalMs > 0.0) ? (header.stepCount * header.stepMs * replayCount) / totalMs : 0.0);
+	if (replayCount > 1)
+		printf("every replay ends in the same state: %s\n", sameState ? "yes" : "NO");
+
+	return sameState ? 0 : 1;
+}